@@ -1,3 +1,5 @@
+import type { ParsedField } from './packet-reader'
+
 export interface NetworkInterface {
   name: string
   friendlyName: string
@@ -7,6 +9,7 @@ export interface NetworkInterface {
 export interface PacketInfo {
   index: number
   timestamp: number
+  timestampNs?: string  // integer ns since epoch, as a string (beyond JS safe integers)
   length: number
   hexDump: string
   outbound: boolean
@@ -36,6 +39,48 @@ export interface SessionMeta {
   serverPort: number
   timestamp: number
   dead: boolean
+  restored?: boolean
+  tcp?: SessionTcpStats
+}
+
+export interface TcpDirectionStats {
+  segments: number
+  bytes: number
+  retransmittedBytes: number
+  outOfOrderSegments: number
+  replacements: number
+  holes: number
+  holeTotalNs: number
+  holeMaxNs: number
+  sizeBuckets: number[]   // <=64, <=128, <=256, <=512, <=1024, <=1460, <=4096, larger
+}
+
+export interface SessionTcpStats {
+  rttNs: number           // -1 when the SYN/SYN-ACK was not captured
+  inbound: TcpDirectionStats
+  outbound: TcpDirectionStats
+}
+
+export interface CaptureFlow {
+  index: number
+  client: string
+  server: string
+  serverPort: number
+  frames: number
+  bytes: number
+  firstTimestamp: number
+  lastTimestamp: number
+  hasHandshake: boolean
+  version?: number
+  subVersion?: string
+  locale?: number
+  handshakeFrame?: number
+}
+
+export interface CaptureIndex {
+  path: string
+  frameCount: number
+  flows: CaptureFlow[]
 }
 
 export interface ScriptEntry {
@@ -84,6 +129,425 @@ export async function getSessions(): Promise<SessionMeta[]> {
   return (await fetch('/api/sessions')).json()
 }
 
+export interface StageStats {
+  count: number
+  meanNs: number
+  minNs: number
+  p50Ns: number
+  p90Ns: number
+  p99Ns: number
+  p999Ns: number
+  maxNs: number
+}
+
+export interface PipelineStats {
+  stages: Record<'capture' | 'reassembly' | 'decrypt' | 'store' | 'delivery', StageStats>
+  counters: Record<string, number>
+}
+
+export async function getPipelineStats(): Promise<PipelineStats> {
+  if (isSaucer) return JSON.parse(await (window as any).saucer.exposed.getPipelineStats())
+  return (await fetch('/api/pipeline-stats')).json()
+}
+
+// Every occurrence of a 2/4/8-byte little-endian value across stored packets
+export interface ValueMatch {
+  seq: number          // packet index (offline: index in the decoded capture)
+  offset: number       // byte offset in the payload
+  opcode: string
+  opcodeRaw: number
+  outbound: boolean
+  sessionId: number
+}
+
+export interface ValueMatches {
+  error?: string
+  width: number
+  total: number
+  common: boolean          // too frequent to list everywhere: matches incomplete
+  indexedFromSeq: number   // older packets dropped out of the index
+  matches: ValueMatch[]
+}
+
+export async function findValue(hexBytes: string, offline = false, limit = 1000): Promise<ValueMatches> {
+  if (isSaucer) return JSON.parse(await (window as any).saucer.exposed.findValue(hexBytes, offline, limit))
+  const params = new URLSearchParams({ value: hexBytes, offline: String(offline), limit: String(limit) })
+  return (await fetch(`/api/find-value?${params}`)).json()
+}
+
+// Per payload byte position of one opcode (index = position), updated live
+export interface ByteVariability {
+  packets: number
+  samples: number[]    // packets long enough to have the byte
+  min: number[]
+  max: number[]
+  distinct: number[]   // distinct byte values seen
+  entropy: number[]    // bits, 0..8
+}
+
+export async function getByteVariability(direction: 'send' | 'recv', opcode: number): Promise<ByteVariability> {
+  if (isSaucer) return JSON.parse(await (window as any).saucer.exposed.getByteVariability(direction, opcode))
+  const params = new URLSearchParams({ direction, opcode: String(opcode) })
+  return (await fetch(`/api/byte-variability?${params}`)).json()
+}
+
+// Shared-memory ring that external tools read decoded packets from (sdk/maple_ring.h)
+export interface SharedRingStatus {
+  open: boolean
+  name: string
+  capacity: number    // data bytes
+  published: number   // records since this sniffer started
+  truncated: number   // payloads cut to half the ring
+  nextSeq: number
+}
+
+export async function getSharedRingStatus(): Promise<SharedRingStatus> {
+  if (isSaucer) return JSON.parse(await (window as any).saucer.exposed.getSharedRingStatus())
+  return (await fetch('/api/shared-ring')).json()
+}
+
+// Packet sinks: every decoded packet is queued to each sink's own thread.
+// File paths are directories (relative = next to the exe); a stream path is a
+// pipe name on Windows (\\.\pipe\<path>) or a Unix socket path elsewhere.
+export interface SinkConfig {
+  name: string
+  kind: 'binary' | 'ndjson' | 'stream'
+  policy?: 'dropNewest' | 'dropOldest' | 'block'   // when the queue is full
+  path?: string
+  prefix?: string       // file name prefix (default: name)
+  rotateMB?: number     // files: start a new one past this size
+  keepFiles?: number    // files: rotated files kept (0 = all)
+  json?: boolean        // stream: NDJSON instead of binary records
+  queueMB?: number
+  blockMs?: number      // 'block': longest wait for queue room
+}
+
+export interface SinkStatus extends Required<SinkConfig> {
+  accepted: number
+  written: number
+  dropped: number       // queue full
+  failed: number        // write failed or no stream consumer connected
+  batches: number
+  queuedBytes: number
+}
+
+export async function getSinks(): Promise<SinkStatus[]> {
+  if (isSaucer) return JSON.parse(await (window as any).saucer.exposed.getSinks())
+  return (await fetch('/api/sinks')).json()
+}
+
+export async function saveSinks(sinks: SinkConfig[]): Promise<boolean> {
+  if (isSaucer) return await (window as any).saucer.exposed.saveSinks(JSON.stringify(sinks))
+  const res = await fetch('/api/sinks', {
+    method: 'POST',
+    headers: { 'Content-Type': 'application/json' },
+    body: JSON.stringify(sinks)
+  })
+  const data = await res.json()
+  return data.success
+}
+
+// Chrome trace-event recording (open the written file in chrome://tracing or Perfetto)
+export async function startTrace(): Promise<boolean> {
+  if (isSaucer) return await (window as any).saucer.exposed.startTrace()
+  return (await fetch('/api/trace/start', { method: 'POST' })).ok
+}
+
+export async function stopTrace(): Promise<{ path?: string }> {
+  if (isSaucer) return JSON.parse(await (window as any).saucer.exposed.stopTrace())
+  return (await fetch('/api/trace/stop', { method: 'POST' })).json()
+}
+
+export interface OpcodePairConfig {
+  name?: string
+  request: number | string   // number or "0x0027"
+  response: number | string
+  timeoutMs?: number
+}
+
+export interface LatencySummary {
+  startNs?: string
+  count: number
+  meanNs: number
+  p50Ns: number
+  p90Ns: number
+  p99Ns: number
+  maxNs: number
+}
+
+export interface PairLatency {
+  name: string
+  request: string
+  response: string
+  locale: number
+  version: number
+  unanswered: number
+  total: LatencySummary
+  series: LatencySummary[]   // one entry per minute of capture time
+}
+
+export async function getOpcodePairs(locale: number, version: number): Promise<OpcodePairConfig[]> {
+  if (isSaucer) return JSON.parse(await (window as any).saucer.exposed.getOpcodePairs(locale, version))
+  return (await fetch(`/api/opcode-pairs?locale=${locale}&version=${version}`)).json()
+}
+
+export async function saveOpcodePairs(locale: number, version: number, pairs: OpcodePairConfig[]): Promise<boolean> {
+  if (isSaucer) return await (window as any).saucer.exposed.saveOpcodePairs(locale, version, JSON.stringify(pairs))
+  const res = await fetch('/api/opcode-pairs', {
+    method: 'POST',
+    headers: { 'Content-Type': 'application/json' },
+    body: JSON.stringify({ locale, version, pairs })
+  })
+  const data = await res.json()
+  return data.success
+}
+
+export async function getResponseLatency(): Promise<PairLatency[]> {
+  if (isSaucer) return JSON.parse(await (window as any).saucer.exposed.getResponseLatency())
+  return (await fetch('/api/response-latency')).json()
+}
+
+// Watch rules: opcode set + byte patterns, matched natively against every decoded packet
+export interface WatchRuleConfig {
+  name?: string
+  direction?: 'in' | 'out' | 'any'
+  opcodes?: (number | string)[]                     // empty/omitted = any opcode
+  patterns?: { bytes: string, offset?: number }[]   // hex like "0A 00 FF"; offset omitted = anywhere
+}
+
+export interface WatchEvent {
+  seq: number
+  rule: string
+  locale: number
+  version: number
+  sessionId: number
+  timestampNs: string
+  outbound: boolean
+  opcode: string
+  opcodeRaw: number
+  length: number
+}
+
+export interface WatchRuleStats {
+  rule: string
+  locale: number
+  version: number
+  hits: number
+  lastNs: string
+}
+
+export async function getWatchRules(locale: number, version: number): Promise<WatchRuleConfig[]> {
+  if (isSaucer) return JSON.parse(await (window as any).saucer.exposed.getWatchRules(locale, version))
+  return (await fetch(`/api/watch-rules?locale=${locale}&version=${version}`)).json()
+}
+
+export async function saveWatchRules(locale: number, version: number, rules: WatchRuleConfig[]): Promise<boolean> {
+  if (isSaucer) return await (window as any).saucer.exposed.saveWatchRules(locale, version, JSON.stringify(rules))
+  const res = await fetch('/api/watch-rules', {
+    method: 'POST',
+    headers: { 'Content-Type': 'application/json' },
+    body: JSON.stringify({ locale, version, rules })
+  })
+  const data = await res.json()
+  return data.success
+}
+
+// Matches with seq >= since; pass the returned next on the following poll
+// Declarative opcode layouts (scripts/<locale>_<version>/layouts.json), extracted natively
+// from every captured packet into typed columns
+export interface LayoutField {
+  name: string
+  type: 'byte' | 'short' | 'int' | 'long' | 'filetime' | 'string' | 'fixedstring' | 'bytes' | 'skip' | 'array' | 'object'
+  signed?: boolean
+  length?: number                            // fixedstring/bytes/skip
+  count?: number | 'byte' | 'short' | 'int'  // array: fixed count or prefix width (default 'short')
+  fields?: LayoutField[]                     // array element / object members
+}
+
+export interface OpcodeLayouts {
+  send: Record<string, LayoutField[]>   // key: opcode, decimal or "0x0031"
+  recv: Record<string, LayoutField[]>
+}
+
+export interface FieldColumnInfo {
+  name: string      // "obj.field", "arr[].field"
+  type: 'int' | 'filetime' | 'string' | 'bytes'
+  rows: number
+}
+
+export interface FieldLayoutStats {
+  locale: number
+  version: number
+  direction: 'send' | 'recv'
+  opcode: string
+  opcodeRaw: number
+  parsed: number
+  failed: number    // payload did not fit the layout
+  columns: FieldColumnInfo[]
+}
+
+export interface FieldQueryResult {
+  rows: number
+  truncated: boolean
+  keptFrom: number    // rows of earlier packets were dropped (memory budget)
+  matches: number[]   // packet indexes, as in PacketInfo.index (offline: index in the decoded capture)
+}
+
+export async function getLayouts(locale: number, version: number): Promise<OpcodeLayouts> {
+  if (isSaucer) return JSON.parse(await (window as any).saucer.exposed.getLayouts(locale, version))
+  return (await fetch(`/api/layouts?locale=${locale}&version=${version}`)).json()
+}
+
+export async function saveLayouts(locale: number, version: number, layouts: OpcodeLayouts): Promise<boolean> {
+  if (isSaucer) return await (window as any).saucer.exposed.saveLayouts(locale, version, JSON.stringify(layouts))
+  const res = await fetch('/api/layouts', {
+    method: 'POST',
+    headers: { 'Content-Type': 'application/json' },
+    body: JSON.stringify({ locale, version, layouts })
+  })
+  const data = await res.json()
+  return data.success
+}
+
+// (offline: the store loaded by decodeCapture/loadTriggerCapture/importMsb, extracted on first use)
+export async function getFieldColumns(offline = false): Promise<FieldLayoutStats[]> {
+  if (isSaucer) return JSON.parse(await (window as any).saucer.exposed.getFieldColumns(offline))
+  return (await fetch(`/api/field-columns?offline=${offline}`)).json()
+}
+
+// e.g. queryFields(8, 95, 'recv', 0x7D, 'mapId', '==', '100000000'). Values are integers
+// (decimal or 0x), hex bytes for bytes columns, or text. Returns {} for an unknown column.
+export async function queryFields(locale: number, version: number, direction: string, opcode: number,
+                                  column: string, op: '==' | '!=' | '<' | '<=' | '>' | '>=' | 'contains',
+                                  value: string, offline = false, limit = 10000): Promise<FieldQueryResult> {
+  if (isSaucer) return JSON.parse(await (window as any).saucer.exposed.queryFields(locale, version, direction, opcode, column, op, value, offline, limit))
+  return (await fetch(`/api/field-query?locale=${locale}&version=${version}&direction=${direction}&opcode=${opcode}&column=${encodeURIComponent(column)}&op=${encodeURIComponent(op)}&value=${encodeURIComponent(value)}&offline=${offline}&limit=${limit}`)).json()
+}
+
+export async function getWatchEvents(since: number): Promise<{ next: number, events: WatchEvent[] }> {
+  if (isSaucer) return JSON.parse(await (window as any).saucer.exposed.getWatchEvents(since))
+  return (await fetch(`/api/watch-events?since=${since}`)).json()
+}
+
+export async function getWatchStats(): Promise<WatchRuleStats[]> {
+  if (isSaucer) return JSON.parse(await (window as any).saucer.exposed.getWatchStats())
+  return (await fetch('/api/watch-stats')).json()
+}
+
+// Oscilloscope-style capture: keep the last preSeconds in memory, persist them plus
+// postSeconds after a trigger fires
+export interface CaptureTriggerConfig {
+  name?: string
+  kind: 'opcode' | 'pattern' | 'dead'
+  direction?: 'in' | 'out' | 'any'
+  opcode?: number | string   // required for 'opcode', optional filter for 'pattern'
+  pattern?: string           // 'pattern': hex bytes like "0A 00 FF", anywhere in the payload
+}
+
+export interface TriggerSettings {
+  preSeconds?: number        // default 30
+  postSeconds?: number       // default 30
+  rawFrames?: boolean        // also write the captured frames as .pcap
+  maxRingMB?: number         // default 64
+  triggers: CaptureTriggerConfig[]   // empty = disarmed
+}
+
+export interface TriggerEventInfo {
+  trigger: string
+  sessionId: number
+  timestampNs: string
+  packets: number
+  frames: number
+  packetsPath: string
+  pcapPath: string
+}
+
+export interface TriggerStatus {
+  state: 'idle' | 'armed' | 'recording'
+  ringPackets: number
+  ringFrames: number
+  ringBytes: number
+  events: TriggerEventInfo[]
+}
+
+export async function configureTrigger(settings: TriggerSettings): Promise<boolean> {
+  if (isSaucer) return await (window as any).saucer.exposed.configureTrigger(JSON.stringify(settings))
+  const res = await fetch('/api/trigger', {
+    method: 'POST',
+    headers: { 'Content-Type': 'application/json' },
+    body: JSON.stringify(settings)
+  })
+  const data = await res.json()
+  return data.success
+}
+
+export async function getTriggerStatus(): Promise<TriggerStatus> {
+  if (isSaucer) return JSON.parse(await (window as any).saucer.exposed.getTriggerStatus())
+  return (await fetch('/api/trigger')).json()
+}
+
+// Load a saved trigger window; page through it with getCapturePackets()
+export async function loadTriggerCapture(path: string): Promise<{ path?: string, packetCount?: number }> {
+  if (isSaucer) return JSON.parse(await (window as any).saucer.exposed.loadTriggerCapture(path))
+  return (await fetch(`/api/trigger-capture?path=${encodeURIComponent(path)}`)).json()
+}
+
+// Opcodes dropped right after decryption (never stored or sent to the UI, still counted)
+export interface SuppressionRules {
+  send: (number | string)[]   // number or "0x0027"
+  recv: (number | string)[]
+}
+
+export interface SuppressedOpcode {
+  sessionId: number
+  outbound: boolean
+  opcode: string
+  opcodeRaw: number
+  packets: number
+  bytes: number
+}
+
+export async function getSuppressionRules(locale: number, version: number): Promise<SuppressionRules> {
+  if (isSaucer) return JSON.parse(await (window as any).saucer.exposed.getSuppressionRules(locale, version))
+  return (await fetch(`/api/suppression?locale=${locale}&version=${version}`)).json()
+}
+
+export async function saveSuppressionRules(locale: number, version: number, rules: SuppressionRules): Promise<boolean> {
+  if (isSaucer) return await (window as any).saucer.exposed.saveSuppressionRules(locale, version, JSON.stringify(rules))
+  const res = await fetch('/api/suppression', {
+    method: 'POST',
+    headers: { 'Content-Type': 'application/json' },
+    body: JSON.stringify({ locale, version, rules })
+  })
+  const data = await res.json()
+  return data.success
+}
+
+export async function getSuppressionStats(): Promise<SuppressedOpcode[]> {
+  if (isSaucer) return JSON.parse(await (window as any).saucer.exposed.getSuppressionStats())
+  return (await fetch('/api/suppression-stats')).json()
+}
+
+export interface BandwidthOpcode {
+  opcode: number
+  packets: number
+  bytes: number
+  charted: boolean   // one of the top opcodes with its own series
+}
+
+export interface BandwidthTimeline {
+  resolution: number                    // bucket width in seconds (1, 10 or 60), 0 if no data
+  points: [number, number, number][]    // [bucket start (unix s), packets, bytes]; divide by resolution for rates
+  opcodes: BandwidthOpcode[]            // totals of the direction, largest first
+}
+
+// Traffic history of one session direction; opcode -1 = all opcodes, resolution 0 = automatic
+export async function getBandwidthTimeline(sessionId: number, direction: 'in' | 'out', opcode: number,
+                                           fromSec: number, toSec: number, resolution = 0): Promise<BandwidthTimeline> {
+  if (isSaucer) return JSON.parse(await (window as any).saucer.exposed.getBandwidthTimeline(sessionId, direction, opcode, fromSec, toSec, resolution))
+  return (await fetch(`/api/bandwidth-timeline?session=${sessionId}&direction=${direction}&opcode=${opcode}&from=${fromSec}&to=${toSec}&resolution=${resolution}`)).json()
+}
+
 export async function getScript(direction: string, opcode: number, locale: number, version: number): Promise<string> {
   if (isSaucer) return await (window as any).saucer.exposed.getScript(direction, opcode, locale, version)
   const res = await fetch(`/api/script?direction=${direction}&opcode=${opcode}&locale=${locale}&version=${version}`)
@@ -101,6 +565,55 @@ export async function saveScript(direction: string, opcode: number, code: string
   return data.success
 }
 
+export interface BulkScriptResult {
+  index: number            // packet index (live seq, or position in the decoded capture)
+  success: boolean
+  error?: string
+  fields: ParsedField[]
+}
+
+export interface BulkScriptRun {
+  error?: string           // script did not compile
+  packets: number
+  failed: number
+  seconds: number
+  results: BulkScriptResult[]
+}
+
+// Run the saved script of one opcode natively over every buffered packet of it
+// (sessionId -1 = all sessions; offline: the store loaded by decodeCapture/loadTriggerCapture)
+export async function runScriptBulk(direction: string, opcode: number, locale: number, version: number,
+                                    offline = false, sessionId = -1, limit = 10000): Promise<BulkScriptRun> {
+  if (isSaucer) return JSON.parse(await (window as any).saucer.exposed.runScriptBulk(direction, opcode, locale, version, offline, sessionId, limit))
+  return (await fetch(`/api/script-bulk?direction=${direction}&opcode=${opcode}&locale=${locale}&version=${version}&offline=${offline}&sessionId=${sessionId}&limit=${limit}`)).json()
+}
+
+export interface InferredField {
+  kind: 'byte' | 'short' | 'int' | 'long' | 'filetime' | 'string' | 'tail'
+  name: string
+  offset: number      // -1 after a variable-length field
+  min: number         // integer range, or string length range
+  max: number
+  constant?: number
+  counter: boolean
+  flag: boolean
+}
+
+export interface InferredLayout {
+  samples: number
+  minSize: number
+  maxSize: number
+  fields: InferredField[]
+  script: string      // '' without samples
+}
+
+// Infer a skeleton script from every buffered sample of one opcode
+// (offline: the store loaded by decodeCapture/loadTriggerCapture)
+export async function inferLayout(direction: string, opcode: number, offline = false): Promise<InferredLayout> {
+  if (isSaucer) return JSON.parse(await (window as any).saucer.exposed.inferLayout(direction, opcode, offline))
+  return (await fetch(`/api/infer-layout?direction=${direction}&opcode=${opcode}&offline=${offline}`)).json()
+}
+
 export async function listScripts(locale: number, version: number): Promise<ScriptEntry[]> {
   if (isSaucer) return JSON.parse(await (window as any).saucer.exposed.listScripts(locale, version))
   return (await fetch(`/api/scripts?locale=${locale}&version=${version}`)).json()
@@ -133,3 +646,190 @@ export async function saveOpcodeNames(locale: number, version: number, names: Op
   const data = await res.json()
   return data.success
 }
+
+// Offline capture files
+export async function indexCapture(pcapPath: string): Promise<CaptureIndex | null> {
+  if (isSaucer) {
+    const res = JSON.parse(await (window as any).saucer.exposed.indexCapture(pcapPath))
+    return res.flows ? res : null
+  }
+  return (await fetch(`/api/capture-index?path=${encodeURIComponent(pcapPath)}`)).json()
+}
+
+// Decode packets [first, first + count) of one indexed flow (seeks via checkpoints)
+export async function decodeCaptureFlow(pcapPath: string, flowIndex: number, first: number, count: number): Promise<PacketInfo[]> {
+  if (isSaucer) return JSON.parse(await (window as any).saucer.exposed.decodeCaptureFlow(pcapPath, flowIndex, first, count))
+  return (await fetch(`/api/capture-flow?path=${encodeURIComponent(pcapPath)}&flow=${flowIndex}&first=${first}&count=${count}`)).json()
+}
+
+export interface CaptureDecodeSummary {
+  path: string
+  packetCount: number
+  flowsDecoded: number
+  flowsFailed: number
+  seconds: number
+}
+
+// Decode every flow of a capture in parallel into one timestamp-ordered store
+export async function decodeCapture(pcapPath: string): Promise<CaptureDecodeSummary> {
+  if (isSaucer) return JSON.parse(await (window as any).saucer.exposed.decodeCapture(pcapPath))
+  return (await fetch(`/api/capture-decode?path=${encodeURIComponent(pcapPath)}`)).json()
+}
+
+// Page through the store filled by decodeCapture()
+export async function getCapturePackets(first: number, count: number): Promise<PacketInfo[]> {
+  if (isSaucer) return JSON.parse(await (window as any).saucer.exposed.getCapturePackets(first, count))
+  return (await fetch(`/api/capture-packets?first=${first}&count=${count}`)).json()
+}
+
+export type SessionDiffEntry =
+  | { kind: 'same', a: number, b: number, count: number }
+  | { kind: 'changed', a: number, b: number, opcode: string, opcodeRaw: number, outbound: boolean,
+      ranges: [number, number, number, number][] }   // [offsetA, lengthA, offsetB, lengthB] in the payload
+  | { kind: 'removed', a: number, opcode: string, opcodeRaw: number, outbound: boolean }
+  | { kind: 'added', b: number, opcode: string, opcodeRaw: number, outbound: boolean }
+
+export interface SessionDiff {
+  packetsA: number
+  packetsB: number
+  same: number
+  changed: number
+  removed: number
+  added: number
+  approximate: boolean   // sequences too different for an exact alignment
+  seconds: number
+  truncated: boolean
+  entries: SessionDiffEntry[]   // a/b are positions within each session's packet sequence
+}
+
+// Structural diff of two sessions. A source is '' (the store loaded by decodeCapture,
+// loadTriggerCapture or importMsb), a .mspkts trigger window, a .msb file or a .pcap file.
+export async function diffSessions(sourceA: string, sessionA: number, sourceB: string, sessionB: number): Promise<SessionDiff> {
+  if (isSaucer) return JSON.parse(await (window as any).saucer.exposed.diffSessions(sourceA, sessionA, sourceB, sessionB))
+  return (await fetch(`/api/session-diff?sourceA=${encodeURIComponent(sourceA)}&sessionA=${sessionA}&sourceB=${encodeURIComponent(sourceB)}&sessionB=${sessionB}`)).json()
+}
+
+export interface OpcodeProposal {
+  direction: 'send' | 'recv'
+  opcode: string          // new version
+  opcodeRaw: number
+  oldOpcode: string
+  oldOpcodeRaw: number
+  name: string            // from the old version's opcodes.json ('' when unnamed)
+  score: number           // fingerprint similarity 0..1
+  confidence: number      // score discounted by the runner-up margin
+}
+
+export interface OpcodeMapping {
+  old?: { locale: number, version: number }
+  new?: { locale: number, version: number }
+  packetsOld: number
+  packetsNew: number
+  proposals: OpcodeProposal[]   // highest confidence first
+}
+
+// Propose names for a new client version's opcodes from a labeled session of an older
+// version. Sources as in diffSessions.
+export async function mapOpcodes(sourceOld: string, sessionOld: number, sourceNew: string, sessionNew: number): Promise<OpcodeMapping> {
+  if (isSaucer) return JSON.parse(await (window as any).saucer.exposed.mapOpcodes(sourceOld, sessionOld, sourceNew, sessionNew))
+  return (await fetch(`/api/opcode-map?sourceOld=${encodeURIComponent(sourceOld)}&sessionOld=${sessionOld}&sourceNew=${encodeURIComponent(sourceNew)}&sessionNew=${sessionNew}`)).json()
+}
+
+export interface PlaintextExport {
+  path: string
+  packets: number    // Maple packets written
+  frames: number     // pcap records, including the synthetic SYN/FIN exchanges
+  sessions: number
+  bytes: number
+}
+
+// Write decrypted sessions as a plaintext TCP pcap for Wireshark/tshark (sessionId -1 = all).
+// Segments carry u32 length (LE), u16 opcode, payload. Sources as in diffSessions;
+// outPath '' = exports/plaintext-<time>.pcap next to the exe.
+export async function exportPlaintextPcap(source: string, sessionId = -1, outPath = ''): Promise<PlaintextExport> {
+  if (isSaucer) return JSON.parse(await (window as any).saucer.exposed.exportPlaintextPcap(source, sessionId, outPath))
+  const params = new URLSearchParams({ source, sessionId: String(sessionId), outPath })
+  return (await fetch(`/api/export-plaintext-pcap?${params}`, { method: 'POST' })).json()
+}
+
+export interface MsbSession {
+  id: number
+  file: string
+  packets: number
+  version: number
+  locale: number
+  subVersion: string
+}
+
+export interface MsbImport {
+  path: string
+  files: number
+  failed: number        // unreadable files (truncated ones keep what was read)
+  packetCount: number
+  sessions: MsbSession[]
+  seconds: number
+}
+
+// Load a MapleShark .msb file, or every .msb in a directory (one session each), as the
+// offline store used by source ''
+export async function importMsb(path: string): Promise<MsbImport> {
+  if (isSaucer) return JSON.parse(await (window as any).saucer.exposed.importMsb(path))
+  return (await fetch(`/api/import-msb?path=${encodeURIComponent(path)}`, { method: 'POST' })).json()
+}
+
+// Write one session as a MapleShark .msb (format 0x2027). Sources as in diffSessions;
+// outPath '' = exports/session-<id>-<time>.msb next to the exe.
+export async function exportMsb(source: string, sessionId: number, outPath = ''): Promise<{ path: string, packets: number }> {
+  if (isSaucer) return JSON.parse(await (window as any).saucer.exposed.exportMsb(source, sessionId, outPath))
+  const params = new URLSearchParams({ source, sessionId: String(sessionId), outPath })
+  return (await fetch(`/api/export-msb?${params}`, { method: 'POST' })).json()
+}
+
+export interface SequencePacket {
+  opcode: string
+  opcodeRaw: number
+  outbound: boolean
+}
+
+export interface OpcodeSequence {
+  packets: SequencePacket[]   // oldest first; runs of one opcode count once
+  count: number
+  error: number               // count may be low by up to this much (pruned while rare)
+  confidence: number          // how often the last packet followed the ones before it
+}
+
+export interface ResponseCandidate {
+  request: string
+  requestRaw: number
+  response: string
+  responseRaw: number
+  count: number      // times response was the first inbound packet after request
+  requests: number
+  meanMs: number
+}
+
+export interface SequenceAnomaly {
+  sessionId: number
+  timestamp: number
+  previous: SequencePacket
+  packet: SequencePacket
+  probability: number   // how often packet had followed previous until then
+}
+
+export interface OpcodeSequences {
+  packets: number
+  sessions: number
+  entries: number
+  floor: number
+  sequences: OpcodeSequence[]    // most frequent first
+  responses: ResponseCandidate[]
+  anomalies: SequenceAnomaly[]   // newest first
+}
+
+// Frequent opcode sequences (flows such as login or channel change), request -> response
+// candidates and rare transitions. source is 'live' or a source as in diffSessions.
+export async function getOpcodeSequences(source = 'live', minLength = 3, limit = 100): Promise<OpcodeSequences> {
+  if (isSaucer) return JSON.parse(await (window as any).saucer.exposed.getOpcodeSequences(source, minLength, limit))
+  const params = new URLSearchParams({ source, minLength: String(minLength), limit: String(limit) })
+  return (await fetch(`/api/opcode-sequences?${params}`)).json()
+}
@@ -0,0 +1,281 @@
+// Python bindings for the decode core: Protocol, offline capture decoding and
+// the columnar packet store. Columns are exported through the buffer protocol
+// (numpy.asarray / memoryview wrap them without copying); no Python object is
+// created per packet unless asked for with PacketStore.get().
+#include "../src/protocol/protocol.h"
+#include "../src/capture/pcap_file.h"
+#include "../src/offline/flow_index.h"
+#include "../src/offline/bulk_decoder.h"
+#include "../src/store/packet_store.h"
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+#include <pybind11/stl/filesystem.h>
+#include <memory>
+#include <string>
+
+namespace py = pybind11;
+namespace fs = std::filesystem;
+using namespace maple;
+
+namespace {
+
+using StorePtr = std::shared_ptr<PacketStore>;
+
+// Read-only 1-D view into a store; holds the store alive while any view of it exists
+struct Column {
+    StorePtr owner;
+    const void* data;
+    size_t size;
+    size_t itemSize;
+    std::string format;
+};
+
+template <typename T>
+Column column(const StorePtr& store, const std::vector<T>& v) {
+    static const T empty{};   // buffers must not point at null
+    return { store, v.empty() ? &empty : v.data(), v.size(), sizeof(T), py::format_descriptor<T>::format() };
+}
+
+StorePtr toStore(const std::vector<Packet>& pkts, StorePtr store = nullptr) {
+    if (!store) store = std::make_shared<PacketStore>();
+    for (const auto& pkt : pkts) store->append(pkt);
+    return store;
+}
+
+RawPacket toRaw(const uint8_t* data, size_t len, int64_t timestampNs) {
+    RawPacket raw;
+    raw.data.assign(data, data + len);
+    raw.len = raw.caplen = static_cast<uint32_t>(len);
+    raw.timestampNs = timestampNs;
+    raw.timestamp = static_cast<double>(timestampNs) / 1e9;
+    return raw;
+}
+
+const uint8_t* contiguousBytes(const py::buffer_info& info, const char* what) {
+    if (info.ndim != 1 || info.itemsize != 1 || (info.size > 1 && info.strides[0] != 1)) {
+        throw py::value_error(std::string(what) + " must be a contiguous 1-D byte buffer");
+    }
+    return static_cast<const uint8_t*>(info.ptr);
+}
+
+template <typename T>
+const T* contiguousArray(const py::buffer_info& info, const char* what) {
+    if (info.ndim != 1 || info.itemsize != static_cast<py::ssize_t>(sizeof(T)) ||
+        (info.size > 1 && info.strides[0] != static_cast<py::ssize_t>(sizeof(T)))) {
+        throw py::value_error(std::string(what) + " must be a contiguous 1-D array of " +
+                              std::to_string(sizeof(T) * 8) + "-bit integers");
+    }
+    return static_cast<const T*>(info.ptr);
+}
+
+// Decodes a capture file front to back through one Protocol, like the live
+// pipeline, handing out PacketStore batches
+class CaptureDecoder {
+public:
+    CaptureDecoder(const fs::path& path, size_t batchPackets) : batchPackets_(batchPackets ? batchPackets : 1) {
+        if (!reader_.open(path)) throw std::runtime_error("Could not open capture: " + reader_.error());
+        if (reader_.linkType() != PcapReader::LINKTYPE_ETHERNET) {
+            throw std::runtime_error("Unsupported link type " + std::to_string(reader_.linkType()));
+        }
+    }
+
+    StorePtr next() {
+        auto store = std::make_shared<PacketStore>();
+        RawPacket raw;
+        while (store->size() < batchPackets_ && reader_.next(raw)) {
+            frames_++;
+            toStore(protocol_.process(raw), store);
+        }
+        return store->empty() ? nullptr : store;
+    }
+
+    uint64_t frames() const { return frames_; }
+    uint64_t position() const { return reader_.position(); }
+    uint64_t fileSize() const { return reader_.fileSize(); }
+
+private:
+    PcapReader reader_;
+    Protocol protocol_;
+    size_t batchPackets_;
+    uint64_t frames_ = 0;
+};
+
+py::dict flowToDict(const FlowEntry& f, size_t index) {
+    auto ip = [](uint32_t v) {
+        return std::to_string(v >> 24) + "." + std::to_string((v >> 16) & 0xFF) + "." +
+               std::to_string((v >> 8) & 0xFF) + "." + std::to_string(v & 0xFF);
+    };
+    py::dict d;
+    d["index"] = index;
+    d["client"] = ip(f.clientIP) + ":" + std::to_string(f.clientPort);
+    d["server"] = ip(f.serverIP) + ":" + std::to_string(f.serverPort);
+    d["first_timestamp"] = f.firstTimestamp;
+    d["last_timestamp"] = f.lastTimestamp;
+    d["frames"] = f.frameOffsets.size();
+    d["payload_bytes"] = f.payloadBytes;
+    d["has_handshake"] = f.hasHandshake;
+    d["version"] = f.version;
+    d["locale"] = f.locale;
+    d["sub_version"] = f.subVersion;
+    return d;
+}
+
+} // namespace
+
+PYBIND11_MODULE(maplesniffer, m) {
+    m.doc() = "MapleSniffer decode core: protocol decoding, capture files and the columnar packet store";
+
+    py::class_<Column>(m, "Column", py::buffer_protocol(),
+                       "Read-only column; numpy.asarray(column) wraps it without copying")
+        .def_buffer([](Column& c) {
+            return py::buffer_info(const_cast<void*>(c.data), static_cast<py::ssize_t>(c.itemSize), c.format, 1,
+                                   { static_cast<py::ssize_t>(c.size) },
+                                   { static_cast<py::ssize_t>(c.itemSize) }, true);
+        })
+        .def("__len__", [](const Column& c) { return c.size; })
+        .def_property_readonly("format", [](const Column& c) { return c.format; });
+
+    py::class_<PacketStore, StorePtr> store(m, "PacketStore", "Columnar store of decoded packets");
+    store.attr("FLAG_OUTBOUND") = static_cast<int>(PacketStore::FLAG_OUTBOUND);
+    store.attr("FLAG_HANDSHAKE") = static_cast<int>(PacketStore::FLAG_HANDSHAKE);
+    store.attr("FLAG_DEAD") = static_cast<int>(PacketStore::FLAG_DEAD);
+    store
+        .def(py::init<>())
+        .def_static("load", [](const fs::path& path) {
+            std::optional<PacketStore> loaded;
+            {
+                py::gil_scoped_release release;
+                loaded = PacketStore::load(path);
+            }
+            if (!loaded) throw std::runtime_error("Could not load packet store: " + path.string());
+            return std::make_shared<PacketStore>(std::move(*loaded));
+        }, py::arg("path"), "Load a .mspkts file")
+        .def("save", [](const PacketStore& s, const fs::path& path) {
+            py::gil_scoped_release release;
+            return s.save(path);
+        }, py::arg("path"))
+        .def_static("merge", [](const std::vector<StorePtr>& parts) {
+            std::vector<PacketStore> copies;
+            copies.reserve(parts.size());
+            for (const auto& p : parts) copies.push_back(*p);
+            py::gil_scoped_release release;
+            return std::make_shared<PacketStore>(PacketStore::merge(std::move(copies)));
+        }, py::arg("parts"), "One timeline ordered by timestamp (inputs are copied)")
+        .def("__len__", &PacketStore::size)
+        .def_property_readonly("memory_bytes", &PacketStore::memoryBytes)
+        .def_property_readonly("timestamps_ns", [](const StorePtr& s) { return column(s, s->timestampsNs()); })
+        .def_property_readonly("session_ids", [](const StorePtr& s) { return column(s, s->sessionIds()); })
+        .def_property_readonly("opcodes", [](const StorePtr& s) { return column(s, s->opcodes()); })
+        .def_property_readonly("flags", [](const StorePtr& s) { return column(s, s->flags()); })
+        .def_property_readonly("lengths", [](const StorePtr& s) { return column(s, s->lengths()); })
+        .def_property_readonly("server_ports", [](const StorePtr& s) { return column(s, s->serverPorts()); })
+        .def_property_readonly("payload_offsets", [](const StorePtr& s) { return column(s, s->payloadOffsets()); },
+                               "len(store) + 1 offsets into payload_data")
+        .def_property_readonly("payload_data", [](const StorePtr& s) { return column(s, s->payloadData()); })
+        .def("payload", [](const StorePtr& s, size_t i) {
+            if (i >= s->size()) throw py::index_error("packet index out of range");
+            static const uint8_t empty = 0;
+            size_t size = s->payloadSize(i);
+            return Column{ s, size ? s->payload(i) : &empty, size, 1, py::format_descriptor<uint8_t>::format() };
+        }, py::arg("index"), "Payload of one packet as a zero-copy view")
+        .def("get", [](const PacketStore& s, size_t i) {
+            if (i >= s.size()) throw py::index_error("packet index out of range");
+            Packet pkt = s.get(i);
+            py::dict d;
+            d["timestamp_ns"] = pkt.timestampNs;
+            d["session_id"] = pkt.sessionId;
+            d["opcode"] = pkt.opcode;
+            d["outbound"] = pkt.outbound;
+            d["length"] = pkt.length;
+            d["server_port"] = pkt.serverPort;
+            d["payload"] = py::bytes(reinterpret_cast<const char*>(pkt.payload.data()), pkt.payload.size());
+            if (pkt.isHandshake) {
+                d["handshake"] = true;
+                d["version"] = pkt.version;
+                d["locale"] = pkt.locale;
+                d["sub_version"] = pkt.subVersionStr;
+            }
+            if (pkt.isDeadNotification) d["dead"] = true;
+            return d;
+        }, py::arg("index"), "One packet as a dict (for inspection, not bulk work)");
+
+    py::class_<Protocol>(m, "Protocol", "Stateful decoder: Ethernet/IPv4/TCP frames in, decoded packets out")
+        .def(py::init<>())
+        .def("process", [](Protocol& p, py::buffer frame, int64_t timestampNs) {
+            py::buffer_info info = frame.request();
+            const uint8_t* data = contiguousBytes(info, "frame");
+            RawPacket raw = toRaw(data, static_cast<size_t>(info.size), timestampNs);
+            py::gil_scoped_release release;
+            return toStore(p.process(raw));
+        }, py::arg("frame"), py::arg("timestamp_ns"))
+        .def("process_batch", [](Protocol& p, py::buffer frames, py::buffer offsets, py::buffer timestamps) {
+            py::buffer_info frameInfo = frames.request();
+            py::buffer_info offsetInfo = offsets.request();
+            py::buffer_info tsInfo = timestamps.request();
+            const uint8_t* data = contiguousBytes(frameInfo, "frames");
+            const uint64_t* offs = contiguousArray<uint64_t>(offsetInfo, "offsets");
+            const int64_t* ts = contiguousArray<int64_t>(tsInfo, "timestamps_ns");
+            size_t count = offsetInfo.size ? static_cast<size_t>(offsetInfo.size) - 1 : 0;
+            if (static_cast<size_t>(tsInfo.size) != count) {
+                throw py::value_error("timestamps_ns needs one entry per frame (len(offsets) - 1)");
+            }
+            for (size_t i = 0; i < count; i++) {
+                if (offs[i] > offs[i + 1] || offs[i + 1] > static_cast<uint64_t>(frameInfo.size)) {
+                    throw py::value_error("offsets must ascend within frames");
+                }
+            }
+
+            py::gil_scoped_release release;
+            auto store = std::make_shared<PacketStore>();
+            for (size_t i = 0; i < count; i++) {
+                toStore(p.process(toRaw(data + offs[i], offs[i + 1] - offs[i], ts[i])), store);
+            }
+            return store;
+        }, py::arg("frames"), py::arg("offsets"), py::arg("timestamps_ns"),
+           "Frames concatenated in one buffer, offsets (uint64, len n + 1) and timestamps (int64, len n)");
+
+    py::class_<CaptureDecoder>(m, "CaptureDecoder",
+                               "Decode a .pcap file in order, yielding PacketStore batches")
+        .def(py::init<const fs::path&, size_t>(), py::arg("path"), py::arg("batch_packets") = 65536)
+        .def("__iter__", [](py::object self) { return self; })
+        .def("__next__", [](CaptureDecoder& d) {
+            StorePtr batch;
+            {
+                py::gil_scoped_release release;
+                batch = d.next();
+            }
+            if (!batch) throw py::stop_iteration();
+            return batch;
+        })
+        .def_property_readonly("frames", &CaptureDecoder::frames)
+        .def_property_readonly("position", &CaptureDecoder::position)
+        .def_property_readonly("file_size", &CaptureDecoder::fileSize);
+
+    m.def("index_capture", [](const fs::path& path) {
+        std::optional<FlowIndex> index;
+        {
+            py::gil_scoped_release release;
+            index = FlowIndex::loadOrBuild(path);
+        }
+        if (!index) throw std::runtime_error("Could not index capture: " + path.string());
+        py::list flows;
+        for (size_t i = 0; i < index->flows().size(); i++) flows.append(flowToDict(index->flows()[i], i));
+        return flows;
+    }, py::arg("path"), "TCP flows of a capture (builds or reuses the .msidx sidecar)");
+
+    m.def("decode_capture", [](const fs::path& path, size_t threads) {
+        std::optional<BulkDecodeResult> result;
+        {
+            py::gil_scoped_release release;
+            auto index = FlowIndex::loadOrBuild(path);
+            if (index) {
+                BulkDecoder::Options options;
+                options.threads = threads;
+                result = BulkDecoder::decode(path, *index, options);
+            }
+        }
+        if (!result) throw std::runtime_error("Could not decode capture: " + path.string());
+        return std::make_shared<PacketStore>(std::move(result->packets));
+    }, py::arg("path"), py::arg("threads") = 0,
+       "Decode every flow of a capture in parallel into one PacketStore ordered by timestamp");
+}
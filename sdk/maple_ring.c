@@ -0,0 +1,171 @@
+/*
+ * MapleSniffer shared-memory packet ring: reader.
+ * Build alongside your consumer (C99); see maple_ring.h.
+ */
+#include "maple_ring.h"
+
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/* Acquire loads / fences on the shared header. The writer publishes
+ * write_pos with release semantics and stores reserve_pos before it
+ * touches record bytes. */
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+static uint64_t load_acquire(const uint64_t* p) {
+    uint64_t v = *(const volatile uint64_t*)p;
+#if defined(_M_ARM64)
+    __dmb(_ARM64_BARRIER_ISHLD);
+#else
+    _ReadWriteBarrier();   /* x86/x64 loads are not reordered with other loads */
+#endif
+    return v;
+}
+static void fence_acquire(void) {
+#if defined(_M_ARM64)
+    __dmb(_ARM64_BARRIER_ISHLD);
+#else
+    _ReadWriteBarrier();
+#endif
+}
+#else
+static uint64_t load_acquire(const uint64_t* p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+static void fence_acquire(void) { __atomic_thread_fence(__ATOMIC_ACQUIRE); }
+#endif
+
+static void unmap(maple_ring_reader* r) {
+#ifdef _WIN32
+    if (r->base) UnmapViewOfFile(r->base);
+    if (r->handle) CloseHandle((HANDLE)r->handle);
+#else
+    if (r->base) munmap((void*)r->base, r->mapped_size);
+#endif
+    r->base = NULL;
+    r->handle = NULL;
+}
+
+int maple_ring_open(maple_ring_reader* r, const char* name) {
+    memset(r, 0, sizeof(*r));
+    r->next_seq = UINT64_MAX;
+
+#ifdef _WIN32
+    {
+        HANDLE mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, name ? name : MAPLE_RING_DEFAULT_NAME_WIN);
+        MEMORY_BASIC_INFORMATION info;
+        if (!mapping) return MAPLE_RING_ERROR;
+        r->handle = mapping;
+        r->base = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!r->base || !VirtualQuery(r->base, &info, sizeof(info))) {
+            unmap(r);
+            return MAPLE_RING_ERROR;
+        }
+        r->mapped_size = info.RegionSize;
+    }
+#else
+    {
+        struct stat st;
+        void* base;
+        int fd = shm_open(name ? name : MAPLE_RING_DEFAULT_NAME_POSIX, O_RDONLY, 0);
+        if (fd < 0) return MAPLE_RING_ERROR;
+        if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(maple_ring_header)) {
+            close(fd);
+            return MAPLE_RING_ERROR;
+        }
+        base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (base == MAP_FAILED) return MAPLE_RING_ERROR;
+        r->base = (const uint8_t*)base;
+        r->mapped_size = (size_t)st.st_size;
+    }
+#endif
+
+    r->header = (const maple_ring_header*)r->base;
+    if (r->header->magic != MAPLE_RING_MAGIC || r->header->version != MAPLE_RING_VERSION ||
+        r->header->record_header_size != sizeof(maple_ring_record) || r->header->capacity == 0 ||
+        (r->header->capacity & (r->header->capacity - 1)) != 0 ||
+        r->header->data_offset + r->header->capacity > r->mapped_size) {
+        unmap(r);
+        return MAPLE_RING_ERROR;
+    }
+    r->data = r->base + r->header->data_offset;
+    r->read_pos = load_acquire(&r->header->write_pos);
+    return MAPLE_RING_OK;
+}
+
+void maple_ring_close(maple_ring_reader* r) {
+    unmap(r);
+    r->header = NULL;
+    r->data = NULL;
+}
+
+/* Bytes at [pos, pos + capacity) are intact as long as the writer has not
+ * reserved past pos + capacity */
+static int intact(const maple_ring_reader* r, uint64_t pos) {
+    fence_acquire();
+    return load_acquire(&r->header->reserve_pos) <= pos + r->header->capacity;
+}
+
+static int resync(maple_ring_reader* r) {
+    r->read_pos = load_acquire(&r->header->write_pos);
+    r->current_size = 0;
+    return MAPLE_RING_OVERRUN;
+}
+
+int maple_ring_next(maple_ring_reader* r, const maple_ring_record** out) {
+    const uint64_t capacity = r->header->capacity;
+
+    for (;;) {
+        uint64_t write_pos = load_acquire(&r->header->write_pos);
+        uint64_t offset = r->read_pos & (capacity - 1);
+        const maple_ring_record* rec;
+        uint32_t size;
+        uint8_t flags;
+        uint64_t seq;
+
+        if (r->read_pos == write_pos) return MAPLE_RING_EMPTY;
+        if (write_pos - r->read_pos > capacity) return resync(r);
+
+        /* Too little room left for a header: the writer wrapped */
+        if (capacity - offset < sizeof(maple_ring_record)) {
+            r->read_pos += capacity - offset;
+            continue;
+        }
+
+        rec = (const maple_ring_record*)(r->data + offset);
+        size = rec->size;
+        flags = rec->flags;
+        seq = rec->seq;
+        if (!intact(r, r->read_pos)) return resync(r);
+        if (size < sizeof(maple_ring_record) || size > capacity - offset || (size & 7) != 0) return resync(r);
+
+        if (flags & MAPLE_RING_FLAG_PAD) {
+            r->read_pos += size;
+            continue;
+        }
+
+        if (r->next_seq != UINT64_MAX && seq > r->next_seq) r->lost += seq - r->next_seq;
+        r->current_pos = r->read_pos;
+        r->current_size = size;
+        r->current_seq = seq;
+        *out = rec;
+        return MAPLE_RING_OK;
+    }
+}
+
+int maple_ring_done(maple_ring_reader* r) {
+    if (!r->current_size) return MAPLE_RING_ERROR;
+    if (!intact(r, r->current_pos)) return resync(r);
+    r->read_pos = r->current_pos + r->current_size;
+    r->next_seq = r->current_seq + 1;
+    r->current_size = 0;
+    return MAPLE_RING_OK;
+}
@@ -0,0 +1,122 @@
+/*
+ * MapleSniffer shared-memory packet ring: layout and reader API.
+ *
+ * The sniffer publishes every decoded packet into a named shared-memory
+ * region ("Local\MapleSniffer.Ring" on Windows, "/maple_sniffer_ring" in
+ * /dev/shm elsewhere). One writer, any number of readers; readers map the
+ * region read-only and never slow the writer down. A reader that falls more
+ * than the ring capacity behind is told so (MAPLE_RING_OVERRUN) and resumes
+ * at the newest record; sequence gaps give the number of records it missed.
+ *
+ * Records are read in place (zero copy): maple_ring_next() hands out a
+ * pointer into the ring, maple_ring_done() confirms the writer did not
+ * overwrite it meanwhile. Data read between the two calls is only
+ * trustworthy if maple_ring_done() returns MAPLE_RING_OK.
+ *
+ *     maple_ring_reader r;
+ *     if (maple_ring_open(&r, NULL) != MAPLE_RING_OK) return;
+ *     for (;;) {
+ *         const maple_ring_record* rec;
+ *         int rc = maple_ring_next(&r, &rec);
+ *         if (rc == MAPLE_RING_EMPTY) { sleep_a_little(); continue; }
+ *         if (rc != MAPLE_RING_OK) continue;            // overrun: resynced
+ *         handle(rec, maple_ring_payload(rec));
+ *         if (maple_ring_done(&r) != MAPLE_RING_OK) undo(rec);   // torn
+ *     }
+ */
+#ifndef MAPLE_RING_H
+#define MAPLE_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MAPLE_RING_MAGIC 0x474E4952454C504DULL   /* "MPLERING" */
+#define MAPLE_RING_VERSION 1
+#define MAPLE_RING_DEFAULT_NAME_WIN "Local\\MapleSniffer.Ring"
+#define MAPLE_RING_DEFAULT_NAME_POSIX "/maple_sniffer_ring"
+
+/* Record flags */
+#define MAPLE_RING_FLAG_OUTBOUND  0x01
+#define MAPLE_RING_FLAG_HANDSHAKE 0x02
+#define MAPLE_RING_FLAG_DEAD      0x04
+#define MAPLE_RING_FLAG_TRUNCATED 0x08   /* payload cut to fit the ring */
+#define MAPLE_RING_FLAG_PAD       0x80   /* filler up to the end of the ring; skipped by readers */
+
+/* Region header. Positions are byte counts since the ring was created and
+ * only grow; a record at position p lives at data offset p % capacity. */
+typedef struct maple_ring_header {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t record_header_size;   /* sizeof(maple_ring_record) */
+    uint64_t capacity;             /* data bytes, a power of two */
+    uint64_t data_offset;          /* from the start of the region */
+    uint8_t reserved0[32];
+
+    /* Written by the writer only, on their own cache lines */
+    uint64_t write_pos;            /* end of the last complete record (release) */
+    uint64_t next_seq;             /* seq of the next record */
+    uint8_t reserved1[48];
+    uint64_t reserve_pos;          /* end of the record being written (set before writing) */
+    uint8_t reserved2[56];
+} maple_ring_header;
+
+/* Fixed record header, followed by payload_size bytes and padding to 8 */
+typedef struct maple_ring_record {
+    uint32_t size;                 /* whole record incl. header and padding */
+    uint32_t payload_size;
+    uint64_t seq;                  /* consecutive over the ring's lifetime */
+    int64_t timestamp_ns;          /* capture time, ns since the Unix epoch */
+    uint32_t session_id;
+    uint16_t opcode;
+    uint8_t flags;
+    uint8_t locale;                /* handshakes */
+    uint16_t version;              /* handshakes */
+    uint16_t server_port;
+    uint32_t length;               /* original packet length */
+} maple_ring_record;
+
+enum {
+    MAPLE_RING_OK = 0,
+    MAPLE_RING_EMPTY = 1,          /* nothing new yet */
+    MAPLE_RING_OVERRUN = 2,        /* fell behind: resumed at the newest record */
+    MAPLE_RING_ERROR = -1
+};
+
+typedef struct maple_ring_reader {
+    void* handle;                  /* platform mapping handle */
+    const uint8_t* base;
+    size_t mapped_size;
+    const maple_ring_header* header;
+    const uint8_t* data;
+    uint64_t read_pos;
+    uint64_t next_seq;             /* seq expected next, UINT64_MAX before the first record */
+    uint64_t lost;                 /* records skipped because of overruns */
+    uint64_t current_pos;          /* record handed out by maple_ring_next */
+    uint32_t current_size;
+    uint64_t current_seq;
+} maple_ring_reader;
+
+/* name NULL = default name. Starts at the newest record. */
+int maple_ring_open(maple_ring_reader* reader, const char* name);
+void maple_ring_close(maple_ring_reader* reader);
+
+/* Next record in place: MAPLE_RING_OK, MAPLE_RING_EMPTY or MAPLE_RING_OVERRUN */
+int maple_ring_next(maple_ring_reader* reader, const maple_ring_record** record);
+
+/* Finish the record from maple_ring_next: MAPLE_RING_OK if it stayed intact
+ * while it was used, MAPLE_RING_OVERRUN (and resync) if it was overwritten */
+int maple_ring_done(maple_ring_reader* reader);
+
+static inline const uint8_t* maple_ring_payload(const maple_ring_record* record) {
+    return (const uint8_t*)(record + 1);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MAPLE_RING_H */
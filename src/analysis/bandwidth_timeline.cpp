@@ -0,0 +1,155 @@
+#include "bandwidth_timeline.h"
+#include <algorithm>
+
+namespace maple {
+
+// --- RateRing ---
+
+void RateRing::add(int64_t timestampNs, uint64_t bytes) {
+    if (timestampNs < 0) return;
+    int64_t bucket = timestampNs / bucketNs_;
+
+    // Far older than the ring holds: nowhere to put it
+    if (newestBucket_ >= 0 && bucket <= newestBucket_ - static_cast<int64_t>(slots_.size())) return;
+
+    Slot& slot = slots_[static_cast<size_t>(bucket % static_cast<int64_t>(slots_.size()))];
+    if (slot.bucket != bucket) {
+        slot.bucket = bucket;
+        slot.packets = 0;
+        slot.bytes = 0;
+    }
+    slot.packets++;
+    slot.bytes += bytes;
+    newestBucket_ = std::max(newestBucket_, bucket);
+}
+
+void RateRing::query(int64_t fromNs, int64_t toNs, std::vector<Point>& out) const {
+    if (newestBucket_ < 0 || toNs <= fromNs) return;
+
+    int64_t size = static_cast<int64_t>(slots_.size());
+    int64_t first = std::max(fromNs / bucketNs_, newestBucket_ - size + 1);
+    int64_t last = std::min((toNs - 1) / bucketNs_, newestBucket_);
+    for (int64_t b = std::max<int64_t>(first, 0); b <= last; b++) {
+        const Slot& slot = slots_[static_cast<size_t>(b % size)];
+        if (slot.bucket == b) {
+            out.push_back({ b * bucketNs_, slot.packets, slot.bytes });
+        } else {
+            out.push_back({ b * bucketNs_, 0, 0 });
+        }
+    }
+}
+
+// --- BandwidthTimeline ---
+
+BandwidthTimeline::Series::Series() {
+    for (size_t i = 0; i < LEVEL_COUNT; i++) {
+        levels.emplace_back(LEVEL_BUCKET_NS[i], LEVEL_SLOTS[i]);
+    }
+}
+
+void BandwidthTimeline::Series::add(int64_t timestampNs, uint64_t bytes) {
+    for (auto& level : levels) level.add(timestampNs, bytes);
+}
+
+void BandwidthTimeline::addToDirection(Direction& dir, uint16_t opcode, int64_t timestampNs, uint64_t bytes) {
+    dir.all.add(timestampNs, bytes);
+
+    auto& total = dir.totals[opcode];
+    total.opcode = opcode;
+    total.packets++;
+    total.bytes += bytes;
+
+    auto it = dir.top.find(opcode);
+    if (it == dir.top.end()) {
+        if (dir.top.size() >= TOP_OPCODES) {
+            // Take over the smallest charted opcode once this one outgrows it
+            auto smallest = std::min_element(dir.top.begin(), dir.top.end(), [&](const auto& a, const auto& b) {
+                return dir.totals[a.first].bytes < dir.totals[b.first].bytes;
+            });
+            if (dir.totals[smallest->first].bytes >= total.bytes) return;
+            dir.totals[smallest->first].charted = false;
+            dir.top.erase(smallest);
+        }
+        it = dir.top.emplace(opcode, std::make_unique<Series>()).first;
+        total.charted = true;
+    }
+    it->second->add(timestampNs, bytes);
+}
+
+void BandwidthTimeline::onPacket(const Packet& pkt) {
+    if (pkt.isHandshake || pkt.isDeadNotification) return;
+
+    auto& slot = sessions_[pkt.sessionId];
+    if (!slot) {
+        slot = std::make_unique<SessionSeries>();
+        // Stamped before eviction so the new session is never the oldest one
+        slot->lastNs = pkt.timestampNs;
+        if (sessions_.size() > MAX_SESSIONS) {
+            uint32_t id = pkt.sessionId;
+            auto oldest = std::min_element(sessions_.begin(), sessions_.end(), [id](const auto& a, const auto& b) {
+                if (a.first == id || b.first == id) return b.first == id && a.first != id;
+                return a.second->lastNs < b.second->lastNs;
+            });
+            sessions_.erase(oldest);
+        }
+    }
+
+    // Erasing another session leaves slot valid
+    SessionSeries& session = *slot;
+    session.lastNs = std::max(session.lastNs, pkt.timestampNs);
+    addToDirection(pkt.outbound ? session.out : session.in, pkt.opcode, pkt.timestampNs, pkt.length);
+}
+
+std::optional<BandwidthTimeline::QueryResult> BandwidthTimeline::query(
+        uint32_t sessionId, bool outbound, std::optional<uint16_t> opcode,
+        int64_t fromNs, int64_t toNs, int64_t resolutionNs) const {
+    auto sit = sessions_.find(sessionId);
+    if (sit == sessions_.end()) return std::nullopt;
+    const Direction& dir = outbound ? sit->second->out : sit->second->in;
+
+    const Series* series = &dir.all;
+    if (opcode) {
+        auto it = dir.top.find(*opcode);
+        if (it == dir.top.end()) return std::nullopt;
+        series = it->second.get();
+    }
+
+    // Exact level if requested, otherwise the finest whose ring reaches back
+    // to fromNs and whose point count fits
+    size_t level = LEVEL_COUNT - 1;
+    if (resolutionNs > 0) {
+        for (size_t i = 0; i < LEVEL_COUNT; i++) {
+            if (LEVEL_BUCKET_NS[i] >= resolutionNs) { level = i; break; }
+        }
+    } else {
+        int64_t newest = std::max(sit->second->lastNs, toNs);
+        for (size_t i = 0; i < LEVEL_COUNT; i++) {
+            const RateRing& ring = series->levels[i];
+            bool covers = newest - ring.spanNs() <= fromNs;
+            bool fits = (toNs - fromNs) / ring.bucketNs() <= static_cast<int64_t>(MAX_POINTS);
+            if (covers && fits) { level = i; break; }
+        }
+    }
+
+    QueryResult result;
+    const RateRing& ring = series->levels[level];
+    result.resolutionNs = ring.bucketNs();
+
+    // Clamp the window to MAX_POINTS buckets, keeping its newest end
+    int64_t from = std::max(fromNs, toNs - ring.bucketNs() * static_cast<int64_t>(MAX_POINTS));
+    ring.query(from, toNs, result.points);
+    return result;
+}
+
+std::vector<BandwidthTimeline::OpcodeTotal> BandwidthTimeline::opcodeTotals(uint32_t sessionId, bool outbound) const {
+    std::vector<OpcodeTotal> out;
+    auto sit = sessions_.find(sessionId);
+    if (sit == sessions_.end()) return out;
+
+    const Direction& dir = outbound ? sit->second->out : sit->second->in;
+    for (const auto& [op, total] : dir.totals) out.push_back(total);
+    std::sort(out.begin(), out.end(), [](const OpcodeTotal& a, const OpcodeTotal& b) { return a.bytes > b.bytes; });
+    return out;
+}
+
+} // namespace maple
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "../protocol/protocol.h"
+#include <array>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace maple {
+
+// Packets/bytes per time bucket for one series at one resolution.
+// Fixed ring: slot = bucket % size, tagged with its absolute bucket number
+// so stale slots read as empty without ever being cleared.
+class RateRing {
+public:
+    struct Point {
+        int64_t startNs;
+        uint32_t packets;
+        uint64_t bytes;
+    };
+
+    RateRing(int64_t bucketNs, size_t slots) : bucketNs_(bucketNs), slots_(slots) {}
+
+    void add(int64_t timestampNs, uint64_t bytes);
+
+    // Buckets overlapping [fromNs, toNs) still held by the ring (empty ones included)
+    void query(int64_t fromNs, int64_t toNs, std::vector<Point>& out) const;
+
+    int64_t bucketNs() const { return bucketNs_; }
+    int64_t spanNs() const { return bucketNs_ * static_cast<int64_t>(slots_.size()); }
+
+private:
+    struct Slot {
+        int64_t bucket = -1;
+        uint32_t packets = 0;
+        uint64_t bytes = 0;
+    };
+
+    int64_t bucketNs_;
+    int64_t newestBucket_ = -1;
+    std::vector<Slot> slots_;
+};
+
+// Downsampled traffic history per session, direction and top opcodes.
+// Every decoded packet is added to a pyramid of rings (1 s for an hour,
+// 10 s for six hours, 1 min for a day) so the UI can chart long captures
+// without touching stored packets. Not synchronized: callers serialize access.
+class BandwidthTimeline {
+public:
+    static constexpr size_t LEVEL_COUNT = 3;
+    static constexpr std::array<int64_t, LEVEL_COUNT> LEVEL_BUCKET_NS = {
+        1'000'000'000, 10'000'000'000, 60'000'000'000 };
+    static constexpr std::array<size_t, LEVEL_COUNT> LEVEL_SLOTS = { 3600, 2160, 1440 };
+
+    static constexpr size_t TOP_OPCODES = 8;     // per session and direction
+    static constexpr size_t MAX_SESSIONS = 64;   // least recently active are dropped
+    static constexpr size_t MAX_POINTS = 4000;   // per query
+
+    struct OpcodeTotal {
+        uint16_t opcode;
+        uint64_t packets;
+        uint64_t bytes;
+        bool charted;       // has a series (currently in the top set)
+    };
+
+    struct QueryResult {
+        int64_t resolutionNs = 0;
+        std::vector<RateRing::Point> points;
+    };
+
+    void onPacket(const Packet& pkt);
+
+    // opcode nullopt = whole direction. resolutionNs 0 picks the finest level
+    // that covers the window within MAX_POINTS. Returns nullopt for unknown series.
+    std::optional<QueryResult> query(uint32_t sessionId, bool outbound, std::optional<uint16_t> opcode,
+                                     int64_t fromNs, int64_t toNs, int64_t resolutionNs) const;
+
+    // Opcode totals of one direction, largest byte count first
+    std::vector<OpcodeTotal> opcodeTotals(uint32_t sessionId, bool outbound) const;
+
+private:
+    struct Series {
+        std::vector<RateRing> levels;
+        Series();
+        void add(int64_t timestampNs, uint64_t bytes);
+    };
+
+    struct Direction {
+        Series all;
+        std::map<uint16_t, OpcodeTotal> totals;
+        std::map<uint16_t, std::unique_ptr<Series>> top;  // at most TOP_OPCODES
+    };
+
+    struct SessionSeries {
+        int64_t lastNs = 0;
+        Direction in;
+        Direction out;
+    };
+
+    static void addToDirection(Direction& dir, uint16_t opcode, int64_t timestampNs, uint64_t bytes);
+
+    std::map<uint32_t, std::unique_ptr<SessionSeries>> sessions_;
+};
+
+} // namespace maple
@@ -0,0 +1,123 @@
+#include "byte_variability.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define MAPLE_HAVE_SSE2 1
+#endif
+
+namespace maple {
+
+namespace {
+
+void updateMinMax(uint8_t* mins, uint8_t* maxs, const uint8_t* data, size_t n) {
+    size_t i = 0;
+#ifdef MAPLE_HAVE_SSE2
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mins + i));
+        __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(maxs + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(mins + i), _mm_min_epu8(lo, v));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(maxs + i), _mm_max_epu8(hi, v));
+    }
+#endif
+    for (; i < n; i++) {
+        mins[i] = std::min(mins[i], data[i]);
+        maxs[i] = std::max(maxs[i], data[i]);
+    }
+}
+
+} // namespace
+
+void ByteVariabilityTracker::onPacket(const Packet& pkt) {
+    if (pkt.isHandshake || pkt.isDeadNotification || pkt.suppressed) return;
+    onPayload(pkt.outbound, pkt.opcode, pkt.payload.data(), pkt.payload.size());
+}
+
+size_t ByteVariabilityTracker::entryBytes(size_t positions) {
+    // mins + maxs + histogram + value set per position, and a length counter
+    return positions * (2 + 256 + 32 + sizeof(uint64_t));
+}
+
+void ByteVariabilityTracker::evictFor(const Entry* keep) {
+    while (memoryBytes_ > MEMORY_BUDGET) {
+        auto oldest = entries_.end();
+        for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+            if (&it->second == keep) continue;
+            if (oldest == entries_.end() || it->second.lastUpdate < oldest->second.lastUpdate) oldest = it;
+        }
+        if (oldest == entries_.end()) return;
+        memoryBytes_ -= entryBytes(oldest->second.mins.size());
+        entries_.erase(oldest);
+    }
+}
+
+void ByteVariabilityTracker::onPayload(bool outbound, uint16_t opcode, const uint8_t* data, size_t size) {
+    Entry& e = entries_[{ outbound, opcode }];
+    size_t n = std::min(size, MAX_POSITIONS);
+    e.lastUpdate = ++tick_;
+
+    if (n > e.mins.size()) {
+        memoryBytes_ += entryBytes(n) - entryBytes(e.mins.size());
+        e.mins.resize(n, 0xFF);
+        e.maxs.resize(n, 0);
+        e.histograms.resize(n, {});
+        e.seen.resize(n, {});
+        // Only growth can cross the budget
+        evictFor(&e);
+    }
+    if (n >= e.lengthCounts.size()) e.lengthCounts.resize(n + 1, 0);
+    e.lengthCounts[n]++;
+    e.packets++;
+
+    updateMinMax(e.mins.data(), e.maxs.data(), data, n);
+    for (size_t i = 0; i < n; i++) {
+        uint8_t b = data[i];
+        e.seen[i][b >> 6] |= 1ull << (b & 63);
+        auto& h = e.histograms[i];
+        if (++h[b] == 0xFF) {
+            for (auto& c : h) c >>= 1;
+        }
+    }
+}
+
+std::optional<ByteVariabilityMap> ByteVariabilityTracker::map(bool outbound, uint16_t opcode) const {
+    auto it = entries_.find({ outbound, opcode });
+    if (it == entries_.end()) return std::nullopt;
+    const Entry& e = it->second;
+
+    ByteVariabilityMap m;
+    m.outbound = outbound;
+    m.opcode = opcode;
+    m.packets = e.packets;
+    m.positions.resize(e.mins.size());
+
+    // Position i is covered by every payload of length > i
+    uint64_t covering = 0;
+    for (size_t len = e.lengthCounts.size(); len-- > 1;) {
+        covering += e.lengthCounts[len];
+        if (len - 1 < m.positions.size()) m.positions[len - 1].samples = covering;
+    }
+
+    for (size_t i = 0; i < m.positions.size(); i++) {
+        auto& p = m.positions[i];
+        p.min = e.mins[i];
+        p.max = e.maxs[i];
+        for (uint64_t word : e.seen[i]) p.distinct += static_cast<uint16_t>(std::popcount(word));
+
+        uint64_t total = 0;
+        for (uint8_t c : e.histograms[i]) total += c;
+        double entropy = 0;
+        for (uint8_t c : e.histograms[i]) {
+            if (!c) continue;
+            double f = static_cast<double>(c) / static_cast<double>(total);
+            entropy -= f * std::log2(f);
+        }
+        p.entropy = entropy;
+    }
+    return m;
+}
+
+} // namespace maple
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "../protocol/protocol.h"
+#include <array>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <vector>
+
+namespace maple {
+
+// Statistics of one payload byte position over every packet of an opcode
+struct BytePositionStats {
+    uint64_t samples = 0;     // packets long enough to have this byte
+    uint8_t min = 0;
+    uint8_t max = 0;
+    uint16_t distinct = 0;    // distinct byte values seen (exact)
+    double entropy = 0;       // bits, 0..8
+
+    bool constant() const { return samples > 0 && min == max; }
+};
+
+struct ByteVariabilityMap {
+    bool outbound = false;
+    uint16_t opcode = 0;
+    uint64_t packets = 0;
+    std::vector<BytePositionStats> positions;   // up to the longest payload (capped)
+};
+
+// Per (direction, opcode) and payload byte position: min/max, distinct values
+// and entropy, updated as packets arrive. Min/max are byte columns updated 16
+// positions at a time (SSE2); entropy comes from per-position 8-bit histograms
+// whose counters are halved when one saturates, so proportions survive long
+// captures. A position costs about 290 bytes; past MEMORY_BUDGET the least
+// recently updated opcodes are dropped.
+// Not synchronized: callers serialize access.
+class ByteVariabilityTracker {
+public:
+    static constexpr size_t MAX_POSITIONS = 1024;
+    static constexpr size_t MEMORY_BUDGET = 64u << 20;
+
+    void onPacket(const Packet& pkt);
+    void onPayload(bool outbound, uint16_t opcode, const uint8_t* data, size_t size);
+
+    std::optional<ByteVariabilityMap> map(bool outbound, uint16_t opcode) const;
+    void clear() {
+        entries_.clear();
+        memoryBytes_ = 0;
+    }
+
+    size_t memoryBytes() const { return memoryBytes_; }
+
+private:
+    struct Entry {
+        uint64_t packets = 0;
+        uint64_t lastUpdate = 0;                     // tick_ of the latest packet
+        std::vector<uint8_t> mins;
+        std::vector<uint8_t> maxs;
+        std::vector<std::array<uint8_t, 256>> histograms;
+        std::vector<std::array<uint64_t, 4>> seen;   // 256-bit value sets
+        std::vector<uint64_t> lengthCounts;          // packets per (capped) payload length
+    };
+
+    static size_t entryBytes(size_t positions);
+    void evictFor(const Entry* keep);
+
+    std::map<std::pair<bool, uint16_t>, Entry> entries_;
+    size_t memoryBytes_ = 0;
+    uint64_t tick_ = 0;
+};
+
+} // namespace maple
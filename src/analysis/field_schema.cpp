@@ -0,0 +1,448 @@
+#include "field_schema.h"
+#include "../metrics/trace.h"
+#include <algorithm>
+
+namespace maple {
+
+namespace {
+
+uint32_t tableKey(uint8_t locale, uint16_t version) {
+    return (static_cast<uint32_t>(locale) << 16) | version;
+}
+
+uint64_t readLE(const uint8_t* p, size_t width) {
+    uint64_t v = 0;
+    for (size_t i = 0; i < width; i++) v |= static_cast<uint64_t>(p[i]) << (8 * i);
+    return v;
+}
+
+int64_t extend(uint64_t v, uint8_t width, bool isSigned) {
+    if (!isSigned || width >= 8) return static_cast<int64_t>(v);
+    unsigned shift = 64 - 8 * width;
+    return static_cast<int64_t>(v << shift) >> shift;
+}
+
+void appendText(FieldColumn& c, uint64_t seq, const uint8_t* p, size_t len) {
+    c.seqs.push_back(seq);
+    c.text.append(reinterpret_cast<const char*>(p), len);
+    c.textEnds.push_back(static_cast<uint32_t>(c.text.size()));
+}
+
+void truncate(FieldColumn& c, size_t rows) {
+    c.seqs.resize(rows);
+    if (c.type == FieldColumn::Type::Int || c.type == FieldColumn::Type::Time) {
+        c.ints.resize(rows);
+    } else {
+        c.textEnds.resize(rows);
+        c.text.resize(rows ? c.textEnds.back() : 0);
+    }
+}
+
+} // namespace
+
+uint16_t SchemaProgram::addColumn(const std::string& name, FieldColumn::Type type, bool isSigned, uint8_t width) {
+    FieldColumn c;
+    c.name = name;
+    c.type = type;
+    c.isSigned = isSigned;
+    c.width = width;
+    columns_.push_back(std::move(c));
+    return static_cast<uint16_t>(columns_.size() - 1);
+}
+
+bool SchemaProgram::emit(const std::vector<SchemaField>& fields, const std::string& prefix, size_t depth,
+                         std::string& error) {
+    using Type = SchemaField::Type;
+    for (const auto& f : fields) {
+        if (f.name.empty()) {
+            error = "field without a name" + (prefix.empty() ? "" : " in " + prefix);
+            return false;
+        }
+        std::string path = prefix + f.name;
+        bool duplicate = std::any_of(columns_.begin(), columns_.end(), [&](const FieldColumn& c) {
+            return c.name == path;
+        });
+        if (duplicate) {
+            error = "duplicate field " + path;
+            return false;
+        }
+        if (columns_.size() >= NO_COLUMN) {
+            error = "too many fields";
+            return false;
+        }
+
+        switch (f.type) {
+            case Type::Byte:
+            case Type::Short:
+            case Type::Int:
+            case Type::Long: {
+                uint8_t width = f.type == Type::Byte ? 1 : f.type == Type::Short ? 2 : f.type == Type::Int ? 4 : 8;
+                code_.push_back({ Op::Int, width, addColumn(path, FieldColumn::Type::Int, f.isSigned, width), 0, 0 });
+                break;
+            }
+            case Type::FileTime:
+                code_.push_back({ Op::Int, 8, addColumn(path, FieldColumn::Type::Time, false, 8), 0, 0 });
+                break;
+            case Type::String:
+                code_.push_back({ Op::String, 0, addColumn(path, FieldColumn::Type::String, false, 0), 0, 0 });
+                break;
+            case Type::FixedString:
+                code_.push_back({ Op::FixedString, 0, addColumn(path, FieldColumn::Type::String, false, 0), f.length, 0 });
+                break;
+            case Type::Bytes:
+                code_.push_back({ Op::Bytes, 0, addColumn(path, FieldColumn::Type::Bytes, false, 0), f.length, 0 });
+                break;
+            case Type::Skip:
+                code_.push_back({ Op::Skip, 0, NO_COLUMN, f.length, 0 });
+                break;
+            case Type::Array: {
+                if (depth + 1 > MAX_DEPTH) {
+                    error = "arrays nested too deep at " + path;
+                    return false;
+                }
+                if (f.countWidth != 0 && f.countWidth != 1 && f.countWidth != 2 && f.countWidth != 4) {
+                    error = "bad count width for " + path;
+                    return false;
+                }
+                size_t begin = code_.size();
+                code_.push_back({ Op::ArrayBegin, f.countWidth, NO_COLUMN, f.countWidth ? 0 : f.length, 0 });
+                if (!emit(f.children, path + "[].", depth + 1, error)) return false;
+                code_.push_back({ Op::ArrayEnd, 0, NO_COLUMN, static_cast<uint32_t>(begin + 1), 0 });
+                code_[begin].jump = static_cast<uint32_t>(code_.size() - 1);
+                break;
+            }
+            case Type::Object:
+                if (depth + 1 > MAX_DEPTH) {
+                    error = "objects nested too deep at " + path;
+                    return false;
+                }
+                if (!emit(f.children, path + ".", depth + 1, error)) return false;
+                break;
+        }
+    }
+    return true;
+}
+
+std::optional<SchemaProgram> SchemaProgram::compile(const std::vector<SchemaField>& fields, std::string& error) {
+    SchemaProgram program;
+    if (!program.emit(fields, "", 0, error)) return std::nullopt;
+    return program;
+}
+
+bool SchemaProgram::run(uint64_t seq, const uint8_t* data, size_t size, std::vector<FieldColumn>& columns) const {
+    struct Loop {
+        uint32_t remaining;
+        uint32_t body;
+    };
+    Loop loops[MAX_DEPTH];
+    size_t depth = 0;
+    uint32_t iterations = 0;
+
+    // Rows of this packet are the tail of every column: drop them on a misfit
+    auto fail = [&] {
+        for (auto& c : columns) {
+            auto first = std::lower_bound(c.seqs.begin(), c.seqs.end(), seq);
+            truncate(c, static_cast<size_t>(first - c.seqs.begin()));
+        }
+        return false;
+    };
+
+    size_t pos = 0;
+    size_t pc = 0;
+    const size_t end = code_.size();
+    while (pc < end) {
+        const Instr& in = code_[pc];
+        switch (in.op) {
+            case Op::Int: {
+                if (size - pos < in.width) return fail();
+                if (in.column != NO_COLUMN) {
+                    FieldColumn& c = columns[in.column];
+                    c.seqs.push_back(seq);
+                    c.ints.push_back(extend(readLE(data + pos, in.width), in.width, c.isSigned));
+                }
+                pos += in.width;
+                pc++;
+                break;
+            }
+            case Op::String: {
+                if (size - pos < 2) return fail();
+                size_t len = readLE(data + pos, 2);
+                if (size - pos - 2 < len) return fail();
+                appendText(columns[in.column], seq, data + pos + 2, len);
+                pos += 2 + len;
+                pc++;
+                break;
+            }
+            case Op::FixedString:
+            case Op::Bytes:
+                if (size - pos < in.arg) return fail();
+                appendText(columns[in.column], seq, data + pos, in.arg);
+                pos += in.arg;
+                pc++;
+                break;
+            case Op::Skip:
+                if (size - pos < in.arg) return fail();
+                pos += in.arg;
+                pc++;
+                break;
+            case Op::ArrayBegin: {
+                uint32_t count = in.arg;
+                if (in.width) {
+                    if (size - pos < in.width) return fail();
+                    count = static_cast<uint32_t>(readLE(data + pos, in.width));
+                    pos += in.width;
+                }
+                if (count == 0) {
+                    pc = in.jump + 1;
+                } else {
+                    loops[depth++] = { count, static_cast<uint32_t>(pc + 1) };
+                    pc++;
+                }
+                break;
+            }
+            case Op::ArrayEnd: {
+                if (++iterations > MAX_ITERATIONS) return fail();
+                Loop& loop = loops[depth - 1];
+                if (--loop.remaining > 0) {
+                    pc = loop.body;
+                } else {
+                    depth--;
+                    pc++;
+                }
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+void FieldExtractor::setLayouts(uint8_t locale, uint16_t version, Layouts layouts) {
+    auto table = std::make_shared<Table>();
+    table->locale = locale;
+    table->version = version;
+    for (auto& [key, program] : layouts) {
+        Entry entry;
+        entry.columns = program.columns();
+        entry.program = std::move(program);
+        table->entries.emplace(key, std::move(entry));
+    }
+
+    // Bound sessions move to the new table
+    uint32_t key = tableKey(locale, version);
+    auto old = tables_[key];
+    for (auto& [id, bound] : sessions_) {
+        if (old && bound == old) bound = table;
+    }
+    tables_[key] = std::move(table);
+}
+
+bool FieldExtractor::hasLayouts(uint8_t locale, uint16_t version) const {
+    return tables_.contains(tableKey(locale, version));
+}
+
+void FieldExtractor::bindSession(uint32_t sessionId, uint8_t locale, uint16_t version) {
+    auto it = tables_.find(tableKey(locale, version));
+    if (it != tables_.end()) {
+        sessions_[sessionId] = it->second;
+    } else {
+        sessions_.erase(sessionId);
+    }
+}
+
+bool FieldExtractor::onPacket(const Packet& pkt, uint64_t seq) {
+    if (pkt.isHandshake) {
+        bindSession(pkt.sessionId, pkt.locale, pkt.version);
+        return true;
+    }
+    if (pkt.isDeadNotification) {
+        sessions_.erase(pkt.sessionId);
+        return true;
+    }
+    if (pkt.suppressed) return true;
+    return extract(pkt.sessionId, pkt.outbound, pkt.opcode, pkt.payload.data(), pkt.payload.size(), seq);
+}
+
+bool FieldExtractor::extract(uint32_t sessionId, bool outbound, uint16_t opcode, const uint8_t* data, size_t size,
+                             uint64_t seq) {
+    auto sit = sessions_.find(sessionId);
+    if (sit == sessions_.end()) return true;
+    auto eit = sit->second->entries.find({ outbound, opcode });
+    if (eit == sit->second->entries.end()) return true;
+
+    Entry& entry = eit->second;
+    if (entry.program.run(seq, data, size, entry.columns)) {
+        entry.parsed++;
+        return true;
+    }
+    entry.failed++;
+    return false;
+}
+
+void FieldExtractor::addStore(const PacketStore& store) {
+    TraceSpan span("analysis", "extractFields");
+    static constexpr size_t BUDGET_INTERVAL = 65536;
+    const auto& flags = store.flags();
+    for (size_t i = 0; i < store.size(); i++) {
+        uint32_t sessionId = store.sessionIds()[i];
+        if (flags[i] & PacketStore::FLAG_HANDSHAKE) {
+            Packet hs = store.get(i);
+            bindSession(sessionId, hs.locale, hs.version);
+        } else if (flags[i] & PacketStore::FLAG_DEAD) {
+            sessions_.erase(sessionId);
+        } else {
+            extract(sessionId, (flags[i] & PacketStore::FLAG_OUTBOUND) != 0, store.opcodes()[i],
+                    store.payload(i), store.payloadSize(i), i);
+        }
+        if ((i + 1) % BUDGET_INTERVAL == 0) enforceBudget();
+    }
+    enforceBudget();
+}
+
+const FieldExtractor::Entry* FieldExtractor::find(uint8_t locale, uint16_t version, bool outbound,
+                                                  uint16_t opcode) const {
+    auto tit = tables_.find(tableKey(locale, version));
+    if (tit == tables_.end()) return nullptr;
+    auto eit = tit->second->entries.find({ outbound, opcode });
+    return eit == tit->second->entries.end() ? nullptr : &eit->second;
+}
+
+const FieldColumn* FieldExtractor::column(uint8_t locale, uint16_t version, bool outbound, uint16_t opcode,
+                                          const std::string& name) const {
+    const Entry* entry = find(locale, version, outbound, opcode);
+    if (!entry) return nullptr;
+    for (const auto& c : entry->columns) {
+        if (c.name == name) return &c;
+    }
+    return nullptr;
+}
+
+std::optional<std::vector<uint64_t>> FieldExtractor::query(uint8_t locale, uint16_t version, bool outbound,
+                                                           uint16_t opcode, const FieldQuery& q, size_t limit) const {
+    TraceSpan span("analysis", "queryFields");
+    const FieldColumn* c = column(locale, version, outbound, opcode, q.column);
+    if (!c) return std::nullopt;
+
+    std::vector<uint64_t> out;
+    auto hit = [&](size_t row) {
+        // Array columns have several rows per packet: report each packet once
+        if (out.empty() || out.back() != c->seqs[row]) out.push_back(c->seqs[row]);
+        return out.size() >= limit;
+    };
+
+    using Op = FieldQuery::Op;
+    if (c->type == FieldColumn::Type::Int || c->type == FieldColumn::Type::Time) {
+        const int64_t* v = c->ints.data();
+        const int64_t x = q.number;
+        for (size_t row = 0; row < c->rows(); row++) {
+            bool match = false;
+            switch (q.op) {
+                case Op::Eq: match = v[row] == x; break;
+                case Op::Ne: match = v[row] != x; break;
+                case Op::Lt: match = v[row] < x; break;
+                case Op::Le: match = v[row] <= x; break;
+                case Op::Gt: match = v[row] > x; break;
+                case Op::Ge: match = v[row] >= x; break;
+                case Op::Contains: break;
+            }
+            if (match && hit(row)) break;
+        }
+    } else {
+        for (size_t row = 0; row < c->rows(); row++) {
+            std::string_view v = c->textAt(row);
+            bool match = false;
+            switch (q.op) {
+                case Op::Eq: match = v == q.text; break;
+                case Op::Ne: match = v != q.text; break;
+                case Op::Lt: match = v < q.text; break;
+                case Op::Le: match = v <= q.text; break;
+                case Op::Gt: match = v > q.text; break;
+                case Op::Ge: match = v >= q.text; break;
+                case Op::Contains: match = v.find(q.text) != std::string_view::npos; break;
+            }
+            if (match && hit(row)) break;
+        }
+    }
+    return out;
+}
+
+void FieldExtractor::trimBefore(uint64_t seq) {
+    keptFromSeq_ = std::max(keptFromSeq_, seq);
+    for (auto& [key, table] : tables_) {
+        for (auto& [id, entry] : table->entries) {
+            for (auto& c : entry.columns) {
+                size_t drop = static_cast<size_t>(std::lower_bound(c.seqs.begin(), c.seqs.end(), seq) - c.seqs.begin());
+                if (drop == 0) continue;
+                c.seqs.erase(c.seqs.begin(), c.seqs.begin() + drop);
+                if (c.type == FieldColumn::Type::Int || c.type == FieldColumn::Type::Time) {
+                    c.ints.erase(c.ints.begin(), c.ints.begin() + drop);
+                } else {
+                    uint32_t cut = c.textEnds[drop - 1];
+                    c.text.erase(0, cut);
+                    c.textEnds.erase(c.textEnds.begin(), c.textEnds.begin() + drop);
+                    for (auto& e : c.textEnds) e -= cut;
+                }
+            }
+        }
+    }
+}
+
+size_t FieldExtractor::memoryBytes() const {
+    size_t bytes = 0;
+    for (const auto& [key, table] : tables_) {
+        for (const auto& [id, entry] : table->entries) {
+            for (const auto& c : entry.columns) {
+                bytes += c.seqs.size() * sizeof(uint64_t) + c.ints.size() * sizeof(int64_t) +
+                         c.textEnds.size() * sizeof(uint32_t) + c.text.size();
+            }
+        }
+    }
+    return bytes;
+}
+
+void FieldExtractor::enforceBudget() {
+    size_t used = memoryBytes();
+    if (used <= options_.memoryBudget) return;
+
+    uint64_t first = UINT64_MAX;
+    uint64_t last = 0;
+    for (const auto& [key, table] : tables_) {
+        for (const auto& [id, entry] : table->entries) {
+            for (const auto& c : entry.columns) {
+                if (c.seqs.empty()) continue;
+                first = std::min(first, c.seqs.front());
+                last = std::max(last, c.seqs.back());
+            }
+        }
+    }
+    if (first > last) return;
+
+    // Rows taken as spread evenly over sequence numbers; cutting down to 3/4 of
+    // the budget leaves room so the next packets do not trim again
+    double keep = 0.75 * static_cast<double>(options_.memoryBudget) / static_cast<double>(used);
+    auto keepSeqs = static_cast<uint64_t>(static_cast<double>(last - first + 1) * keep);
+    trimBefore(last + 1 - std::max<uint64_t>(keepSeqs, 1));
+}
+
+void FieldExtractor::clearValues() {
+    keptFromSeq_ = 0;
+    for (auto& [key, table] : tables_) {
+        for (auto& [id, entry] : table->entries) {
+            entry.columns = entry.program.columns();
+            entry.parsed = entry.failed = 0;
+        }
+    }
+}
+
+std::vector<FieldSchemaStats> FieldExtractor::stats() const {
+    std::vector<FieldSchemaStats> out;
+    for (const auto& [key, table] : tables_) {
+        for (const auto& [id, entry] : table->entries) {
+            FieldSchemaStats s{ table->locale, table->version, id.first, id.second, entry.parsed, entry.failed, {} };
+            for (const auto& c : entry.columns) s.columns.push_back(&c);
+            out.push_back(std::move(s));
+        }
+    }
+    return out;
+}
+
+} // namespace maple
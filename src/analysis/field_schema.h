@@ -0,0 +1,177 @@
+#pragma once
+
+#include "../protocol/protocol.h"
+#include "../store/packet_store.h"
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace maple {
+
+// One field of a declarative opcode layout (scripts/<locale>_<version>/layouts.json).
+// Mirrors the PacketReader calls of a parse script.
+struct SchemaField {
+    enum class Type { Byte, Short, Int, Long, FileTime, String, FixedString, Bytes, Skip, Array, Object };
+
+    std::string name;
+    Type type = Type::Byte;
+    bool isSigned = false;         // integers
+    uint32_t length = 0;           // FixedString/Bytes/Skip; Array fixed count when countWidth is 0
+    uint8_t countWidth = 2;        // Array: width of the count prefix (0 = fixed count)
+    std::vector<SchemaField> children;   // Array element / Object members
+};
+
+// Typed value column of one schema. Leaf fields of objects are named
+// "obj.field", fields inside arrays "arr[].field" and get one row per element.
+struct FieldColumn {
+    enum class Type { Int, Time, String, Bytes };
+
+    std::string name;
+    Type type = Type::Int;
+    bool isSigned = false;
+    uint8_t width = 0;
+
+    std::vector<uint64_t> seqs;       // packet sequence number of each row, ascending
+    std::vector<int64_t> ints;        // Int/Time rows (sign- or zero-extended)
+    std::vector<uint32_t> textEnds;   // String/Bytes rows: end offsets into text
+    std::string text;
+
+    size_t rows() const { return seqs.size(); }
+    std::string_view textAt(size_t row) const {
+        uint32_t begin = row ? textEnds[row - 1] : 0;
+        return std::string_view(text).substr(begin, textEnds[row] - begin);
+    }
+};
+
+// Layout compiled to a flat instruction list. Arrays become a begin/end
+// pair that loops over the body, objects are flattened away.
+class SchemaProgram {
+public:
+    enum class Op : uint8_t { Int, String, FixedString, Bytes, Skip, ArrayBegin, ArrayEnd };
+
+    struct Instr {
+        Op op;
+        uint8_t width;       // Int: bytes; ArrayBegin: count prefix bytes (0 = fixed)
+        uint16_t column;     // NO_COLUMN = value discarded
+        uint32_t arg;        // length; ArrayBegin: fixed count; ArrayEnd: body start
+        uint32_t jump;       // ArrayBegin: index of its ArrayEnd
+    };
+
+    static constexpr uint16_t NO_COLUMN = 0xFFFF;
+    static constexpr size_t MAX_DEPTH = 16;
+    static constexpr uint32_t MAX_ITERATIONS = 1 << 16;   // array elements per packet
+
+    // Returns nullopt and sets error on an invalid layout
+    static std::optional<SchemaProgram> compile(const std::vector<SchemaField>& fields, std::string& error);
+
+    const std::vector<Instr>& code() const { return code_; }
+    const std::vector<FieldColumn>& columns() const { return columns_; }   // empty templates
+
+    // Run over one payload, appending a row per value. A payload that ends
+    // early or overruns leaves the columns unchanged and returns false.
+    bool run(uint64_t seq, const uint8_t* data, size_t size, std::vector<FieldColumn>& columns) const;
+
+private:
+    bool emit(const std::vector<SchemaField>& fields, const std::string& prefix, size_t depth, std::string& error);
+    uint16_t addColumn(const std::string& name, FieldColumn::Type type, bool isSigned, uint8_t width);
+
+    std::vector<Instr> code_;
+    std::vector<FieldColumn> columns_;
+};
+
+struct FieldQuery {
+    enum class Op { Eq, Ne, Lt, Le, Gt, Ge, Contains };
+
+    std::string column;
+    Op op = Op::Eq;
+    int64_t number = 0;       // Int/Time columns
+    std::string text;         // String/Bytes columns (raw bytes)
+};
+
+struct FieldSchemaStats {
+    uint8_t locale = 0;
+    uint16_t version = 0;
+    bool outbound = false;
+    uint16_t opcode = 0;
+    uint64_t parsed = 0;
+    uint64_t failed = 0;
+    std::vector<const FieldColumn*> columns;
+};
+
+// Runs the compiled layouts of each game version on every decoded packet of
+// its sessions and keeps the extracted values as typed columns keyed by packet
+// sequence number, so fields can be filtered without running scripts.
+// Past memoryBudget the oldest rows are dropped, however many packets the
+// caller itself keeps.
+class FieldExtractor {
+public:
+    using Layouts = std::map<std::pair<bool, uint16_t>, SchemaProgram>;   // (outbound, opcode)
+
+    struct Options {
+        size_t memoryBudget = 256u << 20;   // column bytes: 16 per number row, 12 + length per text row
+    };
+
+    FieldExtractor() : FieldExtractor(Options{}) {}
+    explicit FieldExtractor(const Options& options) : options_(options) {}
+
+    // Replace the layouts of one game version (drops their columns)
+    void setLayouts(uint8_t locale, uint16_t version, Layouts layouts);
+    bool hasLayouts(uint8_t locale, uint16_t version) const;
+
+    // Attach a session whose handshake was not seen (resumed after restart)
+    void bindSession(uint32_t sessionId, uint8_t locale, uint16_t version);
+
+    // Extract the fields of pkt, stored under seq; returns false if a layout failed
+    bool onPacket(const Packet& pkt, uint64_t seq);
+
+    // Extract every row of a decoded store, keyed by store index. Layouts of
+    // the versions of its handshakes must be set first.
+    void addStore(const PacketStore& store);
+
+    // Sequence numbers of packets with a row satisfying the query, ascending,
+    // at most limit. nullopt if there is no such layout or column.
+    std::optional<std::vector<uint64_t>> query(uint8_t locale, uint16_t version, bool outbound, uint16_t opcode,
+                                               const FieldQuery& q, size_t limit) const;
+
+    // Column of a layout (to check its type before building a query)
+    const FieldColumn* column(uint8_t locale, uint16_t version, bool outbound, uint16_t opcode,
+                              const std::string& name) const;
+
+    // Drop rows of packets before seq
+    void trimBefore(uint64_t seq);
+    // Drop the oldest rows while the columns exceed the memory budget
+    void enforceBudget();
+    void clearValues();
+
+    size_t memoryBytes() const;
+    uint64_t keptFromSeq() const { return keptFromSeq_; }   // older rows were dropped
+
+    std::vector<FieldSchemaStats> stats() const;
+
+private:
+    struct Entry {
+        SchemaProgram program;
+        std::vector<FieldColumn> columns;
+        uint64_t parsed = 0;
+        uint64_t failed = 0;
+    };
+    struct Table {
+        uint8_t locale = 0;
+        uint16_t version = 0;
+        std::map<std::pair<bool, uint16_t>, Entry> entries;
+    };
+
+    const Entry* find(uint8_t locale, uint16_t version, bool outbound, uint16_t opcode) const;
+    bool extract(uint32_t sessionId, bool outbound, uint16_t opcode, const uint8_t* data, size_t size, uint64_t seq);
+
+    Options options_;
+    uint64_t keptFromSeq_ = 0;
+    std::map<uint32_t, std::shared_ptr<Table>> tables_;    // key: locale << 16 | version
+    std::map<uint32_t, std::shared_ptr<Table>> sessions_;
+};
+
+} // namespace maple
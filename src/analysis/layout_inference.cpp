@@ -0,0 +1,338 @@
+#include "layout_inference.h"
+#include "../metrics/trace.h"
+#include <algorithm>
+#include <array>
+#include <iomanip>
+#include <sstream>
+
+namespace maple {
+
+namespace {
+
+constexpr size_t WINDOW = 8;
+
+// FILETIMEs accepted as dates: 2000..2100, plus the 1900-01-01 "none" sentinel
+constexpr uint64_t FILETIME_2000 = 125911584000000000ULL;
+constexpr uint64_t FILETIME_2100 = 157469184000000000ULL;
+constexpr uint64_t FILETIME_NONE = 94354848000000000ULL;
+
+struct ColumnStats {
+    uint8_t min = 0xFF;
+    uint8_t max = 0;
+    bool signOnly = true;   // every value 0x00 or 0xFF
+
+    bool varies() const { return min != max; }
+    bool zero() const { return max == 0; }
+};
+
+uint64_t readLE(const uint8_t* p, size_t width) {
+    uint64_t v = 0;
+    for (size_t i = 0; i < width; i++) v |= static_cast<uint64_t>(p[i]) << (8 * i);
+    return v;
+}
+
+bool printable(uint8_t b) {
+    // High bytes pass: strings are UTF-8 or a legacy multi-byte codepage
+    return (b >= 0x20 && b != 0x7F) || b == '\t' || b == '\r' || b == '\n';
+}
+
+class Walker {
+public:
+    Walker(std::vector<std::span<const uint8_t>> samples)
+        : samples_(std::move(samples)), pos_(samples_.size(), 0) {
+        for (auto& col : columns_) col.resize(samples_.size());
+    }
+
+    // Gather the next WINDOW bytes of every sample into columns. Returns false
+    // when any sample is exhausted (ended receives how many).
+    bool gather(size_t& ended) {
+        const size_t n = samples_.size();
+        ended = 0;
+        minAvail_ = WINDOW;
+        for (size_t s = 0; s < n; s++) {
+            size_t rem = samples_[s].size() - pos_[s];
+            if (rem == 0) { ended++; continue; }
+            size_t avail = std::min(rem, WINDOW);
+            minAvail_ = std::min(minAvail_, avail);
+            const uint8_t* p = samples_[s].data() + pos_[s];
+            for (size_t k = 0; k < WINDOW; k++) columns_[k][s] = k < avail ? p[k] : 0;
+        }
+        if (ended) return false;
+
+        // Plain loops over contiguous columns: the compiler vectorizes these
+        for (size_t k = 0; k < minAvail_; k++) {
+            const uint8_t* col = columns_[k].data();
+            uint8_t lo = 0xFF, hi = 0;
+            size_t other = 0;
+            for (size_t s = 0; s < n; s++) {
+                lo = std::min(lo, col[s]);
+                hi = std::max(hi, col[s]);
+                other += (col[s] != 0 && col[s] != 0xFF);
+            }
+            stats_[k] = { lo, hi, other == 0 };
+        }
+        return true;
+    }
+
+    size_t minAvail() const { return minAvail_; }
+    const ColumnStats& stats(size_t k) const { return stats_[k]; }
+
+    int fixedOffset() const {
+        for (size_t s = 1; s < pos_.size(); s++) {
+            if (pos_[s] != pos_[0]) return -1;
+        }
+        return static_cast<int>(pos_[0]);
+    }
+
+    // u16 length prefix that fits and is followed by printable text, in every
+    // sample, starting delta bytes past the cursor
+    bool mapleString(size_t delta, uint64_t& minLen, uint64_t& maxLen) const {
+        if (minAvail_ < delta + 2) return false;
+        size_t nonEmpty = 0;
+        minLen = UINT64_MAX;
+        maxLen = 0;
+        for (size_t s = 0; s < samples_.size(); s++) {
+            const uint8_t* p = samples_[s].data() + pos_[s] + delta;
+            size_t len = readLE(p, 2);
+            if (len > samples_[s].size() - pos_[s] - delta - 2) return false;
+            if (!std::all_of(p + 2, p + 2 + len, printable)) return false;
+            nonEmpty += len > 0;
+            minLen = std::min<uint64_t>(minLen, len);
+            maxLen = std::max<uint64_t>(maxLen, len);
+        }
+        // All-empty is indistinguishable from a zero short
+        return nonEmpty * 4 >= samples_.size() && nonEmpty > 0;
+    }
+
+    bool fileTime(size_t delta) const {
+        if (samples_.empty()) return false;
+        for (size_t s = 0; s < samples_.size(); s++) {
+            if (samples_[s].size() - pos_[s] < delta + 8) return false;
+            uint64_t v = readLE(samples_[s].data() + pos_[s] + delta, 8);
+            if ((v < FILETIME_2000 || v > FILETIME_2100) && v != FILETIME_NONE) return false;
+        }
+        return true;
+    }
+
+    // Value range, constant and counter detection for an integer of this width
+    void describe(InferredField& field, size_t width) const {
+        const size_t n = samples_.size();
+        uint64_t lo = UINT64_MAX, hi = 0, prev = 0;
+        size_t rising = 0, steps = 0;
+        for (size_t s = 0; s < n; s++) {
+            uint64_t v = readLE(samples_[s].data() + pos_[s], width);
+            lo = std::min(lo, v);
+            hi = std::max(hi, v);
+            if (s > 0) {
+                steps++;
+                if (v > prev) rising++;
+            }
+            prev = v;
+        }
+        field.minValue = lo;
+        field.maxValue = hi;
+        if (lo == hi) field.constant = lo;
+        // Strictly increasing across capture order, a few resets tolerated
+        field.counter = n >= 8 && width >= 2 && lo != hi && rising * 10 >= steps * 9;
+        field.flag = width == 1 && lo == 0 && hi == 1;
+    }
+
+    void advance(size_t width) {
+        for (auto& p : pos_) p += width;
+    }
+
+    void advanceString() {
+        for (size_t s = 0; s < samples_.size(); s++) {
+            pos_[s] += 2 + readLE(samples_[s].data() + pos_[s], 2);
+        }
+    }
+
+private:
+    std::vector<std::span<const uint8_t>> samples_;
+    std::vector<size_t> pos_;
+    std::array<std::vector<uint8_t>, WINDOW> columns_;
+    std::array<ColumnStats, WINDOW> stats_{};
+    size_t minAvail_ = 0;
+};
+
+// Width of the next integer from column statistics (m = bytes every sample still has)
+InferredField::Kind pickWidth(const Walker& w) {
+    using Kind = InferredField::Kind;
+    const size_t m = w.minAvail();
+    auto st = [&](size_t k) -> const ColumnStats& { return w.stats(k); };
+
+    // Constant run: group whole zero/constant ints rather than emitting byte by byte
+    size_t constRun = 0;
+    while (constRun < m && !st(constRun).varies()) constRun++;
+    if (constRun >= 4) return Kind::Int;
+    if (constRun >= 2) return Kind::Short;
+    if (constRun == 1) return Kind::Byte;
+
+    // Booleans: 0/1 not followed by the zero high bytes of a small int
+    if (st(0).max <= 1 && !(m >= 4 && st(1).zero() && st(2).zero() && st(3).zero())) return Kind::Byte;
+
+    // Full-range 64-bit value (ids, serial numbers): random high dword
+    if (m >= 8 && st(3).varies() && st(4).varies() && st(5).varies() && !st(7).signOnly &&
+        st(7).max - st(7).min > 0x40) {
+        return Kind::Long;
+    }
+    if (m >= 4 && (st(2).varies() || st(3).varies())) return Kind::Int;
+    if (m >= 4 && st(1).varies() && st(2).zero() && st(3).zero()) return Kind::Int;
+    if (m >= 2 && st(1).varies()) return Kind::Short;
+    if (m >= 4 && st(1).zero() && st(2).zero() && st(3).zero()) return Kind::Int;
+    if (m >= 2 && st(1).zero() && (m < 3 || st(2).varies())) return Kind::Short;
+    return Kind::Byte;
+}
+
+size_t widthOf(InferredField::Kind kind);
+
+// Column statistics cannot see where a field ends; a string or FILETIME that
+// parses in every sample inside the chosen width marks an earlier boundary
+InferredField::Kind pickInteger(const Walker& w) {
+    using Kind = InferredField::Kind;
+    Kind kind = pickWidth(w);
+    uint64_t minLen, maxLen;
+    for (size_t delta : { 4, 2, 1 }) {
+        if (delta >= widthOf(kind)) continue;
+        if (w.mapleString(delta, minLen, maxLen) || w.fileTime(delta)) {
+            return delta == 4 ? Kind::Int : delta == 2 ? Kind::Short : Kind::Byte;
+        }
+    }
+    return kind;
+}
+
+size_t widthOf(InferredField::Kind kind) {
+    switch (kind) {
+        case InferredField::Kind::Short: return 2;
+        case InferredField::Kind::Int: return 4;
+        case InferredField::Kind::Long:
+        case InferredField::Kind::FileTime: return 8;
+        default: return 1;
+    }
+}
+
+const char* prefixOf(const InferredField& f) {
+    if (f.counter) return "counter";
+    if (f.flag) return "flag";
+    switch (f.kind) {
+        case InferredField::Kind::Byte: return "byte";
+        case InferredField::Kind::Short: return "short";
+        case InferredField::Kind::Int: return "int";
+        case InferredField::Kind::Long: return "long";
+        case InferredField::Kind::FileTime: return "time";
+        case InferredField::Kind::MapleString: return "str";
+        case InferredField::Kind::Tail: return "tail";
+    }
+    return "field";
+}
+
+} // namespace
+
+InferredLayout LayoutInference::infer(const std::vector<std::span<const uint8_t>>& samples, const Options& options) {
+    TraceSpan span("analysis", "inferLayout");
+    InferredLayout layout;
+    if (samples.empty()) return layout;
+
+    // Thin evenly, keeping capture order
+    std::vector<std::span<const uint8_t>> picked;
+    size_t stride = (samples.size() + options.maxSamples - 1) / std::max<size_t>(options.maxSamples, 1);
+    for (size_t i = 0; i < samples.size(); i += std::max<size_t>(stride, 1)) picked.push_back(samples[i]);
+
+    layout.samples = picked.size();
+    layout.minSize = SIZE_MAX;
+    for (const auto& s : picked) {
+        layout.minSize = std::min(layout.minSize, s.size());
+        layout.maxSize = std::max(layout.maxSize, s.size());
+    }
+
+    Walker w(std::move(picked));
+    auto tail = [](int offset) {
+        InferredField f;
+        f.kind = InferredField::Kind::Tail;
+        f.offset = offset;
+        return f;
+    };
+    auto add = [&](InferredField f) {
+        f.name = std::string(prefixOf(f)) + std::to_string(layout.fields.size());
+        layout.fields.push_back(std::move(f));
+    };
+
+    while (true) {
+        size_t ended = 0;
+        int offset = w.fixedOffset();
+        if (!w.gather(ended)) {
+            // Some samples stop here, others go on: leave the rest to the script author
+            if (ended < layout.samples) add(tail(offset));
+            break;
+        }
+        if (layout.fields.size() + 1 >= options.maxFields) {
+            add(tail(offset));
+            break;
+        }
+
+        InferredField field;
+        field.offset = offset;
+        if (w.mapleString(0, field.minValue, field.maxValue)) {
+            field.kind = InferredField::Kind::MapleString;
+            w.advanceString();
+        } else if (w.fileTime(0)) {
+            field.kind = InferredField::Kind::FileTime;
+            w.describe(field, 8);
+            field.counter = false;
+            w.advance(8);
+        } else {
+            field.kind = pickInteger(w);
+            size_t width = widthOf(field.kind);
+            w.describe(field, width);
+            w.advance(width);
+        }
+        add(std::move(field));
+    }
+    return layout;
+}
+
+std::string LayoutInference::toScript(const InferredLayout& layout, const std::string& header) {
+    std::ostringstream out;
+    if (!header.empty()) out << "// " << header << "\n";
+    out << "// Inferred from " << layout.samples << " samples (" << layout.minSize;
+    if (layout.maxSize != layout.minSize) out << ".." << layout.maxSize;
+    out << " bytes); review names and types before saving\n";
+
+    auto hex = [](uint64_t v, size_t width) {
+        std::ostringstream h;
+        h << "0x" << std::hex << std::uppercase << std::setw(static_cast<int>(width * 2)) << std::setfill('0') << v;
+        return h.str();
+    };
+
+    for (const auto& f : layout.fields) {
+        std::string call, note;
+        switch (f.kind) {
+            case InferredField::Kind::Byte: call = "readByte"; break;
+            case InferredField::Kind::Short: call = "readShort"; break;
+            case InferredField::Kind::Int: call = "readInt"; break;
+            case InferredField::Kind::Long: call = "readLong"; break;
+            case InferredField::Kind::FileTime: call = "readFileTime"; break;
+            case InferredField::Kind::MapleString: call = "readMapleString"; break;
+            case InferredField::Kind::Tail: break;
+        }
+
+        if (f.kind == InferredField::Kind::Tail) {
+            out << "packet.readBytes(\"" << f.name << "\", packet.remaining())  // length varies\n";
+            continue;
+        }
+        if (f.kind == InferredField::Kind::MapleString) {
+            note = std::to_string(f.minValue) + ".." + std::to_string(f.maxValue) + " chars";
+        } else if (f.constant) {
+            note = "always " + hex(*f.constant, widthOf(f.kind));
+        } else if (f.kind != InferredField::Kind::FileTime && !f.flag) {
+            note = std::to_string(f.minValue) + ".." + std::to_string(f.maxValue);
+        }
+
+        out << "packet." << call << "(\"" << f.name << "\")";
+        if (!note.empty()) out << "  // " << note;
+        out << "\n";
+    }
+    return out.str();
+}
+
+} // namespace maple
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace maple {
+
+// One field of an inferred packet layout
+struct InferredField {
+    enum class Kind { Byte, Short, Int, Long, FileTime, MapleString, Tail };
+
+    Kind kind = Kind::Byte;
+    std::string name;
+    int offset = -1;                   // fixed payload offset; -1 once a string came before
+    std::optional<uint64_t> constant;  // same value in every sample
+    bool counter = false;              // increases with capture order
+    bool flag = false;                 // byte that is only ever 0 or 1
+    uint64_t minValue = 0, maxValue = 0;   // integers; string lengths for MapleString
+};
+
+struct InferredLayout {
+    size_t samples = 0;     // samples examined (evenly thinned to maxSamples)
+    size_t minSize = 0, maxSize = 0;
+    std::vector<InferredField> fields;
+};
+
+// Guesses the field layout of one opcode from its payload samples. Walks a
+// cursor through every sample at once; at each step the next 8 bytes of all
+// samples are gathered into per-position columns and the field kind is picked
+// from column statistics (constant, 0/1, sign bytes only, varying), after
+// checking for maple strings (u16 length that fits and printable text) and
+// FILETIMEs (every value a plausible date). Ambiguous widths prefer the one
+// MapleStory uses most, so the result is a starting point for a script.
+class LayoutInference {
+public:
+    struct Options {
+        size_t maxSamples = 8192;
+        size_t maxFields = 256;
+    };
+
+    // Samples in capture order (counters are detected from that order)
+    static InferredLayout infer(const std::vector<std::span<const uint8_t>>& samples, const Options& options);
+    static InferredLayout infer(const std::vector<std::span<const uint8_t>>& samples) {
+        return infer(samples, Options{});
+    }
+
+    // Skeleton parse script using the packet.readX API
+    static std::string toScript(const InferredLayout& layout, const std::string& header);
+};
+
+} // namespace maple
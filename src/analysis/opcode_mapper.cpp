@@ -0,0 +1,291 @@
+#include "opcode_mapper.h"
+#include "../metrics/trace.h"
+#include "../util/thread_pool.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <unordered_map>
+
+namespace maple {
+
+namespace {
+
+uint32_t tokenOf(const PacketStore& store, uint32_t i) {
+    bool outbound = (store.flags()[i] & PacketStore::FLAG_OUTBOUND) != 0;
+    return (outbound ? 0x10000u : 0u) | store.opcodes()[i];
+}
+
+// Minimum-cost assignment of rows to columns (rows <= cols), O(rows^2 * cols).
+// Returns the column of every row.
+std::vector<size_t> hungarian(const std::vector<std::vector<double>>& cost) {
+    const size_t n = cost.size();
+    const size_t m = n ? cost[0].size() : 0;
+    const double INF = std::numeric_limits<double>::infinity();
+    std::vector<double> u(n + 1, 0.0), v(m + 1, 0.0), minv(m + 1);
+    std::vector<size_t> p(m + 1, 0), way(m + 1, 0);
+    std::vector<char> used(m + 1);
+
+    for (size_t i = 1; i <= n; i++) {
+        p[0] = i;
+        size_t j0 = 0;
+        std::fill(minv.begin(), minv.end(), INF);
+        std::fill(used.begin(), used.end(), 0);
+        do {
+            used[j0] = 1;
+            size_t i0 = p[j0], j1 = 0;
+            double delta = INF;
+            for (size_t j = 1; j <= m; j++) {
+                if (used[j]) continue;
+                double cur = cost[i0 - 1][j - 1] - u[i0] - v[j];
+                if (cur < minv[j]) { minv[j] = cur; way[j] = j0; }
+                if (minv[j] < delta) { delta = minv[j]; j1 = j; }
+            }
+            for (size_t j = 0; j <= m; j++) {
+                if (used[j]) { u[p[j]] += delta; v[j] -= delta; }
+                else minv[j] -= delta;
+            }
+            j0 = j1;
+        } while (p[j0] != 0);
+        do {
+            size_t j1 = way[j0];
+            p[j0] = p[j1];
+            j0 = j1;
+        } while (j0);
+    }
+
+    std::vector<size_t> rowToCol(n, 0);
+    for (size_t j = 1; j <= m; j++) {
+        if (p[j]) rowToCol[p[j] - 1] = j - 1;
+    }
+    return rowToCol;
+}
+
+// Best assignment of old -> new fingerprints of one direction by score matrix
+std::vector<std::pair<size_t, size_t>> assign(const std::vector<std::vector<double>>& score) {
+    std::vector<std::pair<size_t, size_t>> pairs;
+    if (score.empty() || score[0].empty()) return pairs;
+    size_t rows = score.size(), cols = score[0].size();
+    bool transpose = rows > cols;
+
+    std::vector<std::vector<double>> cost(transpose ? cols : rows, std::vector<double>(transpose ? rows : cols));
+    for (size_t i = 0; i < rows; i++) {
+        for (size_t j = 0; j < cols; j++) {
+            (transpose ? cost[j][i] : cost[i][j]) = 1.0 - score[i][j];
+        }
+    }
+    auto rowToCol = hungarian(cost);
+    for (size_t r = 0; r < rowToCol.size(); r++) {
+        pairs.push_back(transpose ? std::make_pair(rowToCol[r], r) : std::make_pair(r, rowToCol[r]));
+    }
+    return pairs;
+}
+
+} // namespace
+
+std::vector<OpcodeFingerprint> OpcodeMapper::fingerprint(const PacketStore& store, const std::vector<uint32_t>& packets,
+                                                         size_t threads) {
+    TraceSpan span("mapper", "fingerprint");
+
+    // One sequential pass: group by opcode, note order of first appearance
+    std::map<uint32_t, std::vector<uint32_t>> positions;   // token -> positions in packets
+    std::vector<uint32_t> firstSeen[2];
+    for (uint32_t k = 0; k < packets.size(); k++) {
+        uint32_t token = tokenOf(store, packets[k]);
+        auto& list = positions[token];
+        if (list.empty()) firstSeen[token >> 16].push_back(token);
+        list.push_back(k);
+    }
+
+    std::vector<OpcodeFingerprint> out(positions.size());
+    std::vector<const std::vector<uint32_t>*> groups;
+    size_t slot = 0;
+    for (const auto& [token, list] : positions) {
+        OpcodeFingerprint& fp = out[slot++];
+        fp.outbound = (token >> 16) != 0;
+        fp.opcode = static_cast<uint16_t>(token);
+        const auto& order = firstSeen[token >> 16];
+        size_t rank = static_cast<size_t>(std::find(order.begin(), order.end(), token) - order.begin());
+        fp.firstRank = order.size() > 1 ? static_cast<double>(rank) / static_cast<double>(order.size() - 1) : 0.0;
+        groups.push_back(&list);
+    }
+
+    // Per-opcode features in parallel; every task writes only its own fingerprint
+    ThreadPool pool(threads);
+    for (size_t g = 0; g < groups.size(); g++) {
+        pool.submit([&, g] {
+            OpcodeFingerprint& fp = out[g];
+            const auto& list = *groups[g];
+            const double total = static_cast<double>(packets.size());
+            fp.count = list.size();
+            fp.frequency = static_cast<double>(list.size()) / total;
+            fp.firstPosition = static_cast<double>(list.front()) / total;
+            fp.minSize = std::numeric_limits<uint32_t>::max();
+
+            std::vector<std::array<uint32_t, 256>> byteCounts(OpcodeFingerprint::ENTROPY_POSITIONS);
+            for (auto& c : byteCounts) c.fill(0);
+            std::array<uint32_t, OpcodeFingerprint::ENTROPY_POSITIONS> samples{};
+            std::unordered_map<uint32_t, uint32_t> next;
+            uint64_t replies = 0;
+
+            for (uint32_t k : list) {
+                uint32_t i = packets[k];
+                uint32_t size = static_cast<uint32_t>(store.payloadSize(i));
+                fp.minSize = std::min(fp.minSize, size);
+                fp.maxSize = std::max(fp.maxSize, size);
+                size_t bucket = std::min<size_t>(std::bit_width(size), OpcodeFingerprint::SIZE_BUCKETS - 1);
+                fp.sizeHistogram[bucket] += 1.0;
+
+                const uint8_t* payload = store.payload(i);
+                size_t profiled = std::min<size_t>(size, OpcodeFingerprint::ENTROPY_POSITIONS);
+                for (size_t p = 0; p < profiled; p++) {
+                    byteCounts[p][payload[p]]++;
+                    samples[p]++;
+                }
+
+                if (k + 1 < packets.size()) next[tokenOf(store, packets[k + 1])]++;
+                if (k > 0) {
+                    bool prevOutbound = (store.flags()[packets[k - 1]] & PacketStore::FLAG_OUTBOUND) != 0;
+                    if (prevOutbound != fp.outbound) replies++;
+                }
+            }
+
+            for (auto& h : fp.sizeHistogram) h /= static_cast<double>(list.size());
+            fp.replyFraction = static_cast<double>(replies) / static_cast<double>(list.size());
+
+            for (size_t p = 0; p < OpcodeFingerprint::ENTROPY_POSITIONS; p++) {
+                if (samples[p] == 0) { fp.entropy[p] = -1.0; continue; }
+                double h = 0.0;
+                for (uint32_t c : byteCounts[p]) {
+                    if (!c) continue;
+                    double q = static_cast<double>(c) / samples[p];
+                    h -= q * std::log2(q);
+                }
+                fp.entropy[p] = h;
+            }
+
+            std::vector<std::pair<uint32_t, double>> succ;
+            for (const auto& [token, n] : next) succ.push_back({ token, static_cast<double>(n) / list.size() });
+            std::sort(succ.begin(), succ.end(), [](const auto& a, const auto& b) {
+                return a.second != b.second ? a.second > b.second : a.first < b.first;
+            });
+            if (succ.size() > OpcodeFingerprint::SUCCESSORS) succ.resize(OpcodeFingerprint::SUCCESSORS);
+            fp.successors = std::move(succ);
+        });
+    }
+    pool.wait();
+    return out;
+}
+
+double OpcodeMapper::similarity(const OpcodeFingerprint& a, const OpcodeFingerprint& b) {
+    if (a.outbound != b.outbound) return 0.0;
+
+    // Size distribution: histogram intersection, plus exact fixed-size agreement
+    double sizeSim = 0.0;
+    for (size_t i = 0; i < OpcodeFingerprint::SIZE_BUCKETS; i++) {
+        sizeSim += std::min(a.sizeHistogram[i], b.sizeHistogram[i]);
+    }
+    bool fixedA = a.minSize == a.maxSize, fixedB = b.minSize == b.maxSize;
+    if (fixedA && fixedB) sizeSim = 0.5 * sizeSim + (a.minSize == b.minSize ? 0.5 : 0.0);
+
+    // Position in the session (login sequence order)
+    double orderSim = 1.0 - 0.5 * (std::abs(a.firstRank - b.firstRank) + std::abs(a.firstPosition - b.firstPosition));
+
+    // Volume: frequency ratio
+    double freqSim = std::min(a.frequency, b.frequency) / std::max(a.frequency, b.frequency);
+
+    // Byte entropy profile over positions both opcodes reach
+    double entropyDiff = 0.0;
+    size_t positions = 0, onlyOne = 0;
+    for (size_t p = 0; p < OpcodeFingerprint::ENTROPY_POSITIONS; p++) {
+        if (a.entropy[p] < 0 && b.entropy[p] < 0) continue;
+        if (a.entropy[p] < 0 || b.entropy[p] < 0) { onlyOne++; continue; }
+        entropyDiff += std::abs(a.entropy[p] - b.entropy[p]) / 8.0;
+        positions++;
+    }
+    double entropySim = positions + onlyOne == 0 ? 1.0
+                        : (static_cast<double>(positions) - entropyDiff) / static_cast<double>(positions + onlyOne);
+
+    double replySim = 1.0 - std::abs(a.replyFraction - b.replyFraction);
+
+    return 0.30 * sizeSim + 0.25 * orderSim + 0.15 * freqSim + 0.20 * entropySim + 0.10 * replySim;
+}
+
+std::vector<OpcodeMatch> OpcodeMapper::map(const PacketStore& oldStore, const std::vector<uint32_t>& oldPackets,
+                                           const PacketStore& newStore, const std::vector<uint32_t>& newPackets,
+                                           const Options& options) {
+    TraceSpan span("mapper", "map");
+    auto oldPrints = fingerprint(oldStore, oldPackets, options.threads);
+    auto newPrints = fingerprint(newStore, newPackets, options.threads);
+
+    std::vector<OpcodeMatch> result;
+    auto token = [](const OpcodeFingerprint& fp) { return (fp.outbound ? 0x10000u : 0u) | fp.opcode; };
+
+    // Indices per direction
+    std::vector<size_t> oldDir[2], newDir[2];
+    for (size_t i = 0; i < oldPrints.size(); i++) oldDir[oldPrints[i].outbound].push_back(i);
+    for (size_t i = 0; i < newPrints.size(); i++) newDir[newPrints[i].outbound].push_back(i);
+
+    std::vector<std::vector<double>> base[2];
+    for (int d = 0; d < 2; d++) {
+        base[d].assign(oldDir[d].size(), std::vector<double>(newDir[d].size()));
+        for (size_t i = 0; i < oldDir[d].size(); i++) {
+            for (size_t j = 0; j < newDir[d].size(); j++) {
+                base[d][i][j] = similarity(oldPrints[oldDir[d][i]], newPrints[newDir[d][j]]);
+            }
+        }
+    }
+
+    // Round 1: fingerprints only; gives the old -> new token map used for co-occurrence
+    std::unordered_map<uint32_t, uint32_t> oldToNew;
+    for (int d = 0; d < 2; d++) {
+        for (const auto& [i, j] : assign(base[d])) {
+            if (base[d][i][j] >= options.minScore) {
+                oldToNew[token(oldPrints[oldDir[d][i]])] = token(newPrints[newDir[d][j]]);
+            }
+        }
+    }
+
+    // Round 2: successor agreement under the round-1 map
+    for (int d = 0; d < 2; d++) {
+        auto& score = base[d];
+        for (size_t i = 0; i < oldDir[d].size(); i++) {
+            const auto& a = oldPrints[oldDir[d][i]];
+            for (size_t j = 0; j < newDir[d].size(); j++) {
+                const auto& b = newPrints[newDir[d][j]];
+                double co = 0.0;
+                for (const auto& [sa, fa] : a.successors) {
+                    auto mapped = oldToNew.find(sa);
+                    if (mapped == oldToNew.end()) continue;
+                    for (const auto& [sb, fb] : b.successors) {
+                        if (sb == mapped->second) co += std::min(fa, fb);
+                    }
+                }
+                score[i][j] = 0.8 * score[i][j] + 0.2 * std::min(co, 1.0);
+            }
+        }
+
+        for (const auto& [i, j] : assign(score)) {
+            double s = score[i][j];
+            if (s < options.minScore) continue;
+
+            // Confidence drops when another candidate in the row or column is nearly as good
+            double runnerUp = 0.0;
+            for (size_t jj = 0; jj < score[i].size(); jj++) if (jj != j) runnerUp = std::max(runnerUp, score[i][jj]);
+            for (size_t ii = 0; ii < score.size(); ii++) if (ii != i) runnerUp = std::max(runnerUp, score[ii][j]);
+            double margin = std::clamp(0.5 + (s - runnerUp) * 5.0, 0.0, 1.0);
+
+            const auto& a = oldPrints[oldDir[d][i]];
+            const auto& b = newPrints[newDir[d][j]];
+            result.push_back({ a.outbound, a.opcode, b.opcode, s, s * margin });
+        }
+    }
+
+    std::sort(result.begin(), result.end(), [](const OpcodeMatch& x, const OpcodeMatch& y) {
+        return x.confidence > y.confidence;
+    });
+    return result;
+}
+
+} // namespace maple
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "../store/packet_store.h"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace maple {
+
+// Behavioural fingerprint of one opcode in one session
+struct OpcodeFingerprint {
+    static constexpr size_t SIZE_BUCKETS = 12;      // payload size by bit width: 0, 1, 2-3, 4-7, ...
+    static constexpr size_t ENTROPY_POSITIONS = 16;  // leading payload bytes profiled
+    static constexpr size_t SUCCESSORS = 4;          // most frequent next opcodes kept
+
+    bool outbound = false;
+    uint16_t opcode = 0;
+    uint64_t count = 0;
+    double frequency = 0.0;        // share of the session's packets
+    double firstPosition = 0.0;    // first occurrence / session length
+    double firstRank = 0.0;        // order of first appearance among opcodes of this direction, 0..1
+    double replyFraction = 0.0;    // share preceded by a packet in the other direction
+    uint32_t minSize = 0;
+    uint32_t maxSize = 0;
+    std::array<double, SIZE_BUCKETS> sizeHistogram{};
+    std::array<double, ENTROPY_POSITIONS> entropy{};   // bits; -1 where no packet is that long
+    std::vector<std::pair<uint32_t, double>> successors;   // (token, share); token = outbound << 16 | opcode
+};
+
+// Proposed correspondence of a new-version opcode to an old-version one
+struct OpcodeMatch {
+    bool outbound = false;
+    uint16_t oldOpcode = 0;
+    uint16_t newOpcode = 0;
+    double score = 0.0;        // fingerprint similarity, 0..1
+    double confidence = 0.0;   // score discounted by how close the runner-up was
+};
+
+// Maps opcodes between client versions from traffic alone: fingerprints the
+// opcodes of a session from each version (in parallel, one task per opcode),
+// scores every same-direction pair, and solves the assignment with the
+// Hungarian algorithm. A second round adds co-occurrence agreement: pairs
+// whose successors map onto each other under the first assignment score higher.
+class OpcodeMapper {
+public:
+    struct Options {
+        size_t threads = 0;
+        double minScore = 0.35;   // weaker pairs are not proposed
+    };
+
+    static std::vector<OpcodeFingerprint> fingerprint(const PacketStore& store, const std::vector<uint32_t>& packets,
+                                                      size_t threads = 0);
+
+    static double similarity(const OpcodeFingerprint& a, const OpcodeFingerprint& b);
+
+    static std::vector<OpcodeMatch> map(const PacketStore& oldStore, const std::vector<uint32_t>& oldPackets,
+                                        const PacketStore& newStore, const std::vector<uint32_t>& newPackets,
+                                        const Options& options);
+    static std::vector<OpcodeMatch> map(const PacketStore& oldStore, const std::vector<uint32_t>& oldPackets,
+                                        const PacketStore& newStore, const std::vector<uint32_t>& newPackets) {
+        return map(oldStore, oldPackets, newStore, newPackets, Options{});
+    }
+};
+
+} // namespace maple
@@ -0,0 +1,141 @@
+#include "response_latency.h"
+
+namespace maple {
+
+static uint32_t tableKey(uint8_t locale, uint16_t version) {
+    return (static_cast<uint32_t>(locale) << 16) | version;
+}
+
+void ResponseLatencyTracker::setPairs(uint8_t locale, uint16_t version, std::vector<OpcodePair> pairs) {
+    auto table = std::make_unique<Table>();
+    table->locale = locale;
+    table->version = version;
+    for (auto& p : pairs) {
+        auto stats = std::make_unique<PairStats>();
+        stats->pair = std::move(p);
+        table->pairs.push_back(std::move(stats));
+    }
+
+    // Sessions bound to the old table re-bind with fresh pending queues
+    auto& slot = tables_[tableKey(locale, version)];
+    for (auto& [id, session] : sessions_) {
+        if (slot && session.table == slot.get()) {
+            session.table = table.get();
+            session.pending.assign(table->pairs.size(), {});
+        }
+    }
+    slot = std::move(table);
+}
+
+bool ResponseLatencyTracker::hasPairs(uint8_t locale, uint16_t version) const {
+    return tables_.count(tableKey(locale, version)) != 0;
+}
+
+void ResponseLatencyTracker::bindSession(uint32_t sessionId, uint8_t locale, uint16_t version) {
+    auto it = tables_.find(tableKey(locale, version));
+    SessionState& session = sessions_[sessionId];
+    session.table = it != tables_.end() ? it->second.get() : nullptr;
+    session.pending.assign(session.table ? session.table->pairs.size() : 0, {});
+}
+
+void ResponseLatencyTracker::onPacket(const Packet& pkt) {
+    if (pkt.isHandshake) {
+        bindSession(pkt.sessionId, pkt.locale, pkt.version);
+        return;
+    }
+    if (pkt.isDeadNotification) {
+        sessions_.erase(pkt.sessionId);
+        return;
+    }
+
+    auto sit = sessions_.find(pkt.sessionId);
+    if (sit == sessions_.end() || !sit->second.table) return;
+    SessionState& session = sit->second;
+    auto& pairs = session.table->pairs;
+
+    for (size_t i = 0; i < pairs.size(); i++) {
+        PairStats& stats = *pairs[i];
+        auto& pending = session.pending[i];
+        advanceInterval(stats, pkt.timestampNs);
+
+        // Requests that waited too long will never be matched
+        while (!pending.empty() && pkt.timestampNs - pending.front() > stats.pair.timeoutNs) {
+            pending.pop_front();
+            stats.unanswered++;
+        }
+
+        if (pkt.outbound && pkt.opcode == stats.pair.request) {
+            if (pending.size() >= MAX_PENDING) {
+                pending.pop_front();
+                stats.unanswered++;
+            }
+            pending.push_back(pkt.timestampNs);
+        } else if (!pkt.outbound && pkt.opcode == stats.pair.response && !pending.empty()) {
+            // A response answers the latest outstanding request. Matching the
+            // oldest instead would let one dropped request skew every later
+            // pair until it times out; the skipped ones count as unanswered.
+            int64_t latency = pkt.timestampNs - pending.back();
+            stats.unanswered += pending.size() - 1;
+            pending.clear();
+            stats.histogram.record(latency > 0 ? static_cast<uint64_t>(latency) : 0);
+        }
+    }
+}
+
+void ResponseLatencyTracker::advanceInterval(PairStats& stats, int64_t nowNs) {
+    if (stats.intervalStartNs < 0) {
+        stats.intervalStartNs = nowNs - nowNs % intervalNs_;
+        stats.intervalBase = stats.histogram.snapshot();
+        return;
+    }
+    if (nowNs < stats.intervalStartNs + intervalNs_) return;
+
+    // Close the finished interval; idle gaps produce no empty entries
+    auto current = stats.histogram.snapshot();
+    auto delta = current - stats.intervalBase;
+    if (delta.count > 0) {
+        stats.series.push_back(summarize(delta, stats.intervalStartNs));
+        if (stats.series.size() > MAX_SERIES) stats.series.pop_front();
+    }
+    stats.intervalBase = std::move(current);
+    stats.intervalStartNs = nowNs - nowNs % intervalNs_;
+}
+
+LatencySummary ResponseLatencyTracker::summarize(const LatencyHistogram::Snapshot& snap, int64_t startNs) {
+    LatencySummary s;
+    s.startNs = startNs;
+    s.count = snap.count;
+    s.meanNs = static_cast<uint64_t>(snap.mean());
+    s.p50Ns = snap.percentile(0.5);
+    s.p90Ns = snap.percentile(0.9);
+    s.p99Ns = snap.percentile(0.99);
+    s.maxNs = snap.max();
+    return s;
+}
+
+std::vector<PairLatencyReport> ResponseLatencyTracker::report() const {
+    std::vector<PairLatencyReport> out;
+    for (const auto& [key, table] : tables_) {
+        for (const auto& stats : table->pairs) {
+            PairLatencyReport r;
+            r.pair = stats->pair;
+            r.locale = table->locale;
+            r.version = table->version;
+            r.unanswered = stats->unanswered;
+
+            auto snap = stats->histogram.snapshot();
+            r.total = summarize(snap, 0);
+            r.series.assign(stats->series.begin(), stats->series.end());
+
+            // Include the interval still in progress
+            auto open = snap - stats->intervalBase;
+            if (stats->intervalStartNs >= 0 && open.count > 0) {
+                r.series.push_back(summarize(open, stats->intervalStartNs));
+            }
+            out.push_back(std::move(r));
+        }
+    }
+    return out;
+}
+
+} // namespace maple
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "../metrics/histogram.h"
+#include "../protocol/protocol.h"
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace maple {
+
+// One request/response correlation rule: an outbound request opcode answered
+// by an inbound response opcode on the same session
+struct OpcodePair {
+    std::string name;
+    uint16_t request = 0;
+    uint16_t response = 0;
+    int64_t timeoutNs = 5'000'000'000;  // unanswered requests older than this are dropped
+};
+
+// Latency summary of one interval (or the whole run)
+struct LatencySummary {
+    int64_t startNs = 0;     // capture time the interval starts at
+    uint64_t count = 0;
+    uint64_t meanNs = 0;
+    uint64_t p50Ns = 0;
+    uint64_t p90Ns = 0;
+    uint64_t p99Ns = 0;
+    uint64_t maxNs = 0;
+};
+
+struct PairLatencyReport {
+    OpcodePair pair;
+    uint8_t locale = 0;
+    uint16_t version = 0;
+    uint64_t unanswered = 0;          // requests that timed out
+    LatencySummary total;
+    std::vector<LatencySummary> series;  // closed intervals, oldest first
+};
+
+// Correlates requests with responses per session and keeps incremental
+// latency percentiles per pair: a cumulative histogram plus one summary per
+// interval of capture time. All timing is integer nanoseconds.
+// Pair tables are per locale/version; sessions pick theirs up at handshake.
+// Not synchronized: callers serialize access.
+class ResponseLatencyTracker {
+public:
+    static constexpr int64_t DEFAULT_INTERVAL_NS = 60'000'000'000;  // one summary per minute
+    static constexpr size_t MAX_SERIES = 24 * 60;                   // a day of minutes
+    static constexpr size_t MAX_PENDING = 256;                      // per session and pair
+
+    explicit ResponseLatencyTracker(int64_t intervalNs = DEFAULT_INTERVAL_NS) : intervalNs_(intervalNs) {}
+
+    // Replace the pairing table for one game version (resets its statistics)
+    void setPairs(uint8_t locale, uint16_t version, std::vector<OpcodePair> pairs);
+    bool hasPairs(uint8_t locale, uint16_t version) const;
+
+    // Feed decoded packets in capture order (handshakes bind sessions to a table)
+    void onPacket(const Packet& pkt);
+
+    // Attach a session whose handshake was not seen (resumed after restart)
+    void bindSession(uint32_t sessionId, uint8_t locale, uint16_t version);
+
+    std::vector<PairLatencyReport> report() const;
+
+private:
+    struct PairStats {
+        OpcodePair pair;
+        uint64_t unanswered = 0;
+        LatencyHistogram histogram;
+        LatencyHistogram::Snapshot intervalBase;  // cumulative state at interval start
+        int64_t intervalStartNs = -1;
+        std::deque<LatencySummary> series;
+    };
+
+    struct Table {
+        uint8_t locale = 0;
+        uint16_t version = 0;
+        std::vector<std::unique_ptr<PairStats>> pairs;
+    };
+
+    struct SessionState {
+        Table* table = nullptr;
+        std::vector<std::deque<int64_t>> pending;  // request timestamps per pair index
+    };
+
+    void advanceInterval(PairStats& stats, int64_t nowNs);
+    static LatencySummary summarize(const LatencyHistogram::Snapshot& snap, int64_t startNs);
+
+    int64_t intervalNs_;
+    std::map<uint32_t, std::unique_ptr<Table>> tables_;   // key: locale << 16 | version
+    std::map<uint32_t, SessionState> sessions_;
+};
+
+} // namespace maple
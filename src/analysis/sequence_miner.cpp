@@ -0,0 +1,253 @@
+#include "sequence_miner.h"
+#include <algorithm>
+#include <utility>
+#include <unordered_set>
+
+namespace maple {
+
+namespace {
+
+// One symbol into a running n-gram hash. Hashes run newest symbol first, so
+// every length ending at a packet comes out of one pass over the window.
+uint64_t hashStep(uint64_t h, uint32_t symbol) {
+    h = (h ^ symbol) * 0x9E3779B97F4A7C15ull;
+    return h ^ (h >> 29);
+}
+
+constexpr uint64_t HASH_SEED = 0x243F6A8885A308D3ull;
+constexpr size_t MIN_SLOTS = 4096;
+
+} // namespace
+
+SequenceMiner::SequenceMiner(const Options& options) : options_(options) {
+    options_.maxLength = std::clamp<size_t>(options_.maxLength, 2, MAX_LENGTH);
+}
+
+uint64_t SequenceMiner::hashSymbols(const uint32_t* newestFirst, size_t length) {
+    uint64_t h = HASH_SEED;
+    for (size_t i = 0; i < length; i++) h = hashStep(h, newestFirst[i]);
+    return h;
+}
+
+const SequenceMiner::Entry* SequenceMiner::find(uint64_t hash) const {
+    if (slots_.empty()) return nullptr;
+    size_t mask = slots_.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        if (slots_[i].hash == hash) return &slots_[i];
+        if (slots_[i].hash == 0) return nullptr;
+    }
+}
+
+SequenceMiner::Entry& SequenceMiner::slot(uint64_t hash) {
+    size_t mask = slots_.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        if (slots_[i].hash == hash || slots_[i].hash == 0) return slots_[i];
+    }
+}
+
+uint64_t SequenceMiner::countOf(const uint32_t* newestFirst, size_t length) const {
+    const Entry* e = find(hashSymbols(newestFirst, length) | 1);
+    return e ? e->count : 0;
+}
+
+// Moves entries whose count + error reaches minBound into a table of the given size
+void SequenceMiner::rehash(size_t capacity, uint64_t minBound) {
+    std::vector<Entry> old = std::exchange(slots_, std::vector<Entry>(capacity));
+    entries_ = 0;
+    for (const Entry& e : old) {
+        if (e.hash == 0 || e.count + e.error < minBound) continue;
+        slot(e.hash) = e;
+        entries_++;
+    }
+}
+
+void SequenceMiner::onPacket(const Packet& pkt) {
+    if (pkt.isHandshake || pkt.isDeadNotification) {
+        endSession(pkt.sessionId);
+        return;
+    }
+    if (pkt.suppressed) return;
+    add(pkt.sessionId, pkt.outbound, pkt.opcode, pkt.timestampNs);
+}
+
+void SequenceMiner::addStore(const PacketStore& store) {
+    const auto& flags = store.flags();
+    for (size_t i = 0; i < store.size(); i++) {
+        if (flags[i] & (PacketStore::FLAG_HANDSHAKE | PacketStore::FLAG_DEAD)) {
+            endSession(store.sessionIds()[i]);
+            continue;
+        }
+        add(store.sessionIds()[i], (flags[i] & PacketStore::FLAG_OUTBOUND) != 0,
+            store.opcodes()[i], store.timestampsNs()[i]);
+    }
+}
+
+void SequenceMiner::add(uint32_t sessionId, bool outbound, uint16_t opcode, int64_t timestampNs) {
+    packets_++;
+    SessionWindow& w = sessions_[sessionId];
+
+    // The latest request is the one a response answers
+    if (outbound) {
+        requests_[opcode]++;
+        w.pendingRequest = true;
+        w.request = opcode;
+        w.requestNs = timestampNs;
+    } else if (w.pendingRequest) {
+        int64_t elapsed = timestampNs - w.requestNs;
+        if (elapsed <= options_.responseWindowNs) {
+            ResponseCount& rc = responses_[(static_cast<uint32_t>(w.request) << 16) | opcode];
+            rc.count++;
+            rc.totalNs += static_cast<uint64_t>(std::max<int64_t>(elapsed, 0));
+        }
+        w.pendingRequest = false;
+    }
+
+    uint32_t symbol = OpcodeSymbol::make(outbound, opcode);
+    if (options_.collapseRepeats && w.size > 0 && w.recent[w.head] == symbol) return;
+
+    w.head = (w.head + 1) % MAX_LENGTH;
+    w.recent[w.head] = symbol;
+    w.size = std::min(w.size + 1, MAX_LENGTH);
+
+    std::array<uint32_t, MAX_LENGTH> window;
+    for (size_t k = 0; k < w.size; k++) window[k] = w.recent[(w.head + MAX_LENGTH - k) % MAX_LENGTH];
+
+    // Judge the transition against what was counted before this packet
+    if (w.size >= 2) {
+        uint64_t before = countOf(window.data() + 1, 1);
+        if (before >= options_.anomalySupport) {
+            // A pruned transition may have occurred up to floor_ times
+            const Entry* pair = find(hashSymbols(window.data(), 2) | 1);
+            uint64_t seen = pair ? pair->count + pair->error : floor_;
+            double p = static_cast<double>(seen) / static_cast<double>(before);
+            if (p < options_.anomalyProbability) {
+                if (anomalies_.size() >= options_.maxAnomalies) anomalies_.pop_front();
+                anomalies_.push_back({ sessionId, timestampNs, window[1], symbol, p });
+            }
+        }
+    }
+
+    size_t lengths = std::min(w.size, options_.maxLength);
+    uint64_t h = HASH_SEED;
+    for (size_t n = 1; n <= lengths; n++) {
+        // Grow while under budget, prune once at it; keeps the table at most half full
+        if ((entries_ + 1) * 2 > slots_.size()) {
+            if (entries_ >= options_.maxEntries) prune();
+            else rehash(std::max(slots_.size() * 2, MIN_SLOTS), 0);
+        }
+        h = hashStep(h, window[n - 1]);
+        Entry& e = slot(h | 1);   // odd hashes, so 0 marks empty slots
+        if (e.hash == 0) {
+            e.hash = h | 1;
+            for (size_t i = 0; i < n; i++) e.symbols[i] = window[n - 1 - i];
+            e.length = static_cast<uint8_t>(n);
+            e.error = floor_;
+            entries_++;
+        }
+        e.count++;
+    }
+}
+
+void SequenceMiner::prune() {
+    // Raise the floor so about a quarter of the budget is freed at once
+    size_t target = options_.maxEntries - options_.maxEntries / 4;
+    std::vector<uint64_t> bounds;
+    bounds.reserve(entries_);
+    for (const Entry& e : slots_) {
+        if (e.hash) bounds.push_back(e.count + e.error);
+    }
+    size_t drop = entries_ - target;
+    std::nth_element(bounds.begin(), bounds.begin() + static_cast<ptrdiff_t>(drop - 1), bounds.end());
+    floor_ = std::max(floor_ + 1, bounds[drop - 1]);
+    rehash(slots_.size(), floor_ + 1);
+}
+
+std::vector<OpcodeSequence> SequenceMiner::top(size_t minLength, size_t limit, bool closedOnly) const {
+    std::array<uint32_t, MAX_LENGTH> newestFirst;
+    auto reversed = [&](const Entry& e, size_t from, size_t length) {
+        for (size_t i = 0; i < length; i++) newestFirst[i] = e.symbols[from + length - 1 - i];
+        return newestFirst.data();
+    };
+
+    // A sequence is covered when prepending or appending one packet loses
+    // less than a tenth of its occurrences
+    std::unordered_set<uint64_t> covered;
+    if (closedOnly) {
+        for (const Entry& e : slots_) {
+            if (e.hash == 0 || e.length < 2) continue;
+            size_t n = e.length - 1u;
+            for (size_t from : { size_t{ 0 }, size_t{ 1 } }) {
+                const Entry* parent = find(hashSymbols(reversed(e, from, n), n) | 1);
+                if (parent && e.count * 10 >= parent->count * 9) covered.insert(parent->hash);
+            }
+        }
+    }
+
+    std::vector<const Entry*> candidates;
+    for (const Entry& e : slots_) {
+        if (e.hash == 0 || e.length < minLength || covered.contains(e.hash)) continue;
+        candidates.push_back(&e);
+    }
+    size_t n = std::min(limit, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + static_cast<ptrdiff_t>(n), candidates.end(),
+                      [](const Entry* a, const Entry* b) {
+                          if (a->count != b->count) return a->count > b->count;
+                          return a->length > b->length;
+                      });
+
+    std::vector<OpcodeSequence> result;
+    result.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+        const Entry& e = *candidates[i];
+        OpcodeSequence seq;
+        seq.symbols.assign(e.symbols.begin(), e.symbols.begin() + e.length);
+        seq.count = e.count;
+        seq.error = e.error;
+        uint64_t prefix = e.length > 1 ? countOf(reversed(e, 0, e.length - 1u), e.length - 1u) : packets_;
+        seq.confidence = prefix ? std::min(1.0, static_cast<double>(e.count) / static_cast<double>(prefix)) : 0.0;
+        result.push_back(std::move(seq));
+    }
+    return result;
+}
+
+std::vector<ResponseCandidate> SequenceMiner::responses(size_t limit) const {
+    std::vector<ResponseCandidate> result;
+    result.reserve(responses_.size());
+    for (const auto& [key, rc] : responses_) {
+        ResponseCandidate c;
+        c.request = static_cast<uint16_t>(key >> 16);
+        c.response = static_cast<uint16_t>(key);
+        c.count = rc.count;
+        auto it = requests_.find(c.request);
+        c.requests = it != requests_.end() ? it->second : 0;
+        c.meanNs = rc.count ? rc.totalNs / rc.count : 0;
+        result.push_back(c);
+    }
+    size_t n = std::min(limit, result.size());
+    std::partial_sort(result.begin(), result.begin() + static_cast<ptrdiff_t>(n), result.end(),
+                      [](const ResponseCandidate& a, const ResponseCandidate& b) { return a.count > b.count; });
+    result.resize(n);
+    return result;
+}
+
+SequenceMinerStats SequenceMiner::stats() const {
+    SequenceMinerStats s;
+    s.packets = packets_;
+    s.sessions = sessions_.size();
+    s.entries = entries_;
+    s.floor = floor_;
+    return s;
+}
+
+void SequenceMiner::clear() {
+    slots_.clear();
+    entries_ = 0;
+    sessions_.clear();
+    responses_.clear();
+    requests_.clear();
+    anomalies_.clear();
+    packets_ = 0;
+    floor_ = 0;
+}
+
+} // namespace maple
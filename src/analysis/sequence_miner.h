@@ -0,0 +1,134 @@
+#pragma once
+
+#include "../protocol/protocol.h"
+#include "../store/packet_store.h"
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+namespace maple {
+
+// A packet as the miner sees it: direction and opcode in one 17-bit symbol
+struct OpcodeSymbol {
+    static uint32_t make(bool outbound, uint16_t opcode) { return (outbound ? 0x10000u : 0u) | opcode; }
+    static bool outbound(uint32_t symbol) { return (symbol & 0x10000u) != 0; }
+    static uint16_t opcode(uint32_t symbol) { return static_cast<uint16_t>(symbol); }
+};
+
+struct OpcodeSequence {
+    std::vector<uint32_t> symbols;   // OpcodeSymbol values, oldest first
+    uint64_t count = 0;              // occurrences (may undercount by at most error)
+    uint64_t error = 0;
+    double confidence = 0;           // count / count of the sequence minus its last packet
+};
+
+// An outbound opcode and the inbound opcode that most often came first after it
+struct ResponseCandidate {
+    uint16_t request = 0;
+    uint16_t response = 0;
+    uint64_t count = 0;       // times response was the first inbound packet after request
+    uint64_t requests = 0;    // times request was sent
+    uint64_t meanNs = 0;      // mean time from request to response
+};
+
+// A packet whose opcode rarely follows the previous one
+struct SequenceAnomaly {
+    uint32_t sessionId = 0;
+    int64_t timestampNs = 0;
+    uint32_t previous = 0;    // OpcodeSymbol
+    uint32_t symbol = 0;
+    double probability = 0;   // how often symbol followed previous before this packet
+};
+
+struct SequenceMinerStats {
+    uint64_t packets = 0;
+    uint64_t sessions = 0;
+    uint64_t entries = 0;     // counted n-grams in the table
+    uint64_t floor = 0;       // counts at or below this were pruned to stay in budget
+};
+
+// Frequent opcode n-grams per session, counted incrementally with a hashed
+// sliding window: each packet adds one n-gram per length ending at it, into
+// an open-addressing table. The table is kept under maxEntries by pruning the
+// rarest entries (lossy counting); entries created after a prune carry the
+// pruned count as their error bound. Runs of one opcode collapse to one symbol so movement and
+// keep-alive spam does not drown the flows around it.
+// Not synchronized: callers serialize access.
+class SequenceMiner {
+public:
+    static constexpr size_t MAX_LENGTH = 8;
+
+    struct Options {
+        size_t maxLength = 6;               // longest n-gram counted (<= MAX_LENGTH)
+        size_t maxEntries = 1 << 19;        // table budget (~64 MiB)
+        bool collapseRepeats = true;
+        int64_t responseWindowNs = 2'000'000'000;   // later inbound packets are not responses
+        uint64_t anomalySupport = 200;      // previous opcode seen at least this often
+        double anomalyProbability = 0.001;  // transitions rarer than this are anomalies
+        size_t maxAnomalies = 1000;         // most recent kept
+    };
+
+    SequenceMiner() : SequenceMiner(Options{}) {}
+    explicit SequenceMiner(const Options& options);
+
+    // Feed packets in capture order (handshakes and dead streams end a session's window)
+    void onPacket(const Packet& pkt);
+    void add(uint32_t sessionId, bool outbound, uint16_t opcode, int64_t timestampNs);
+    void endSession(uint32_t sessionId) { sessions_.erase(sessionId); }
+
+    // Every row of a store, in order
+    void addStore(const PacketStore& store);
+
+    // Most frequent n-grams of at least minLength packets. closedOnly hides a
+    // sequence when a one-packet extension of it occurs nearly as often.
+    std::vector<OpcodeSequence> top(size_t minLength, size_t limit, bool closedOnly = true) const;
+    std::vector<ResponseCandidate> responses(size_t limit) const;
+    const std::deque<SequenceAnomaly>& anomalies() const { return anomalies_; }
+    SequenceMinerStats stats() const;
+
+    void clear();
+
+private:
+    struct Entry {
+        uint64_t hash = 0;    // 0 = empty slot
+        uint64_t count = 0;
+        uint64_t error = 0;
+        std::array<uint32_t, MAX_LENGTH> symbols{};
+        uint8_t length = 0;
+    };
+
+    struct SessionWindow {
+        std::array<uint32_t, MAX_LENGTH> recent{};   // ring of the last symbols
+        size_t size = 0;                             // symbols seen, saturating at MAX_LENGTH
+        size_t head = 0;                             // slot of the newest
+        bool pendingRequest = false;
+        uint16_t request = 0;
+        int64_t requestNs = 0;
+    };
+
+    struct ResponseCount {
+        uint64_t count = 0;
+        uint64_t totalNs = 0;
+    };
+
+    static uint64_t hashSymbols(const uint32_t* newestFirst, size_t length);
+    const Entry* find(uint64_t hash) const;
+    Entry& slot(uint64_t hash);    // existing entry or the empty slot it goes in
+    uint64_t countOf(const uint32_t* newestFirst, size_t length) const;
+    void rehash(size_t capacity, uint64_t minBound);
+    void prune();
+
+    Options options_;
+    std::vector<Entry> slots_;     // power-of-two size, at most half full
+    size_t entries_ = 0;
+    std::unordered_map<uint32_t, SessionWindow> sessions_;
+    std::unordered_map<uint32_t, ResponseCount> responses_;   // key: request << 16 | response
+    std::unordered_map<uint16_t, uint64_t> requests_;
+    std::deque<SequenceAnomaly> anomalies_;
+    uint64_t packets_ = 0;
+    uint64_t floor_ = 0;
+};
+
+} // namespace maple
@@ -0,0 +1,261 @@
+#include "session_diff.h"
+#include "../metrics/trace.h"
+#include "../util/thread_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace maple {
+
+namespace {
+
+// Longest common subsequence of a and b as matched index pairs, via Myers'
+// bisection (middle snake) recursion: O((N+M)D) time, O(N+M) space.
+template <typename T>
+class Myers {
+public:
+    Myers(const T* a, size_t n, const T* b, size_t m, int64_t maxCost)
+        : a_(a), b_(b), maxCost_(maxCost) {
+        size_t size = 2 * (n + m) + 2;
+        v1_.resize(size);
+        v2_.resize(size);
+        run(0, static_cast<int64_t>(n), 0, static_cast<int64_t>(m));
+    }
+
+    // Matched (i, j) pairs in increasing order
+    const std::vector<std::pair<uint32_t, uint32_t>>& matches() const { return matches_; }
+    bool approximate() const { return approximate_; }
+
+private:
+    void run(int64_t aLo, int64_t aHi, int64_t bLo, int64_t bHi) {
+        // Common prefix and suffix never need the expensive search
+        while (aLo < aHi && bLo < bHi && a_[aLo] == b_[bLo]) {
+            matches_.push_back({ static_cast<uint32_t>(aLo++), static_cast<uint32_t>(bLo++) });
+        }
+        int64_t suffix = 0;
+        while (aLo < aHi - suffix && bLo < bHi - suffix && a_[aHi - 1 - suffix] == b_[bHi - 1 - suffix]) suffix++;
+
+        if (aLo < aHi - suffix && bLo < bHi - suffix) {
+            int64_t x, y;
+            if (bisect(aLo, aHi - suffix, bLo, bHi - suffix, x, y)) {
+                run(aLo, aLo + x, bLo, bLo + y);
+                run(aLo + x, aHi - suffix, bLo + y, bHi - suffix);
+            }
+        }
+
+        for (int64_t s = suffix; s > 0; s--) {
+            matches_.push_back({ static_cast<uint32_t>(aHi - s), static_cast<uint32_t>(bHi - s) });
+        }
+    }
+
+    // Find where a shortest edit path of a[aLo, aHi) -> b[bLo, bHi) crosses its
+    // middle. Returns false if the ranges share nothing worth aligning.
+    bool bisect(int64_t aLo, int64_t aHi, int64_t bLo, int64_t bHi, int64_t& splitX, int64_t& splitY) {
+        const int64_t n = aHi - aLo;
+        const int64_t m = bHi - bLo;
+        const int64_t maxD = (n + m + 1) / 2;
+        const int64_t offset = maxD;
+        const int64_t length = 2 * maxD + 2;
+        std::fill(v1_.begin(), v1_.begin() + length, -1);
+        std::fill(v2_.begin(), v2_.begin() + length, -1);
+        v1_[offset + 1] = 0;
+        v2_[offset + 1] = 0;
+
+        const int64_t delta = n - m;
+        const bool front = (delta % 2) != 0;
+        int64_t k1start = 0, k1end = 0, k2start = 0, k2end = 0;
+        int64_t bestX = 0, bestY = 0;
+
+        for (int64_t d = 0; d < maxD; d++) {
+            if (d > maxCost_) {
+                // Too different to align exactly in reasonable time: split at the
+                // furthest forward point (still valid, no longer minimal)
+                approximate_ = true;
+                if (bestX + bestY == 0 || (bestX == n && bestY == m)) return false;
+                splitX = bestX;
+                splitY = bestY;
+                return true;
+            }
+
+            for (int64_t k1 = -d + k1start; k1 <= d - k1end; k1 += 2) {
+                int64_t k1off = offset + k1;
+                int64_t x1 = (k1 == -d || (k1 != d && v1_[k1off - 1] < v1_[k1off + 1]))
+                                 ? v1_[k1off + 1] : v1_[k1off - 1] + 1;
+                int64_t y1 = x1 - k1;
+                while (x1 < n && y1 < m && a_[aLo + x1] == b_[bLo + y1]) { x1++; y1++; }
+                v1_[k1off] = x1;
+                if (x1 > n) {
+                    k1end += 2;
+                } else if (y1 > m) {
+                    k1start += 2;
+                } else {
+                    if (x1 + y1 > bestX + bestY) { bestX = x1; bestY = y1; }
+                    if (front) {
+                        int64_t k2off = offset + delta - k1;
+                        if (k2off >= 0 && k2off < length && v2_[k2off] != -1 && x1 >= n - v2_[k2off]) {
+                            splitX = x1;
+                            splitY = y1;
+                            return true;
+                        }
+                    }
+                }
+            }
+
+            for (int64_t k2 = -d + k2start; k2 <= d - k2end; k2 += 2) {
+                int64_t k2off = offset + k2;
+                int64_t x2 = (k2 == -d || (k2 != d && v2_[k2off - 1] < v2_[k2off + 1]))
+                                 ? v2_[k2off + 1] : v2_[k2off - 1] + 1;
+                int64_t y2 = x2 - k2;
+                while (x2 < n && y2 < m && a_[aHi - 1 - x2] == b_[bHi - 1 - y2]) { x2++; y2++; }
+                v2_[k2off] = x2;
+                if (x2 > n) {
+                    k2end += 2;
+                } else if (y2 > m) {
+                    k2start += 2;
+                } else if (!front) {
+                    int64_t k1off = offset + delta - k2;
+                    if (k1off >= 0 && k1off < length && v1_[k1off] != -1) {
+                        int64_t x1 = v1_[k1off];
+                        int64_t y1 = offset + x1 - k1off;
+                        if (x1 >= n - x2) {
+                            splitX = x1;
+                            splitY = y1;
+                            return true;
+                        }
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+    const T* a_;
+    const T* b_;
+    int64_t maxCost_;
+    bool approximate_ = false;
+    std::vector<int64_t> v1_, v2_;
+    std::vector<std::pair<uint32_t, uint32_t>> matches_;
+};
+
+// Alignment token: direction + opcode
+uint32_t token(const PacketStore& store, uint32_t i) {
+    bool outbound = (store.flags()[i] & PacketStore::FLAG_OUTBOUND) != 0;
+    return (outbound ? 0x10000u : 0u) | store.opcodes()[i];
+}
+
+} // namespace
+
+std::vector<uint32_t> SessionDiff::sessionPackets(const PacketStore& store, uint32_t sessionId) {
+    std::vector<uint32_t> out;
+    const auto& ids = store.sessionIds();
+    const auto& flags = store.flags();
+    for (size_t i = 0; i < store.size(); i++) {
+        if (ids[i] != sessionId) continue;
+        if (flags[i] & (PacketStore::FLAG_HANDSHAKE | PacketStore::FLAG_DEAD)) continue;
+        out.push_back(static_cast<uint32_t>(i));
+    }
+    return out;
+}
+
+std::vector<ByteRange> SessionDiff::diffBytes(const uint8_t* a, size_t lenA, const uint8_t* b, size_t lenB,
+                                              int64_t maxEditCost) {
+    std::vector<ByteRange> ranges;
+
+    // Same size: most edits are in-place field changes, no alignment needed
+    if (lenA == lenB) {
+        size_t i = 0;
+        while (i < lenA) {
+            if (a[i] == b[i]) { i++; continue; }
+            size_t start = i;
+            while (i < lenA && a[i] != b[i]) i++;
+            uint32_t off = static_cast<uint32_t>(start), len = static_cast<uint32_t>(i - start);
+            ranges.push_back({ off, len, off, len });
+        }
+        return ranges;
+    }
+
+    Myers<uint8_t> myers(a, lenA, b, lenB, maxEditCost);
+    uint32_t ia = 0, ib = 0;
+    auto flush = [&](uint32_t toA, uint32_t toB) {
+        if (toA > ia || toB > ib) ranges.push_back({ ia, toA - ia, ib, toB - ib });
+    };
+    for (const auto& [ma, mb] : myers.matches()) {
+        flush(ma, mb);
+        ia = ma + 1;
+        ib = mb + 1;
+    }
+    flush(static_cast<uint32_t>(lenA), static_cast<uint32_t>(lenB));
+    return ranges;
+}
+
+SessionDiffResult SessionDiff::diff(const PacketStore& storeA, const std::vector<uint32_t>& packetsA,
+                                    const PacketStore& storeB, const std::vector<uint32_t>& packetsB,
+                                    const Options& options) {
+    TraceSpan span("diff", "sessions");
+    auto started = std::chrono::steady_clock::now();
+    SessionDiffResult result;
+
+    std::vector<uint32_t> tokensA(packetsA.size()), tokensB(packetsB.size());
+    for (size_t i = 0; i < packetsA.size(); i++) tokensA[i] = token(storeA, packetsA[i]);
+    for (size_t i = 0; i < packetsB.size(); i++) tokensB[i] = token(storeB, packetsB[i]);
+
+    std::vector<std::pair<uint32_t, uint32_t>> matches;
+    {
+        TraceSpan align("diff", "align");
+        Myers<uint32_t> myers(tokensA.data(), tokensA.size(), tokensB.data(), tokensB.size(), options.maxEditCost);
+        matches = myers.matches();
+        result.approximate = myers.approximate();
+    }
+
+    // Walk the alignment: unmatched runs become removals then additions
+    std::vector<size_t> pairEntries;   // entries that still need a byte comparison
+    result.entries.reserve(std::max(packetsA.size(), packetsB.size()));
+    size_t ia = 0, ib = 0;
+    auto emitGap = [&](size_t toA, size_t toB) {
+        for (; ia < toA; ia++) result.entries.push_back({ DiffEntry::Kind::Removed, static_cast<int64_t>(ia), -1, {} });
+        for (; ib < toB; ib++) result.entries.push_back({ DiffEntry::Kind::Added, -1, static_cast<int64_t>(ib), {} });
+    };
+    for (const auto& [ma, mb] : matches) {
+        emitGap(ma, mb);
+        pairEntries.push_back(result.entries.size());
+        result.entries.push_back({ DiffEntry::Kind::Same, static_cast<int64_t>(ma), static_cast<int64_t>(mb), {} });
+        ia = ma + 1;
+        ib = mb + 1;
+    }
+    emitGap(packetsA.size(), packetsB.size());
+
+    // Byte-level comparison of aligned pairs, in parallel blocks
+    {
+        TraceSpan bytes("diff", "bytes");
+        static constexpr size_t BLOCK = 512;
+        ThreadPool pool(options.threads);
+        for (size_t begin = 0; begin < pairEntries.size(); begin += BLOCK) {
+            size_t end = std::min(begin + BLOCK, pairEntries.size());
+            pool.submit([&, begin, end] {
+                for (size_t k = begin; k < end; k++) {
+                    DiffEntry& e = result.entries[pairEntries[k]];
+                    uint32_t pa = packetsA[static_cast<size_t>(e.positionA)];
+                    uint32_t pb = packetsB[static_cast<size_t>(e.positionB)];
+                    size_t lenA = storeA.payloadSize(pa), lenB = storeB.payloadSize(pb);
+                    if (lenA == lenB && std::memcmp(storeA.payload(pa), storeB.payload(pb), lenA) == 0) continue;
+                    e.kind = DiffEntry::Kind::Changed;
+                    e.ranges = diffBytes(storeA.payload(pa), lenA, storeB.payload(pb), lenB, options.maxByteEditCost);
+                }
+            });
+        }
+        pool.wait();
+    }
+
+    for (const auto& e : result.entries) {
+        switch (e.kind) {
+            case DiffEntry::Kind::Same:    result.same++; break;
+            case DiffEntry::Kind::Changed: result.changed++; break;
+            case DiffEntry::Kind::Removed: result.removed++; break;
+            case DiffEntry::Kind::Added:   result.added++; break;
+        }
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    return result;
+}
+
+} // namespace maple
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "../store/packet_store.h"
+#include <cstdint>
+#include <vector>
+
+namespace maple {
+
+// A changed byte range: payload A[offsetA, offsetA + lengthA) became B[offsetB, offsetB + lengthB)
+struct ByteRange {
+    uint32_t offsetA = 0;
+    uint32_t lengthA = 0;
+    uint32_t offsetB = 0;
+    uint32_t lengthB = 0;
+};
+
+struct DiffEntry {
+    enum class Kind : uint8_t { Same, Changed, Removed, Added };
+
+    Kind kind = Kind::Same;
+    int64_t positionA = -1;    // position within sequence A, -1 for Added
+    int64_t positionB = -1;    // position within sequence B, -1 for Removed
+    std::vector<ByteRange> ranges;   // Changed only
+};
+
+struct SessionDiffResult {
+    std::vector<DiffEntry> entries;   // in sequence order
+    size_t same = 0;
+    size_t changed = 0;
+    size_t removed = 0;
+    size_t added = 0;
+    bool approximate = false;   // the edit cost limit was hit; alignment may not be minimal
+    double seconds = 0.0;
+};
+
+// Structural diff of two packet sequences (sessions of one or two captures).
+// Packets are aligned on (direction, opcode) with Myers' O((N+M)D) algorithm
+// in its linear-space divide-and-conquer form. Aligned pairs with different
+// payloads then get a byte-level diff; those run in parallel on a thread pool.
+class SessionDiff {
+public:
+    struct Options {
+        size_t threads = 0;            // byte-diff workers, 0 = hardware threads
+        int64_t maxEditCost = 4096;    // per bisection; beyond it the split is approximated
+        int64_t maxByteEditCost = 1024;
+    };
+
+    // Indexes into store of one session's packets, in order (handshake and
+    // dead-stream markers excluded)
+    static std::vector<uint32_t> sessionPackets(const PacketStore& store, uint32_t sessionId);
+
+    static SessionDiffResult diff(const PacketStore& storeA, const std::vector<uint32_t>& packetsA,
+                                  const PacketStore& storeB, const std::vector<uint32_t>& packetsB,
+                                  const Options& options);
+    static SessionDiffResult diff(const PacketStore& storeA, const std::vector<uint32_t>& packetsA,
+                                  const PacketStore& storeB, const std::vector<uint32_t>& packetsB) {
+        return diff(storeA, packetsA, storeB, packetsB, Options{});
+    }
+
+    // Changed byte ranges between two payloads
+    static std::vector<ByteRange> diffBytes(const uint8_t* a, size_t lenA, const uint8_t* b, size_t lenB,
+                                            int64_t maxEditCost = 1024);
+};
+
+} // namespace maple
@@ -0,0 +1,214 @@
+#include "trigger_recorder.h"
+#include "../capture/pcap_file.h"
+#include "../store/packet_store.h"
+#include "../metrics/trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+
+namespace maple {
+
+TriggerRecorder::~TriggerRecorder() {
+    // The writer saves every queued window before it stops
+    if (writer_.joinable()) {
+        writer_.request_stop();
+        writer_.join();
+    }
+}
+
+void TriggerRecorder::configure(TriggerConfig config) {
+    if (state_ == State::Recording) finish();
+    config_ = std::move(config);
+    packets_.clear();
+    frames_.clear();
+    ringBytes_ = 0;
+    state_ = config_.triggers.empty() ? State::Idle : State::Armed;
+}
+
+std::vector<TriggerEvent> TriggerRecorder::events() const {
+    std::lock_guard<std::mutex> lock(eventsMutex_);
+    return events_;
+}
+
+void TriggerRecorder::onFrame(const RawPacket& raw) {
+    if (!wantsFrames()) return;
+    frames_.push_back(raw);
+    if (state_ == State::Armed) {
+        ringBytes_ += cost(raw);
+        evict(raw.timestampNs);
+    }
+}
+
+void TriggerRecorder::onPackets(const std::vector<Packet>& pkts) {
+    for (const auto& pkt : pkts) {
+        if (state_ == State::Idle) return;
+
+        if (state_ == State::Recording) {
+            if (pkt.timestampNs >= endNs_) {
+                finish();
+            } else {
+                if (!pkt.suppressed) keep(pkt);
+                continue;
+            }
+        }
+
+        // Armed: suppressed packets can still trigger, but carry nothing worth keeping
+        if (!pkt.suppressed) {
+            keep(pkt);
+            ringBytes_ += cost(packets_.back());
+        }
+        if (const CaptureTrigger* trigger = match(pkt)) {
+            fire(pkt, *trigger);
+        } else {
+            evict(pkt.timestampNs);
+        }
+    }
+}
+
+void TriggerRecorder::keep(const Packet& pkt) {
+    packets_.push_back(pkt);
+    // Rebuilt from the payload on load; handshakes keep theirs (no payload column data)
+    if (!pkt.isHandshake) packets_.back().hexDump.clear();
+}
+
+void TriggerRecorder::poll(int64_t nowNs) {
+    if (state_ == State::Recording && nowNs >= endNs_) finish();
+}
+
+const CaptureTrigger* TriggerRecorder::match(const Packet& pkt) const {
+    for (const auto& t : config_.triggers) {
+        if (t.kind == CaptureTrigger::Kind::StreamDead) {
+            if (pkt.isDeadNotification) return &t;
+            continue;
+        }
+        if (pkt.isHandshake || pkt.isDeadNotification) continue;
+        if (t.outbound && *t.outbound != pkt.outbound) continue;
+        if (t.opcode && *t.opcode != pkt.opcode) continue;
+
+        if (t.kind == CaptureTrigger::Kind::Opcode) {
+            if (t.opcode) return &t;
+        } else if (!t.pattern.empty() && !pkt.suppressed) {
+            auto it = std::search(pkt.payload.begin(), pkt.payload.end(),
+                                  std::boyer_moore_horspool_searcher(t.pattern.begin(), t.pattern.end()));
+            if (it != pkt.payload.end()) return &t;
+        }
+    }
+    return nullptr;
+}
+
+void TriggerRecorder::fire(const Packet& pkt, const CaptureTrigger& trigger) {
+    TraceSpan span("trigger", "fire");
+    std::cout << "[Trigger] '" << trigger.name << "' fired on session " << pkt.sessionId << std::endl;
+
+    // Drop anything older than the pre-trigger window, then freeze the ring
+    evict(pkt.timestampNs);
+    state_ = State::Recording;
+    endNs_ = pkt.timestampNs + config_.postNs;
+    current_ = {};
+    current_.trigger = trigger.name;
+    current_.sessionId = pkt.sessionId;
+    current_.timestampNs = pkt.timestampNs;
+}
+
+void TriggerRecorder::evict(int64_t newestNs) {
+    int64_t cutoff = newestNs - config_.preNs;
+    while (!packets_.empty() && (packets_.front().timestampNs < cutoff || ringBytes_ > config_.maxRingBytes)) {
+        ringBytes_ -= std::min(ringBytes_, cost(packets_.front()));
+        packets_.pop_front();
+    }
+    while (!frames_.empty() && (frames_.front().timestampNs < cutoff || ringBytes_ > config_.maxRingBytes)) {
+        ringBytes_ -= std::min(ringBytes_, cost(frames_.front()));
+        frames_.pop_front();
+    }
+}
+
+// File stem from the trigger time, UTC: trigger-YYYYmmdd-HHMMSS-<ms>
+static std::string windowStem(int64_t timestampNs) {
+    using namespace std::chrono;
+    sys_time<nanoseconds> tp{ nanoseconds(timestampNs) };
+    auto day = floor<days>(tp);
+    year_month_day ymd{ day };
+    hh_mm_ss hms{ floor<milliseconds>(tp - day) };
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "trigger-%04d%02u%02u-%02d%02d%02d-%03d",
+                  static_cast<int>(ymd.year()), static_cast<unsigned>(ymd.month()), static_cast<unsigned>(ymd.day()),
+                  static_cast<int>(hms.hours().count()), static_cast<int>(hms.minutes().count()),
+                  static_cast<int>(hms.seconds().count()), static_cast<int>(hms.subseconds().count()));
+    return buf;
+}
+
+void TriggerRecorder::finish() {
+    Window window;
+    window.event = std::move(current_);
+    window.packets = std::move(packets_);
+    window.frames = std::move(frames_);
+    window.dir = outputDir_;
+    packets_.clear();
+    frames_.clear();
+    ringBytes_ = 0;
+    state_ = State::Armed;
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        queue_.push_back(std::move(window));
+    }
+    if (!writer_.joinable()) writer_ = std::jthread([this](std::stop_token stop) { runWriter(stop); });
+    queued_.notify_one();
+}
+
+void TriggerRecorder::runWriter(std::stop_token stop) {
+    Tracer::setThreadName("trigger-writer");
+    while (true) {
+        Window window;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex_);
+            queued_.wait(lock, stop, [&] { return !queue_.empty(); });
+            if (queue_.empty()) break;   // stopped with nothing left to write
+            window = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        write(window);
+    }
+}
+
+void TriggerRecorder::write(Window& window) {
+    TraceSpan span("trigger", "write");
+    TriggerEvent& event = window.event;
+
+    std::error_code ec;
+    std::filesystem::create_directories(window.dir, ec);
+    std::string stem = windowStem(event.timestampNs);
+
+    PacketStore store;
+    for (const auto& pkt : window.packets) store.append(pkt);
+    event.packets = store.size();
+    event.packetsPath = window.dir / (stem + ".mspkts");
+    if (!store.save(event.packetsPath)) {
+        std::cerr << "[Trigger] Could not write " << event.packetsPath.string() << std::endl;
+        return;
+    }
+
+    if (!window.frames.empty()) {
+        event.pcapPath = window.dir / (stem + ".pcap");
+        PcapWriter pcap;
+        bool ok = pcap.open(event.pcapPath);
+        for (const auto& raw : window.frames) {
+            if (!ok) break;
+            ok = pcap.write(raw);
+        }
+        pcap.close();
+        if (!ok) {
+            std::cerr << "[Trigger] Could not write " << event.pcapPath.string() << std::endl;
+            event.pcapPath.clear();
+        }
+        event.frames = window.frames.size();
+    }
+
+    std::cout << "[Trigger] Saved " << event.packets << " packets to " << event.packetsPath.string() << std::endl;
+    std::lock_guard<std::mutex> lock(eventsMutex_);
+    events_.push_back(std::move(event));
+}
+
+} // namespace maple
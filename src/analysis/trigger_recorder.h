@@ -0,0 +1,125 @@
+#pragma once
+
+#include "../protocol/protocol.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace maple {
+
+// Condition that freezes the pre-trigger ring
+struct CaptureTrigger {
+    enum class Kind { Opcode, Pattern, StreamDead };
+
+    Kind kind = Kind::Opcode;
+    std::string name;
+    std::optional<bool> outbound;       // nullopt = either direction
+    std::optional<uint16_t> opcode;     // required for Opcode, optional filter for Pattern
+    std::vector<uint8_t> pattern;       // Pattern: bytes found anywhere in the payload
+};
+
+struct TriggerConfig {
+    int64_t preNs = 30'000'000'000;     // history kept before a trigger
+    int64_t postNs = 30'000'000'000;    // recorded after it
+    bool rawFrames = false;             // also keep captured frames (written as .pcap)
+    size_t maxRingBytes = 64u << 20;    // ring budget; oldest entries go first
+    std::vector<CaptureTrigger> triggers;
+};
+
+// One persisted window
+struct TriggerEvent {
+    std::string trigger;
+    uint32_t sessionId = 0;
+    int64_t timestampNs = 0;
+    size_t packets = 0;
+    size_t frames = 0;
+    std::filesystem::path packetsPath;  // .mspkts (PacketStore::load)
+    std::filesystem::path pcapPath;     // empty unless rawFrames
+};
+
+// Oscilloscope-style capture: decoded packets (and optionally raw frames) of
+// the last preNs stay in a ring. When a trigger matches, the ring is frozen,
+// the next postNs are appended, and the window is queued for one long-lived
+// writer thread (started on the first window) that saves it to outputDir.
+// The recorder re-arms at once; it never waits for the disk.
+// Not synchronized except for events(): callers serialize the other calls.
+class TriggerRecorder {
+public:
+    enum class State { Idle, Armed, Recording };
+
+    TriggerRecorder() = default;
+    ~TriggerRecorder();
+
+    TriggerRecorder(const TriggerRecorder&) = delete;
+    TriggerRecorder& operator=(const TriggerRecorder&) = delete;
+
+    void setOutputDir(std::filesystem::path dir) { outputDir_ = std::move(dir); }
+
+    // Arms when there is at least one trigger, otherwise goes idle.
+    // A window being recorded is finished first.
+    void configure(TriggerConfig config);
+    const TriggerConfig& config() const { return config_; }
+
+    State state() const { return state_; }
+    bool wantsFrames() const { return state_ != State::Idle && config_.rawFrames; }
+
+    void onFrame(const RawPacket& raw);
+    void onPackets(const std::vector<Packet>& pkts);
+
+    // Close the post-trigger window when traffic has stopped (wall clock ns)
+    void poll(int64_t nowNs);
+
+    size_t ringPackets() const { return packets_.size(); }
+    size_t ringFrames() const { return frames_.size(); }
+    size_t ringBytes() const { return ringBytes_; }
+
+    // Windows written so far, oldest first
+    std::vector<TriggerEvent> events() const;
+
+private:
+    // A finished window waiting for the writer
+    struct Window {
+        TriggerEvent event;
+        std::deque<Packet> packets;
+        std::deque<RawPacket> frames;
+        std::filesystem::path dir;
+    };
+
+    const CaptureTrigger* match(const Packet& pkt) const;
+    void fire(const Packet& pkt, const CaptureTrigger& trigger);
+    void finish();
+    void evict(int64_t newestNs);
+    void keep(const Packet& pkt);
+    void runWriter(std::stop_token stop);
+    void write(Window& window);
+
+    static size_t cost(const Packet& pkt) { return sizeof(Packet) + pkt.payload.size(); }
+    static size_t cost(const RawPacket& raw) { return sizeof(RawPacket) + raw.data.size(); }
+
+    std::filesystem::path outputDir_;
+    TriggerConfig config_;
+    State state_ = State::Idle;
+
+    std::deque<Packet> packets_;
+    std::deque<RawPacket> frames_;
+    size_t ringBytes_ = 0;
+
+    TriggerEvent current_;
+    int64_t endNs_ = 0;
+
+    std::mutex queueMutex_;
+    std::condition_variable_any queued_;
+    std::deque<Window> queue_;
+    std::jthread writer_;
+
+    mutable std::mutex eventsMutex_;
+    std::vector<TriggerEvent> events_;
+};
+
+} // namespace maple
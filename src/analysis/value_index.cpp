@@ -0,0 +1,316 @@
+#include "value_index.h"
+#include "../metrics/trace.h"
+#include <algorithm>
+#include <cstring>
+
+namespace maple {
+
+namespace {
+
+// Local packet index and payload offset packed for sorting
+constexpr int OFFSET_BITS = 24;
+constexpr uint64_t OFFSET_MASK = (1ull << OFFSET_BITS) - 1;
+constexpr uint8_t WIDTHS[3] = { 2, 4, 8 };
+
+uint64_t loadLE(const uint8_t* p, uint8_t width) {
+    uint64_t v = 0;
+    std::memcpy(&v, p, width);   // little-endian hosts only (x86/x64, ARM64)
+    return v;
+}
+
+void putVarint(std::vector<uint8_t>& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<uint8_t>(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(v));
+}
+
+uint64_t getVarint(const uint8_t*& p) {
+    uint64_t v = 0;
+    for (int shift = 0;; shift += 7) {
+        uint8_t b = *p++;
+        v |= static_cast<uint64_t>(b & 0x7F) << shift;
+        if ((b & 0x80) == 0) return v;
+    }
+}
+
+template <typename T>
+size_t vectorBytes(const std::vector<T>& v) {
+    return v.capacity() * sizeof(T);
+}
+
+} // namespace
+
+size_t ValueIndex::RawSegment::memoryBytes() const {
+    return vectorBytes(seqs) + vectorBytes(opcodes) + vectorBytes(sessionIds) + vectorBytes(outbound) +
+           vectorBytes(ends) + vectorBytes(data);
+}
+
+ValueIndex::ValueIndex(const Options& options) : options_(options) {
+    options_.maxPayload = std::min<uint32_t>(options_.maxPayload, static_cast<uint32_t>(OFFSET_MASK));
+    options_.segmentPackets = std::max<uint32_t>(options_.segmentPackets, 1);
+    sealer_ = std::jthread([this](std::stop_token stop) { sealLoop(stop); });
+}
+
+ValueIndex::~ValueIndex() {
+    sealer_.request_stop();
+    work_.notify_all();
+    if (sealer_.joinable()) sealer_.join();
+}
+
+int ValueIndex::tableFor(uint8_t width) {
+    switch (width) {
+    case 2: return 0;
+    case 4: return 1;
+    case 8: return 2;
+    default: return -1;
+    }
+}
+
+void ValueIndex::add(uint64_t seq, const Packet& pkt) {
+    add(seq, pkt.opcode, pkt.outbound, pkt.sessionId, pkt.payload.data(), pkt.payload.size());
+}
+
+void ValueIndex::add(uint64_t seq, uint16_t opcode, bool outbound, uint32_t sessionId,
+                     const uint8_t* data, size_t size) {
+    size = std::min<size_t>(size, options_.maxPayload);
+    std::lock_guard<std::mutex> lock(mutex_);
+    active_.seqs.push_back(seq);
+    active_.opcodes.push_back(opcode);
+    active_.sessionIds.push_back(sessionId);
+    active_.outbound.push_back(outbound ? 1 : 0);
+    active_.data.insert(active_.data.end(), data, data + size);
+    active_.ends.push_back(static_cast<uint32_t>(active_.data.size()));
+    if (active_.size() >= options_.segmentPackets) sealActive();
+}
+
+void ValueIndex::sealActive() {
+    auto raw = std::make_shared<RawSegment>(std::move(active_));
+    active_ = RawSegment();
+    pendingBytes_ += raw->memoryBytes();
+    pending_.push_back(std::move(raw));
+    enforceBudget();
+    work_.notify_one();
+}
+
+void ValueIndex::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (active_.size()) sealActive();
+    built_.wait(lock, [&] { return pending_.empty(); });
+}
+
+void ValueIndex::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    active_ = RawSegment();
+    pending_.clear();
+    segments_.clear();
+    segmentBytes_ = 0;
+    pendingBytes_ = 0;
+    evictedSegments_ = 0;
+    evictedBeforeSeq_ = 0;
+    generation_++;
+    built_.notify_all();
+}
+
+void ValueIndex::enforceBudget() {
+    while (!segments_.empty() && segmentBytes_ + pendingBytes_ + active_.memoryBytes() > options_.memoryBudget) {
+        const auto& oldest = *segments_.front();
+        if (!oldest.seqs.empty()) evictedBeforeSeq_ = oldest.seqs.back() + 1;
+        segmentBytes_ -= oldest.memoryBytes;
+        segments_.pop_front();
+        evictedSegments_++;
+    }
+}
+
+void ValueIndex::sealLoop(std::stop_token stop) {
+    Tracer::setThreadName("value-index");
+    while (true) {
+        std::shared_ptr<const RawSegment> raw;
+        uint64_t generation;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (!work_.wait(lock, stop, [&] { return !pending_.empty(); })) return;
+            raw = pending_.front();
+            generation = generation_;
+        }
+
+        std::shared_ptr<Segment> seg;
+        {
+            TraceSpan span("analysis", "valueIndexSeal");
+            seg = build(*raw);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (generation != generation_ || pending_.empty() || pending_.front() != raw) continue;   // cleared meanwhile
+        pending_.pop_front();
+        pendingBytes_ -= raw->memoryBytes();
+        segmentBytes_ += seg->memoryBytes;
+        segments_.push_back(std::move(seg));
+        enforceBudget();
+        built_.notify_all();
+    }
+}
+
+std::shared_ptr<ValueIndex::Segment> ValueIndex::build(const RawSegment& raw) const {
+    auto seg = std::make_shared<Segment>();
+    seg->seqs = raw.seqs;
+    seg->opcodes = raw.opcodes;
+    seg->sessionIds = raw.sessionIds;
+    seg->outbound = raw.outbound;
+
+    std::vector<std::pair<uint64_t, uint64_t>> tuples;   // (value, packed position)
+    for (int t = 0; t < 3; t++) {
+        uint8_t width = WIDTHS[t];
+        if (!(options_.widths & width)) continue;
+
+        tuples.clear();
+        uint32_t begin = 0;
+        for (size_t i = 0; i < raw.size(); i++) {
+            uint32_t end = raw.ends[i];
+            const uint8_t* p = raw.data.data() + begin;
+            for (uint32_t off = 0; off + width <= end - begin; off++) {
+                tuples.emplace_back(loadLE(p + off, width), (static_cast<uint64_t>(i) << OFFSET_BITS) | off);
+            }
+            begin = end;
+        }
+        std::sort(tuples.begin(), tuples.end());
+
+        Table& table = seg->tables[t];
+        for (size_t j = 0; j < tuples.size();) {
+            size_t k = j;
+            while (k < tuples.size() && tuples[k].first == tuples[j].first) k++;
+            uint64_t value = tuples[j].first;
+
+            if (k - j > options_.maxPostings) {
+                table.commonValues.push_back(value);
+                table.commonCounts.push_back(static_cast<uint32_t>(k - j));
+            } else {
+                table.values.push_back(value);
+                table.starts.push_back(static_cast<uint32_t>(table.postings.size()));
+                uint64_t prevPacket = 0;
+                uint64_t prevOffset = 0;
+                for (size_t x = j; x < k; x++) {
+                    uint64_t packet = tuples[x].second >> OFFSET_BITS;
+                    uint64_t offset = tuples[x].second & OFFSET_MASK;
+                    uint64_t delta = packet - prevPacket;
+                    putVarint(table.postings, delta);
+                    putVarint(table.postings, delta ? offset : offset - prevOffset);
+                    prevPacket = packet;
+                    prevOffset = offset;
+                }
+            }
+            j = k;
+        }
+        table.starts.push_back(static_cast<uint32_t>(table.postings.size()));
+
+        table.values.shrink_to_fit();
+        table.starts.shrink_to_fit();
+        table.postings.shrink_to_fit();
+        table.commonValues.shrink_to_fit();
+        table.commonCounts.shrink_to_fit();
+    }
+
+    seg->memoryBytes = sizeof(Segment) + vectorBytes(seg->seqs) + vectorBytes(seg->opcodes) +
+                       vectorBytes(seg->sessionIds) + vectorBytes(seg->outbound);
+    for (const auto& t : seg->tables) {
+        seg->memoryBytes += vectorBytes(t.values) + vectorBytes(t.starts) + vectorBytes(t.postings) +
+                            vectorBytes(t.commonValues) + vectorBytes(t.commonCounts);
+    }
+    return seg;
+}
+
+void ValueIndex::search(const Segment& seg, int t, uint64_t value, size_t limit, ValueMatches& out) const {
+    const Table& table = seg.tables[t];
+
+    auto common = std::lower_bound(table.commonValues.begin(), table.commonValues.end(), value);
+    if (common != table.commonValues.end() && *common == value) {
+        out.common = true;
+        out.total += table.commonCounts[common - table.commonValues.begin()];
+        return;
+    }
+
+    auto it = std::lower_bound(table.values.begin(), table.values.end(), value);
+    if (it == table.values.end() || *it != value) return;
+    size_t i = it - table.values.begin();
+    const uint8_t* p = table.postings.data() + table.starts[i];
+    const uint8_t* end = table.postings.data() + table.starts[i + 1];
+
+    uint64_t packet = 0;
+    uint64_t offset = 0;
+    while (p < end) {
+        uint64_t delta = getVarint(p);
+        uint64_t off = getVarint(p);
+        packet += delta;
+        offset = delta ? off : offset + off;
+        out.total++;
+        if (out.postings.size() < limit) {
+            out.postings.push_back({ seg.seqs[packet], static_cast<uint32_t>(offset), seg.opcodes[packet],
+                                     seg.outbound[packet] != 0, seg.sessionIds[packet] });
+        }
+    }
+}
+
+void ValueIndex::scan(const RawSegment& raw, uint8_t width, uint64_t value, size_t limit, ValueMatches& out) const {
+    uint8_t needle[8];
+    std::memcpy(needle, &value, sizeof(needle));
+    uint32_t begin = 0;
+    for (size_t i = 0; i < raw.size(); i++) {
+        uint32_t end = raw.ends[i];
+        const uint8_t* p = raw.data.data() + begin;
+        size_t len = end - begin;
+        for (size_t off = 0; off + width <= len;) {
+            auto hit = static_cast<const uint8_t*>(std::memchr(p + off, needle[0], len - width + 1 - off));
+            if (!hit) break;
+            off = hit - p;
+            if (std::memcmp(hit, needle, width) == 0) {
+                out.total++;
+                if (out.postings.size() < limit) {
+                    out.postings.push_back({ raw.seqs[i], static_cast<uint32_t>(off), raw.opcodes[i],
+                                             raw.outbound[i] != 0, raw.sessionIds[i] });
+                }
+            }
+            off++;
+        }
+        begin = end;
+    }
+}
+
+ValueMatches ValueIndex::find(uint8_t width, uint64_t value, size_t limit) const {
+    TraceSpan span("analysis", "valueIndexFind");
+    ValueMatches out;
+    int t = tableFor(width);
+    if (t < 0 || !(options_.widths & width)) return out;
+    if (width < 8) value &= (1ull << (width * 8)) - 1;
+
+    // Oldest first, so postings come out in sequence order
+    std::lock_guard<std::mutex> lock(mutex_);
+    out.indexedFromSeq = evictedBeforeSeq_;
+    for (const auto& seg : segments_) search(*seg, t, value, limit, out);
+    for (const auto& raw : pending_) scan(*raw, width, value, limit, out);
+    scan(active_, width, value, limit, out);
+    return out;
+}
+
+ValueIndexStats ValueIndex::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ValueIndexStats s;
+    s.indexedFromSeq = evictedBeforeSeq_;
+    s.segments = segments_.size();
+    s.evictedSegments = evictedSegments_;
+    for (const auto& seg : segments_) {
+        s.packets += seg->seqs.size();
+        for (const auto& t : seg->tables) {
+            s.keys += t.values.size();
+            s.commonKeys += t.commonValues.size();
+            s.postingBytes += t.postings.size();
+        }
+    }
+    for (const auto& raw : pending_) s.pendingPackets += raw->size();
+    s.pendingPackets += active_.size();
+    s.packets += s.pendingPackets;
+    s.memoryBytes = segmentBytes_ + pendingBytes_ + active_.memoryBytes();
+    return s;
+}
+
+} // namespace maple
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "../protocol/protocol.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace maple {
+
+struct ValuePosting {
+    uint64_t seq = 0;        // packet sequence number
+    uint32_t offset = 0;     // byte offset in the payload
+    uint16_t opcode = 0;
+    bool outbound = false;
+    uint32_t sessionId = 0;
+};
+
+struct ValueMatches {
+    std::vector<ValuePosting> postings;   // ascending (seq, offset), at most limit
+    uint64_t total = 0;                   // all occurrences found, including common counts
+    bool common = false;                  // over the frequency cutoff somewhere: postings incomplete
+    uint64_t indexedFromSeq = 0;          // older packets were evicted (memory budget)
+};
+
+struct ValueIndexStats {
+    uint64_t packets = 0;         // currently indexed
+    uint64_t indexedFromSeq = 0;
+    size_t segments = 0;          // sealed
+    size_t pendingPackets = 0;    // active + waiting to be sealed (searched by scanning)
+    uint64_t keys = 0;
+    uint64_t commonKeys = 0;
+    uint64_t postingBytes = 0;
+    size_t memoryBytes = 0;
+    uint64_t evictedSegments = 0;
+};
+
+// Inverted index from the 2-, 4- and 8-byte little-endian value at every
+// payload offset to the (packet, offset) places it occurs.
+//
+// Packets collect in an active segment (searched by scanning its payloads).
+// Every segmentPackets it is sealed on a background thread: per width, a
+// sorted array of distinct values pointing into varint-coded posting lists.
+// A value with more than maxPostings occurrences in a segment keeps only its
+// count. Past memoryBudget the oldest segments are dropped whole.
+// Synchronized internally (sealing runs on its own thread).
+class ValueIndex {
+public:
+    struct Options {
+        uint8_t widths = 2 | 4 | 8;          // bit set of value widths in bytes
+        size_t memoryBudget = 256u << 20;
+        uint32_t segmentPackets = 4096;
+        uint32_t maxPostings = 4096;         // per value and segment
+        uint32_t maxPayload = 16384;         // bytes indexed per packet
+    };
+
+    ValueIndex() : ValueIndex(Options{}) {}
+    explicit ValueIndex(const Options& options);
+    ~ValueIndex();
+
+    ValueIndex(const ValueIndex&) = delete;
+    ValueIndex& operator=(const ValueIndex&) = delete;
+
+    // seq must ascend
+    void add(uint64_t seq, const Packet& pkt);
+    void add(uint64_t seq, uint16_t opcode, bool outbound, uint32_t sessionId, const uint8_t* data, size_t size);
+
+    // Seal the active segment and wait until every segment is built
+    void flush();
+    void clear();
+
+    // width 2, 4 or 8; value little-endian
+    ValueMatches find(uint8_t width, uint64_t value, size_t limit) const;
+
+    ValueIndexStats stats() const;
+
+private:
+    // Packets not yet sealed: payloads kept as they are and scanned
+    struct RawSegment {
+        std::vector<uint64_t> seqs;
+        std::vector<uint16_t> opcodes;
+        std::vector<uint32_t> sessionIds;
+        std::vector<uint8_t> outbound;
+        std::vector<uint32_t> ends;       // payload end offsets into data
+        std::vector<uint8_t> data;
+
+        size_t size() const { return seqs.size(); }
+        size_t memoryBytes() const;
+    };
+
+    struct Table {
+        std::vector<uint64_t> values;        // distinct, ascending
+        std::vector<uint32_t> starts;        // values.size() + 1 offsets into postings
+        std::vector<uint8_t> postings;       // varint (packet delta, offset) pairs
+        std::vector<uint64_t> commonValues;  // over the cutoff, ascending
+        std::vector<uint32_t> commonCounts;
+    };
+
+    struct Segment {
+        std::vector<uint64_t> seqs;
+        std::vector<uint16_t> opcodes;
+        std::vector<uint32_t> sessionIds;
+        std::vector<uint8_t> outbound;
+        Table tables[3];                     // widths 2, 4, 8
+        size_t memoryBytes = 0;
+    };
+
+    static int tableFor(uint8_t width);
+    std::shared_ptr<Segment> build(const RawSegment& raw) const;
+    void sealActive();                       // caller holds mutex_
+    void enforceBudget();                    // caller holds mutex_
+    void scan(const RawSegment& raw, uint8_t width, uint64_t value, size_t limit, ValueMatches& out) const;
+    void search(const Segment& seg, int table, uint64_t value, size_t limit, ValueMatches& out) const;
+    void sealLoop(std::stop_token stop);
+
+    Options options_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable_any work_;       // pending_ not empty
+    std::condition_variable_any built_;      // a pending segment was built
+    RawSegment active_;
+    std::deque<std::shared_ptr<const RawSegment>> pending_;   // oldest first, front is being built
+    std::deque<std::shared_ptr<const Segment>> segments_;     // oldest first
+    size_t segmentBytes_ = 0;
+    size_t pendingBytes_ = 0;
+    uint64_t generation_ = 0;                // bumped by clear(): drops builds in flight
+    uint64_t evictedSegments_ = 0;
+    uint64_t evictedBeforeSeq_ = 0;
+
+    std::jthread sealer_;                    // last: stopped before the rest is destroyed
+};
+
+} // namespace maple
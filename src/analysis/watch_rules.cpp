@@ -0,0 +1,162 @@
+#include "watch_rules.h"
+#include <algorithm>
+#include <cstring>
+
+namespace maple {
+
+// --- WatchRuleSet ---
+
+WatchRuleSet::WatchRuleSet(std::vector<WatchRule> rules) : rules_(std::move(rules)) {
+    floating_.resize(rules_.size());
+    scanOpcodes_.assign(65536, false);
+    for (uint32_t r = 0; r < rules_.size(); r++) {
+        const WatchRule& rule = rules_[r];
+        for (const auto& p : rule.patterns) {
+            if (p.offset >= 0 || p.bytes.empty()) continue;
+            floating_[r].push_back(automaton_.add(p.bytes.data(), p.bytes.size()));
+            patternRule_.push_back(r);
+        }
+
+        if (!floating_[r].empty()) {
+            if (rule.opcodes.empty()) scanAnyOpcode_ = true;
+            for (uint16_t op : rule.opcodes) scanOpcodes_[op] = true;
+        } else if (rule.opcodes.empty()) {
+            directAny_.push_back(r);
+        } else {
+            for (uint16_t op : rule.opcodes) {
+                auto& list = directByOpcode_[op];
+                if (list.empty() || list.back() != r) list.push_back(r);
+            }
+        }
+    }
+    automaton_.build();
+    seen_.assign(automaton_.patternCount(), 0);
+}
+
+bool WatchRuleSet::accepts(uint32_t r, const Packet& pkt) const {
+    const WatchRule& rule = rules_[r];
+    if (rule.outbound && *rule.outbound != pkt.outbound) return false;
+    if (!rule.opcodes.empty() &&
+        std::find(rule.opcodes.begin(), rule.opcodes.end(), pkt.opcode) == rule.opcodes.end()) {
+        return false;
+    }
+    if (pkt.suppressed && !rule.patterns.empty()) return false;
+
+    for (const auto& p : rule.patterns) {
+        if (p.offset < 0) continue;
+        size_t end = static_cast<size_t>(p.offset) + p.bytes.size();
+        if (end > pkt.payload.size() ||
+            std::memcmp(pkt.payload.data() + p.offset, p.bytes.data(), p.bytes.size()) != 0) {
+            return false;
+        }
+    }
+    for (uint32_t id : floating_[r]) {
+        if (seen_[id] != generation_) return false;
+    }
+    return true;
+}
+
+void WatchRuleSet::match(const Packet& pkt, std::vector<uint32_t>& out) const {
+    out.clear();
+    if (pkt.isHandshake || pkt.isDeadNotification) return;
+    generation_++;
+
+    // Rules with floating patterns become candidates only when the single
+    // automaton pass hits one of their patterns
+    if ((scanAnyOpcode_ || scanOpcodes_[pkt.opcode]) && !pkt.payload.empty()) {
+        automaton_.scan(pkt.payload.data(), pkt.payload.size(), [&](uint32_t id, size_t) {
+            if (seen_[id] == generation_) return;
+            seen_[id] = generation_;
+            out.push_back(patternRule_[id]);
+        });
+    }
+
+    auto it = directByOpcode_.find(pkt.opcode);
+    if (it != directByOpcode_.end()) out.insert(out.end(), it->second.begin(), it->second.end());
+    out.insert(out.end(), directAny_.begin(), directAny_.end());
+
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+    std::erase_if(out, [&](uint32_t r) { return !accepts(r, pkt); });
+}
+
+// --- WatchMonitor ---
+
+static uint32_t tableKey(uint8_t locale, uint16_t version) {
+    return (static_cast<uint32_t>(locale) << 16) | version;
+}
+
+void WatchMonitor::setRules(uint8_t locale, uint16_t version, std::vector<WatchRule> rules) {
+    auto table = std::make_shared<Table>();
+    table->locale = locale;
+    table->version = version;
+    for (const auto& rule : rules) table->stats.push_back({ rule.name, locale, version, 0, 0 });
+    table->rules = std::make_unique<WatchRuleSet>(std::move(rules));
+
+    // Bound sessions move to the new table
+    uint32_t key = tableKey(locale, version);
+    auto old = tables_[key];
+    for (auto& [id, bound] : sessions_) {
+        if (old && bound == old) bound = table;
+    }
+    tables_[key] = std::move(table);
+}
+
+bool WatchMonitor::hasRules(uint8_t locale, uint16_t version) const {
+    return tables_.contains(tableKey(locale, version));
+}
+
+void WatchMonitor::bindSession(uint32_t sessionId, uint8_t locale, uint16_t version) {
+    auto it = tables_.find(tableKey(locale, version));
+    if (it != tables_.end()) {
+        sessions_[sessionId] = it->second;
+    } else {
+        sessions_.erase(sessionId);
+    }
+}
+
+size_t WatchMonitor::onPacket(const Packet& pkt) {
+    if (pkt.isHandshake) {
+        bindSession(pkt.sessionId, pkt.locale, pkt.version);
+        return 0;
+    }
+    if (pkt.isDeadNotification) {
+        sessions_.erase(pkt.sessionId);
+        return 0;
+    }
+
+    auto sit = sessions_.find(pkt.sessionId);
+    if (sit == sessions_.end()) return 0;
+    Table& table = *sit->second;
+
+    table.rules->match(pkt, matched_);
+    for (uint32_t r : matched_) {
+        auto& stats = table.stats[r];
+        stats.hits++;
+        stats.lastNs = pkt.timestampNs;
+
+        events_.push_back({ nextSeq_++, stats.rule, table.locale, table.version, pkt.sessionId,
+                            pkt.timestampNs, pkt.outbound, pkt.opcode, pkt.length });
+        if (events_.size() > MAX_EVENTS) events_.pop_front();
+    }
+    return matched_.size();
+}
+
+std::vector<WatchEvent> WatchMonitor::events(uint64_t since) const {
+    std::vector<WatchEvent> out;
+    if (events_.empty() || since >= nextSeq_) return out;
+    uint64_t first = events_.front().seq;
+    size_t start = since > first ? static_cast<size_t>(since - first) : 0;
+    out.assign(events_.begin() + static_cast<std::ptrdiff_t>(start), events_.end());
+    return out;
+}
+
+std::vector<WatchRuleStats> WatchMonitor::stats() const {
+    std::vector<WatchRuleStats> out;
+    for (const auto& [key, table] : tables_) {
+        out.insert(out.end(), table->stats.begin(), table->stats.end());
+    }
+    return out;
+}
+
+} // namespace maple
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "../protocol/protocol.h"
+#include "../util/aho_corasick.h"
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace maple {
+
+// Byte pattern of a watch rule, matched against the payload (after the opcode)
+struct WatchPattern {
+    std::vector<uint8_t> bytes;
+    int32_t offset = -1;            // fixed payload offset, -1 = anywhere
+};
+
+// Fires when a packet has one of the opcodes (any if empty), the direction
+// matches, and every pattern is present
+struct WatchRule {
+    std::string name;
+    std::optional<bool> outbound;   // nullopt = either direction
+    std::vector<uint16_t> opcodes;
+    std::vector<WatchPattern> patterns;
+};
+
+// A compiled rule table. Every floating pattern of every rule goes into one
+// Aho-Corasick automaton, so a packet costs one payload pass however many
+// rules there are, and only rules whose patterns were hit get verified.
+// Rules without floating patterns are indexed by opcode and fixed-offset
+// patterns are compared in place. Suppressed packets carry no payload and can
+// only match rules without patterns.
+class WatchRuleSet {
+public:
+    explicit WatchRuleSet(std::vector<WatchRule> rules);
+
+    const std::vector<WatchRule>& rules() const { return rules_; }
+
+    // Indexes of the rules matching pkt, ascending. Uses internal scratch space:
+    // one caller at a time.
+    void match(const Packet& pkt, std::vector<uint32_t>& out) const;
+
+private:
+    bool accepts(uint32_t rule, const Packet& pkt) const;
+
+    std::vector<WatchRule> rules_;
+    std::vector<std::vector<uint32_t>> floating_;   // per rule: automaton pattern ids
+
+    // Rules without floating patterns, by opcode (plus opcode-agnostic ones)
+    std::unordered_map<uint16_t, std::vector<uint32_t>> directByOpcode_;
+    std::vector<uint32_t> directAny_;
+
+    // Automaton over floating patterns; scanned only if a rule could use it
+    AhoCorasick automaton_;
+    std::vector<uint32_t> patternRule_;             // pattern id -> owning rule
+    std::vector<bool> scanOpcodes_;                 // 65536 entries
+    bool scanAnyOpcode_ = false;
+
+    // Scratch: pattern id -> scan generation it was last seen in
+    mutable std::vector<uint64_t> seen_;
+    mutable uint64_t generation_ = 0;
+};
+
+// A rule match, as raised to the UI
+struct WatchEvent {
+    uint64_t seq = 0;
+    std::string rule;
+    uint8_t locale = 0;
+    uint16_t version = 0;
+    uint32_t sessionId = 0;
+    int64_t timestampNs = 0;
+    bool outbound = false;
+    uint16_t opcode = 0;
+    uint32_t length = 0;
+};
+
+struct WatchRuleStats {
+    std::string rule;
+    uint8_t locale = 0;
+    uint16_t version = 0;
+    uint64_t hits = 0;
+    int64_t lastNs = 0;
+};
+
+// Applies per-version rule sets to live traffic: sessions pick their set up at
+// handshake, matches go to a bounded event ring (polled by sequence number)
+// and to per-rule hit counters. Not synchronized: callers serialize access.
+class WatchMonitor {
+public:
+    static constexpr size_t MAX_EVENTS = 4096;
+
+    // Replace the rules of one game version (resets their counters)
+    void setRules(uint8_t locale, uint16_t version, std::vector<WatchRule> rules);
+    bool hasRules(uint8_t locale, uint16_t version) const;
+
+    // Returns the number of rule matches raised for pkt
+    size_t onPacket(const Packet& pkt);
+
+    // Attach a session whose handshake was not seen (resumed after restart)
+    void bindSession(uint32_t sessionId, uint8_t locale, uint16_t version);
+
+    // Events with seq >= since still in the ring, oldest first
+    std::vector<WatchEvent> events(uint64_t since) const;
+    uint64_t nextSeq() const { return nextSeq_; }
+
+    std::vector<WatchRuleStats> stats() const;
+
+private:
+    struct Table {
+        uint8_t locale = 0;
+        uint16_t version = 0;
+        std::unique_ptr<WatchRuleSet> rules;
+        std::vector<WatchRuleStats> stats;
+    };
+
+    std::map<uint32_t, std::shared_ptr<Table>> tables_;    // key: locale << 16 | version
+    std::map<uint32_t, std::shared_ptr<Table>> sessions_;
+    std::deque<WatchEvent> events_;
+    uint64_t nextSeq_ = 0;
+    std::vector<uint32_t> matched_;
+};
+
+} // namespace maple
@@ -1,4 +1,12 @@
 #include "app.h"
+#include "../protocol/state_io.h"
+#include "../offline/bulk_decoder.h"
+#include "../offline/plaintext_pcap.h"
+#include "../store/msb_file.h"
+#include "../analysis/field_schema.h"
+#include "../analysis/layout_inference.h"
+#include "../analysis/opcode_mapper.h"
+#include "../analysis/session_diff.h"
 #include <nlohmann/json.hpp>
 #include <saucer/embedded/all.hpp>
 #include <saucer/icon.hpp>
@@ -6,6 +14,8 @@
 #include <fstream>
 #include <sstream>
 #include <iomanip>
+#include <chrono>
+#include <ctime>
 
 using json = nlohmann::json;
 namespace fs = std::filesystem;
@@ -18,11 +28,63 @@ static std::string formatOpcode(uint16_t opcode) {
     return oss.str();
 }
 
-App::App(Capture& capture) : capture_(capture) {
+static json packetToJson(const Packet& pkt, uint64_t index) {
+    json pktJson;
+    pktJson["index"] = index;
+    pktJson["timestamp"] = pkt.timestamp;
+    pktJson["timestampNs"] = std::to_string(pkt.timestampNs);  // exceeds JS safe integers
+    pktJson["length"] = pkt.length;
+    pktJson["hexDump"] = pkt.hexDump;
+    pktJson["outbound"] = pkt.outbound;
+    pktJson["isHandshake"] = pkt.isHandshake;
+    pktJson["sessionId"] = pkt.sessionId;
+
+    if (pkt.isHandshake) {
+        pktJson["opcode"] = "Handshake";
+        pktJson["opcodeRaw"] = 0;
+        pktJson["version"] = pkt.version;
+        pktJson["subVersion"] = pkt.subVersionStr;
+        pktJson["locale"] = pkt.locale;
+    } else {
+        pktJson["opcode"] = formatOpcode(pkt.opcode);
+        pktJson["opcodeRaw"] = pkt.opcode;
+    }
+
+    pktJson["decrypted"] = !pkt.isHandshake;
+    return pktJson;
+}
+
+static fs::path pathFromUtf8(const std::string& s) {
+    return fs::path(std::u8string(s.begin(), s.end()));
+}
+
+static std::string formatIP(uint32_t ip) {
+    std::ostringstream oss;
+    oss << ((ip >> 24) & 0xFF) << '.' << ((ip >> 16) & 0xFF) << '.'
+        << ((ip >> 8) & 0xFF) << '.' << (ip & 0xFF);
+    return oss.str();
+}
+
+static std::string formatEndpoint(uint32_t ip, uint16_t port) {
+    return formatIP(ip) + ':' + std::to_string(port);
+}
+
+App::App(Capture& capture, Protocol& protocol, PipelineMetrics& metrics)
+    : capture_(capture), protocol_(protocol), metrics_(metrics) {
     // Set scripts base path to exe directory / scripts
     wchar_t exePath[MAX_PATH];
     GetModuleFileNameW(nullptr, exePath, MAX_PATH);
     scriptsBasePath_ = fs::path(exePath).parent_path() / "scripts";
+    liveStatePath_ = fs::path(exePath).parent_path() / "live_sessions.state";
+    tracesPath_ = fs::path(exePath).parent_path() / "traces";
+    exportsPath_ = fs::path(exePath).parent_path() / "exports";
+    sinksPath_ = fs::path(exePath).parent_path() / "sinks.json";
+    trigger_.setOutputDir(fs::path(exePath).parent_path() / "triggers");
+
+    if (!ring_.open(MAPLE_RING_DEFAULT_NAME_WIN)) {
+        std::cerr << "[App] Shared-memory ring unavailable" << std::endl;
+    }
+    loadSinks();
 }
 
 void App::setup(saucer::application* app) {
@@ -109,11 +171,64 @@ void App::setup(saucer::application* app) {
     webview_->expose("getScript", [this](const std::string& direction, int opcode, int locale, int version) {
         return getScript(direction, opcode, locale, version);
     });
+    webview_->expose("inferLayout", [this](const std::string& direction, int opcode, bool offline) {
+        return inferLayout(direction, opcode, offline);
+    });
+    webview_->expose("runScriptBulk", [this](const std::string& direction, int opcode, int locale, int version,
+                                             bool offline, int sessionId, int limit) {
+        return runScriptBulk(direction, opcode, locale, version, offline, sessionId, limit);
+    });
     webview_->expose("saveScript", [this](const std::string& direction, int opcode, const std::string& code, int locale, int version) {
         return saveScript(direction, opcode, code, locale, version);
     });
     webview_->expose("listScripts", [this](int locale, int version) { return listScripts(locale, version); });
     webview_->expose("getSessions", [this]() { return getSessions(); });
+    webview_->expose("getPipelineStats", [this]() { return getPipelineStats(); });
+    webview_->expose("getSharedRingStatus", [this]() { return getSharedRingStatus(); });
+    webview_->expose("findValue", [this](std::string hexBytes, bool offline, int limit) {
+        return findValue(hexBytes, offline, limit);
+    });
+    webview_->expose("getValueIndexStats", [this]() { return getValueIndexStats(); });
+    webview_->expose("getByteVariability", [this](std::string direction, int opcode) {
+        return getByteVariability(direction, opcode);
+    });
+    webview_->expose("getSinks", [this]() { return getSinks(); });
+    webview_->expose("saveSinks", [this](std::string sinksJson) { return saveSinks(sinksJson); });
+    webview_->expose("getOpcodePairs", [this](int locale, int version) { return getOpcodePairs(locale, version); });
+    webview_->expose("saveOpcodePairs", [this](int locale, int version, const std::string& pairsJson) {
+        return saveOpcodePairs(locale, version, pairsJson);
+    });
+    webview_->expose("getResponseLatency", [this]() { return getResponseLatency(); });
+    webview_->expose("getSuppressionRules", [this](int locale, int version) { return getSuppressionRules(locale, version); });
+    webview_->expose("saveSuppressionRules", [this](int locale, int version, const std::string& rulesJson) {
+        return saveSuppressionRules(locale, version, rulesJson);
+    });
+    webview_->expose("getSuppressionStats", [this]() { return getSuppressionStats(); });
+    webview_->expose("getWatchRules", [this](int locale, int version) { return getWatchRules(locale, version); });
+    webview_->expose("saveWatchRules", [this](int locale, int version, const std::string& rulesJson) {
+        return saveWatchRules(locale, version, rulesJson);
+    });
+    webview_->expose("getWatchEvents", [this](int since) { return getWatchEvents(since); });
+    webview_->expose("getLayouts", [this](int locale, int version) { return getLayouts(locale, version); });
+    webview_->expose("saveLayouts", [this](int locale, int version, const std::string& layoutsJson) {
+        return saveLayouts(locale, version, layoutsJson);
+    });
+    webview_->expose("getFieldColumns", [this](bool offline) { return getFieldColumns(offline); });
+    webview_->expose("queryFields", [this](int locale, int version, const std::string& direction, int opcode,
+                                           const std::string& column, const std::string& op, const std::string& value,
+                                           bool offline, int limit) {
+        return queryFields(locale, version, direction, opcode, column, op, value, offline, limit);
+    });
+    webview_->expose("getWatchStats", [this]() { return getWatchStats(); });
+    webview_->expose("configureTrigger", [this](const std::string& configJson) { return configureTrigger(configJson); });
+    webview_->expose("getTriggerStatus", [this]() { return getTriggerStatus(); });
+    webview_->expose("loadTriggerCapture", [this](const std::string& path) { return loadTriggerCapture(path); });
+    webview_->expose("getBandwidthTimeline", [this](int sessionId, const std::string& direction, int opcode,
+                                                    double fromSec, double toSec, int resolutionSec) {
+        return getBandwidthTimeline(sessionId, direction, opcode, fromSec, toSec, resolutionSec);
+    });
+    webview_->expose("startTrace", [this]() { return startTrace(); });
+    webview_->expose("stopTrace", [this]() { return stopTrace(); });
 
     // Opcode names I/O
     webview_->expose("getOpcodeNames", [this](int locale, int version) {
@@ -128,15 +243,112 @@ void App::setup(saucer::application* app) {
         return decryptOpcodes(hexPayload, desKey);
     });
 
+    // Offline capture files
+    webview_->expose("indexCapture", [this](const std::string& pcapPath) {
+        return indexCapture(pcapPath);
+    });
+    webview_->expose("decodeCaptureFlow", [this](const std::string& pcapPath, int flowIndex, int first, int count) {
+        return decodeCaptureFlow(pcapPath, flowIndex, first, count);
+    });
+    webview_->expose("decodeCapture", [this](const std::string& pcapPath) {
+        return decodeCapture(pcapPath);
+    });
+    webview_->expose("getCapturePackets", [this](int first, int count) {
+        return getCapturePackets(first, count);
+    });
+    webview_->expose("diffSessions", [this](const std::string& sourceA, int sessionA, const std::string& sourceB, int sessionB) {
+        return diffSessions(sourceA, sessionA, sourceB, sessionB);
+    });
+    webview_->expose("mapOpcodes", [this](const std::string& sourceOld, int sessionOld, const std::string& sourceNew, int sessionNew) {
+        return mapOpcodes(sourceOld, sessionOld, sourceNew, sessionNew);
+    });
+    webview_->expose("exportPlaintextPcap", [this](const std::string& source, int sessionId, const std::string& outPath) {
+        return exportPlaintextPcap(source, sessionId, outPath);
+    });
+    webview_->expose("importMsb", [this](const std::string& path) {
+        return importMsb(path);
+    });
+    webview_->expose("exportMsb", [this](const std::string& source, int sessionId, const std::string& outPath) {
+        return exportMsb(source, sessionId, outPath);
+    });
+    webview_->expose("getOpcodeSequences", [this](const std::string& source, int minLength, int limit) {
+        return getOpcodeSequences(source, minLength, limit);
+    });
+
     // Embed frontend and serve
     webview_->embed(saucer::embedded::all());
     webview_->serve("/index.html");
 
     window_->show();
+
+    autosaveThread_ = std::jthread([this](std::stop_token stop) { autosaveLoop(stop); });
+    statsThread_ = std::jthread([this](std::stop_token stop) { statsLoop(stop); });
 }
 
 void App::addPackets(const std::vector<Packet>& pkts) {
+    TraceSpan span("app", "addPackets");
+    StageTimer timer(&metrics_, PipelineStage::Store);
+
+    {
+        // Applies from the session's next segment on
+        std::lock_guard<std::mutex> lock(suppressionMutex_);
+        for (const auto& pkt : pkts) {
+            if (pkt.isHandshake && !suppressionLoaded_.contains({ pkt.locale, pkt.version })) {
+                loadSuppressionRules(pkt.locale, pkt.version);
+            }
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(latencyMutex_);
+        for (const auto& pkt : pkts) {
+            if (pkt.isHandshake && !latency_.hasPairs(pkt.locale, pkt.version)) {
+                loadOpcodePairs(pkt.locale, pkt.version);
+            }
+            latency_.onPacket(pkt);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(timelineMutex_);
+        for (const auto& pkt : pkts) timeline_.onPacket(pkt);
+    }
+    {
+        std::lock_guard<std::mutex> lock(variabilityMutex_);
+        for (const auto& pkt : pkts) variability_.onPacket(pkt);
+    }
+    {
+        std::lock_guard<std::mutex> lock(sequencesMutex_);
+        for (const auto& pkt : pkts) sequences_.onPacket(pkt);
+    }
+    {
+        std::lock_guard<std::mutex> lock(watchMutex_);
+        size_t matches = 0;
+        for (const auto& pkt : pkts) {
+            if (pkt.isHandshake && !watch_.hasRules(pkt.locale, pkt.version)) {
+                loadWatchRules(pkt.locale, pkt.version);
+            }
+            matches += watch_.onPacket(pkt);
+        }
+        if (matches) metrics_.add(PipelineCounter::WatchMatches, matches);
+    }
+    {
+        std::lock_guard<std::mutex> lock(triggerMutex_);
+        trigger_.onPackets(pkts);
+    }
+    {
+        std::lock_guard<std::mutex> lock(fieldsMutex_);
+        for (const auto& pkt : pkts) {
+            if (pkt.isHandshake && !fields_.hasLayouts(pkt.locale, pkt.version)) {
+                loadLayouts(pkt.locale, pkt.version);
+            }
+        }
+    }
+
+    // Queued for the sink threads, never waited on
+    sinks_.publish(pkts);
+
+    uint64_t now = monotonicNs();
     std::lock_guard<std::mutex> lock(packetsMutex_);
+    std::lock_guard<std::mutex> fieldsLock(fieldsMutex_);
     for (const auto& pkt : pkts) {
         // Track session info from handshake packets
         if (pkt.isHandshake && pkt.version > 0) {
@@ -164,16 +376,46 @@ void App::addPackets(const std::vector<Packet>& pkts) {
             }
         }
 
+        // Field rows are keyed by the sequence number the packet is stored under
+        fields_.onPacket(pkt, nextPacketSeq_);
+
+        // Counted by the analyzers above, but never stored or sent to the UI
+        if (pkt.suppressed) {
+            auto& count = suppressedCounts_[{ pkt.sessionId, pkt.outbound, pkt.opcode }];
+            count.packets++;
+            count.bytes += pkt.length;
+            continue;
+        }
+
+        ring_.publish(pkt);
+        values_.add(nextPacketSeq_, pkt);
         packets_.push_back(pkt);
+        enqueuedAtNs_.push_back(now);
         nextPacketSeq_++;
         if (packets_.size() > MAX_PACKETS) {
             packets_.pop_front();
+            enqueuedAtNs_.pop_front();
             baseSeq_++;
         }
     }
+
+    // Field rows outlive the packet buffer; they have their own memory budget,
+    // checked in batches since summing the columns walks every layout
+    static constexpr uint64_t FIELD_BUDGET_INTERVAL = 4096;
+    if (nextPacketSeq_ - fieldsCheckedSeq_ >= FIELD_BUDGET_INTERVAL) {
+        fields_.enforceBudget();
+        fieldsCheckedSeq_ = nextPacketSeq_;
+    }
+}
+
+void App::onRawFrame(const RawPacket& raw) {
+    if (!triggerFrames_.load(std::memory_order_relaxed)) return;
+    std::lock_guard<std::mutex> lock(triggerMutex_);
+    trigger_.onFrame(raw);
 }
 
 std::string App::getStatus() {
+    TraceSpan span("bridge", "getStatus");
     json j;
     j["capturing"] = capture_.isRunning();
     j["interface"] = capture_.currentInterface();
@@ -199,6 +441,7 @@ std::string App::getInterfaces() {
 }
 
 std::string App::getPackets(int since) {
+    TraceSpan span("bridge", "getPackets");
     std::lock_guard<std::mutex> lock(packetsMutex_);
     json j = json::array();
 
@@ -209,31 +452,262 @@ std::string App::getPackets(int since) {
         startOffset = static_cast<size_t>(sinceSeq - baseSeq_);
     }
 
+    TraceSpan serialize("json", "serializePackets");
+    uint64_t now = monotonicNs();
     for (size_t i = startOffset; i < packets_.size(); i++) {
-        const auto& pkt = packets_[i];
-        json pktJson;
-        pktJson["index"] = static_cast<uint64_t>(baseSeq_ + i);
-        pktJson["timestamp"] = pkt.timestamp;
-        pktJson["length"] = pkt.length;
-        pktJson["hexDump"] = pkt.hexDump;
-        pktJson["outbound"] = pkt.outbound;
-        pktJson["isHandshake"] = pkt.isHandshake;
-        pktJson["sessionId"] = pkt.sessionId;
-
-        if (pkt.isHandshake) {
-            pktJson["opcode"] = "Handshake";
-            pktJson["opcodeRaw"] = 0;
-            pktJson["version"] = pkt.version;
-            pktJson["subVersion"] = pkt.subVersionStr;
-            pktJson["locale"] = pkt.locale;
-        } else {
-            pktJson["opcode"] = formatOpcode(pkt.opcode);
-            pktJson["opcodeRaw"] = pkt.opcode;
+        j.push_back(packetToJson(packets_[i], baseSeq_ + i));
+
+        // First hand-out of a packet ends its trip through the pipeline
+        if (baseSeq_ + i >= deliveredSeq_) {
+            metrics_.record(PipelineStage::Delivery, now - enqueuedAtNs_[i]);
+            metrics_.add(PipelineCounter::PacketsDelivered);
+        }
+    }
+    deliveredSeq_ = std::max(deliveredSeq_, baseSeq_ + packets_.size());
+    return j.dump();
+}
+
+static constexpr char LIVE_STATE_MAGIC[8] = { 'M', 'S', 'L', 'I', 'V', 'E', '\0', '\0' };
+static constexpr uint32_t LIVE_STATE_VERSION = 1;
+
+bool App::saveLiveState() {
+    std::lock_guard<std::mutex> saveLock(liveStateMutex_);
+
+    // Only connections that can still produce traffic are worth resuming
+    ProtocolState state = protocol_.saveState();
+    std::erase_if(state.sessions, [](const ProtocolState::Entry& e) {
+        return e.session.terminated || e.session.deadNotified;
+    });
+
+    std::error_code ec;
+    if (state.sessions.empty()) {
+        fs::remove(liveStatePath_, ec);
+        return true;
+    }
+
+    std::vector<SessionMeta> metas;
+    {
+        std::lock_guard<std::mutex> lock(packetsMutex_);
+        for (const auto& s : sessions_) {
+            if (s.dead) continue;
+            for (const auto& e : state.sessions) {
+                if (e.session.sessionId == s.id) { metas.push_back(s); break; }
+            }
+        }
+    }
+
+    // Write to a temp file and rename so a crash mid-write keeps the old state
+    fs::path tmpPath = liveStatePath_;
+    tmpPath += ".tmp";
+    {
+        std::ofstream ofs(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!ofs.is_open()) {
+            std::cerr << "[App] Cannot write live state: " << tmpPath.string() << std::endl;
+            return false;
+        }
+
+        BinaryWriter w(ofs);
+        w.raw(LIVE_STATE_MAGIC, sizeof(LIVE_STATE_MAGIC));
+        w.u32(LIVE_STATE_VERSION);
+        w.i64(std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+        writeProtocolState(w, state);
+
+        w.u32(static_cast<uint32_t>(metas.size()));
+        for (const auto& m : metas) {
+            w.u32(m.id);
+            w.u8(m.locale);
+            w.u16(m.version);
+            w.str(m.subVersion);
+            w.u16(m.serverPort);
+            w.f64(m.timestamp);
+        }
+        if (!w.ok()) return false;
+    }
+
+    fs::rename(tmpPath, liveStatePath_, ec);
+    if (ec) {
+        std::cerr << "[App] Cannot replace live state: " << ec.message() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool App::restoreLiveState() {
+    std::lock_guard<std::mutex> saveLock(liveStateMutex_);
+
+    std::ifstream ifs(liveStatePath_, std::ios::binary);
+    if (!ifs.is_open()) return false;
+
+    BinaryReader r(ifs);
+    char magic[sizeof(LIVE_STATE_MAGIC)];
+    r.raw(magic, sizeof(magic));
+    if (!r.ok() || std::memcmp(magic, LIVE_STATE_MAGIC, sizeof(magic)) != 0 || r.u32() != LIVE_STATE_VERSION) {
+        std::cerr << "[App] Ignoring unrecognized live state file" << std::endl;
+        return false;
+    }
+
+    int64_t savedAt = r.i64();
+    int64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    if (now - savedAt > LIVE_STATE_MAX_AGE_SECONDS) {
+        std::cout << "[App] Live state is " << (now - savedAt) << "s old, not resuming sessions" << std::endl;
+        return false;
+    }
+
+    ProtocolState state;
+    if (!readProtocolState(r, state)) {
+        std::cerr << "[App] Corrupt live state file" << std::endl;
+        return false;
+    }
+
+    std::vector<SessionMeta> metas;
+    uint32_t metaCount = r.u32();
+    for (uint32_t i = 0; i < metaCount && r.ok(); i++) {
+        SessionMeta m{};
+        m.id = r.u32();
+        m.locale = r.u8();
+        m.version = r.u16();
+        m.subVersion = r.str(64);
+        m.serverPort = r.u16();
+        m.timestamp = r.f64();
+        m.restored = true;
+        metas.push_back(std::move(m));
+    }
+    if (!r.ok()) {
+        std::cerr << "[App] Corrupt live state file" << std::endl;
+        return false;
+    }
+
+    // Traffic was missed while we were down: streams re-acquire their IV on the next segment
+    protocol_.restoreState(state, true);
+    {
+        // No handshake will be seen again for these sessions
+        std::lock_guard<std::mutex> lock(latencyMutex_);
+        for (const auto& m : metas) {
+            if (!latency_.hasPairs(m.locale, m.version)) loadOpcodePairs(m.locale, m.version);
+            latency_.bindSession(m.id, m.locale, m.version);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(watchMutex_);
+        for (const auto& m : metas) {
+            if (!watch_.hasRules(m.locale, m.version)) loadWatchRules(m.locale, m.version);
+            watch_.bindSession(m.id, m.locale, m.version);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(fieldsMutex_);
+        for (const auto& m : metas) {
+            if (!fields_.hasLayouts(m.locale, m.version)) loadLayouts(m.locale, m.version);
+            fields_.bindSession(m.id, m.locale, m.version);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(suppressionMutex_);
+        for (const auto& m : metas) {
+            if (!suppressionLoaded_.contains({ m.locale, m.version })) loadSuppressionRules(m.locale, m.version);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(packetsMutex_);
+        sessions_ = std::move(metas);
+    }
+
+    std::cout << "[App] Resumed " << state.sessions.size() << " session(s) from previous run" << std::endl;
+    return true;
+}
+
+void App::autosaveLoop(std::stop_token stop) {
+    std::mutex m;
+    std::unique_lock<std::mutex> lock(m);
+    while (!stop.stop_requested()) {
+        autosaveCv_.wait_for(lock, stop, std::chrono::seconds(LIVE_STATE_AUTOSAVE_SECONDS), [] { return false; });
+        if (stop.stop_requested()) break;
+        if (capture_.isRunning()) saveLiveState();
+    }
+}
+
+void App::statsLoop(std::stop_token stop) {
+    std::mutex m;
+    std::unique_lock<std::mutex> lock(m);
+    auto previous = metrics_.snapshot();
+    while (!stop.stop_requested()) {
+        statsCv_.wait_for(lock, stop, std::chrono::seconds(STATS_LOG_SECONDS), [] { return false; });
+        if (stop.stop_requested()) break;
+
+        {
+            // Close a post-trigger window even if traffic stopped
+            std::lock_guard<std::mutex> triggerLock(triggerMutex_);
+            trigger_.poll(wallClockNs());
         }
 
-        pktJson["decrypted"] = !pkt.isHandshake;
-        j.push_back(pktJson);
+        auto current = metrics_.snapshot();
+        auto interval = current - previous;
+        previous = std::move(current);
+        if (interval.counters[static_cast<size_t>(PipelineCounter::FramesCaptured)] == 0) continue;
+        std::cout << "[Stats] " << PipelineMetrics::formatLogLine(interval) << std::endl;
+    }
+}
+
+std::string App::getPipelineStats() {
+    TraceSpan span("bridge", "getPipelineStats");
+    auto snap = metrics_.snapshot();
+
+    json stages = json::object();
+    for (size_t i = 0; i < PipelineMetrics::STAGE_COUNT; i++) {
+        const auto& h = snap.stages[i];
+        stages[pipelineStageName(static_cast<PipelineStage>(i))] = {
+            {"count", h.count},
+            {"meanNs", h.mean()},
+            {"minNs", h.min()},
+            {"p50Ns", h.percentile(0.5)},
+            {"p90Ns", h.percentile(0.9)},
+            {"p99Ns", h.percentile(0.99)},
+            {"p999Ns", h.percentile(0.999)},
+            {"maxNs", h.max()}
+        };
+    }
+
+    json counters = json::object();
+    for (size_t i = 0; i < PipelineMetrics::COUNTER_COUNT; i++) {
+        counters[pipelineCounterName(static_cast<PipelineCounter>(i))] = snap.counters[i];
+    }
+
+    json j;
+    j["stages"] = stages;
+    j["counters"] = counters;
+    return j.dump();
+}
+
+bool App::startTrace() {
+    Tracer::instance().start();
+    std::cout << "[App] Trace recording started" << std::endl;
+    return true;
+}
+
+std::string App::stopTrace() {
+    Tracer::instance().stop();
+
+    std::error_code ec;
+    fs::create_directories(tracesPath_, ec);
+
+    std::time_t now = std::time(nullptr);
+    std::tm tm{};
+    localtime_s(&tm, &now);
+    std::ostringstream name;
+    name << "trace-" << std::put_time(&tm, "%Y%m%d-%H%M%S") << ".json";
+    fs::path path = tracesPath_ / name.str();
+
+    if (!Tracer::instance().writeJson(path)) {
+        std::cerr << "[App] Cannot write trace: " << path.string() << std::endl;
+        return "{}";
     }
+    std::cout << "[App] Trace written to " << path.string() << std::endl;
+
+    json j;
+    auto u8 = path.u8string();
+    j["path"] = std::string(u8.begin(), u8.end());
     return j.dump();
 }
 
@@ -247,9 +721,25 @@ bool App::startCapture(const std::string& iface, const std::string& filter) {
     {
         std::lock_guard<std::mutex> lock(packetsMutex_);
         packets_.clear();
-        sessions_.clear();
+        enqueuedAtNs_.clear();
+        deliveredSeq_ = 0;
+        // Sessions resumed from the previous run are still being decoded
+        std::erase_if(sessions_, [](const SessionMeta& s) { return !s.restored || s.dead; });
+        std::erase_if(suppressedCounts_, [this](const auto& entry) {
+            uint32_t id = std::get<0>(entry.first);
+            return std::none_of(sessions_.begin(), sessions_.end(), [id](const SessionMeta& s) { return s.id == id; });
+        });
         nextPacketSeq_ = 0;
         baseSeq_ = 0;
+
+        std::lock_guard<std::mutex> fieldsLock(fieldsMutex_);
+        fields_.clearValues();
+        fieldsCheckedSeq_ = 0;
+        values_.clear();
+    }
+    {
+        std::lock_guard<std::mutex> lock(variabilityMutex_);
+        variability_.clear();
     }
 
     return capture_.start(iface, filter);
@@ -291,6 +781,143 @@ bool App::saveScript(const std::string& direction, int opcode, const std::string
     return ofs.good();
 }
 
+std::string App::inferLayout(const std::string& direction, int opcode, bool offline) {
+    TraceSpan span("bridge", "inferLayout");
+    bool outbound = direction == "send";
+    std::ostringstream header;
+    header << "Parse opcode " << formatOpcode(static_cast<uint16_t>(opcode)) << " (" << direction << ")";
+
+    auto respond = [&](const InferredLayout& layout) {
+        static const char* KIND_NAMES[] = { "byte", "short", "int", "long", "filetime", "string", "tail" };
+        json fields = json::array();
+        for (const auto& f : layout.fields) {
+            json jf = {{"kind", KIND_NAMES[static_cast<int>(f.kind)]}, {"name", f.name}, {"offset", f.offset},
+                       {"min", f.minValue}, {"max", f.maxValue}, {"counter", f.counter}, {"flag", f.flag}};
+            if (f.constant) jf["constant"] = *f.constant;
+            fields.push_back(std::move(jf));
+        }
+        json j;
+        j["samples"] = layout.samples;
+        j["minSize"] = layout.minSize;
+        j["maxSize"] = layout.maxSize;
+        j["fields"] = fields;
+        j["script"] = layout.samples ? LayoutInference::toScript(layout, header.str()) : "";
+        return j.dump();
+    };
+
+    // Samples point into the store/buffer: infer while its lock is held (milliseconds)
+    std::vector<std::span<const uint8_t>> samples;
+    if (offline) {
+        std::lock_guard<std::mutex> lock(offlineMutex_);
+        if (offlineStore_) {
+            const PacketStore& store = *offlineStore_;
+            for (size_t i = 0; i < store.size(); i++) {
+                uint8_t f = store.flags()[i];
+                if (store.opcodes()[i] != opcode || ((f & PacketStore::FLAG_OUTBOUND) != 0) != outbound ||
+                    (f & (PacketStore::FLAG_HANDSHAKE | PacketStore::FLAG_DEAD))) continue;
+                samples.emplace_back(store.payload(i), store.payloadSize(i));
+            }
+        }
+        return respond(LayoutInference::infer(samples));
+    }
+
+    std::lock_guard<std::mutex> lock(packetsMutex_);
+    for (const auto& pkt : packets_) {
+        if (pkt.opcode != opcode || pkt.outbound != outbound || pkt.isHandshake || pkt.isDeadNotification) continue;
+        samples.emplace_back(pkt.payload.data(), pkt.payload.size());
+    }
+    return respond(LayoutInference::infer(samples));
+}
+
+static json parsedFieldToJson(const ParsedField& f) {
+    json j = {{"name", f.name}, {"type", f.type}, {"offset", f.offset}, {"length", f.length}};
+    switch (f.kind) {
+        case ParsedField::ValueKind::Null: j["value"] = nullptr; break;
+        case ParsedField::ValueKind::Number: j["value"] = f.number; break;
+        case ParsedField::ValueKind::Text: j["value"] = f.text; break;
+    }
+    if (f.type == "object" || f.type == "array") {
+        json children = json::array();
+        for (const auto& c : f.children) children.push_back(parsedFieldToJson(c));
+        j["children"] = std::move(children);
+    }
+    return j;
+}
+
+std::string App::runScriptBulk(const std::string& direction, int opcode, int locale, int version,
+                               bool offline, int sessionId, int limit) {
+    TraceSpan span("bridge", "runScriptBulk");
+    std::string code = getScript(direction, opcode, locale, version);
+    if (code.empty()) return "{}";
+    bool outbound = direction == "send";
+    size_t cap = static_cast<size_t>(std::clamp(limit, 1, 1000000));
+
+    // Payloads to parse with the packet index each result is reported under
+    std::vector<uint64_t> indexes;
+    std::vector<std::vector<uint8_t>> copies;
+    std::vector<std::span<const uint8_t>> payloads;
+    std::unique_lock<std::mutex> offlineLock(offlineMutex_, std::defer_lock);
+    if (offline) {
+        // The store stays locked while the scripts read it in place
+        offlineLock.lock();
+        if (!offlineStore_) return "{}";
+        const PacketStore& store = *offlineStore_;
+        for (size_t i = 0; i < store.size() && payloads.size() < cap; i++) {
+            uint8_t f = store.flags()[i];
+            if (store.opcodes()[i] != opcode || ((f & PacketStore::FLAG_OUTBOUND) != 0) != outbound ||
+                (f & (PacketStore::FLAG_HANDSHAKE | PacketStore::FLAG_DEAD))) continue;
+            if (sessionId >= 0 && store.sessionIds()[i] != static_cast<uint32_t>(sessionId)) continue;
+            indexes.push_back(i);
+            payloads.emplace_back(store.payload(i), store.payloadSize(i));
+        }
+    } else {
+        // Live payloads are copied so capture is not held up by the scripts
+        std::lock_guard<std::mutex> lock(packetsMutex_);
+        for (size_t i = 0; i < packets_.size() && copies.size() < cap; i++) {
+            const Packet& pkt = packets_[i];
+            if (pkt.opcode != opcode || pkt.outbound != outbound || pkt.isHandshake || pkt.isDeadNotification) continue;
+            if (sessionId >= 0 && pkt.sessionId != static_cast<uint32_t>(sessionId)) continue;
+            indexes.push_back(baseSeq_ + i);
+            copies.push_back(pkt.payload);
+        }
+        for (const auto& c : copies) payloads.emplace_back(c);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<ScriptResult> results;
+    std::string error;
+    bool compiled;
+    {
+        std::lock_guard<std::mutex> lock(scriptsMutex_);
+        std::ostringstream key;
+        key << locale << "_" << version << "/" << direction << "_" << opcode;
+        compiled = scripts_.run(key.str(), code, payloads, results, error);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (!compiled) return json{{"error", error}}.dump();
+
+    TraceSpan serialize("bridge", "runScriptBulk.json");
+    json list = json::array();
+    size_t failed = 0;
+    for (size_t k = 0; k < results.size(); k++) {
+        const ScriptResult& r = results[k];
+        json fields = json::array();
+        for (const auto& f : r.fields) fields.push_back(parsedFieldToJson(f));
+        json entry = {{"index", indexes[k]}, {"success", r.success}, {"fields", std::move(fields)}};
+        if (!r.success) {
+            entry["error"] = r.error;
+            failed++;
+        }
+        list.push_back(std::move(entry));
+    }
+    json j;
+    j["packets"] = results.size();
+    j["failed"] = failed;
+    j["seconds"] = seconds;
+    j["results"] = std::move(list);
+    return j.dump();
+}
+
 std::string App::listScripts(int locale, int version) {
     json j = json::array();
     if (version == 0) return j.dump();
@@ -327,19 +954,49 @@ std::string App::listScripts(int locale, int version) {
     return j.dump();
 }
 
+static json tcpStatsToJson(const TcpStats& t) {
+    json sizes = json::array();
+    for (uint64_t n : t.sizeBuckets) sizes.push_back(n);
+    return {
+        {"segments", t.segments},
+        {"bytes", t.bytes},
+        {"retransmittedBytes", t.retransmittedBytes},
+        {"outOfOrderSegments", t.outOfOrderSegments},
+        {"replacements", t.replacements},
+        {"holes", t.holes},
+        {"holeTotalNs", t.holeTotalNs},
+        {"holeMaxNs", t.holeMaxNs},
+        {"sizeBuckets", sizes}
+    };
+}
+
 std::string App::getSessions() {
+    TraceSpan span("bridge", "getSessions");
+    std::map<uint32_t, SessionTcpStats> tcp;
+    for (auto& t : protocol_.tcpStats()) tcp[t.sessionId] = std::move(t);
+
     std::lock_guard<std::mutex> lock(packetsMutex_);
     json j = json::array();
     for (const auto& s : sessions_) {
-        j.push_back({
+        json sj = {
             {"id", s.id},
             {"locale", s.locale},
             {"version", s.version},
             {"subVersion", s.subVersion},
             {"serverPort", s.serverPort},
             {"timestamp", s.timestamp},
-            {"dead", s.dead}
-        });
+            {"dead", s.dead},
+            {"restored", s.restored}
+        };
+        auto it = tcp.find(s.id);
+        if (it != tcp.end()) {
+            sj["tcp"] = {
+                {"rttNs", it->second.rttNs},
+                {"inbound", tcpStatsToJson(it->second.inbound)},
+                {"outbound", tcpStatsToJson(it->second.outbound)}
+            };
+        }
+        j.push_back(sj);
     }
     return j.dump();
 }
@@ -364,38 +1021,1468 @@ bool App::saveOpcodeNames(int locale, int version, const std::string& namesJson)
     return ofs.good();
 }
 
-std::string App::decryptOpcodes(const std::string& hexPayload, const std::string& desKey) {
-    // Parse space-separated hex string to bytes
-    std::vector<uint8_t> bytes;
-    std::istringstream iss(hexPayload);
+// Opcode given as a number or a "0x1234" string
+static std::optional<uint16_t> parseOpcodeValue(const json& v) {
+    if (v.is_number_unsigned() && v.get<uint64_t>() <= 0xFFFF) return v.get<uint16_t>();
+    if (v.is_string()) {
+        try {
+            unsigned long n = std::stoul(v.get<std::string>(), nullptr, 0);
+            if (n <= 0xFFFF) return static_cast<uint16_t>(n);
+        } catch (...) {}
+    }
+    return std::nullopt;
+}
+
+// Space-separated hex bytes ("0A 00 FF"), the hexDump format
+static bool parseHexBytes(const std::string& text, std::vector<uint8_t>& out) {
+    std::istringstream iss(text);
     std::string hexByte;
     while (iss >> hexByte) {
-        if (hexByte.size() == 2) {
-            try {
-                bytes.push_back(static_cast<uint8_t>(std::stoi(hexByte, nullptr, 16)));
-            } catch (...) {
-                return "{}";
+        if (hexByte.size() != 2) return false;
+        try {
+            out.push_back(static_cast<uint8_t>(std::stoi(hexByte, nullptr, 16)));
+        } catch (...) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void App::loadOpcodePairs(uint8_t locale, uint16_t version) {
+    std::vector<OpcodePair> pairs;
+    auto path = scriptsBasePath_ / (std::to_string(locale) + "_" + std::to_string(version)) / "pairs.json";
+    std::ifstream ifs(path);
+    if (ifs.is_open()) {
+        json j = json::parse(ifs, nullptr, false);
+        if (j.is_array()) {
+            for (const auto& e : j) {
+                if (!e.is_object() || !e.contains("request") || !e.contains("response")) continue;
+                auto request = parseOpcodeValue(e["request"]);
+                auto response = parseOpcodeValue(e["response"]);
+                if (!request || !response) continue;
+
+                OpcodePair pair;
+                pair.request = *request;
+                pair.response = *response;
+                pair.name = e.value("name", formatOpcode(pair.request) + " -> " + formatOpcode(pair.response));
+                if (e.contains("timeoutMs") && e["timeoutMs"].is_number()) {
+                    pair.timeoutNs = static_cast<int64_t>(e["timeoutMs"].get<double>() * 1e6);
+                }
+                pairs.push_back(std::move(pair));
             }
+        } else {
+            std::cerr << "[App] Ignoring malformed " << path.string() << std::endl;
         }
     }
+    // Set even when empty so the file is not re-read on every handshake
+    latency_.setPairs(locale, version, std::move(pairs));
+}
 
-    if (bytes.size() < 4) return "{}";
+std::string App::getOpcodePairs(int locale, int version) {
+    auto path = scriptsBasePath_ / (std::to_string(locale) + "_" + std::to_string(version)) / "pairs.json";
+    std::ifstream ifs(path);
+    if (!ifs.is_open()) return "[]";
+    return std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+}
 
-    int32_t bufferSize = static_cast<int32_t>(
-        bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (bytes[3] << 24));
+bool App::saveOpcodePairs(int locale, int version, const std::string& pairsJson) {
+    if (!json::accept(pairsJson)) return false;
 
-    if (bufferSize <= 0 || static_cast<int>(bytes.size()) < 4 + bufferSize) return "{}";
+    auto dir = scriptsBasePath_ / (std::to_string(locale) + "_" + std::to_string(version));
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    if (ec) return false;
 
-    auto mapping = MapleStream::parseOpcodeEncryption(
-        bytes.data() + 4, static_cast<int>(bytes.size()) - 4, bufferSize, desKey);
+    std::ofstream ofs(dir / "pairs.json", std::ios::trunc);
+    if (!ofs.is_open()) return false;
+    ofs << pairsJson;
+    ofs.close();
+    if (!ofs) return false;
 
-    if (mapping.empty()) return "{}";
+    std::lock_guard<std::mutex> lock(latencyMutex_);
+    loadOpcodePairs(static_cast<uint8_t>(locale), static_cast<uint16_t>(version));
+    return true;
+}
 
-    json j;
-    for (const auto& [enc, real] : mapping) {
-        j[std::to_string(enc)] = real;
+void App::loadSuppressionRules(uint8_t locale, uint16_t version) {
+    SuppressionRules rules;
+    auto path = scriptsBasePath_ / (std::to_string(locale) + "_" + std::to_string(version)) / "suppress.json";
+    std::ifstream ifs(path);
+    if (ifs.is_open()) {
+        // { "send": [opcodes], "recv": [opcodes] }, same direction keys as opcodes.json
+        json j = json::parse(ifs, nullptr, false);
+        if (j.is_object()) {
+            auto readSet = [&](const char* key, std::bitset<65536>& set) {
+                if (!j.contains(key) || !j[key].is_array()) return;
+                for (const auto& v : j[key]) {
+                    if (auto op = parseOpcodeValue(v)) set.set(*op);
+                }
+            };
+            readSet("send", rules.outbound);
+            readSet("recv", rules.inbound);
+        } else {
+            std::cerr << "[App] Ignoring malformed " << path.string() << std::endl;
+        }
     }
-    return j.dump();
+    protocol_.setSuppression(locale, version, rules);
+    suppressionLoaded_.insert({ locale, version });
+}
+
+std::string App::getSuppressionRules(int locale, int version) {
+    auto path = scriptsBasePath_ / (std::to_string(locale) + "_" + std::to_string(version)) / "suppress.json";
+    std::ifstream ifs(path);
+    if (!ifs.is_open()) return R"({"send":[],"recv":[]})";
+    return std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+}
+
+bool App::saveSuppressionRules(int locale, int version, const std::string& rulesJson) {
+    if (!json::accept(rulesJson)) return false;
+
+    auto dir = scriptsBasePath_ / (std::to_string(locale) + "_" + std::to_string(version));
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    if (ec) return false;
+
+    std::ofstream ofs(dir / "suppress.json", std::ios::trunc);
+    if (!ofs.is_open()) return false;
+    ofs << rulesJson;
+    ofs.close();
+    if (!ofs) return false;
+
+    std::lock_guard<std::mutex> lock(suppressionMutex_);
+    loadSuppressionRules(static_cast<uint8_t>(locale), static_cast<uint16_t>(version));
+    return true;
+}
+
+std::string App::getSuppressionStats() {
+    TraceSpan span("bridge", "getSuppressionStats");
+    json j = json::array();
+    std::lock_guard<std::mutex> lock(packetsMutex_);
+    for (const auto& [key, count] : suppressedCounts_) {
+        const auto& [sessionId, outbound, opcode] = key;
+        j.push_back({
+            {"sessionId", sessionId},
+            {"outbound", outbound},
+            {"opcode", formatOpcode(opcode)},
+            {"opcodeRaw", opcode},
+            {"packets", count.packets},
+            {"bytes", count.bytes}
+        });
+    }
+    return j.dump();
+}
+
+std::string App::findValue(const std::string& hexBytes, bool offline, int limit) {
+    TraceSpan span("bridge", "findValue");
+    std::vector<uint8_t> bytes;
+    if (!parseHexBytes(hexBytes, bytes) || (bytes.size() != 2 && bytes.size() != 4 && bytes.size() != 8)) {
+        return json{{"error", "Select 2, 4 or 8 bytes"}}.dump();
+    }
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes.size(); i++) value |= static_cast<uint64_t>(bytes[i]) << (8 * i);
+    size_t cap = limit > 0 ? static_cast<size_t>(limit) : 1000;
+    uint8_t width = static_cast<uint8_t>(bytes.size());
+
+    ValueMatches matches;
+    if (offline) {
+        // First lookup indexes the whole store (seconds for millions of packets)
+        std::lock_guard<std::mutex> lock(offlineMutex_);
+        if (!offlineStore_) return json{{"error", "No decoded capture loaded"}}.dump();
+        if (!offlineValues_) {
+            ValueIndex::Options options;
+            options.memoryBudget = 1ull << 30;
+            offlineValues_ = std::make_unique<ValueIndex>(options);
+            const PacketStore& store = *offlineStore_;
+            for (size_t i = 0; i < store.size(); i++) {
+                uint8_t f = store.flags()[i];
+                if (f & PacketStore::FLAG_HANDSHAKE) continue;
+                offlineValues_->add(i, store.opcodes()[i], (f & PacketStore::FLAG_OUTBOUND) != 0,
+                                    store.sessionIds()[i], store.payload(i), store.payloadSize(i));
+            }
+            offlineValues_->flush();
+        }
+        matches = offlineValues_->find(width, value, cap);
+    } else {
+        matches = values_.find(width, value, cap);
+    }
+
+    json list = json::array();
+    for (const auto& m : matches.postings) {
+        list.push_back({
+            {"seq", m.seq},
+            {"offset", m.offset},
+            {"opcode", formatOpcode(m.opcode)},
+            {"opcodeRaw", m.opcode},
+            {"outbound", m.outbound},
+            {"sessionId", m.sessionId}
+        });
+    }
+    json j;
+    j["width"] = width;
+    j["total"] = matches.total;
+    j["common"] = matches.common;
+    j["indexedFromSeq"] = matches.indexedFromSeq;
+    j["matches"] = list;
+    return j.dump();
+}
+
+std::string App::getValueIndexStats() {
+    TraceSpan span("bridge", "getValueIndexStats");
+    ValueIndexStats s = values_.stats();
+    return json{
+        {"packets", s.packets},
+        {"indexedFromSeq", s.indexedFromSeq},
+        {"segments", s.segments},
+        {"pendingPackets", s.pendingPackets},
+        {"keys", s.keys},
+        {"commonKeys", s.commonKeys},
+        {"postingBytes", s.postingBytes},
+        {"memoryBytes", s.memoryBytes},
+        {"evictedSegments", s.evictedSegments}
+    }.dump();
+}
+
+std::string App::getByteVariability(const std::string& direction, int opcode) {
+    TraceSpan span("bridge", "getByteVariability");
+    std::optional<ByteVariabilityMap> map;
+    {
+        std::lock_guard<std::mutex> lock(variabilityMutex_);
+        map = variability_.map(direction == "send", static_cast<uint16_t>(opcode));
+    }
+
+    // Column arrays, one entry per payload byte position
+    json samples = json::array(), mins = json::array(), maxs = json::array();
+    json distinct = json::array(), entropy = json::array();
+    if (map) {
+        for (const auto& p : map->positions) {
+            samples.push_back(p.samples);
+            mins.push_back(p.min);
+            maxs.push_back(p.max);
+            distinct.push_back(p.distinct);
+            entropy.push_back(std::round(p.entropy * 1000) / 1000);
+        }
+    }
+    json j;
+    j["packets"] = map ? map->packets : 0;
+    j["samples"] = samples;
+    j["min"] = mins;
+    j["max"] = maxs;
+    j["distinct"] = distinct;
+    j["entropy"] = entropy;
+    return j.dump();
+}
+
+std::string App::getSharedRingStatus() {
+    TraceSpan span("bridge", "getSharedRingStatus");
+    std::lock_guard<std::mutex> lock(packetsMutex_);
+    return json{
+        {"open", ring_.isOpen()},
+        {"name", ring_.name()},
+        {"capacity", ring_.capacity()},
+        {"published", ring_.published()},
+        {"truncated", ring_.truncated()},
+        {"nextSeq", ring_.nextSeq()}
+    }.dump();
+}
+
+static const char* SINK_KIND_NAMES[] = { "binary", "ndjson", "stream" };
+static const char* SINK_POLICY_NAMES[] = { "dropNewest", "dropOldest", "block" };
+
+static bool parseSinkConfigs(const json& list, const fs::path& baseDir, std::vector<SinkConfig>& out,
+                             std::string& error) {
+    if (!list.is_array()) {
+        error = "Expected an array of sinks";
+        return false;
+    }
+    for (const auto& e : list) {
+        if (!e.is_object()) {
+            error = "Invalid sink entry";
+            return false;
+        }
+        SinkConfig c;
+        c.name = e.value("name", "sink" + std::to_string(out.size()));
+
+        std::string kind = e.value("kind", "binary");
+        auto k = std::find(std::begin(SINK_KIND_NAMES), std::end(SINK_KIND_NAMES), kind);
+        if (k == std::end(SINK_KIND_NAMES)) {
+            error = c.name + ": unknown kind " + kind;
+            return false;
+        }
+        c.kind = static_cast<SinkConfig::Kind>(k - std::begin(SINK_KIND_NAMES));
+
+        std::string policy = e.value("policy", "dropNewest");
+        auto p = std::find(std::begin(SINK_POLICY_NAMES), std::end(SINK_POLICY_NAMES), policy);
+        if (p == std::end(SINK_POLICY_NAMES)) {
+            error = c.name + ": unknown policy " + policy;
+            return false;
+        }
+        c.policy = static_cast<SinkConfig::Policy>(p - std::begin(SINK_POLICY_NAMES));
+
+        c.path = e.value("path", "");
+        if (c.kind == SinkConfig::Kind::Stream) {
+            if (c.path.empty()) c.path = "MapleSniffer.Packets";
+        } else {
+            // Relative directories are next to the exe
+            fs::path dir = pathFromUtf8(c.path.empty() ? "sinks" : c.path);
+            if (dir.is_relative()) dir = baseDir / dir;
+            auto u8 = dir.u8string();
+            c.path.assign(u8.begin(), u8.end());
+        }
+        c.prefix = e.value("prefix", c.name);
+        c.rotateBytes = static_cast<uint64_t>(e.value("rotateMB", 256.0) * 1024 * 1024);
+        c.keepFiles = e.value("keepFiles", 8u);
+        c.json = e.value("json", false);
+        c.queueBytes = static_cast<size_t>(e.value("queueMB", 64.0) * 1024 * 1024);
+        c.blockMs = e.value("blockMs", 20u);
+        if (c.rotateBytes == 0 || c.queueBytes == 0) {
+            error = c.name + ": rotateMB and queueMB must be positive";
+            return false;
+        }
+        out.push_back(std::move(c));
+    }
+    return true;
+}
+
+bool App::loadSinks() {
+    std::ifstream ifs(sinksPath_);
+    if (!ifs) return true;   // none configured
+    json j = json::parse(ifs, nullptr, false);
+    std::vector<SinkConfig> configs;
+    std::string error;
+    if (!parseSinkConfigs(j, sinksPath_.parent_path(), configs, error) || !sinks_.configure(configs, error)) {
+        std::cerr << "[App] sinks.json: " << error << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::string App::getSinks() {
+    TraceSpan span("bridge", "getSinks");
+    json list = json::array();
+    for (const auto& [c, stats] : sinks_.stats()) {
+        list.push_back({
+            {"name", c.name},
+            {"kind", SINK_KIND_NAMES[static_cast<int>(c.kind)]},
+            {"policy", SINK_POLICY_NAMES[static_cast<int>(c.policy)]},
+            {"path", c.path},
+            {"prefix", c.prefix},
+            {"rotateMB", static_cast<double>(c.rotateBytes) / (1024 * 1024)},
+            {"keepFiles", c.keepFiles},
+            {"json", c.json},
+            {"queueMB", static_cast<double>(c.queueBytes) / (1024 * 1024)},
+            {"blockMs", c.blockMs},
+            {"accepted", stats.accepted},
+            {"written", stats.written},
+            {"dropped", stats.dropped},
+            {"failed", stats.failed},
+            {"batches", stats.batches},
+            {"queuedBytes", stats.queuedBytes}
+        });
+    }
+    return list.dump();
+}
+
+bool App::saveSinks(const std::string& sinksJson) {
+    json j = json::parse(sinksJson, nullptr, false);
+    std::vector<SinkConfig> configs;
+    std::string error;
+    if (!parseSinkConfigs(j, sinksPath_.parent_path(), configs, error) || !sinks_.configure(configs, error)) {
+        std::cerr << "[App] saveSinks: " << error << std::endl;
+        return false;
+    }
+    std::ofstream ofs(sinksPath_);
+    ofs << j.dump(2);
+    return ofs.good();
+}
+
+std::string App::getResponseLatency() {
+    TraceSpan span("bridge", "getResponseLatency");
+    std::vector<PairLatencyReport> reports;
+    {
+        std::lock_guard<std::mutex> lock(latencyMutex_);
+        reports = latency_.report();
+    }
+
+    auto summaryJson = [](const LatencySummary& s) {
+        return json{
+            {"startNs", std::to_string(s.startNs)},
+            {"count", s.count},
+            {"meanNs", s.meanNs},
+            {"p50Ns", s.p50Ns},
+            {"p90Ns", s.p90Ns},
+            {"p99Ns", s.p99Ns},
+            {"maxNs", s.maxNs}
+        };
+    };
+
+    json j = json::array();
+    for (const auto& r : reports) {
+        json series = json::array();
+        for (const auto& s : r.series) series.push_back(summaryJson(s));
+        json total = summaryJson(r.total);
+        total.erase("startNs");
+        j.push_back({
+            {"name", r.pair.name},
+            {"request", formatOpcode(r.pair.request)},
+            {"response", formatOpcode(r.pair.response)},
+            {"locale", r.locale},
+            {"version", r.version},
+            {"unanswered", r.unanswered},
+            {"total", total},
+            {"series", series}
+        });
+    }
+    return j.dump();
+}
+
+void App::loadWatchRules(uint8_t locale, uint16_t version) {
+    std::vector<WatchRule> rules;
+    auto path = scriptsBasePath_ / (std::to_string(locale) + "_" + std::to_string(version)) / "watch.json";
+    std::ifstream ifs(path);
+    if (ifs.is_open()) {
+        // [{ name, direction?, opcodes?: [...], patterns?: [{ bytes: "0A 00", offset? }] }]
+        json j = json::parse(ifs, nullptr, false);
+        if (j.is_array()) {
+            for (const auto& e : j) {
+                if (!e.is_object()) continue;
+                WatchRule rule;
+                std::string direction = e.value("direction", "any");
+                if (direction == "in") rule.outbound = false;
+                else if (direction == "out") rule.outbound = true;
+
+                bool valid = true;
+                if (e.contains("opcodes") && e["opcodes"].is_array()) {
+                    for (const auto& v : e["opcodes"]) {
+                        auto op = parseOpcodeValue(v);
+                        if (op) rule.opcodes.push_back(*op);
+                        else valid = false;
+                    }
+                }
+                if (e.contains("patterns") && e["patterns"].is_array()) {
+                    for (const auto& p : e["patterns"]) {
+                        WatchPattern pattern;
+                        if (!p.is_object() || !parseHexBytes(p.value("bytes", ""), pattern.bytes) || pattern.bytes.empty()) {
+                            valid = false;
+                            continue;
+                        }
+                        pattern.offset = p.value("offset", -1);
+                        rule.patterns.push_back(std::move(pattern));
+                    }
+                }
+                if (!valid || (rule.opcodes.empty() && rule.patterns.empty())) {
+                    std::cerr << "[App] Skipping invalid watch rule in " << path.string() << std::endl;
+                    continue;
+                }
+                rule.name = e.value("name", "rule " + std::to_string(rules.size() + 1));
+                rules.push_back(std::move(rule));
+            }
+        } else {
+            std::cerr << "[App] Ignoring malformed " << path.string() << std::endl;
+        }
+    }
+    // Set even when empty so the file is not re-read on every handshake
+    watch_.setRules(locale, version, std::move(rules));
+}
+
+std::string App::getWatchRules(int locale, int version) {
+    auto path = scriptsBasePath_ / (std::to_string(locale) + "_" + std::to_string(version)) / "watch.json";
+    std::ifstream ifs(path);
+    if (!ifs.is_open()) return "[]";
+    return std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+}
+
+bool App::saveWatchRules(int locale, int version, const std::string& rulesJson) {
+    if (!json::accept(rulesJson)) return false;
+
+    auto dir = scriptsBasePath_ / (std::to_string(locale) + "_" + std::to_string(version));
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    if (ec) return false;
+
+    std::ofstream ofs(dir / "watch.json", std::ios::trunc);
+    if (!ofs.is_open()) return false;
+    ofs << rulesJson;
+    ofs.close();
+    if (!ofs) return false;
+
+    std::lock_guard<std::mutex> lock(watchMutex_);
+    loadWatchRules(static_cast<uint8_t>(locale), static_cast<uint16_t>(version));
+    return true;
+}
+
+// One layouts.json field list: [{ name, type, signed?, length?, count?, fields? }]
+static bool parseSchemaFields(const json& list, std::vector<SchemaField>& out, std::string& error) {
+    static const std::map<std::string, SchemaField::Type> TYPES = {
+        {"byte", SchemaField::Type::Byte}, {"short", SchemaField::Type::Short},
+        {"int", SchemaField::Type::Int}, {"long", SchemaField::Type::Long},
+        {"filetime", SchemaField::Type::FileTime}, {"string", SchemaField::Type::String},
+        {"fixedstring", SchemaField::Type::FixedString}, {"bytes", SchemaField::Type::Bytes},
+        {"skip", SchemaField::Type::Skip}, {"array", SchemaField::Type::Array},
+        {"object", SchemaField::Type::Object},
+    };
+    static const std::map<std::string, uint8_t> COUNT_WIDTHS = { {"byte", 1}, {"short", 2}, {"int", 4} };
+
+    if (!list.is_array()) {
+        error = "field list is not an array";
+        return false;
+    }
+    for (const auto& e : list) {
+        if (!e.is_object()) {
+            error = "field is not an object";
+            return false;
+        }
+        SchemaField f;
+        f.name = e.value("name", "");
+        auto type = TYPES.find(e.value("type", ""));
+        if (type == TYPES.end()) {
+            error = "unknown type for field " + f.name;
+            return false;
+        }
+        f.type = type->second;
+        f.isSigned = e.value("signed", false);
+        f.length = e.value("length", 0u);
+
+        if (f.type == SchemaField::Type::Array) {
+            auto count = e.find("count");
+            if (count != e.end() && count->is_number_unsigned()) {
+                f.countWidth = 0;
+                f.length = count->get<uint32_t>();
+            } else if (count != e.end()) {
+                auto width = count->is_string() ? COUNT_WIDTHS.find(count->get<std::string>()) : COUNT_WIDTHS.end();
+                if (width == COUNT_WIDTHS.end()) {
+                    error = "bad count for array " + f.name;
+                    return false;
+                }
+                f.countWidth = width->second;
+            }
+        }
+        if (f.type == SchemaField::Type::Array || f.type == SchemaField::Type::Object) {
+            if (!parseSchemaFields(e.value("fields", json::array()), f.children, error)) return false;
+        }
+        out.push_back(std::move(f));
+    }
+    return true;
+}
+
+FieldExtractor::Layouts App::readLayouts(uint8_t locale, uint16_t version) const {
+    FieldExtractor::Layouts layouts;
+    auto path = scriptsBasePath_ / (std::to_string(locale) + "_" + std::to_string(version)) / "layouts.json";
+    std::ifstream ifs(path);
+    if (ifs.is_open()) {
+        // { send: { "0x0031": [fields] }, recv: { ... } }
+        json j = json::parse(ifs, nullptr, false);
+        if (j.is_object()) {
+            for (const char* direction : { "send", "recv" }) {
+                if (!j.contains(direction) || !j[direction].is_object()) continue;
+                for (const auto& [key, fields] : j[direction].items()) {
+                    auto opcode = parseOpcodeValue(json(key));
+                    std::vector<SchemaField> parsed;
+                    std::string error;
+                    std::optional<SchemaProgram> program;
+                    if (!opcode) error = "bad opcode";
+                    else if (parseSchemaFields(fields, parsed, error)) program = SchemaProgram::compile(parsed, error);
+                    if (!program) {
+                        std::cerr << "[App] Skipping layout " << direction << " " << key << " in " << path.string()
+                                  << ": " << error << std::endl;
+                        continue;
+                    }
+                    layouts.emplace(std::make_pair(std::string(direction) == "send", *opcode), std::move(*program));
+                }
+            }
+        } else {
+            std::cerr << "[App] Ignoring malformed " << path.string() << std::endl;
+        }
+    }
+    return layouts;
+}
+
+void App::loadLayouts(uint8_t locale, uint16_t version) {
+    // Set even when empty so the file is not re-read on every handshake
+    fields_.setLayouts(locale, version, readLayouts(locale, version));
+}
+
+FieldExtractor& App::offlineFields() {
+    if (!offlineFields_) {
+        FieldExtractor::Options options;
+        options.memoryBudget = 1ull << 30;
+        offlineFields_ = std::make_unique<FieldExtractor>(options);
+        const PacketStore& store = *offlineStore_;
+        for (size_t i = 0; i < store.size(); i++) {
+            if (!(store.flags()[i] & PacketStore::FLAG_HANDSHAKE)) continue;
+            Packet hs = store.get(i);
+            if (!offlineFields_->hasLayouts(hs.locale, hs.version)) {
+                offlineFields_->setLayouts(hs.locale, hs.version, readLayouts(hs.locale, hs.version));
+            }
+        }
+        offlineFields_->addStore(store);
+    }
+    return *offlineFields_;
+}
+
+std::string App::getLayouts(int locale, int version) {
+    auto path = scriptsBasePath_ / (std::to_string(locale) + "_" + std::to_string(version)) / "layouts.json";
+    std::ifstream ifs(path);
+    if (!ifs.is_open()) return "{\"send\":{},\"recv\":{}}";
+    return std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+}
+
+bool App::saveLayouts(int locale, int version, const std::string& layoutsJson) {
+    if (!json::accept(layoutsJson)) return false;
+
+    auto dir = scriptsBasePath_ / (std::to_string(locale) + "_" + std::to_string(version));
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    if (ec) return false;
+
+    std::ofstream ofs(dir / "layouts.json", std::ios::trunc);
+    if (!ofs.is_open()) return false;
+    ofs << layoutsJson;
+    ofs.close();
+    if (!ofs) return false;
+
+    // Values extracted under the old layouts are dropped; new packets fill the columns again
+    {
+        std::lock_guard<std::mutex> lock(fieldsMutex_);
+        loadLayouts(static_cast<uint8_t>(locale), static_cast<uint16_t>(version));
+    }
+    // The decoded capture is extracted again on its next query
+    std::lock_guard<std::mutex> lock(offlineMutex_);
+    offlineFields_.reset();
+    return true;
+}
+
+static const char* columnTypeName(FieldColumn::Type type) {
+    switch (type) {
+        case FieldColumn::Type::Int: return "int";
+        case FieldColumn::Type::Time: return "filetime";
+        case FieldColumn::Type::String: return "string";
+        case FieldColumn::Type::Bytes: return "bytes";
+    }
+    return "";
+}
+
+std::string App::getFieldColumns(bool offline) {
+    TraceSpan span("bridge", "getFieldColumns");
+    std::unique_lock<std::mutex> lock(offline ? offlineMutex_ : fieldsMutex_);
+    if (offline && !offlineStore_) return "[]";
+    FieldExtractor& fields = offline ? offlineFields() : fields_;
+    json j = json::array();
+    for (const auto& s : fields.stats()) {
+        json columns = json::array();
+        for (const FieldColumn* c : s.columns) {
+            columns.push_back({{"name", c->name}, {"type", columnTypeName(c->type)}, {"rows", c->rows()}});
+        }
+        j.push_back({
+            {"locale", s.locale},
+            {"version", s.version},
+            {"direction", s.outbound ? "send" : "recv"},
+            {"opcode", formatOpcode(s.opcode)},
+            {"opcodeRaw", s.opcode},
+            {"parsed", s.parsed},
+            {"failed", s.failed},
+            {"columns", columns}
+        });
+    }
+    return j.dump();
+}
+
+std::string App::queryFields(int locale, int version, const std::string& direction, int opcode,
+                             const std::string& column, const std::string& op, const std::string& value,
+                             bool offline, int limit) {
+    TraceSpan span("bridge", "queryFields");
+    static const std::map<std::string, FieldQuery::Op> OPS = {
+        {"==", FieldQuery::Op::Eq}, {"!=", FieldQuery::Op::Ne}, {"<", FieldQuery::Op::Lt},
+        {"<=", FieldQuery::Op::Le}, {">", FieldQuery::Op::Gt}, {">=", FieldQuery::Op::Ge},
+        {"contains", FieldQuery::Op::Contains},
+    };
+    auto opIt = OPS.find(op);
+    if (opIt == OPS.end() || opcode < 0 || opcode > 0xFFFF) return "{}";
+    bool outbound = direction == "send";
+
+    FieldQuery q;
+    q.column = column;
+    q.op = opIt->second;
+
+    // Offline rows are keyed by store index, live rows by packet seq
+    std::unique_lock<std::mutex> lock(offline ? offlineMutex_ : fieldsMutex_);
+    if (offline && !offlineStore_) return "{}";
+    FieldExtractor& fields = offline ? offlineFields() : fields_;
+    const FieldColumn* c = fields.column(static_cast<uint8_t>(locale), static_cast<uint16_t>(version), outbound,
+                                          static_cast<uint16_t>(opcode), column);
+    if (!c) return "{}";
+
+    // The value is parsed by column type: integer (decimal or 0x), hex bytes, or text
+    switch (c->type) {
+        case FieldColumn::Type::Int:
+        case FieldColumn::Type::Time:
+            try {
+                q.number = std::stoll(value, nullptr, 0);
+            } catch (...) {
+                return "{}";
+            }
+            break;
+        case FieldColumn::Type::Bytes: {
+            std::vector<uint8_t> bytes;
+            if (!parseHexBytes(value, bytes)) return "{}";
+            q.text.assign(bytes.begin(), bytes.end());
+            break;
+        }
+        case FieldColumn::Type::String:
+            q.text = value;
+            break;
+    }
+
+    size_t cap = static_cast<size_t>(std::clamp(limit, 1, 100000));
+    auto matches = fields.query(static_cast<uint8_t>(locale), static_cast<uint16_t>(version), outbound,
+                                 static_cast<uint16_t>(opcode), q, cap + 1);
+    if (!matches) return "{}";
+
+    json j;
+    j["rows"] = c->rows();
+    j["truncated"] = matches->size() > cap;
+    j["keptFrom"] = fields.keptFromSeq();   // rows of older packets were dropped (memory budget)
+    if (matches->size() > cap) matches->resize(cap);
+    j["matches"] = *matches;   // packet indexes as used by getPackets (offline: store indexes)
+    return j.dump();
+}
+
+std::string App::getWatchEvents(int since) {
+    TraceSpan span("bridge", "getWatchEvents");
+    std::vector<WatchEvent> events;
+    uint64_t next = 0;
+    {
+        std::lock_guard<std::mutex> lock(watchMutex_);
+        events = watch_.events(static_cast<uint64_t>(std::max(since, 0)));
+        next = watch_.nextSeq();
+    }
+
+    json list = json::array();
+    for (const auto& e : events) {
+        list.push_back({
+            {"seq", e.seq},
+            {"rule", e.rule},
+            {"locale", e.locale},
+            {"version", e.version},
+            {"sessionId", e.sessionId},
+            {"timestampNs", std::to_string(e.timestampNs)},
+            {"outbound", e.outbound},
+            {"opcode", formatOpcode(e.opcode)},
+            {"opcodeRaw", e.opcode},
+            {"length", e.length}
+        });
+    }
+    return json{{"next", next}, {"events", list}}.dump();
+}
+
+std::string App::getWatchStats() {
+    std::vector<WatchRuleStats> stats;
+    {
+        std::lock_guard<std::mutex> lock(watchMutex_);
+        stats = watch_.stats();
+    }
+    json j = json::array();
+    for (const auto& s : stats) {
+        j.push_back({
+            {"rule", s.rule},
+            {"locale", s.locale},
+            {"version", s.version},
+            {"hits", s.hits},
+            {"lastNs", std::to_string(s.lastNs)}
+        });
+    }
+    return j.dump();
+}
+
+bool App::configureTrigger(const std::string& configJson) {
+    json j = json::parse(configJson, nullptr, false);
+    if (!j.is_object()) return false;
+
+    TriggerConfig config;
+    config.preNs = static_cast<int64_t>(j.value("preSeconds", 30.0) * 1e9);
+    config.postNs = static_cast<int64_t>(j.value("postSeconds", 30.0) * 1e9);
+    config.rawFrames = j.value("rawFrames", false);
+    config.maxRingBytes = static_cast<size_t>(j.value("maxRingMB", 64.0) * 1024 * 1024);
+    if (config.preNs < 0 || config.postNs < 0) return false;
+
+    if (j.contains("triggers") && j["triggers"].is_array()) {
+        for (const auto& e : j["triggers"]) {
+            if (!e.is_object()) return false;
+            CaptureTrigger t;
+            std::string kind = e.value("kind", "opcode");
+            if (kind == "opcode") t.kind = CaptureTrigger::Kind::Opcode;
+            else if (kind == "pattern") t.kind = CaptureTrigger::Kind::Pattern;
+            else if (kind == "dead") t.kind = CaptureTrigger::Kind::StreamDead;
+            else return false;
+
+            std::string direction = e.value("direction", "any");
+            if (direction == "in") t.outbound = false;
+            else if (direction == "out") t.outbound = true;
+
+            if (e.contains("opcode")) {
+                t.opcode = parseOpcodeValue(e["opcode"]);
+                if (!t.opcode) return false;
+            }
+            if (t.kind == CaptureTrigger::Kind::Opcode && !t.opcode) return false;
+
+            if (t.kind == CaptureTrigger::Kind::Pattern) {
+                if (!parseHexBytes(e.value("pattern", ""), t.pattern) || t.pattern.empty()) return false;
+            }
+            t.name = e.value("name", kind + (t.opcode ? " " + formatOpcode(*t.opcode) : std::string()));
+            config.triggers.push_back(std::move(t));
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(triggerMutex_);
+    trigger_.configure(std::move(config));
+    triggerFrames_ = trigger_.wantsFrames();
+    return true;
+}
+
+std::string App::getTriggerStatus() {
+    TraceSpan span("bridge", "getTriggerStatus");
+    json j;
+    std::vector<TriggerEvent> events;
+    {
+        std::lock_guard<std::mutex> lock(triggerMutex_);
+        static constexpr const char* STATE_NAMES[] = { "idle", "armed", "recording" };
+        j["state"] = STATE_NAMES[static_cast<int>(trigger_.state())];
+        j["ringPackets"] = trigger_.ringPackets();
+        j["ringFrames"] = trigger_.ringFrames();
+        j["ringBytes"] = trigger_.ringBytes();
+        events = trigger_.events();
+    }
+
+    auto utf8 = [](const fs::path& p) {
+        auto u8 = p.u8string();
+        return std::string(u8.begin(), u8.end());
+    };
+    json list = json::array();
+    for (const auto& e : events) {
+        list.push_back({
+            {"trigger", e.trigger},
+            {"sessionId", e.sessionId},
+            {"timestampNs", std::to_string(e.timestampNs)},
+            {"packets", e.packets},
+            {"frames", e.frames},
+            {"packetsPath", utf8(e.packetsPath)},
+            {"pcapPath", utf8(e.pcapPath)}
+        });
+    }
+    j["events"] = list;
+    return j.dump();
+}
+
+std::string App::loadTriggerCapture(const std::string& path) {
+    TraceSpan span("bridge", "loadTriggerCapture");
+    auto store = PacketStore::load(pathFromUtf8(path));
+    if (!store) return "{}";
+
+    std::lock_guard<std::mutex> lock(offlineMutex_);
+    json j;
+    j["path"] = path;
+    j["packetCount"] = store->size();
+    offlineStore_ = std::move(*store);
+    offlineStoreIndexed_ = false;
+    offlineValues_.reset();
+    offlineSequences_.reset();
+    offlineFields_.reset();
+    return j.dump();
+}
+
+std::string App::getBandwidthTimeline(int sessionId, const std::string& direction, int opcode,
+                                      double fromSec, double toSec, int resolutionSec) {
+    TraceSpan span("bridge", "getBandwidthTimeline");
+    bool outbound = direction == "out";
+    std::optional<uint16_t> op;
+    if (opcode >= 0) op = static_cast<uint16_t>(opcode);
+    int64_t fromNs = static_cast<int64_t>(fromSec * 1e9);
+    int64_t toNs = static_cast<int64_t>(toSec * 1e9);
+
+    std::optional<BandwidthTimeline::QueryResult> result;
+    std::vector<BandwidthTimeline::OpcodeTotal> totals;
+    {
+        std::lock_guard<std::mutex> lock(timelineMutex_);
+        result = timeline_.query(static_cast<uint32_t>(sessionId), outbound, op,
+                                 fromNs, toNs, static_cast<int64_t>(resolutionSec) * 1'000'000'000);
+        totals = timeline_.opcodeTotals(static_cast<uint32_t>(sessionId), outbound);
+    }
+
+    json opcodes = json::array();
+    for (const auto& t : totals) {
+        opcodes.push_back({
+            {"opcode", t.opcode},
+            {"packets", t.packets},
+            {"bytes", t.bytes},
+            {"charted", t.charted}
+        });
+    }
+    if (!result) return json{{"resolution", 0}, {"points", json::array()}, {"opcodes", opcodes}}.dump();
+
+    // Compact rows: [bucket start (s), packets, bytes]
+    json points = json::array();
+    for (const auto& p : result->points) {
+        points.push_back({ p.startNs / 1'000'000'000, p.packets, p.bytes });
+    }
+    return json{
+        {"resolution", result->resolutionNs / 1'000'000'000},
+        {"points", points},
+        {"opcodes", opcodes}
+    }.dump();
+}
+
+std::string App::decryptOpcodes(const std::string& hexPayload, const std::string& desKey) {
+    // Parse space-separated hex string to bytes
+    std::vector<uint8_t> bytes;
+    std::istringstream iss(hexPayload);
+    std::string hexByte;
+    while (iss >> hexByte) {
+        if (hexByte.size() == 2) {
+            try {
+                bytes.push_back(static_cast<uint8_t>(std::stoi(hexByte, nullptr, 16)));
+            } catch (...) {
+                return "{}";
+            }
+        }
+    }
+
+    if (bytes.size() < 4) return "{}";
+
+    int32_t bufferSize = static_cast<int32_t>(
+        bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (bytes[3] << 24));
+
+    if (bufferSize <= 0 || static_cast<int>(bytes.size()) < 4 + bufferSize) return "{}";
+
+    auto mapping = MapleStream::parseOpcodeEncryption(
+        bytes.data() + 4, static_cast<int>(bytes.size()) - 4, bufferSize, desKey);
+
+    if (mapping.empty()) return "{}";
+
+    json j;
+    for (const auto& [enc, real] : mapping) {
+        j[std::to_string(enc)] = real;
+    }
+    return j.dump();
+}
+
+const FlowIndex* App::loadCaptureIndex(const std::string& pcapPath) {
+    // Caller holds offlineMutex_
+    if (offlinePath_ != pcapPath || !offlineIndex_.has_value()) {
+        auto path = pathFromUtf8(pcapPath);
+        offlineIndex_ = FlowIndex::loadOrBuild(path);
+        offlineCheckpoints_ = CheckpointFile::load(path);
+        if (!offlineCheckpoints_.has_value()) {
+            offlineCheckpoints_ = CheckpointFile::forCapture(path, FlowDecoder::DEFAULT_CHECKPOINT_INTERVAL);
+        }
+        offlineStore_.reset();
+        offlineValues_.reset();
+        offlineSequences_.reset();
+        offlineFields_.reset();
+        offlinePath_ = pcapPath;
+    }
+    return offlineIndex_.has_value() ? &*offlineIndex_ : nullptr;
+}
+
+std::string App::indexCapture(const std::string& pcapPath) {
+    TraceSpan span("bridge", "indexCapture");
+    std::lock_guard<std::mutex> lock(offlineMutex_);
+    const FlowIndex* index = loadCaptureIndex(pcapPath);
+    if (!index) return "{}";
+
+    json flows = json::array();
+    for (size_t i = 0; i < index->flows().size(); i++) {
+        const auto& f = index->flows()[i];
+        json fj = {
+            {"index", i},
+            {"client", formatEndpoint(f.clientIP, f.clientPort)},
+            {"server", formatEndpoint(f.serverIP, f.serverPort)},
+            {"serverPort", f.serverPort},
+            {"frames", f.frameOffsets.size()},
+            {"bytes", f.payloadBytes},
+            {"firstTimestamp", f.firstTimestamp},
+            {"lastTimestamp", f.lastTimestamp},
+            {"hasHandshake", f.hasHandshake}
+        };
+        if (f.hasHandshake) {
+            fj["version"] = f.version;
+            fj["subVersion"] = f.subVersion;
+            fj["locale"] = f.locale;
+            fj["handshakeFrame"] = f.handshakeFrame;
+        }
+        flows.push_back(fj);
+    }
+
+    json j;
+    j["path"] = pcapPath;
+    j["frameCount"] = index->frameCount();
+    j["flows"] = flows;
+    return j.dump();
+}
+
+std::string App::decodeCaptureFlow(const std::string& pcapPath, int flowIndex, int first, int count) {
+    TraceSpan span("bridge", "decodeCaptureFlow");
+    std::lock_guard<std::mutex> lock(offlineMutex_);
+    const FlowIndex* index = loadCaptureIndex(pcapPath);
+    if (!index || flowIndex < 0 || static_cast<size_t>(flowIndex) >= index->flows().size() ||
+        first < 0 || count <= 0) {
+        return "[]";
+    }
+
+    auto path = pathFromUtf8(pcapPath);
+    auto flowIdx = static_cast<uint32_t>(flowIndex);
+    FlowDecoder decoder(path, index->flows()[flowIdx], flowIdx);
+
+    // First visit to a flow: one full pass records checkpoints, later pages seek
+    const FlowCheckpoints* checkpoints = offlineCheckpoints_->find(flowIdx);
+    if (!checkpoints) {
+        FlowCheckpoints fresh;
+        decoder.decodeAll([](Packet&&, uint64_t) { return true; }, &fresh, offlineCheckpoints_->interval());
+        offlineCheckpoints_->put(std::move(fresh));
+        if (!offlineCheckpoints_->save(path)) {
+            std::cerr << "[App] Could not write checkpoint sidecar for " << pcapPath << std::endl;
+        }
+        checkpoints = offlineCheckpoints_->find(flowIdx);
+    }
+
+    std::vector<Packet> pkts;
+    decoder.decodeRange(*checkpoints, static_cast<uint64_t>(first), static_cast<size_t>(count), pkts);
+
+    json j = json::array();
+    for (size_t i = 0; i < pkts.size(); i++) {
+        j.push_back(packetToJson(pkts[i], static_cast<uint64_t>(first) + i));
+    }
+    return j.dump();
+}
+
+std::string App::decodeCapture(const std::string& pcapPath) {
+    TraceSpan span("bridge", "decodeCapture");
+    std::lock_guard<std::mutex> lock(offlineMutex_);
+    const FlowIndex* index = loadCaptureIndex(pcapPath);
+    if (!index) return "{}";
+
+    auto path = pathFromUtf8(pcapPath);
+    BulkDecoder::Options options;
+    options.checkpoints = &*offlineCheckpoints_;
+    auto result = BulkDecoder::decode(path, *index, options);
+    if (!result) return "{}";
+
+    if (!offlineCheckpoints_->save(path)) {
+        std::cerr << "[App] Could not write checkpoint sidecar for " << pcapPath << std::endl;
+    }
+
+    json j;
+    j["path"] = pcapPath;
+    j["packetCount"] = result->packets.size();
+    j["flowsDecoded"] = result->flowsDecoded;
+    j["flowsFailed"] = result->flowsFailed;
+    j["seconds"] = result->seconds;
+    offlineStore_ = std::move(result->packets);
+    offlineStoreIndexed_ = true;
+    offlineValues_.reset();
+    offlineSequences_.reset();
+    offlineFields_.reset();
+    return j.dump();
+}
+
+std::string App::getCapturePackets(int first, int count) {
+    TraceSpan span("bridge", "getCapturePackets");
+    std::lock_guard<std::mutex> lock(offlineMutex_);
+    json j = json::array();
+    if (!offlineStore_ || first < 0 || count <= 0) return j.dump();
+
+    size_t end = std::min(offlineStore_->size(), static_cast<size_t>(first) + static_cast<size_t>(count));
+    for (size_t i = static_cast<size_t>(first); i < end; i++) {
+        j.push_back(packetToJson(offlineStore_->get(i), i));
+    }
+    return j.dump();
+}
+
+// Sources that are capture files (flow index, original addresses) rather than decoded packets
+static bool isCaptureSource(const std::string& source) {
+    auto ext = pathFromUtf8(source).extension();
+    return ext != ".mspkts" && ext != ".msb";
+}
+
+std::optional<PacketStore> App::loadPacketSource(const std::string& source) {
+    auto path = pathFromUtf8(source);
+    if (path.extension() == ".mspkts") return PacketStore::load(path);
+    if (path.extension() == ".msb") {
+        PacketStore store;
+        if (!MsbReader::import(path, store, 1)) return std::nullopt;
+        return store;
+    }
+
+    auto index = FlowIndex::loadOrBuild(path);
+    if (!index) return std::nullopt;
+    auto result = BulkDecoder::decode(path, *index, BulkDecoder::Options{});
+    if (!result) return std::nullopt;
+    return std::move(result->packets);
+}
+
+std::string App::diffSessions(const std::string& sourceA, int sessionA, const std::string& sourceB, int sessionB) {
+    TraceSpan span("bridge", "diffSessions");
+    static constexpr size_t MAX_DIFF_ENTRIES = 20000;
+
+    std::optional<PacketStore> loadedA, loadedB;
+    if (!sourceA.empty() && !(loadedA = loadPacketSource(sourceA))) return "{}";
+    // The same file twice is loaded once
+    if (!sourceB.empty() && sourceB != sourceA && !(loadedB = loadPacketSource(sourceB))) return "{}";
+
+    std::lock_guard<std::mutex> lock(offlineMutex_);
+    const PacketStore* storeA = loadedA ? &*loadedA : (offlineStore_ ? &*offlineStore_ : nullptr);
+    const PacketStore* storeB = loadedB ? &*loadedB : (sourceB.empty() ? (offlineStore_ ? &*offlineStore_ : nullptr) : storeA);
+    if (!storeA || !storeB) return "{}";
+
+    auto packetsA = SessionDiff::sessionPackets(*storeA, static_cast<uint32_t>(sessionA));
+    auto packetsB = SessionDiff::sessionPackets(*storeB, static_cast<uint32_t>(sessionB));
+    auto result = SessionDiff::diff(*storeA, packetsA, *storeB, packetsB);
+
+    auto describe = [](json& j, const PacketStore& store, uint32_t i) {
+        j["opcode"] = formatOpcode(store.opcodes()[i]);
+        j["opcodeRaw"] = store.opcodes()[i];
+        j["outbound"] = (store.flags()[i] & PacketStore::FLAG_OUTBOUND) != 0;
+    };
+
+    // Unchanged runs collapse into one entry
+    json entries = json::array();
+    bool truncated = false;
+    for (size_t k = 0; k < result.entries.size(); k++) {
+        if (entries.size() >= MAX_DIFF_ENTRIES) { truncated = true; break; }
+        const DiffEntry& e = result.entries[k];
+        json j;
+        switch (e.kind) {
+            case DiffEntry::Kind::Same: {
+                size_t run = 1;
+                while (k + run < result.entries.size() && result.entries[k + run].kind == DiffEntry::Kind::Same) run++;
+                j = {{"kind", "same"}, {"a", e.positionA}, {"b", e.positionB}, {"count", run}};
+                k += run - 1;
+                break;
+            }
+            case DiffEntry::Kind::Changed: {
+                json ranges = json::array();
+                for (const auto& r : e.ranges) ranges.push_back({ r.offsetA, r.lengthA, r.offsetB, r.lengthB });
+                j = {{"kind", "changed"}, {"a", e.positionA}, {"b", e.positionB}, {"ranges", ranges}};
+                describe(j, *storeA, packetsA[static_cast<size_t>(e.positionA)]);
+                break;
+            }
+            case DiffEntry::Kind::Removed:
+                j = {{"kind", "removed"}, {"a", e.positionA}};
+                describe(j, *storeA, packetsA[static_cast<size_t>(e.positionA)]);
+                break;
+            case DiffEntry::Kind::Added:
+                j = {{"kind", "added"}, {"b", e.positionB}};
+                describe(j, *storeB, packetsB[static_cast<size_t>(e.positionB)]);
+                break;
+        }
+        entries.push_back(std::move(j));
+    }
+
+    json j;
+    j["packetsA"] = packetsA.size();
+    j["packetsB"] = packetsB.size();
+    j["same"] = result.same;
+    j["changed"] = result.changed;
+    j["removed"] = result.removed;
+    j["added"] = result.added;
+    j["approximate"] = result.approximate;
+    j["seconds"] = result.seconds;
+    j["truncated"] = truncated;
+    j["entries"] = entries;
+    return j.dump();
+}
+
+// Locale and version from the session's handshake, if the store has it
+static std::optional<std::pair<int, int>> sessionVersion(const PacketStore& store, uint32_t sessionId) {
+    for (size_t i = 0; i < store.size(); i++) {
+        if (store.sessionIds()[i] != sessionId || !(store.flags()[i] & PacketStore::FLAG_HANDSHAKE)) continue;
+        Packet hs = store.get(i);
+        return std::make_pair(static_cast<int>(hs.locale), static_cast<int>(hs.version));
+    }
+    return std::nullopt;
+}
+
+std::string App::mapOpcodes(const std::string& sourceOld, int sessionOld, const std::string& sourceNew, int sessionNew) {
+    TraceSpan span("bridge", "mapOpcodes");
+
+    std::optional<PacketStore> loadedOld, loadedNew;
+    if (!sourceOld.empty() && !(loadedOld = loadPacketSource(sourceOld))) return "{}";
+    if (!sourceNew.empty() && sourceNew != sourceOld && !(loadedNew = loadPacketSource(sourceNew))) return "{}";
+
+    std::lock_guard<std::mutex> lock(offlineMutex_);
+    const PacketStore* storeOld = loadedOld ? &*loadedOld : (offlineStore_ ? &*offlineStore_ : nullptr);
+    const PacketStore* storeNew = loadedNew ? &*loadedNew : (sourceNew.empty() ? (offlineStore_ ? &*offlineStore_ : nullptr) : storeOld);
+    if (!storeOld || !storeNew) return "{}";
+
+    auto oldVersion = sessionVersion(*storeOld, static_cast<uint32_t>(sessionOld));
+    auto newVersion = sessionVersion(*storeNew, static_cast<uint32_t>(sessionNew));
+
+    // Names of the labeled (old) version
+    json names = json::object();
+    if (oldVersion) {
+        try {
+            names = json::parse(getOpcodeNames(oldVersion->first, oldVersion->second));
+        } catch (const json::exception&) {}
+    }
+    auto nameOf = [&](bool outbound, uint16_t opcode) -> std::string {
+        const char* dir = outbound ? "send" : "recv";
+        if (!names.contains(dir) || !names[dir].is_object()) return "";
+        auto it = names[dir].find(std::to_string(opcode));
+        return it != names[dir].end() && it->is_string() ? it->get<std::string>() : "";
+    };
+
+    auto packetsOld = SessionDiff::sessionPackets(*storeOld, static_cast<uint32_t>(sessionOld));
+    auto packetsNew = SessionDiff::sessionPackets(*storeNew, static_cast<uint32_t>(sessionNew));
+    auto matches = OpcodeMapper::map(*storeOld, packetsOld, *storeNew, packetsNew);
+
+    json proposals = json::array();
+    for (const auto& m : matches) {
+        proposals.push_back({
+            {"direction", m.outbound ? "send" : "recv"},
+            {"opcode", formatOpcode(m.newOpcode)},
+            {"opcodeRaw", m.newOpcode},
+            {"oldOpcode", formatOpcode(m.oldOpcode)},
+            {"oldOpcodeRaw", m.oldOpcode},
+            {"name", nameOf(m.outbound, m.oldOpcode)},
+            {"score", m.score},
+            {"confidence", m.confidence},
+        });
+    }
+
+    json j;
+    if (oldVersion) j["old"] = {{"locale", oldVersion->first}, {"version", oldVersion->second}};
+    if (newVersion) j["new"] = {{"locale", newVersion->first}, {"version", newVersion->second}};
+    j["packetsOld"] = packetsOld.size();
+    j["packetsNew"] = packetsNew.size();
+    j["proposals"] = proposals;
+    return j.dump();
+}
+
+// exports/<prefix>-<local time><ext>, creating the directory
+static fs::path timestampedExportPath(const fs::path& dir, const std::string& prefix, const std::string& ext) {
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    std::time_t now = std::time(nullptr);
+    std::tm tm{};
+    localtime_s(&tm, &now);
+    std::ostringstream name;
+    name << prefix << '-' << std::put_time(&tm, "%Y%m%d-%H%M%S") << ext;
+    return dir / name.str();
+}
+
+std::string App::exportPlaintextPcap(const std::string& source, int sessionId, const std::string& outPath) {
+    TraceSpan span("bridge", "exportPlaintextPcap");
+    fs::path path = outPath.empty() ? timestampedExportPath(exportsPath_, "plaintext", ".pcap") : pathFromUtf8(outPath);
+
+    PlaintextPcapExporter::Options options;
+    if (sessionId >= 0) options.sessionId = static_cast<uint32_t>(sessionId);
+
+    // Original addresses come from the capture's flow index; other sources get synthetic ones
+    std::optional<PlaintextExportResult> result;
+    if (!source.empty()) {
+        auto store = loadPacketSource(source);
+        if (!store) return "{}";
+        std::optional<FlowIndex> index;
+        if (isCaptureSource(source)) index = FlowIndex::loadOrBuild(pathFromUtf8(source));
+        if (index) options.endpoints = PlaintextPcapExporter::fromFlowIndex(*index);
+        result = PlaintextPcapExporter::write(*store, path, options);
+    } else {
+        std::lock_guard<std::mutex> lock(offlineMutex_);
+        if (!offlineStore_) return "{}";
+        if (offlineStoreIndexed_ && offlineIndex_) options.endpoints = PlaintextPcapExporter::fromFlowIndex(*offlineIndex_);
+        result = PlaintextPcapExporter::write(*offlineStore_, path, options);
+    }
+    if (!result) return "{}";
+    std::cout << "[App] Plaintext pcap written to " << path.string() << std::endl;
+
+    json j;
+    auto u8 = path.u8string();
+    j["path"] = std::string(u8.begin(), u8.end());
+    j["packets"] = result->packets;
+    j["frames"] = result->frames;
+    j["sessions"] = result->sessions;
+    j["bytes"] = result->bytes;
+    return j.dump();
+}
+
+std::string App::importMsb(const std::string& path) {
+    TraceSpan span("bridge", "importMsb");
+    auto start = std::chrono::steady_clock::now();
+
+    fs::path root = pathFromUtf8(path);
+    std::vector<fs::path> files;
+    std::error_code ec;
+    if (fs::is_directory(root, ec)) {
+        for (const auto& entry : fs::directory_iterator(root, ec)) {
+            if (entry.is_regular_file() && entry.path().extension() == ".msb") files.push_back(entry.path());
+        }
+        std::sort(files.begin(), files.end());
+    } else {
+        files.push_back(root);
+    }
+
+    // One session per file, merged into one timeline
+    std::vector<PacketStore> parts;
+    json sessions = json::array();
+    size_t failed = 0;
+    for (const auto& file : files) {
+        PacketStore part;
+        uint32_t sessionId = static_cast<uint32_t>(parts.size() + 1);
+        auto count = MsbReader::import(file, part, sessionId);
+        if (!count) {
+            failed++;
+            continue;
+        }
+        Packet hs = part.get(0);
+        auto u8 = file.u8string();
+        sessions.push_back({
+            {"id", sessionId},
+            {"file", std::string(u8.begin(), u8.end())},
+            {"packets", *count},
+            {"version", hs.version},
+            {"locale", hs.locale},
+            {"subVersion", hs.subVersionStr}
+        });
+        parts.push_back(std::move(part));
+    }
+    if (parts.empty()) return "{}";
+    PacketStore store = parts.size() == 1 ? std::move(parts.front()) : PacketStore::merge(std::move(parts));
+
+    json j;
+    j["path"] = path;
+    j["files"] = files.size();
+    j["failed"] = failed;
+    j["packetCount"] = store.size();
+    j["sessions"] = sessions;
+    j["seconds"] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::lock_guard<std::mutex> lock(offlineMutex_);
+    offlineStore_ = std::move(store);
+    offlineStoreIndexed_ = false;
+    offlineValues_.reset();
+    offlineSequences_.reset();
+    offlineFields_.reset();
+    return j.dump();
+}
+
+std::string App::exportMsb(const std::string& source, int sessionId, const std::string& outPath) {
+    TraceSpan span("bridge", "exportMsb");
+    if (sessionId < 0) return "{}";
+    auto id = static_cast<uint32_t>(sessionId);
+
+    std::optional<PacketStore> loaded;
+    std::optional<FlowIndex> index;
+    if (!source.empty()) {
+        if (!(loaded = loadPacketSource(source))) return "{}";
+        if (isCaptureSource(source)) index = FlowIndex::loadOrBuild(pathFromUtf8(source));
+    }
+
+    std::lock_guard<std::mutex> lock(offlineMutex_);
+    const PacketStore* store = loaded ? &*loaded : (offlineStore_ ? &*offlineStore_ : nullptr);
+    const FlowIndex* flows = index ? &*index : (source.empty() && offlineStoreIndexed_ && offlineIndex_ ? &*offlineIndex_ : nullptr);
+    if (!store) return "{}";
+
+    auto header = MsbWriter::sessionHeader(*store, id);
+    if (!header) return "{}";
+    // Sessions decoded from a capture are flow index + 1
+    if (flows && id >= 1 && id <= flows->flows().size()) {
+        const FlowEntry& flow = flows->flows()[id - 1];
+        header->localEndpoint = formatIP(flow.clientIP);
+        header->localPort = flow.clientPort;
+        header->remoteEndpoint = formatIP(flow.serverIP);
+        header->remotePort = flow.serverPort;
+    }
+
+    fs::path path = outPath.empty()
+        ? timestampedExportPath(exportsPath_, "session-" + std::to_string(id), ".msb")
+        : pathFromUtf8(outPath);
+    auto written = MsbWriter::exportSession(*store, id, *header, path);
+    if (!written) return "{}";
+    std::cout << "[App] Session " << id << " written to " << path.string() << std::endl;
+
+    json j;
+    auto u8 = path.u8string();
+    j["path"] = std::string(u8.begin(), u8.end());
+    j["packets"] = *written;
+    return j.dump();
+}
+
+std::string App::getOpcodeSequences(const std::string& source, int minLength, int limit) {
+    TraceSpan span("bridge", "getOpcodeSequences");
+    size_t length = static_cast<size_t>(std::clamp(minLength, 1, static_cast<int>(SequenceMiner::MAX_LENGTH)));
+    size_t cap = limit > 0 ? static_cast<size_t>(limit) : 100;
+
+    auto symbolJson = [](uint32_t symbol) {
+        return json{
+            {"opcode", formatOpcode(OpcodeSymbol::opcode(symbol))},
+            {"opcodeRaw", OpcodeSymbol::opcode(symbol)},
+            {"outbound", OpcodeSymbol::outbound(symbol)}
+        };
+    };
+    auto report = [&](const SequenceMiner& miner) {
+        json sequences = json::array();
+        for (const auto& seq : miner.top(length, cap)) {
+            json packets = json::array();
+            for (uint32_t symbol : seq.symbols) packets.push_back(symbolJson(symbol));
+            sequences.push_back({
+                {"packets", packets},
+                {"count", seq.count},
+                {"error", seq.error},
+                {"confidence", std::round(seq.confidence * 1000) / 1000}
+            });
+        }
+        json responses = json::array();
+        for (const auto& r : miner.responses(cap)) {
+            responses.push_back({
+                {"request", formatOpcode(r.request)},
+                {"requestRaw", r.request},
+                {"response", formatOpcode(r.response)},
+                {"responseRaw", r.response},
+                {"count", r.count},
+                {"requests", r.requests},
+                {"meanMs", static_cast<double>(r.meanNs) / 1e6}
+            });
+        }
+        json anomalies = json::array();
+        const auto& recent = miner.anomalies();
+        for (auto it = recent.rbegin(); it != recent.rend() && anomalies.size() < cap; ++it) {
+            anomalies.push_back({
+                {"sessionId", it->sessionId},
+                {"timestamp", static_cast<double>(it->timestampNs) / 1e9},
+                {"previous", symbolJson(it->previous)},
+                {"packet", symbolJson(it->symbol)},
+                {"probability", it->probability}
+            });
+        }
+        auto stats = miner.stats();
+        json j;
+        j["packets"] = stats.packets;
+        j["sessions"] = stats.sessions;
+        j["entries"] = stats.entries;
+        j["floor"] = stats.floor;
+        j["sequences"] = sequences;
+        j["responses"] = responses;
+        j["anomalies"] = anomalies;   // newest first
+        return j.dump();
+    };
+
+    if (source == "live") {
+        std::lock_guard<std::mutex> lock(sequencesMutex_);
+        return report(sequences_);
+    }
+    if (!source.empty()) {
+        auto store = loadPacketSource(source);
+        if (!store) return "{}";
+        SequenceMiner miner;
+        miner.addStore(*store);
+        return report(miner);
+    }
+
+    std::lock_guard<std::mutex> lock(offlineMutex_);
+    if (!offlineStore_) return "{}";
+    if (!offlineSequences_) {
+        offlineSequences_ = std::make_unique<SequenceMiner>();
+        offlineSequences_->addStore(*offlineStore_);
+    }
+    return report(*offlineSequences_);
 }
 
 } // namespace maple
@@ -2,23 +2,51 @@
 
 #include "../capture/capture.h"
 #include "../protocol/protocol.h"
+#include "../offline/flow_index.h"
+#include "../offline/flow_decoder.h"
+#include "../store/packet_store.h"
+#include "../metrics/pipeline_metrics.h"
+#include "../analysis/response_latency.h"
+#include "../analysis/bandwidth_timeline.h"
+#include "../analysis/trigger_recorder.h"
+#include "../analysis/watch_rules.h"
+#include "../analysis/field_schema.h"
+#include "../analysis/value_index.h"
+#include "../analysis/byte_variability.h"
+#include "../analysis/sequence_miner.h"
+#include "../script/script_runner.h"
+#include "../sink/shared_ring.h"
+#include "../sink/packet_sink.h"
 #include <saucer/smartview.hpp>
+#include <atomic>
+#include <condition_variable>
 #include <deque>
 #include <mutex>
 #include <optional>
+#include <set>
 #include <string>
 #include <filesystem>
+#include <thread>
 
 namespace maple {
 
 class App {
 public:
-    explicit App(Capture& capture);
+    App(Capture& capture, Protocol& protocol, PipelineMetrics& metrics);
 
     void setup(saucer::application* app);
 
     void addPackets(const std::vector<Packet>& pkts);
 
+    // Every captured frame, before protocol decoding (feeds the trigger ring when enabled)
+    void onRawFrame(const RawPacket& raw);
+
+    // Persist live sessions so a restarted sniffer keeps decoding them.
+    // saveLiveState runs on shutdown and periodically (crash safety);
+    // restoreLiveState must run before capture starts.
+    bool saveLiveState();
+    bool restoreLiveState();
+
 private:
     std::string getStatus();
     std::string getInterfaces();
@@ -29,29 +57,198 @@ private:
     // Script I/O (parameterized by locale/version from frontend)
     std::string getScript(const std::string& direction, int opcode, int locale, int version);
     bool saveScript(const std::string& direction, int opcode, const std::string& code, int locale, int version);
+    // Skeleton script inferred from every buffered sample of one opcode
+    // (offline = the store filled by decodeCapture/loadTriggerCapture)
+    std::string inferLayout(const std::string& direction, int opcode, bool offline);
+    // Run the saved script of one opcode natively over every buffered packet of it
+    // (sessionId -1 = all sessions), at most limit results
+    std::string runScriptBulk(const std::string& direction, int opcode, int locale, int version,
+                              bool offline, int sessionId, int limit);
     std::string listScripts(int locale, int version);
     std::string getSessions();
 
+    // Pipeline latency/throughput statistics since start
+    std::string getPipelineStats();
+
+    // Shared-memory ring for external readers (sdk/maple_ring.h): name, size, records published
+    std::string getSharedRingStatus();
+
+    // Packet sinks (files, pipe/socket streams), kept in sinks.json next to the exe
+    std::string getSinks();
+    bool saveSinks(const std::string& sinksJson);
+    bool loadSinks();
+
+    // Chrome trace recording; stopTrace writes traces/trace-<time>.json next to the exe
+    bool startTrace();
+    std::string stopTrace();
+
     // Opcode names I/O
     std::string getOpcodeNames(int locale, int version);
     bool saveOpcodeNames(int locale, int version, const std::string& namesJson);
 
+    // Request/response pairing tables (scripts/<locale>_<version>/pairs.json) and latency stats
+    std::string getOpcodePairs(int locale, int version);
+    bool saveOpcodePairs(int locale, int version, const std::string& pairsJson);
+    std::string getResponseLatency();
+    void loadOpcodePairs(uint8_t locale, uint16_t version);   // caller holds latencyMutex_
+
+    // Opcodes dropped after decryption (scripts/<locale>_<version>/suppress.json)
+    // and how many packets/bytes each one dropped per session
+    std::string getSuppressionRules(int locale, int version);
+    bool saveSuppressionRules(int locale, int version, const std::string& rulesJson);
+    std::string getSuppressionStats();
+    void loadSuppressionRules(uint8_t locale, uint16_t version);   // caller holds suppressionMutex_
+
+    // Watch rules (scripts/<locale>_<version>/watch.json), matches polled by sequence number
+    std::string getWatchRules(int locale, int version);
+    bool saveWatchRules(int locale, int version, const std::string& rulesJson);
+    std::string getWatchEvents(int since);
+    std::string getWatchStats();
+    void loadWatchRules(uint8_t locale, uint16_t version);   // caller holds watchMutex_
+
+    // Declarative opcode layouts (scripts/<locale>_<version>/layouts.json), extracted
+    // natively from every stored packet into typed columns; offline = the decoded capture store
+    std::string getLayouts(int locale, int version);
+    bool saveLayouts(int locale, int version, const std::string& layoutsJson);
+    std::string getFieldColumns(bool offline);
+    std::string queryFields(int locale, int version, const std::string& direction, int opcode,
+                            const std::string& column, const std::string& op, const std::string& value,
+                            bool offline, int limit);
+    FieldExtractor::Layouts readLayouts(uint8_t locale, uint16_t version) const;
+    void loadLayouts(uint8_t locale, uint16_t version);   // caller holds fieldsMutex_
+    FieldExtractor& offlineFields();                      // caller holds offlineMutex_, offlineStore_ set
+
+    // Every occurrence of a 2/4/8-byte little-endian value (hex bytes as selected in the
+    // byte inspector) across the buffered packets; offline = the decoded capture store
+    std::string findValue(const std::string& hexBytes, bool offline, int limit);
+    std::string getValueIndexStats();
+
+    // Per byte position of one opcode's payloads: min/max, distinct values, entropy
+    std::string getByteVariability(const std::string& direction, int opcode);
+
+    // Pre/post-trigger capture windows (written to triggers/ next to the exe)
+    bool configureTrigger(const std::string& configJson);
+    std::string getTriggerStatus();
+    std::string loadTriggerCapture(const std::string& path);   // into offlineStore_
+
+    // Downsampled packets/bytes per bucket for one session direction (opcode -1 = all opcodes).
+    // resolutionSec 0 = pick automatically from the window
+    std::string getBandwidthTimeline(int sessionId, const std::string& direction, int opcode,
+                                     double fromSec, double toSec, int resolutionSec);
+
     // Opcode encryption
     std::string decryptOpcodes(const std::string& hexPayload, const std::string& desKey);
 
+    // Offline capture files
+    std::string indexCapture(const std::string& pcapPath);
+    std::string decodeCaptureFlow(const std::string& pcapPath, int flowIndex, int first, int count);
+    std::string decodeCapture(const std::string& pcapPath);
+    std::string getCapturePackets(int first, int count);
+    const FlowIndex* loadCaptureIndex(const std::string& pcapPath);
+
+    // Structural diff of two sessions. A source is "" (the store filled by
+    // decodeCapture/loadTriggerCapture/importMsb), a .mspkts or .msb file or a capture file.
+    std::string diffSessions(const std::string& sourceA, int sessionA, const std::string& sourceB, int sessionB);
+    std::optional<PacketStore> loadPacketSource(const std::string& source);
+
+    // Propose names for a new version's opcodes from a labeled session of an
+    // older version (names come from the old version's opcodes.json)
+    std::string mapOpcodes(const std::string& sourceOld, int sessionOld, const std::string& sourceNew, int sessionNew);
+
+    // Decrypted sessions as a plaintext TCP pcap (sessionId -1 = all) for Wireshark/tshark.
+    // source as in diffSessions; outPath "" = exports/plaintext-<time>.pcap next to the exe
+    std::string exportPlaintextPcap(const std::string& source, int sessionId, const std::string& outPath);
+
+    // MapleShark session files. importMsb reads a .msb file or a directory of them
+    // (one session each) into offlineStore_; exportMsb writes one session of a source
+    // (as in diffSessions); outPath "" = exports/session-<id>-<time>.msb next to the exe
+    std::string importMsb(const std::string& path);
+    std::string exportMsb(const std::string& source, int sessionId, const std::string& outPath);
+
+    // Frequent opcode sequences, request -> response candidates and rare transitions.
+    // source is "live" (mined as packets arrive) or a source as in diffSessions.
+    std::string getOpcodeSequences(const std::string& source, int minLength, int limit);
+
+    void autosaveLoop(std::stop_token stop);
+    void statsLoop(std::stop_token stop);
+
     Capture& capture_;
+    Protocol& protocol_;
+    PipelineMetrics& metrics_;
     std::shared_ptr<saucer::window> window_;
     std::optional<saucer::smartview> webview_;
 
     std::deque<Packet> packets_;
+    std::deque<uint64_t> enqueuedAtNs_;   // parallel to packets_, for delivery latency
+    uint64_t deliveredSeq_ = 0;           // packets before this seq were already handed out
     std::mutex packetsMutex_;
     static constexpr size_t MAX_PACKETS = 500;
     uint64_t nextPacketSeq_ = 0;   // monotonic sequence number
     uint64_t baseSeq_ = 0;         // seq of packets_.front()
+    SharedRingWriter ring_;        // written under packetsMutex_
+    PacketSinks sinks_;            // own locking, one thread per sink
+    std::filesystem::path sinksPath_;
 
     // Script system
     std::filesystem::path scriptsBasePath_;
 
+    // Request/response latency per opcode pair
+    std::mutex latencyMutex_;
+    ResponseLatencyTracker latency_;
+
+    // Opcode suppression: versions whose suppress.json was applied to protocol_,
+    // and per (session, outbound, opcode) totals of dropped packets (under packetsMutex_)
+    std::mutex suppressionMutex_;
+    std::set<std::pair<uint8_t, uint16_t>> suppressionLoaded_;
+    struct SuppressedCount {
+        uint64_t packets = 0;
+        uint64_t bytes = 0;
+    };
+    std::map<std::tuple<uint32_t, bool, uint16_t>, SuppressedCount> suppressedCounts_;
+
+    // Watch rule matching
+    std::mutex watchMutex_;
+    WatchMonitor watch_;
+
+    std::mutex scriptsMutex_;
+    ScriptRunner scripts_;
+
+    // Locked after packetsMutex_ when both are held (rows are keyed by packet seq)
+    std::mutex fieldsMutex_;
+    FieldExtractor fields_;
+    uint64_t fieldsCheckedSeq_ = 0;   // packet seq of the last memory budget check
+
+    // Value -> (packet seq, offset) index over stored payloads (synchronized internally)
+    ValueIndex values_;
+
+    // Trigger capture; triggerFrames_ mirrors trigger_.wantsFrames() for the per-frame fast path
+    std::mutex triggerMutex_;
+    TriggerRecorder trigger_;
+    std::atomic<bool> triggerFrames_{false};
+
+    // Multi-resolution traffic history per session
+    std::mutex timelineMutex_;
+    BandwidthTimeline timeline_;
+
+    // Byte-position statistics per (direction, opcode)
+    std::mutex variabilityMutex_;
+    ByteVariabilityTracker variability_;
+
+    // Opcode n-grams and request/response candidates of live traffic
+    std::mutex sequencesMutex_;
+    SequenceMiner sequences_;
+
+    // Offline capture file currently being browsed (index + decode checkpoints)
+    std::mutex offlineMutex_;
+    std::string offlinePath_;
+    std::optional<FlowIndex> offlineIndex_;
+    std::optional<CheckpointFile> offlineCheckpoints_;
+    std::optional<PacketStore> offlineStore_;   // whole capture, after decodeCapture
+    bool offlineStoreIndexed_ = false;          // offlineStore_ decoded from offlineIndex_'s flows
+    std::unique_ptr<ValueIndex> offlineValues_;  // over offlineStore_, built on first findValue
+    std::unique_ptr<SequenceMiner> offlineSequences_;   // over offlineStore_, built on first use
+    std::unique_ptr<FieldExtractor> offlineFields_;     // over offlineStore_, built on first use
+
     // Multi-session tracking
     struct SessionMeta {
         uint32_t id;
@@ -61,8 +258,24 @@ private:
         uint16_t serverPort;
         double timestamp;
         bool dead = false;
+        bool restored = false;   // carried over from a previous run
     };
     std::vector<SessionMeta> sessions_;
+
+    std::filesystem::path tracesPath_;
+    std::filesystem::path exportsPath_;
+
+    // Live session persistence (file next to the exe)
+    std::filesystem::path liveStatePath_;
+    std::mutex liveStateMutex_;
+    static constexpr int LIVE_STATE_AUTOSAVE_SECONDS = 30;
+    static constexpr int64_t LIVE_STATE_MAX_AGE_SECONDS = 30 * 60;  // older state: connections are gone
+    static constexpr int STATS_LOG_SECONDS = 10;
+    std::condition_variable_any autosaveCv_;
+    std::condition_variable_any statsCv_;
+    // Last members: stopped before the rest is destroyed
+    std::jthread autosaveThread_;
+    std::jthread statsThread_;
 };
 
 } // namespace maple
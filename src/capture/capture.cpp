@@ -191,8 +191,18 @@ void Capture::pcapCallback(u_char* user, const pcap_pkthdr* header, const u_char
     pkt.len = header->len;
     pkt.caplen = header->caplen;
     pkt.timestamp = header->ts.tv_sec + header->ts.tv_usec / 1000000.0;
+    pkt.timestampNs = static_cast<int64_t>(header->ts.tv_sec) * 1000000000 +
+                      static_cast<int64_t>(header->ts.tv_usec) * 1000;
     pkt.data.assign(packet, packet + header->caplen);
 
+    if (self->metrics_) {
+        self->metrics_->add(PipelineCounter::FramesCaptured);
+        self->metrics_->add(PipelineCounter::BytesCaptured, header->caplen);
+        uint64_t capturedNs = static_cast<uint64_t>(pkt.timestampNs);
+        uint64_t nowNs = wallClockNs();
+        if (nowNs > capturedNs) self->metrics_->record(PipelineStage::Capture, nowNs - capturedNs);
+    }
+
     // Copy callback under lock, invoke outside to avoid blocking capture thread
     PacketCallback cb;
     {
@@ -200,11 +210,13 @@ void Capture::pcapCallback(u_char* user, const pcap_pkthdr* header, const u_char
         cb = self->callback_;
     }
     if (cb) {
+        TraceSpan span("capture", "frame");
         cb(pkt);
     }
 }
 
 void Capture::captureLoop() {
+    Tracer::setThreadName("capture");
     pcap_loop(handle_, 0, pcapCallback, reinterpret_cast<u_char*>(this));
 }
 
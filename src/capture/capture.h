@@ -1,6 +1,8 @@
 #pragma once
 
 #include <pcap.h>
+#include "../metrics/pipeline_metrics.h"
+#include "../metrics/trace.h"
 #include <string>
 #include <vector>
 #include <unordered_map>
@@ -17,6 +19,7 @@ struct RawPacket {
     uint32_t len;
     uint32_t caplen;
     double timestamp;
+    int64_t timestampNs = 0;   // same instant in integer ns since the epoch (no double rounding)
 };
 
 struct NetworkInterface {
@@ -43,6 +46,9 @@ public:
     const std::string& currentInterface() const { return currentInterface_; }
     const std::string& currentFilter() const { return currentFilter_; }
 
+    // Optional live metrics (frame counters, capture latency); set before start()
+    void setMetrics(PipelineMetrics* metrics) { metrics_ = metrics; }
+
     void setPacketCallback(PacketCallback cb);
 
 private:
@@ -56,6 +62,7 @@ private:
     PacketCallback callback_;
     std::string currentInterface_;
     std::string currentFilter_;
+    PipelineMetrics* metrics_ = nullptr;
 };
 
 } // namespace maple
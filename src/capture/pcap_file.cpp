@@ -0,0 +1,186 @@
+#include "pcap_file.h"
+#include <algorithm>
+#include <iostream>
+
+namespace maple {
+
+static constexpr uint32_t PCAP_MAGIC_US = 0xA1B2C3D4;
+static constexpr uint32_t PCAP_MAGIC_NS = 0xA1B23C4D;
+static constexpr uint32_t PCAP_MAGIC_US_SWAPPED = 0xD4C3B2A1;
+static constexpr uint32_t PCAP_MAGIC_NS_SWAPPED = 0x4D3CB2A1;
+
+// Upper bound for a single record; anything larger means we lost framing
+static constexpr uint32_t MAX_RECORD_SIZE = 256 * 1024;
+
+uint32_t PcapReader::read32(const uint8_t* p) const {
+    uint32_t v = static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+                 (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    if (swapped_) {
+        v = ((v & 0xFF) << 24) | ((v & 0xFF00) << 8) | ((v >> 8) & 0xFF00) | (v >> 24);
+    }
+    return v;
+}
+
+bool PcapReader::open(const std::filesystem::path& path) {
+    close();
+
+    std::error_code ec;
+    fileSize_ = std::filesystem::file_size(path, ec);
+    if (ec) {
+        error_ = "cannot stat file";
+        return false;
+    }
+
+    // Large read buffer: index/replay passes are purely sequential
+    ioBuffer_.resize(1 << 20);
+    file_.rdbuf()->pubsetbuf(ioBuffer_.data(), static_cast<std::streamsize>(ioBuffer_.size()));
+    file_.open(path, std::ios::binary);
+    if (!file_.is_open()) {
+        error_ = "cannot open file";
+        return false;
+    }
+
+    uint8_t hdr[GLOBAL_HEADER_SIZE];
+    file_.read(reinterpret_cast<char*>(hdr), GLOBAL_HEADER_SIZE);
+    if (file_.gcount() != static_cast<std::streamsize>(GLOBAL_HEADER_SIZE)) {
+        error_ = "file too short";
+        close();
+        return false;
+    }
+
+    uint32_t magic = static_cast<uint32_t>(hdr[0]) | (static_cast<uint32_t>(hdr[1]) << 8) |
+                     (static_cast<uint32_t>(hdr[2]) << 16) | (static_cast<uint32_t>(hdr[3]) << 24);
+    switch (magic) {
+        case PCAP_MAGIC_US:         swapped_ = false; nanosecond_ = false; break;
+        case PCAP_MAGIC_NS:         swapped_ = false; nanosecond_ = true;  break;
+        case PCAP_MAGIC_US_SWAPPED: swapped_ = true;  nanosecond_ = false; break;
+        case PCAP_MAGIC_NS_SWAPPED: swapped_ = true;  nanosecond_ = true;  break;
+        default:
+            error_ = "not a pcap file (pcapng is not supported)";
+            close();
+            return false;
+    }
+
+    snapLen_ = read32(hdr + 16);
+    linkType_ = read32(hdr + 20) & 0x0FFFFFFF;
+    if (linkType_ != LINKTYPE_ETHERNET) {
+        std::cerr << "[PcapReader] Warning: link type " << linkType_
+                  << " is not Ethernet, TCP parsing will fail" << std::endl;
+    }
+
+    position_ = GLOBAL_HEADER_SIZE;
+    error_.clear();
+    return true;
+}
+
+void PcapReader::close() {
+    if (file_.is_open()) file_.close();
+    file_.clear();
+    position_ = 0;
+}
+
+bool PcapReader::next(RawPacket& pkt, uint64_t* offset) {
+    if (!file_.is_open()) return false;
+
+    uint8_t rec[RECORD_HEADER_SIZE];
+    file_.read(reinterpret_cast<char*>(rec), RECORD_HEADER_SIZE);
+    if (file_.gcount() != static_cast<std::streamsize>(RECORD_HEADER_SIZE)) {
+        return false; // clean EOF or truncated header
+    }
+
+    uint32_t tsSec = read32(rec);
+    uint32_t tsFrac = read32(rec + 4);
+    uint32_t inclLen = read32(rec + 8);
+    uint32_t origLen = read32(rec + 12);
+
+    if (inclLen > MAX_RECORD_SIZE) {
+        error_ = "corrupt record at offset " + std::to_string(position_);
+        return false;
+    }
+
+    pkt.data.resize(inclLen);
+    file_.read(reinterpret_cast<char*>(pkt.data.data()), inclLen);
+    if (file_.gcount() != static_cast<std::streamsize>(inclLen)) {
+        error_ = "truncated record at offset " + std::to_string(position_);
+        return false;
+    }
+
+    pkt.len = origLen;
+    pkt.caplen = inclLen;
+    pkt.timestamp = tsSec + tsFrac / (nanosecond_ ? 1000000000.0 : 1000000.0);
+    pkt.timestampNs = static_cast<int64_t>(tsSec) * 1000000000 +
+                      static_cast<int64_t>(tsFrac) * (nanosecond_ ? 1 : 1000);
+
+    if (offset) *offset = position_;
+    position_ += RECORD_HEADER_SIZE + inclLen;
+    return true;
+}
+
+bool PcapReader::seek(uint64_t offset) {
+    if (!file_.is_open() || offset < GLOBAL_HEADER_SIZE || offset >= fileSize_) return false;
+    if (offset == position_) return true;
+
+    // Frames of one flow are interleaved with other flows: a real seek would
+    // throw away the read buffer for every frame
+    if (offset > position_ && offset - position_ < ioBuffer_.size()) {
+        file_.ignore(static_cast<std::streamsize>(offset - position_));
+        if (!file_.good()) return false;
+        position_ = offset;
+        return true;
+    }
+
+    file_.clear();
+    file_.seekg(static_cast<std::streamoff>(offset));
+    if (!file_.good()) return false;
+    position_ = offset;
+    return true;
+}
+
+// --- PcapWriter ---
+
+static void put32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = static_cast<uint8_t>(v >> (i * 8));
+}
+
+bool PcapWriter::open(const std::filesystem::path& path, uint32_t linkType) {
+    close();
+    file_.open(path, std::ios::binary | std::ios::trunc);
+    if (!file_.is_open()) return false;
+
+    uint8_t hdr[PcapReader::GLOBAL_HEADER_SIZE]{};
+    put32(hdr, PCAP_MAGIC_NS);
+    hdr[4] = 2;   // version 2.4
+    hdr[6] = 4;
+    put32(hdr + 16, SNAP_LEN);
+    put32(hdr + 20, linkType);
+    file_.write(reinterpret_cast<const char*>(hdr), sizeof(hdr));
+    frames_ = 0;
+    return file_.good();
+}
+
+void PcapWriter::close() {
+    if (file_.is_open()) file_.close();
+    file_.clear();
+}
+
+bool PcapWriter::write(const RawPacket& pkt) {
+    return write(pkt.timestampNs, pkt.data.data(), static_cast<uint32_t>(pkt.data.size()),
+                 std::max(pkt.len, static_cast<uint32_t>(pkt.data.size())));
+}
+
+bool PcapWriter::write(int64_t timestampNs, const uint8_t* data, uint32_t len, uint32_t origLen) {
+    if (!file_.is_open()) return false;
+    len = std::min(len, SNAP_LEN);
+
+    uint8_t rec[PcapReader::RECORD_HEADER_SIZE];
+    put32(rec, static_cast<uint32_t>(timestampNs / 1'000'000'000));
+    put32(rec + 4, static_cast<uint32_t>(timestampNs % 1'000'000'000));
+    put32(rec + 8, len);
+    put32(rec + 12, origLen);
+    file_.write(reinterpret_cast<const char*>(rec), sizeof(rec));
+    file_.write(reinterpret_cast<const char*>(data), len);
+    frames_++;
+    return file_.good();
+}
+
+} // namespace maple
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "capture.h"
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace maple {
+
+// Streaming reader for classic libpcap capture files (.pcap, not pcapng).
+// Exposes the file offset of every record so indexes can seek straight to a frame.
+class PcapReader {
+public:
+    static constexpr uint32_t LINKTYPE_ETHERNET = 1;
+
+    PcapReader() = default;
+
+    PcapReader(const PcapReader&) = delete;
+    PcapReader& operator=(const PcapReader&) = delete;
+
+    bool open(const std::filesystem::path& path);
+    void close();
+    bool isOpen() const { return file_.is_open(); }
+
+    // Read the next record. offset receives the file offset of its record header.
+    // Returns false on EOF or a truncated/corrupt record.
+    bool next(RawPacket& pkt, uint64_t* offset = nullptr);
+
+    // Position the reader at a record header previously reported by next().
+    // Short forward jumps are skipped through the read buffer instead of seeking.
+    bool seek(uint64_t offset);
+    uint64_t position() const { return position_; }
+
+    uint64_t fileSize() const { return fileSize_; }
+    uint32_t linkType() const { return linkType_; }
+    uint32_t snapLen() const { return snapLen_; }
+    const std::string& error() const { return error_; }
+
+    static constexpr uint64_t GLOBAL_HEADER_SIZE = 24;
+    static constexpr uint64_t RECORD_HEADER_SIZE = 16;
+
+private:
+    uint32_t read32(const uint8_t* p) const;
+
+    std::vector<char> ioBuffer_;   // declared before file_: must outlive the stream
+    std::ifstream file_;
+    uint64_t fileSize_ = 0;
+    uint64_t position_ = 0;
+    uint32_t linkType_ = 0;
+    uint32_t snapLen_ = 0;
+    bool swapped_ = false;     // file written on a big-endian host
+    bool nanosecond_ = false;  // ts fraction is ns instead of us
+    std::string error_;
+};
+
+// Writer for classic libpcap files with nanosecond timestamps (readable by PcapReader and Wireshark)
+class PcapWriter {
+public:
+    PcapWriter() = default;
+
+    PcapWriter(const PcapWriter&) = delete;
+    PcapWriter& operator=(const PcapWriter&) = delete;
+
+    bool open(const std::filesystem::path& path, uint32_t linkType = PcapReader::LINKTYPE_ETHERNET);
+    void close();
+    bool isOpen() const { return file_.is_open(); }
+
+    bool write(const RawPacket& pkt);
+    bool write(int64_t timestampNs, const uint8_t* data, uint32_t len, uint32_t origLen);
+
+    uint64_t frames() const { return frames_; }
+
+    static constexpr uint32_t SNAP_LEN = 262144;
+
+private:
+    std::ofstream file_;
+    uint64_t frames_ = 0;
+};
+
+} // namespace maple
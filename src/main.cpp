@@ -8,10 +8,17 @@
 coco::stray start(saucer::application *app) {
     maple::Capture capture;
     maple::Protocol protocol;
-    maple::App mApp(capture);
+    maple::PipelineMetrics metrics;
+    capture.setMetrics(&metrics);
+    protocol.setMetrics(&metrics);
+    maple::App mApp(capture, protocol, metrics);
+
+    // Pick up sessions that were live when the previous instance exited
+    mApp.restoreLiveState();
 
     capture.setPacketCallback([&protocol, &mApp](const maple::RawPacket& raw) {
         try {
+            mApp.onRawFrame(raw);
             auto packets = protocol.process(raw);
             if (!packets.empty()) {
                 mApp.addPackets(packets);
@@ -23,6 +30,7 @@ coco::stray start(saucer::application *app) {
 
     co_await app->finish();
     capture.stop();
+    mApp.saveLiveState();
 }
 
 int main() {
@@ -0,0 +1,80 @@
+#include "histogram.h"
+#include <bit>
+
+namespace maple {
+
+size_t LatencyHistogram::bucketIndex(uint64_t v) {
+    if (v < SUB_BUCKETS) return static_cast<size_t>(v);  // exact below 32 ns
+
+    int exponent = std::bit_width(v) - 1;
+    if (exponent > MAX_EXPONENT) return BUCKET_COUNT - 1;
+
+    int shift = exponent - SUB_BUCKET_BITS;
+    size_t sub = static_cast<size_t>((v >> shift) & (SUB_BUCKETS - 1));
+    return SUB_BUCKETS + static_cast<size_t>(shift) * SUB_BUCKETS + sub;
+}
+
+uint64_t LatencyHistogram::bucketLow(size_t index) {
+    if (index < SUB_BUCKETS) return index;
+    size_t shift = (index - SUB_BUCKETS) / SUB_BUCKETS;
+    uint64_t sub = (index - SUB_BUCKETS) % SUB_BUCKETS;
+    return (SUB_BUCKETS + sub) << shift;
+}
+
+uint64_t LatencyHistogram::bucketHigh(size_t index) {
+    if (index < SUB_BUCKETS) return index + 1;
+    size_t shift = (index - SUB_BUCKETS) / SUB_BUCKETS;
+    return bucketLow(index) + (1ull << shift);
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const {
+    Snapshot s;
+    s.buckets.resize(BUCKET_COUNT);
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+        s.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+    }
+    // Derive count from the copied buckets so percentiles stay consistent
+    // with concurrent record() calls
+    for (uint64_t b : s.buckets) s.count += b;
+    s.sum = sum_.load(std::memory_order_relaxed);
+    return s;
+}
+
+uint64_t LatencyHistogram::Snapshot::percentile(double q) const {
+    if (count == 0) return 0;
+    uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(count - 1)) + 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); i++) {
+        seen += buckets[i];
+        if (seen >= rank) return (bucketLow(i) + bucketHigh(i) - 1) / 2;
+    }
+    return bucketLow(buckets.size() - 1);
+}
+
+uint64_t LatencyHistogram::Snapshot::min() const {
+    for (size_t i = 0; i < buckets.size(); i++) {
+        if (buckets[i]) return bucketLow(i);
+    }
+    return 0;
+}
+
+uint64_t LatencyHistogram::Snapshot::max() const {
+    for (size_t i = buckets.size(); i-- > 0; ) {
+        if (buckets[i]) return bucketHigh(i) - 1;
+    }
+    return 0;
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::Snapshot::operator-(const Snapshot& earlier) const {
+    Snapshot d;
+    d.buckets.resize(buckets.size());
+    for (size_t i = 0; i < buckets.size(); i++) {
+        uint64_t before = i < earlier.buckets.size() ? earlier.buckets[i] : 0;
+        d.buckets[i] = buckets[i] - before;
+        d.count += d.buckets[i];
+    }
+    d.sum = sum - earlier.sum;
+    return d;
+}
+
+} // namespace maple
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace maple {
+
+// Monotonic clock in nanoseconds, for stage timing
+inline uint64_t monotonicNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Wall clock in nanoseconds since the Unix epoch (comparable to capture timestamps)
+inline uint64_t wallClockNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+// HDR-style latency histogram: log-linear buckets (32 linear sub-buckets per
+// power of two, ~3% relative error) from 1 ns to ~4.9 h. record() is a couple
+// of relaxed atomic adds, safe from any thread without locking.
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BUCKET_BITS = 5;
+    static constexpr uint64_t SUB_BUCKETS = 1ull << SUB_BUCKET_BITS;
+    static constexpr int MAX_EXPONENT = 43;
+    static constexpr size_t BUCKET_COUNT = SUB_BUCKETS + (MAX_EXPONENT - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    // Point-in-time copy; subtract two snapshots for interval statistics
+    struct Snapshot {
+        std::vector<uint64_t> buckets;
+        uint64_t count = 0;
+        uint64_t sum = 0;
+
+        // Value at quantile q in [0, 1] (bucket midpoint), 0 if empty
+        uint64_t percentile(double q) const;
+        uint64_t min() const;
+        uint64_t max() const;
+        double mean() const { return count ? static_cast<double>(sum) / count : 0.0; }
+
+        Snapshot operator-(const Snapshot& earlier) const;
+    };
+
+    void record(uint64_t ns) {
+        buckets_[bucketIndex(ns)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(ns, std::memory_order_relaxed);
+    }
+
+    Snapshot snapshot() const;
+
+    static size_t bucketIndex(uint64_t v);
+    static uint64_t bucketLow(size_t index);
+    static uint64_t bucketHigh(size_t index);  // exclusive
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+};
+
+} // namespace maple
@@ -0,0 +1,81 @@
+#include "pipeline_metrics.h"
+#include <iomanip>
+#include <sstream>
+
+namespace maple {
+
+const char* pipelineStageName(PipelineStage stage) {
+    switch (stage) {
+        case PipelineStage::Capture:    return "capture";
+        case PipelineStage::Reassembly: return "reassembly";
+        case PipelineStage::Decrypt:    return "decrypt";
+        case PipelineStage::Store:      return "store";
+        case PipelineStage::Delivery:   return "delivery";
+        default:                        return "?";
+    }
+}
+
+const char* pipelineCounterName(PipelineCounter counter) {
+    switch (counter) {
+        case PipelineCounter::FramesCaptured:      return "framesCaptured";
+        case PipelineCounter::BytesCaptured:       return "bytesCaptured";
+        case PipelineCounter::SegmentsReassembled: return "segmentsReassembled";
+        case PipelineCounter::PacketsDecoded:      return "packetsDecoded";
+        case PipelineCounter::BytesDecoded:        return "bytesDecoded";
+        case PipelineCounter::PacketsDelivered:    return "packetsDelivered";
+        case PipelineCounter::PacketsSuppressed:   return "packetsSuppressed";
+        case PipelineCounter::WatchMatches:        return "watchMatches";
+        default:                                   return "?";
+    }
+}
+
+PipelineMetrics::Snapshot PipelineMetrics::snapshot() const {
+    Snapshot s;
+    for (size_t i = 0; i < STAGE_COUNT; i++) s.stages[i] = stages_[i].snapshot();
+    for (size_t i = 0; i < COUNTER_COUNT; i++) s.counters[i] = counters_[i].load(std::memory_order_relaxed);
+    s.takenAtNs = monotonicNs();
+    return s;
+}
+
+PipelineMetrics::Snapshot PipelineMetrics::Snapshot::operator-(const Snapshot& earlier) const {
+    Snapshot d;
+    for (size_t i = 0; i < STAGE_COUNT; i++) d.stages[i] = stages[i] - earlier.stages[i];
+    for (size_t i = 0; i < COUNTER_COUNT; i++) d.counters[i] = counters[i] - earlier.counters[i];
+    d.takenAtNs = takenAtNs - earlier.takenAtNs;  // interval length
+    return d;
+}
+
+// Compact duration: 850ns, 12.3us, 4.1ms, 2.0s
+static std::string formatNs(uint64_t ns) {
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(1);
+    if (ns < 1000) oss << ns << "ns";
+    else if (ns < 1000000) oss << ns / 1e3 << "us";
+    else if (ns < 1000000000) oss << ns / 1e6 << "ms";
+    else oss << ns / 1e9 << "s";
+    return oss.str();
+}
+
+std::string PipelineMetrics::formatLogLine(const Snapshot& interval) {
+    double seconds = interval.takenAtNs / 1e9;
+    if (seconds <= 0) seconds = 1;
+    auto rate = [&](PipelineCounter c) { return interval.counters[static_cast<size_t>(c)] / seconds; };
+
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(0)
+        << rate(PipelineCounter::FramesCaptured) << " frames/s, "
+        << rate(PipelineCounter::PacketsDecoded) << " pkts/s, "
+        << std::setprecision(1) << rate(PipelineCounter::BytesDecoded) / 1024.0 << " KiB/s decoded";
+
+    for (size_t i = 0; i < STAGE_COUNT; i++) {
+        const auto& h = interval.stages[i];
+        if (h.count == 0) continue;
+        oss << " | " << pipelineStageName(static_cast<PipelineStage>(i))
+            << " p50=" << formatNs(h.percentile(0.5))
+            << " p99=" << formatNs(h.percentile(0.99))
+            << " max=" << formatNs(h.max());
+    }
+    return oss.str();
+}
+
+} // namespace maple
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "histogram.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace maple {
+
+// Stages a live packet passes through, in order
+enum class PipelineStage {
+    Capture,      // pcap timestamp -> our callback (driver + ring buffer delay)
+    Reassembly,   // TcpReasm add + drain per segment
+    Decrypt,      // MapleStream::tryRead per decoded packet
+    Store,        // App::addPackets per batch
+    Delivery,     // App::addPackets -> handed to the UI by getPackets
+    Count
+};
+
+const char* pipelineStageName(PipelineStage stage);
+
+enum class PipelineCounter {
+    FramesCaptured,
+    BytesCaptured,
+    SegmentsReassembled,
+    PacketsDecoded,
+    BytesDecoded,
+    PacketsDelivered,
+    PacketsSuppressed,
+    WatchMatches,
+    Count
+};
+
+const char* pipelineCounterName(PipelineCounter counter);
+
+// Latency histograms and throughput counters for the live pipeline.
+// One instance is owned by main and handed to Capture, Protocol and App;
+// offline decoders run without one so they never skew live numbers.
+class PipelineMetrics {
+public:
+    static constexpr size_t STAGE_COUNT = static_cast<size_t>(PipelineStage::Count);
+    static constexpr size_t COUNTER_COUNT = static_cast<size_t>(PipelineCounter::Count);
+
+    struct Snapshot {
+        std::array<LatencyHistogram::Snapshot, STAGE_COUNT> stages;
+        std::array<uint64_t, COUNTER_COUNT> counters{};
+        uint64_t takenAtNs = 0;   // monotonic
+
+        Snapshot operator-(const Snapshot& earlier) const;
+    };
+
+    void record(PipelineStage stage, uint64_t ns) { stages_[static_cast<size_t>(stage)].record(ns); }
+    void add(PipelineCounter counter, uint64_t n = 1) {
+        counters_[static_cast<size_t>(counter)].fetch_add(n, std::memory_order_relaxed);
+    }
+
+    Snapshot snapshot() const;
+
+    // One-line summary of an interval: rates plus p50/p99 per stage
+    static std::string formatLogLine(const Snapshot& interval);
+
+private:
+    std::array<LatencyHistogram, STAGE_COUNT> stages_;
+    std::array<std::atomic<uint64_t>, COUNTER_COUNT> counters_{};
+};
+
+// Records the time from construction to destruction into one stage.
+// A null metrics pointer makes it a no-op (offline decoding).
+class StageTimer {
+public:
+    StageTimer(PipelineMetrics* metrics, PipelineStage stage)
+        : metrics_(metrics), stage_(stage), start_(metrics ? monotonicNs() : 0) {}
+    ~StageTimer() {
+        if (metrics_) metrics_->record(stage_, monotonicNs() - start_);
+    }
+
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+private:
+    PipelineMetrics* metrics_;
+    PipelineStage stage_;
+    uint64_t start_;
+};
+
+} // namespace maple
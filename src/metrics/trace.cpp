@@ -0,0 +1,141 @@
+#include "trace.h"
+#include <fstream>
+#include <iomanip>
+
+namespace maple {
+
+std::atomic<bool> Tracer::enabled_{false};
+
+Tracer& Tracer::instance() {
+    static Tracer tracer;
+    return tracer;
+}
+
+Tracer::LocalState& Tracer::local() {
+    thread_local LocalState state;
+    return state;
+}
+
+Tracer::LocalState::~LocalState() {
+    if (!buffer) return;
+    // Kept until exported: events of finished threads (pool workers) still reach the trace
+    Tracer& t = instance();
+    std::lock_guard<std::mutex> lock(t.mutex_);
+    buffer->exited = true;
+}
+
+Tracer::ThreadBuffer* Tracer::acquireBuffer(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t generation = generation_.load();
+
+    // Rings of exited threads holding no events of the current trace are reused
+    ThreadBuffer* buffer = nullptr;
+    for (auto& b : buffers_) {
+        if (b->exited && b->generation.load() != generation) {
+            buffer = b.get();
+            break;
+        }
+    }
+    if (!buffer) buffer = buffers_.emplace_back(std::make_unique<ThreadBuffer>()).get();
+
+    buffer->tid = nextTid_++;
+    buffer->name = name.empty() ? "thread-" + std::to_string(buffer->tid) : name;
+    buffer->written.store(0);
+    buffer->generation.store(0);
+    buffer->exited = false;
+    return buffer;
+}
+
+void Tracer::start() {
+    {
+        // Rings of exited threads only hold events of the previous trace
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::erase_if(buffers_, [](const auto& b) { return b->exited; });
+    }
+    generation_.fetch_add(1);
+    startNs_ = monotonicNs();
+    enabled_.store(true);
+}
+
+void Tracer::stop() {
+    enabled_.store(false);
+}
+
+void Tracer::setThreadName(const std::string& name) {
+    LocalState& state = local();
+    state.name = name;
+    if (state.buffer) {
+        std::lock_guard<std::mutex> lock(instance().mutex_);
+        state.buffer->name = name;
+    }
+}
+
+void Tracer::record(const char* category, const char* name, uint64_t startNs, uint64_t endNs) {
+    LocalState& state = local();
+    if (!state.buffer) {
+        // Threads that never record while tracing never get a ring
+        if (!enabled()) return;
+        state.buffer = instance().acquireBuffer(state.name);
+    }
+    ThreadBuffer& buffer = *state.buffer;
+
+    // First event of a new trace: drop what this thread recorded before
+    uint64_t generation = instance().generation_.load(std::memory_order_relaxed);
+    uint64_t n = buffer.written.load(std::memory_order_relaxed);
+    if (buffer.generation.load(std::memory_order_relaxed) != generation) {
+        buffer.generation.store(generation, std::memory_order_relaxed);
+        n = 0;
+    }
+
+    buffer.events[n % EVENTS_PER_THREAD] = { category, name, startNs, endNs - startNs };
+    buffer.written.store(n + 1, std::memory_order_release);
+}
+
+static void writeJsonString(std::ostream& os, const std::string& s) {
+    static constexpr char HEX[] = "0123456789abcdef";
+    for (char c : s) {
+        auto u = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            os << '\\' << c;
+        } else if (u < 0x20) {
+            os << "\\u00" << HEX[u >> 4] << HEX[u & 15];
+        } else {
+            os << c;
+        }
+    }
+}
+
+bool Tracer::writeJson(const std::filesystem::path& path) const {
+    std::ofstream ofs(path, std::ios::trunc);
+    if (!ofs.is_open()) return false;
+
+    uint64_t generation = generation_.load();
+    ofs << std::fixed << std::setprecision(3);
+    ofs << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    ofs << "{\"ph\":\"M\",\"pid\":1,\"name\":\"process_name\",\"args\":{\"name\":\"MapleSniffer\"}}";
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& buffer : buffers_) {
+        ofs << ",\n{\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->tid
+            << ",\"name\":\"thread_name\",\"args\":{\"name\":\"";
+        writeJsonString(ofs, buffer->name);   // sink names come from sinks.json
+        ofs << "\"}}";
+        if (buffer->generation.load() != generation) continue;
+
+        uint64_t written = buffer->written.load(std::memory_order_acquire);
+        uint64_t first = written > EVENTS_PER_THREAD ? written - EVENTS_PER_THREAD : 0;
+        for (uint64_t i = first; i < written; i++) {
+            const Event& e = buffer->events[i % EVENTS_PER_THREAD];
+            if (e.startNs < startNs_) continue;
+            // Trace-event timestamps are microseconds
+            ofs << ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->tid
+                << ",\"cat\":\"" << e.category << "\",\"name\":\"" << e.name
+                << "\",\"ts\":" << (e.startNs - startNs_) / 1000.0
+                << ",\"dur\":" << e.durationNs / 1000.0 << "}";
+        }
+    }
+    ofs << "\n]}\n";
+    return ofs.good();
+}
+
+} // namespace maple
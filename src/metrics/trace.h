@@ -0,0 +1,97 @@
+#pragma once
+
+#include "histogram.h"
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace maple {
+
+// Chrome trace-event recorder (load the output in chrome://tracing or Perfetto).
+// Each thread appends complete ("X") events to its own fixed-size ring, so the
+// hot path is two clock reads and a few plain stores with no lock or shared
+// cache line. Rings wrap: a long trace keeps the most recent events per thread.
+// A thread gets its ring on its first event while tracing is on; rings of
+// exited threads are kept for the export and reused once stale.
+// Event names and categories must be string literals (only the pointer is kept).
+class Tracer {
+public:
+    static constexpr size_t EVENTS_PER_THREAD = 1 << 16;
+
+    static Tracer& instance();
+
+    static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+    // Clears previous events and starts recording
+    void start();
+    void stop();
+
+    // Write everything recorded as trace JSON. Call after stop().
+    bool writeJson(const std::filesystem::path& path) const;
+
+    // Label the calling thread in the trace viewer
+    static void setThreadName(const std::string& name);
+
+    static void record(const char* category, const char* name, uint64_t startNs, uint64_t endNs);
+
+private:
+    struct Event {
+        const char* category;
+        const char* name;
+        uint64_t startNs;
+        uint64_t durationNs;
+    };
+
+    // Written only by its owning thread; `written` is published with release
+    // so writeJson can read a consistent prefix
+    struct ThreadBuffer {
+        uint32_t tid = 0;
+        std::string name;
+        std::vector<Event> events = std::vector<Event>(EVENTS_PER_THREAD);
+        std::atomic<uint64_t> written{0};
+        std::atomic<uint64_t> generation{0};   // trace the events belong to
+        bool exited = false;                   // owning thread is gone (guarded by mutex_)
+    };
+
+    // Per-thread name and ring; the ring is handed back when the thread exits
+    struct LocalState {
+        std::string name;
+        ThreadBuffer* buffer = nullptr;
+        ~LocalState();
+    };
+
+    static LocalState& local();
+    ThreadBuffer* acquireBuffer(const std::string& name);
+
+    static std::atomic<bool> enabled_;
+    std::atomic<uint64_t> generation_{0};
+    uint64_t startNs_ = 0;
+
+    mutable std::mutex mutex_;   // guards buffers_ (registration and export only)
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
+    uint32_t nextTid_ = 1;
+};
+
+// Records one complete event covering its own lifetime when tracing is on
+class TraceSpan {
+public:
+    TraceSpan(const char* category, const char* name)
+        : category_(category), name_(name), startNs_(Tracer::enabled() ? monotonicNs() : 0) {}
+    ~TraceSpan() {
+        if (startNs_) Tracer::record(category_, name_, startNs_, monotonicNs());
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char* category_;
+    const char* name_;
+    uint64_t startNs_;
+};
+
+} // namespace maple
@@ -0,0 +1,76 @@
+#include "bulk_decoder.h"
+#include "../util/thread_pool.h"
+#include "../metrics/trace.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+
+namespace maple {
+
+std::optional<BulkDecodeResult> BulkDecoder::decode(const std::filesystem::path& pcapPath,
+                                                    const FlowIndex& index, const Options& options) {
+    auto start = std::chrono::steady_clock::now();
+    const auto& flows = index.flows();
+
+    // Flows without a handshake never produce packets
+    std::vector<uint32_t> work;
+    for (uint32_t i = 0; i < flows.size(); i++) {
+        if (flows[i].hasHandshake) work.push_back(i);
+    }
+
+    // Largest flows first: they bound the wall time, small ones fill the gaps
+    std::sort(work.begin(), work.end(), [&](uint32_t a, uint32_t b) {
+        return flows[a].frameOffsets.size() > flows[b].frameOffsets.size();
+    });
+
+    std::vector<PacketStore> parts(flows.size());
+    std::vector<FlowCheckpoints> checkpoints(options.checkpoints ? flows.size() : 0);
+    std::vector<uint8_t> ok(flows.size(), 0);
+    std::atomic<size_t> done{0};
+    uint64_t interval = options.checkpoints ? options.checkpoints->interval() : 0;
+
+    {
+        ThreadPool pool(std::min(options.threads ? options.threads : std::thread::hardware_concurrency(),
+                                 std::max<size_t>(work.size(), 1)));
+        for (uint32_t flowIdx : work) {
+            pool.submit([&, flowIdx] {
+                TraceSpan span("offline", "decodeFlow");
+                FlowDecoder decoder(pcapPath, flows[flowIdx], flowIdx);
+                PacketStore& store = parts[flowIdx];
+                ok[flowIdx] = decoder.decodeAll([&store](Packet&& pkt, uint64_t) {
+                    store.append(pkt);
+                    return true;
+                }, options.checkpoints ? &checkpoints[flowIdx] : nullptr,
+                   interval > 0 ? interval : FlowDecoder::DEFAULT_CHECKPOINT_INTERVAL);
+
+                size_t n = done.fetch_add(1) + 1;
+                if (options.progress) options.progress(n, work.size());
+            });
+        }
+        pool.wait();
+    }
+
+    BulkDecodeResult result;
+    for (uint32_t flowIdx : work) {
+        if (ok[flowIdx]) {
+            result.flowsDecoded++;
+            if (options.checkpoints) options.checkpoints->put(std::move(checkpoints[flowIdx]));
+        } else {
+            result.flowsFailed++;
+        }
+    }
+    if (!work.empty() && result.flowsDecoded == 0) {
+        std::cerr << "[BulkDecoder] No flow of " << pcapPath.string() << " could be decoded" << std::endl;
+        return std::nullopt;
+    }
+
+    {
+        TraceSpan span("offline", "merge");
+        result.packets = PacketStore::merge(std::move(parts));
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+} // namespace maple
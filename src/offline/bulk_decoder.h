@@ -0,0 +1,37 @@
+#pragma once
+
+#include "flow_index.h"
+#include "flow_decoder.h"
+#include "../store/packet_store.h"
+#include <filesystem>
+#include <functional>
+#include <optional>
+
+namespace maple {
+
+struct BulkDecodeResult {
+    PacketStore packets;       // every flow, merged by timestamp
+    size_t flowsDecoded = 0;
+    size_t flowsFailed = 0;
+    double seconds = 0;        // wall time
+};
+
+// Decodes a whole capture in parallel: flows are independent sessions, so each
+// one decodes on its own pool task (own file handle, own Protocol) and the
+// per-flow results are merged into one timeline at the end.
+class BulkDecoder {
+public:
+    // Called from worker threads as flows finish
+    using Progress = std::function<void(size_t flowsDone, size_t flowsTotal)>;
+
+    struct Options {
+        size_t threads = 0;              // 0: hardware concurrency
+        CheckpointFile* checkpoints = nullptr;  // filled for every decoded flow if set
+        Progress progress;
+    };
+
+    static std::optional<BulkDecodeResult> decode(const std::filesystem::path& pcapPath,
+                                                  const FlowIndex& index, const Options& options);
+};
+
+} // namespace maple
@@ -0,0 +1,199 @@
+#include "flow_decoder.h"
+#include "../capture/pcap_file.h"
+#include "../protocol/state_io.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace maple {
+
+namespace fs = std::filesystem;
+
+static constexpr char CHECKPOINT_MAGIC[8] = { 'M', 'S', 'C', 'K', 'P', 'T', '\0', '\0' };
+
+// --- FlowCheckpoints ---
+
+const DecodeCheckpoint* FlowCheckpoints::nearest(uint64_t packet) const {
+    auto it = std::upper_bound(checkpoints.begin(), checkpoints.end(), packet,
+        [](uint64_t p, const DecodeCheckpoint& cp) { return p < cp.packetIndex; });
+    if (it == checkpoints.begin()) return nullptr;
+    return &*std::prev(it);
+}
+
+// --- CheckpointFile ---
+
+fs::path CheckpointFile::sidecarPath(const fs::path& pcapPath) {
+    fs::path p = pcapPath;
+    p += ".msckpt";
+    return p;
+}
+
+CheckpointFile CheckpointFile::forCapture(const fs::path& pcapPath, uint64_t interval) {
+    CheckpointFile file;
+    std::error_code ec;
+    file.sourceSize_ = fs::file_size(pcapPath, ec);
+    file.sourceMTime_ = captureMTime(pcapPath);
+    file.interval_ = interval;
+    return file;
+}
+
+std::optional<CheckpointFile> CheckpointFile::load(const fs::path& pcapPath) {
+    std::ifstream ifs(sidecarPath(pcapPath), std::ios::binary);
+    if (!ifs.is_open()) return std::nullopt;
+
+    BinaryReader r(ifs);
+    char magic[sizeof(CHECKPOINT_MAGIC)];
+    r.raw(magic, sizeof(magic));
+    if (!r.ok() || std::memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) != 0) return std::nullopt;
+    if (r.u32() != FORMAT_VERSION) return std::nullopt;
+
+    CheckpointFile file;
+    file.sourceSize_ = r.u64();
+    file.sourceMTime_ = r.i64();
+    file.interval_ = r.u64();
+
+    std::error_code ec;
+    if (file.sourceSize_ != fs::file_size(pcapPath, ec) || file.sourceMTime_ != captureMTime(pcapPath)) {
+        return std::nullopt; // capture changed since the checkpoints were taken
+    }
+
+    uint32_t flowCount = r.u32();
+    for (uint32_t i = 0; i < flowCount && r.ok(); i++) {
+        FlowCheckpoints flow;
+        flow.flowIndex = r.u32();
+        flow.packetCount = r.u64();
+        uint32_t cpCount = r.u32();
+        for (uint32_t j = 0; j < cpCount && r.ok(); j++) {
+            DecodeCheckpoint cp;
+            cp.frameOrdinal = r.u32();
+            cp.packetIndex = r.u64();
+            cp.timestamp = r.f64();
+            if (!readProtocolState(r, cp.state)) return std::nullopt;
+            flow.checkpoints.push_back(std::move(cp));
+        }
+        file.flows_.push_back(std::move(flow));
+    }
+
+    if (!r.ok()) return std::nullopt;
+    return file;
+}
+
+bool CheckpointFile::save(const fs::path& pcapPath) const {
+    std::ofstream ofs(sidecarPath(pcapPath), std::ios::binary | std::ios::trunc);
+    if (!ofs.is_open()) return false;
+
+    BinaryWriter w(ofs);
+    w.raw(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    w.u32(FORMAT_VERSION);
+    w.u64(sourceSize_);
+    w.i64(sourceMTime_);
+    w.u64(interval_);
+
+    w.u32(static_cast<uint32_t>(flows_.size()));
+    for (const auto& flow : flows_) {
+        w.u32(flow.flowIndex);
+        w.u64(flow.packetCount);
+        w.u32(static_cast<uint32_t>(flow.checkpoints.size()));
+        for (const auto& cp : flow.checkpoints) {
+            w.u32(cp.frameOrdinal);
+            w.u64(cp.packetIndex);
+            w.f64(cp.timestamp);
+            writeProtocolState(w, cp.state);
+        }
+    }
+    return w.ok();
+}
+
+const FlowCheckpoints* CheckpointFile::find(uint32_t flowIndex) const {
+    for (const auto& flow : flows_) {
+        if (flow.flowIndex == flowIndex) return &flow;
+    }
+    return nullptr;
+}
+
+void CheckpointFile::put(FlowCheckpoints flow) {
+    for (auto& existing : flows_) {
+        if (existing.flowIndex == flow.flowIndex) {
+            existing = std::move(flow);
+            return;
+        }
+    }
+    flows_.push_back(std::move(flow));
+}
+
+// --- FlowDecoder ---
+
+FlowDecoder::FlowDecoder(const fs::path& pcapPath, const FlowEntry& flow, uint32_t flowIndex)
+    : pcapPath_(pcapPath), flow_(flow), flowIndex_(flowIndex), sessionId_(flowIndex + 1)
+{
+}
+
+bool FlowDecoder::decodeAll(const PacketSink& sink, FlowCheckpoints* checkpoints, uint64_t interval) {
+    if (checkpoints) {
+        checkpoints->flowIndex = flowIndex_;
+        checkpoints->packetCount = 0;
+        checkpoints->checkpoints.clear();
+    }
+    Protocol protocol;
+    return run(protocol, 0, 0, sink, checkpoints, interval);
+}
+
+bool FlowDecoder::decodeRange(const FlowCheckpoints& checkpoints, uint64_t first, size_t count,
+                              std::vector<Packet>& out) {
+    if (count == 0) return true;
+
+    Protocol protocol;
+    uint32_t startFrame = 0;
+    uint64_t startPacket = 0;
+    if (const DecodeCheckpoint* cp = checkpoints.nearest(first)) {
+        protocol.restoreState(cp->state);
+        startFrame = cp->frameOrdinal;
+        startPacket = cp->packetIndex;
+    }
+
+    size_t wanted = out.size() + count;
+    return run(protocol, startFrame, startPacket, [&](Packet&& pkt, uint64_t index) {
+        if (index < first) return true;
+        out.push_back(std::move(pkt));
+        return out.size() < wanted;
+    }, nullptr, 0);
+}
+
+bool FlowDecoder::run(Protocol& protocol, uint32_t startFrame, uint64_t startPacket,
+                      const PacketSink& sink, FlowCheckpoints* checkpoints, uint64_t interval) {
+    PcapReader reader;
+    if (!reader.open(pcapPath_)) {
+        std::cerr << "[FlowDecoder] " << pcapPath_.string() << ": " << reader.error() << std::endl;
+        return false;
+    }
+
+    uint64_t packetIndex = startPacket;
+    uint64_t lastCheckpoint = startPacket;
+    RawPacket raw;
+
+    const auto& offsets = flow_.frameOffsets;
+    for (uint32_t i = startFrame; i < offsets.size(); i++) {
+        if (!reader.seek(offsets[i]) || !reader.next(raw)) {
+            std::cerr << "[FlowDecoder] Cannot read frame " << i << " of flow " << flowIndex_ << std::endl;
+            return false;
+        }
+
+        auto pkts = protocol.process(raw);
+        for (auto& pkt : pkts) {
+            pkt.sessionId = sessionId_;
+            if (!sink(std::move(pkt), packetIndex++)) return true;
+        }
+
+        // Checkpoints sit between frames, so resuming replays whole frames only
+        if (checkpoints && interval > 0 && packetIndex - lastCheckpoint >= interval) {
+            checkpoints->checkpoints.push_back({ i + 1, packetIndex, raw.timestamp, protocol.saveState() });
+            lastCheckpoint = packetIndex;
+        }
+    }
+
+    if (checkpoints) checkpoints->packetCount = packetIndex;
+    return true;
+}
+
+} // namespace maple
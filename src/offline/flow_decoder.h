@@ -0,0 +1,86 @@
+#pragma once
+
+#include "flow_index.h"
+#include "../protocol/protocol.h"
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <vector>
+
+namespace maple {
+
+// Resume point inside one flow: full decoder state between two frames
+struct DecodeCheckpoint {
+    uint32_t frameOrdinal = 0;   // first flow frame not yet fed to the decoder
+    uint64_t packetIndex = 0;    // packets emitted before this point
+    double timestamp = 0;
+    ProtocolState state;
+};
+
+struct FlowCheckpoints {
+    uint32_t flowIndex = 0;
+    uint64_t packetCount = 0;    // packets in the whole flow
+    std::vector<DecodeCheckpoint> checkpoints;  // ascending packetIndex
+
+    // Last checkpoint at or before packet, or nullptr (decode from the start)
+    const DecodeCheckpoint* nearest(uint64_t packet) const;
+};
+
+// Checkpoint sidecar stored next to the capture as "<file>.msckpt"
+class CheckpointFile {
+public:
+    static constexpr uint32_t FORMAT_VERSION = 1;
+
+    static std::filesystem::path sidecarPath(const std::filesystem::path& pcapPath);
+
+    // Empty file bound to a capture (records its size/mtime for staleness checks)
+    static CheckpointFile forCapture(const std::filesystem::path& pcapPath, uint64_t interval);
+
+    // Load the sidecar if it exists and still matches the capture
+    static std::optional<CheckpointFile> load(const std::filesystem::path& pcapPath);
+    bool save(const std::filesystem::path& pcapPath) const;
+
+    const FlowCheckpoints* find(uint32_t flowIndex) const;
+    void put(FlowCheckpoints flow);
+
+    uint64_t interval() const { return interval_; }
+
+private:
+    uint64_t sourceSize_ = 0;
+    int64_t sourceMTime_ = 0;
+    uint64_t interval_ = 0;
+    std::vector<FlowCheckpoints> flows_;
+};
+
+// Decodes a single indexed flow straight from the capture file
+class FlowDecoder {
+public:
+    // Return false to stop decoding early
+    using PacketSink = std::function<bool(Packet&& pkt, uint64_t packetIndex)>;
+
+    static constexpr uint64_t DEFAULT_CHECKPOINT_INTERVAL = 10000;
+
+    FlowDecoder(const std::filesystem::path& pcapPath, const FlowEntry& flow, uint32_t flowIndex);
+
+    // Decode the whole flow, recording a checkpoint every `interval` packets
+    bool decodeAll(const PacketSink& sink, FlowCheckpoints* checkpoints = nullptr,
+                   uint64_t interval = DEFAULT_CHECKPOINT_INTERVAL);
+
+    // Decode packets [first, first + count) starting from the nearest checkpoint
+    bool decodeRange(const FlowCheckpoints& checkpoints, uint64_t first, size_t count,
+                     std::vector<Packet>& out);
+
+    // Session id stamped on every emitted packet (defaults to flowIndex + 1)
+    void setSessionId(uint32_t id) { sessionId_ = id; }
+
+private:
+    bool run(Protocol& protocol, uint32_t startFrame, uint64_t startPacket,
+             const PacketSink& sink, FlowCheckpoints* checkpoints, uint64_t interval);
+
+    std::filesystem::path pcapPath_;
+    const FlowEntry& flow_;
+    uint32_t flowIndex_;
+    uint32_t sessionId_;
+};
+
+} // namespace maple
@@ -0,0 +1,336 @@
+#include "flow_index.h"
+#include "../capture/pcap_file.h"
+#include "../protocol/protocol.h"
+#include "../util/binary_io.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include <map>
+
+namespace maple {
+
+namespace fs = std::filesystem;
+
+static constexpr char INDEX_MAGIC[8] = { 'M', 'S', 'I', 'D', 'X', '\0', '\0', '\0' };
+
+// Give up looking for a handshake once this many server bytes arrived without one
+static constexpr size_t HANDSHAKE_SCAN_LIMIT = 1024;
+
+int64_t captureMTime(const fs::path& path) {
+    std::error_code ec;
+    auto t = fs::last_write_time(path, ec);
+    if (ec) return 0;
+    return static_cast<int64_t>(t.time_since_epoch().count());
+}
+
+uint32_t FlowEntry::frameAtTime(double ts) const {
+    // Last marker with timestamp <= ts
+    auto it = std::upper_bound(markers.begin(), markers.end(), ts,
+        [](double t, const FlowTimeMarker& m) { return t < m.timestamp; });
+    if (it == markers.begin()) return 0;
+    return std::prev(it)->frameOrdinal;
+}
+
+fs::path FlowIndex::sidecarPath(const fs::path& pcapPath) {
+    fs::path p = pcapPath;
+    p += ".msidx";
+    return p;
+}
+
+std::optional<FlowIndex> FlowIndex::build(const fs::path& pcapPath, double markerInterval) {
+    PcapReader reader;
+    if (!reader.open(pcapPath)) {
+        std::cerr << "[FlowIndex] " << pcapPath.string() << ": " << reader.error() << std::endl;
+        return std::nullopt;
+    }
+
+    FlowIndex index;
+    index.sourceSize_ = reader.fileSize();
+    index.sourceMTime_ = captureMTime(pcapPath);
+    index.markerInterval_ = markerInterval > 0 ? markerInterval : 1.0;
+    index.linkType_ = reader.linkType();
+
+    // Builder-only state for flows that are still open
+    struct ActiveFlow {
+        size_t flowIdx;
+        std::vector<uint8_t> pendingServer;  // server bytes collected for handshake detection
+        uint64_t pendingOffset = 0;          // frame where pendingServer started
+        uint32_t pendingFrame = 0;
+        bool handshakeDone = false;
+        double nextMarker = 0;
+    };
+    std::map<ConnectionKey, ActiveFlow> active;
+
+    RawPacket raw;
+    uint64_t offset = 0;
+    double nextGlobalMarker = 0;
+
+    while (reader.next(raw, &offset)) {
+        uint64_t frameNumber = index.frameCount_++;
+
+        if (index.markers_.empty() || raw.timestamp >= nextGlobalMarker) {
+            index.markers_.push_back({ raw.timestamp, offset, frameNumber });
+            nextGlobalMarker = raw.timestamp + index.markerInterval_;
+        }
+
+        TcpSegment seg;
+        if (!Protocol::parseTcp(raw.data.data(), static_cast<int>(raw.data.size()), seg)) continue;
+
+        ConnectionKey fwd = { seg.srcIP, seg.dstIP, seg.srcPort, seg.dstPort };
+        ConnectionKey rev = fwd.reverse();
+        ConnectionKey key = (fwd < rev) ? fwd : rev;
+
+        auto it = active.find(key);
+
+        // A fresh SYN on a flow that already carried data is a reconnect on the same port pair
+        bool isSyn = seg.syn && !seg.ack;
+        if (isSyn && it != active.end() && index.flows_[it->second.flowIdx].payloadBytes > 0) {
+            active.erase(it);
+            it = active.end();
+        }
+
+        if (it == active.end()) {
+            FlowEntry flow;
+            flow.firstTimestamp = raw.timestamp;
+            index.flows_.push_back(std::move(flow));
+            it = active.emplace(key, ActiveFlow{ index.flows_.size() - 1, {} }).first;
+        }
+
+        ActiveFlow& af = it->second;
+        FlowEntry& flow = index.flows_[af.flowIdx];
+
+        if (isSyn && !flow.rolesKnown) {
+            flow.clientIP = seg.srcIP;
+            flow.clientPort = seg.srcPort;
+            flow.serverIP = seg.dstIP;
+            flow.serverPort = seg.dstPort;
+            flow.rolesKnown = true;
+        }
+
+        uint32_t ordinal = static_cast<uint32_t>(flow.frameOffsets.size());
+        flow.frameOffsets.push_back(offset);
+        flow.lastTimestamp = raw.timestamp;
+        if (seg.payloadLen > 0) flow.payloadBytes += static_cast<uint64_t>(seg.payloadLen);
+
+        if (flow.markers.empty() || raw.timestamp >= af.nextMarker) {
+            flow.markers.push_back({ raw.timestamp, ordinal });
+            af.nextMarker = raw.timestamp + index.markerInterval_;
+        }
+
+        if (af.handshakeDone || seg.payloadLen <= 0) continue;
+
+        // Same rule as Session: without a SYN, the first payload is assumed to be the server hello
+        if (!flow.rolesKnown) {
+            flow.serverIP = seg.srcIP;
+            flow.serverPort = seg.srcPort;
+            flow.clientIP = seg.dstIP;
+            flow.clientPort = seg.dstPort;
+            flow.rolesKnown = true;
+        }
+        bool fromServer = (seg.srcIP == flow.serverIP && seg.srcPort == flow.serverPort);
+        if (!fromServer) continue;
+
+        if (af.pendingServer.empty()) {
+            af.pendingOffset = offset;
+            af.pendingFrame = ordinal;
+        }
+        af.pendingServer.insert(af.pendingServer.end(), seg.payload, seg.payload + seg.payloadLen);
+
+        auto hs = Session::parseHandshake(af.pendingServer.data(), static_cast<int>(af.pendingServer.size()));
+        if (hs.has_value()) {
+            flow.hasHandshake = true;
+            flow.handshakeOffset = af.pendingOffset;
+            flow.handshakeFrame = af.pendingFrame;
+            flow.version = hs->version;
+            flow.locale = hs->locale;
+            flow.subVersion = hs->patchLocation;
+            af.handshakeDone = true;
+            af.pendingServer.clear();
+            af.pendingServer.shrink_to_fit();
+        } else if (af.pendingServer.size() > HANDSHAKE_SCAN_LIMIT) {
+            af.handshakeDone = true;  // mid-stream capture or not MapleStory
+            af.pendingServer.clear();
+            af.pendingServer.shrink_to_fit();
+        }
+    }
+
+    if (!reader.error().empty()) {
+        std::cerr << "[FlowIndex] Stopped early: " << reader.error() << std::endl;
+    }
+
+    std::cout << "[FlowIndex] Indexed " << index.frameCount_ << " frames, "
+              << index.flows_.size() << " flows" << std::endl;
+    return index;
+}
+
+bool FlowIndex::save(const fs::path& indexPath) const {
+    std::ofstream ofs(indexPath, std::ios::binary | std::ios::trunc);
+    if (!ofs.is_open()) return false;
+
+    BinaryWriter w(ofs);
+    w.raw(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    w.u32(FORMAT_VERSION);
+    w.u64(sourceSize_);
+    w.i64(sourceMTime_);
+    w.f64(markerInterval_);
+    w.u32(linkType_);
+    w.u64(frameCount_);
+
+    w.u32(static_cast<uint32_t>(markers_.size()));
+    for (const auto& m : markers_) {
+        w.f64(m.timestamp);
+        w.u64(m.fileOffset);
+        w.u64(m.frameNumber);
+    }
+
+    w.u32(static_cast<uint32_t>(flows_.size()));
+    for (const auto& f : flows_) {
+        w.u32(f.clientIP);
+        w.u32(f.serverIP);
+        w.u16(f.clientPort);
+        w.u16(f.serverPort);
+        w.u8(f.rolesKnown ? 1 : 0);
+        w.f64(f.firstTimestamp);
+        w.f64(f.lastTimestamp);
+        w.u64(f.payloadBytes);
+
+        w.u8(f.hasHandshake ? 1 : 0);
+        w.u64(f.handshakeOffset);
+        w.u32(f.handshakeFrame);
+        w.u16(f.version);
+        w.u8(f.locale);
+        w.str(f.subVersion);
+
+        // Offsets are increasing: delta + varint keeps the sidecar small
+        w.u32(static_cast<uint32_t>(f.frameOffsets.size()));
+        uint64_t prev = 0;
+        for (uint64_t off : f.frameOffsets) {
+            w.varint(off - prev);
+            prev = off;
+        }
+
+        w.u32(static_cast<uint32_t>(f.markers.size()));
+        for (const auto& m : f.markers) {
+            w.f64(m.timestamp);
+            w.u32(m.frameOrdinal);
+        }
+    }
+
+    return w.ok();
+}
+
+std::optional<FlowIndex> FlowIndex::load(const fs::path& indexPath) {
+    std::ifstream ifs(indexPath, std::ios::binary);
+    if (!ifs.is_open()) return std::nullopt;
+
+    BinaryReader r(ifs);
+    char magic[sizeof(INDEX_MAGIC)];
+    r.raw(magic, sizeof(magic));
+    if (!r.ok() || std::memcmp(magic, INDEX_MAGIC, sizeof(magic)) != 0) return std::nullopt;
+    if (r.u32() != FORMAT_VERSION) return std::nullopt;
+
+    FlowIndex index;
+    index.sourceSize_ = r.u64();
+    index.sourceMTime_ = r.i64();
+    index.markerInterval_ = r.f64();
+    index.linkType_ = r.u32();
+    index.frameCount_ = r.u64();
+
+    uint32_t markerCount = r.u32();
+    for (uint32_t i = 0; i < markerCount && r.ok(); i++) {
+        CaptureTimeMarker m;
+        m.timestamp = r.f64();
+        m.fileOffset = r.u64();
+        m.frameNumber = r.u64();
+        index.markers_.push_back(m);
+    }
+
+    uint32_t flowCount = r.u32();
+    for (uint32_t i = 0; i < flowCount && r.ok(); i++) {
+        FlowEntry f;
+        f.clientIP = r.u32();
+        f.serverIP = r.u32();
+        f.clientPort = r.u16();
+        f.serverPort = r.u16();
+        f.rolesKnown = r.u8() != 0;
+        f.firstTimestamp = r.f64();
+        f.lastTimestamp = r.f64();
+        f.payloadBytes = r.u64();
+
+        f.hasHandshake = r.u8() != 0;
+        f.handshakeOffset = r.u64();
+        f.handshakeFrame = r.u32();
+        f.version = r.u16();
+        f.locale = r.u8();
+        f.subVersion = r.str(256);
+
+        uint32_t frames = r.u32();
+        if (frames > index.frameCount_) return std::nullopt;
+        f.frameOffsets.reserve(frames);
+        uint64_t prev = 0;
+        for (uint32_t j = 0; j < frames && r.ok(); j++) {
+            prev += r.varint();
+            f.frameOffsets.push_back(prev);
+        }
+
+        uint32_t markers = r.u32();
+        if (markers > frames) return std::nullopt;
+        for (uint32_t j = 0; j < markers && r.ok(); j++) {
+            FlowTimeMarker m;
+            m.timestamp = r.f64();
+            m.frameOrdinal = r.u32();
+            f.markers.push_back(m);
+        }
+
+        index.flows_.push_back(std::move(f));
+    }
+
+    if (!r.ok()) return std::nullopt;
+    return index;
+}
+
+std::optional<FlowIndex> FlowIndex::loadOrBuild(const fs::path& pcapPath, double markerInterval) {
+    auto sidecar = sidecarPath(pcapPath);
+
+    std::error_code ec;
+    uint64_t size = fs::file_size(pcapPath, ec);
+    if (ec) return std::nullopt;
+
+    // Same normalization as build(): a sidecar with other marker spacing is rebuilt
+    double interval = markerInterval > 0 ? markerInterval : 1.0;
+    if (fs::exists(sidecar, ec)) {
+        auto loaded = load(sidecar);
+        if (loaded.has_value() && loaded->sourceSize_ == size &&
+            loaded->sourceMTime_ == captureMTime(pcapPath) &&
+            loaded->markerInterval_ == interval) {
+            return loaded;
+        }
+        std::cout << "[FlowIndex] Sidecar is stale, rebuilding" << std::endl;
+    }
+
+    auto built = build(pcapPath, markerInterval);
+    if (built.has_value() && !built->save(sidecar)) {
+        std::cerr << "[FlowIndex] Could not write " << sidecar.string() << std::endl;
+    }
+    return built;
+}
+
+uint64_t FlowIndex::offsetAtTime(double ts) const {
+    auto it = std::upper_bound(markers_.begin(), markers_.end(), ts,
+        [](double t, const CaptureTimeMarker& m) { return t < m.timestamp; });
+    if (it == markers_.begin()) return PcapReader::GLOBAL_HEADER_SIZE;
+    return std::prev(it)->fileOffset;
+}
+
+std::vector<size_t> FlowIndex::flowsInRange(double from, double to) const {
+    std::vector<size_t> result;
+    for (size_t i = 0; i < flows_.size(); i++) {
+        if (flows_[i].lastTimestamp >= from && flows_[i].firstTimestamp <= to) {
+            result.push_back(i);
+        }
+    }
+    return result;
+}
+
+} // namespace maple
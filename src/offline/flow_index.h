@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace maple {
+
+// Periodic seek point inside one flow
+struct FlowTimeMarker {
+    double timestamp;
+    uint32_t frameOrdinal;  // index into FlowEntry::frameOffsets
+};
+
+// Periodic seek point over the whole capture file
+struct CaptureTimeMarker {
+    double timestamp;
+    uint64_t fileOffset;
+    uint64_t frameNumber;
+};
+
+// One TCP connection in a capture file
+struct FlowEntry {
+    uint32_t clientIP = 0;
+    uint32_t serverIP = 0;
+    uint16_t clientPort = 0;
+    uint16_t serverPort = 0;
+    bool rolesKnown = false;   // client/server decided by SYN or handshake direction
+
+    double firstTimestamp = 0;
+    double lastTimestamp = 0;
+    uint64_t payloadBytes = 0;
+
+    // Handshake (server hello) location and the version it announced
+    bool hasHandshake = false;
+    uint64_t handshakeOffset = 0;
+    uint32_t handshakeFrame = 0;   // ordinal within frameOffsets
+    uint16_t version = 0;
+    uint8_t locale = 0;
+    std::string subVersion;
+
+    std::vector<uint64_t> frameOffsets;  // record header offsets, in file order
+    std::vector<FlowTimeMarker> markers;
+
+    // First frame ordinal whose timestamp may be >= ts (conservative: at a marker)
+    uint32_t frameAtTime(double ts) const;
+};
+
+// Modification time of a capture file, recorded by sidecars to detect staleness
+int64_t captureMTime(const std::filesystem::path& path);
+
+// Sidecar index over a pcap file: one pass builds it, later tools seek by flow or time.
+// Stored next to the capture as "<file>.msidx".
+class FlowIndex {
+public:
+    static constexpr uint32_t FORMAT_VERSION = 1;
+
+    // Scan a capture file once and index every TCP flow.
+    // markerInterval: seconds between time markers (global and per flow)
+    static std::optional<FlowIndex> build(const std::filesystem::path& pcapPath, double markerInterval = 1.0);
+
+    static std::optional<FlowIndex> load(const std::filesystem::path& indexPath);
+    bool save(const std::filesystem::path& indexPath) const;
+
+    // Load the sidecar if it matches the capture file and marker interval, otherwise rebuild and save it
+    static std::optional<FlowIndex> loadOrBuild(const std::filesystem::path& pcapPath, double markerInterval = 1.0);
+
+    static std::filesystem::path sidecarPath(const std::filesystem::path& pcapPath);
+
+    const std::vector<FlowEntry>& flows() const { return flows_; }
+    const std::vector<CaptureTimeMarker>& markers() const { return markers_; }
+    uint64_t frameCount() const { return frameCount_; }
+    double markerInterval() const { return markerInterval_; }
+
+    // File offset of the last global marker at or before ts (start of data if none)
+    uint64_t offsetAtTime(double ts) const;
+
+    // Indices of flows with any traffic in [from, to]
+    std::vector<size_t> flowsInRange(double from, double to) const;
+
+private:
+    // Source file identity, used to detect a stale sidecar
+    uint64_t sourceSize_ = 0;
+    int64_t sourceMTime_ = 0;
+
+    double markerInterval_ = 1.0;
+    uint32_t linkType_ = 0;
+    uint64_t frameCount_ = 0;
+    std::vector<CaptureTimeMarker> markers_;
+    std::vector<FlowEntry> flows_;
+};
+
+} // namespace maple
@@ -0,0 +1,206 @@
+#include "plaintext_pcap.h"
+#include "../capture/pcap_file.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+namespace maple {
+
+namespace {
+
+constexpr size_t ETH_SIZE = 14;
+constexpr size_t IP_SIZE = 20;
+constexpr size_t TCP_SIZE = 20;
+constexpr size_t HEADERS_SIZE = ETH_SIZE + IP_SIZE + TCP_SIZE;
+
+constexpr uint8_t TCP_FIN = 0x01;
+constexpr uint8_t TCP_SYN = 0x02;
+constexpr uint8_t TCP_PSH = 0x08;
+constexpr uint8_t TCP_ACK = 0x10;
+
+constexpr uint32_t CLIENT_ISN = 0x10000000;
+constexpr uint32_t SERVER_ISN = 0x20000000;
+
+void put16be(uint8_t* p, uint16_t v) {
+    p[0] = static_cast<uint8_t>(v >> 8);
+    p[1] = static_cast<uint8_t>(v);
+}
+
+void put32be(uint8_t* p, uint32_t v) {
+    put16be(p, static_cast<uint16_t>(v >> 16));
+    put16be(p + 2, static_cast<uint16_t>(v));
+}
+
+uint32_t sumWords(const uint8_t* p, size_t len, uint32_t sum = 0) {
+    for (size_t i = 0; i + 1 < len; i += 2) sum += static_cast<uint32_t>(p[i]) << 8 | p[i + 1];
+    if (len & 1) sum += static_cast<uint32_t>(p[len - 1]) << 8;
+    return sum;
+}
+
+uint16_t foldChecksum(uint32_t sum) {
+    while (sum >> 16) sum = (sum & 0xFFFF) + (sum >> 16);
+    return static_cast<uint16_t>(~sum);
+}
+
+struct Connection {
+    SessionEndpoints endpoints;
+    uint32_t clientSeq = CLIENT_ISN;   // next sequence number per side
+    uint32_t serverSeq = SERVER_ISN;
+    uint16_t ipId = 0;
+    bool open = false;
+    bool closed = false;
+};
+
+class FrameWriter {
+public:
+    explicit FrameWriter(PcapWriter& writer) : writer_(writer), frame_(HEADERS_SIZE + PlaintextPcapExporter::MAX_SEGMENT) {}
+
+    // One TCP segment; advances the sender's sequence number
+    bool segment(int64_t timestampNs, Connection& c, bool fromClient, uint8_t flags,
+                 const uint8_t* data, size_t len) {
+        const SessionEndpoints& ep = c.endpoints;
+        uint32_t srcIP = fromClient ? ep.clientIP : ep.serverIP;
+        uint32_t dstIP = fromClient ? ep.serverIP : ep.clientIP;
+        uint32_t& seq = fromClient ? c.clientSeq : c.serverSeq;
+        uint32_t ack = fromClient ? c.serverSeq : c.clientSeq;
+        uint8_t* f = frame_.data();
+
+        // Ethernet: locally administered MACs, 02:...:01 client and 02:...:02 server
+        static const uint8_t CLIENT_MAC[6] = { 0x02, 0, 0, 0, 0, 0x01 };
+        static const uint8_t SERVER_MAC[6] = { 0x02, 0, 0, 0, 0, 0x02 };
+        std::memcpy(f, fromClient ? SERVER_MAC : CLIENT_MAC, 6);
+        std::memcpy(f + 6, fromClient ? CLIENT_MAC : SERVER_MAC, 6);
+        put16be(f + 12, 0x0800);
+
+        uint8_t* ip = f + ETH_SIZE;
+        std::memset(ip, 0, IP_SIZE);
+        ip[0] = 0x45;
+        put16be(ip + 2, static_cast<uint16_t>(IP_SIZE + TCP_SIZE + len));
+        put16be(ip + 4, c.ipId++);
+        put16be(ip + 6, 0x4000);   // don't fragment
+        ip[8] = 64;
+        ip[9] = 6;
+        put32be(ip + 12, srcIP);
+        put32be(ip + 16, dstIP);
+        put16be(ip + 10, foldChecksum(sumWords(ip, IP_SIZE)));
+
+        uint8_t* tcp = ip + IP_SIZE;
+        std::memset(tcp, 0, TCP_SIZE);
+        put16be(tcp, fromClient ? ep.clientPort : ep.serverPort);
+        put16be(tcp + 2, fromClient ? ep.serverPort : ep.clientPort);
+        put32be(tcp + 4, seq);
+        put32be(tcp + 8, (flags & TCP_ACK) ? ack : 0);
+        tcp[12] = (TCP_SIZE / 4) << 4;
+        tcp[13] = flags;
+        put16be(tcp + 14, 65535);
+        if (len) std::memcpy(tcp + TCP_SIZE, data, len);
+
+        uint32_t pseudo = (srcIP >> 16) + (srcIP & 0xFFFF) + (dstIP >> 16) + (dstIP & 0xFFFF) +
+                          6 + static_cast<uint32_t>(TCP_SIZE + len);
+        put16be(tcp + 16, foldChecksum(sumWords(tcp, TCP_SIZE + len, pseudo)));
+
+        seq += static_cast<uint32_t>(len) + ((flags & (TCP_SYN | TCP_FIN)) ? 1 : 0);
+        auto size = static_cast<uint32_t>(HEADERS_SIZE + len);
+        return writer_.write(timestampNs, f, size, size);
+    }
+
+private:
+    PcapWriter& writer_;
+    std::vector<uint8_t> frame_;
+};
+
+} // namespace
+
+std::optional<PlaintextExportResult> PlaintextPcapExporter::write(const PacketStore& store, const std::filesystem::path& path,
+                                                                  const Options& options) {
+    PcapWriter writer;
+    if (!writer.open(path)) {
+        std::cerr << "[PlaintextPcap] Cannot create " << path.string() << std::endl;
+        return std::nullopt;
+    }
+    FrameWriter frames(writer);
+    PlaintextExportResult result;
+    std::unordered_map<uint32_t, Connection> connections;
+    std::vector<uint8_t> record;   // cleartext frame of the current packet, reused
+
+    const auto& flags = store.flags();
+    bool ok = true;
+    for (size_t i = 0; i < store.size() && ok; i++) {
+        uint32_t sessionId = store.sessionIds()[i];
+        if (options.sessionId && *options.sessionId != sessionId) continue;
+        int64_t ts = store.timestampsNs()[i];
+
+        auto [it, inserted] = connections.try_emplace(sessionId);
+        Connection& c = it->second;
+        if (inserted) {
+            std::optional<SessionEndpoints> ep;
+            if (options.endpoints) ep = options.endpoints(sessionId);
+            if (!ep) {
+                // 10.1.x.y client per session talking to 10.0.0.1
+                ep = SessionEndpoints{};
+                ep->clientIP = 0x0A010000u | (sessionId & 0xFFFF);
+                ep->serverIP = 0x0A000001u;
+                ep->clientPort = static_cast<uint16_t>(49152 + sessionId % 16384);
+                ep->serverPort = store.serverPorts()[i];
+            }
+            c.endpoints = *ep;
+            result.sessions++;
+        }
+        if (c.closed) continue;
+
+        if (!c.open) {
+            ok = frames.segment(ts, c, true, TCP_SYN, nullptr, 0) &&
+                 frames.segment(ts, c, false, TCP_SYN | TCP_ACK, nullptr, 0) &&
+                 frames.segment(ts, c, true, TCP_ACK, nullptr, 0);
+            c.open = true;
+        }
+        if (flags[i] & PacketStore::FLAG_HANDSHAKE) continue;
+        if (flags[i] & PacketStore::FLAG_DEAD) {
+            ok = ok && frames.segment(ts, c, false, TCP_FIN | TCP_ACK, nullptr, 0) &&
+                 frames.segment(ts, c, true, TCP_FIN | TCP_ACK, nullptr, 0) &&
+                 frames.segment(ts, c, false, TCP_ACK, nullptr, 0);
+            c.closed = true;
+            continue;
+        }
+
+        size_t payloadSize = store.payloadSize(i);
+        auto length = static_cast<uint32_t>(payloadSize + 2);
+        uint16_t opcode = store.opcodes()[i];
+        record.resize(HEADER_SIZE + payloadSize);
+        record[0] = static_cast<uint8_t>(length);
+        record[1] = static_cast<uint8_t>(length >> 8);
+        record[2] = static_cast<uint8_t>(length >> 16);
+        record[3] = static_cast<uint8_t>(length >> 24);
+        record[4] = static_cast<uint8_t>(opcode);
+        record[5] = static_cast<uint8_t>(opcode >> 8);
+        if (payloadSize) std::memcpy(record.data() + HEADER_SIZE, store.payload(i), payloadSize);
+
+        bool fromClient = (flags[i] & PacketStore::FLAG_OUTBOUND) != 0;
+        for (size_t off = 0; off < record.size() && ok; off += MAX_SEGMENT) {
+            size_t len = std::min(MAX_SEGMENT, record.size() - off);
+            ok = frames.segment(ts, c, fromClient, TCP_PSH | TCP_ACK, record.data() + off, len);
+        }
+        result.packets++;
+        result.bytes += record.size();
+    }
+
+    result.frames = writer.frames();
+    writer.close();
+    if (!ok) {
+        std::cerr << "[PlaintextPcap] Write failed for " << path.string() << std::endl;
+        return std::nullopt;
+    }
+    return result;
+}
+
+PlaintextPcapExporter::EndpointLookup PlaintextPcapExporter::fromFlowIndex(const FlowIndex& index) {
+    return [&index](uint32_t sessionId) -> std::optional<SessionEndpoints> {
+        if (sessionId == 0 || sessionId > index.flows().size()) return std::nullopt;
+        const FlowEntry& flow = index.flows()[sessionId - 1];
+        return SessionEndpoints{ flow.clientIP, flow.serverIP, flow.clientPort, flow.serverPort };
+    };
+}
+
+} // namespace maple
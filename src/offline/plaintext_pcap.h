@@ -0,0 +1,55 @@
+#pragma once
+
+#include "flow_index.h"
+#include "../store/packet_store.h"
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <optional>
+
+namespace maple {
+
+// Addresses of one connection (IPv4 in host order, as in FlowEntry)
+struct SessionEndpoints {
+    uint32_t clientIP = 0;
+    uint32_t serverIP = 0;
+    uint16_t clientPort = 0;
+    uint16_t serverPort = 0;
+};
+
+struct PlaintextExportResult {
+    uint64_t packets = 0;    // Maple packets written
+    uint64_t frames = 0;     // pcap records, including synthetic SYN/FIN
+    uint64_t sessions = 0;
+    uint64_t bytes = 0;      // TCP payload bytes
+};
+
+// Writes decoded sessions as a standard Ethernet/IPv4/TCP pcap that Wireshark,
+// tshark and Lua dissectors read without knowing the cipher. Each session
+// becomes one TCP connection with its original addresses and timestamps,
+// opened by a synthetic three-way handshake and closed with FINs at its dead
+// marker. Every Maple packet is one segment (split only past the IPv4 size
+// limit) carrying the cleartext frame:
+//   u32 length (LE, opcode + payload)  u16 opcode (LE)  payload
+// Rows are streamed from the store through one reusable frame buffer; only
+// per-session sequence numbers are kept.
+class PlaintextPcapExporter {
+public:
+    using EndpointLookup = std::function<std::optional<SessionEndpoints>(uint32_t sessionId)>;
+
+    static constexpr size_t HEADER_SIZE = 6;                 // length + opcode
+    static constexpr size_t MAX_SEGMENT = 65535 - 20 - 20;   // largest IPv4 TCP payload
+
+    struct Options {
+        std::optional<uint32_t> sessionId;   // nullopt = every session
+        EndpointLookup endpoints;            // unknown sessions get synthetic 10.0.0.0/8 addresses
+    };
+
+    static std::optional<PlaintextExportResult> write(const PacketStore& store, const std::filesystem::path& path,
+                                                      const Options& options);
+
+    // Endpoints of sessions decoded from a capture by BulkDecoder (session id = flow index + 1)
+    static EndpointLookup fromFlowIndex(const FlowIndex& index);
+};
+
+} // namespace maple
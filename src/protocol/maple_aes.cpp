@@ -1,4 +1,5 @@
 #include "maple_aes.h"
+#include "../metrics/trace.h"
 #include <cstring>
 #include <algorithm>
 #include <stdexcept>
@@ -133,8 +134,12 @@ MapleAES::~MapleAES() {
 }
 
 bool MapleAES::confirmHeader(const uint8_t* buf) const {
-    return (buf[0] ^ iv_[2]) == (version_ & 0xFF) &&
-           (buf[1] ^ iv_[3]) == ((version_ >> 8) & 0xFF);
+    return confirmHeader(buf, iv_);
+}
+
+bool MapleAES::confirmHeader(const uint8_t* buf, const uint8_t iv[4]) const {
+    return (buf[0] ^ iv[2]) == (version_ & 0xFF) &&
+           (buf[1] ^ iv[3]) == ((version_ >> 8) & 0xFF);
 }
 
 int MapleAES::getHeaderLength(const uint8_t* buf, bool oldHeader) {
@@ -170,6 +175,8 @@ int MapleAES::getPacketLength(const uint8_t* buf, int bytesAvailable, bool oldHe
 }
 
 void MapleAES::transformAES(uint8_t* data, int dataSize) {
+    TraceSpan span("aes", "keystream");
+
     // Build IV block: repeat 4-byte IV to fill 16 bytes
     uint8_t ivBlock[16];
     for (int i = 0; i < 16; i++) {
@@ -233,14 +240,18 @@ void MapleAES::morph(uint8_t value, uint8_t* iv) {
 }
 
 void MapleAES::shiftIV() {
+    nextIV(iv_);
+}
+
+void MapleAES::nextIV(uint8_t iv[4]) {
     uint8_t oldIV[4];
-    std::memcpy(oldIV, iv_, 4);
+    std::memcpy(oldIV, iv, 4);
 
     uint8_t newIV[4] = { 0xF2, 0x53, 0x50, 0xC6 };
     for (int i = 0; i < 4; i++) {
         morph(oldIV[i], newIV);
     }
-    std::memcpy(iv_, newIV, 4);
+    std::memcpy(iv, newIV, 4);
 }
 
 } // namespace maple
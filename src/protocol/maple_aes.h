@@ -3,6 +3,7 @@
 #include <cstdint>
 #include <vector>
 #include <array>
+#include <cstring>
 #include <openssl/evp.h>
 
 namespace maple {
@@ -18,6 +19,9 @@ public:
     // Validate encrypted packet header against current IV
     bool confirmHeader(const uint8_t* buf) const;
 
+    // Validate a header against an arbitrary IV (resync probing)
+    bool confirmHeader(const uint8_t* buf, const uint8_t iv[4]) const;
+
     // Get header length (4 or 8 bytes)
     static int getHeaderLength(const uint8_t* buf, bool oldHeader = false);
 
@@ -30,9 +34,15 @@ public:
     // Shift IV using Morph function
     void shiftIV();
 
+    // Advance an IV in place by one packet (same step as shiftIV)
+    static void nextIV(uint8_t iv[4]);
+
     // Get current IV (4 bytes)
     const uint8_t* getIV() const { return iv_; }
 
+    // Overwrite the current IV (restoring a saved stream position)
+    void setIV(const uint8_t iv[4]) { std::memcpy(iv_, iv, 4); }
+
 private:
     static void morph(uint8_t value, uint8_t* iv);
 
@@ -86,6 +86,8 @@ std::optional<DecryptedPacket> MapleStream::tryRead(double timestamp) {
     }
 
     // Remove processed data from buffer
+    byteOffset_ += static_cast<uint64_t>(expectedDataSize_);
+    packetIndex_++;
     cursor_ -= expectedDataSize_;
     if (cursor_ > 0) {
         std::memmove(buffer_.data(), buffer_.data() + expectedDataSize_, cursor_);
@@ -102,10 +104,6 @@ std::optional<DecryptedPacket> MapleStream::tryRead(double timestamp) {
     pkt.timestamp = timestamp;
     pkt.outbound = outbound_;
     pkt.opcode = opcode;
-    // Payload is everything after opcode
-    if (packetSize > 2) {
-        pkt.payload.assign(packetBuffer.begin() + 2, packetBuffer.end());
-    }
     pkt.length = static_cast<uint32_t>(packetSize);
 
     // Replace encrypted opcode with real opcode for outbound packets
@@ -116,15 +114,118 @@ std::optional<DecryptedPacket> MapleStream::tryRead(double timestamp) {
         }
     }
 
-    // Generate hex dump of payload (after opcode)
-    pkt.hexDump = toHexDump(pkt.payload.data(), pkt.payload.size());
-
     // Reset expected size for next packet
     expectedDataSize_ = 4;
 
+    // Suppressed: keep only opcode/length for accounting
+    if (suppression_ && suppression_->matches(outbound_, pkt.opcode) &&
+        (outbound_ || pkt.opcode != OPCODE_ENCRYPTION)) {
+        pkt.suppressed = true;
+        return pkt;
+    }
+
+    // Payload is everything after opcode
+    if (packetSize > 2) {
+        pkt.payload.assign(packetBuffer.begin() + 2, packetBuffer.end());
+    }
+
+    // Generate hex dump of payload (after opcode)
+    pkt.hexDump = toHexDump(pkt.payload.data(), pkt.payload.size());
+
     return pkt;
 }
 
+StreamState MapleStream::saveState() const {
+    StreamState state;
+    std::memcpy(state.iv, aes_->getIV(), 4);
+    state.pending.assign(buffer_.begin(), buffer_.begin() + cursor_);
+    state.expectedDataSize = expectedDataSize_;
+    state.dead = dead_;
+    state.opcodeEncrypted = opcodeEncrypted_;
+    state.encryptedOpcodes = encryptedOpcodes_;
+    state.packetIndex = packetIndex_;
+    state.byteOffset = byteOffset_;
+    return state;
+}
+
+void MapleStream::restoreState(const StreamState& state) {
+    aes_->setIV(state.iv);
+    if (buffer_.size() < state.pending.size()) buffer_.resize(state.pending.size());
+    if (!state.pending.empty()) {
+        std::memcpy(buffer_.data(), state.pending.data(), state.pending.size());
+    }
+    cursor_ = static_cast<int>(state.pending.size());
+    expectedDataSize_ = state.expectedDataSize;
+    dead_ = state.dead;
+    opcodeEncrypted_ = state.opcodeEncrypted;
+    encryptedOpcodes_ = state.encryptedOpcodes;
+    packetIndex_ = state.packetIndex;
+    byteOffset_ = state.byteOffset;
+}
+
+bool MapleStream::resync(const uint8_t* data, int len, bool continues, int maxShifts) {
+    auto accept = [&](const uint8_t iv[4], int shifts, const uint8_t* carried, int carriedLen) {
+        aes_->setIV(iv);
+        if (static_cast<int>(buffer_.size()) < carriedLen) buffer_.resize(carriedLen);
+        if (carriedLen > 0) std::memcpy(buffer_.data(), carried, carriedLen);
+        cursor_ = carriedLen;
+        expectedDataSize_ = 4;
+        dead_ = false;
+        packetIndex_ += static_cast<uint64_t>(shifts);  // packets lost in the gap
+        resyncCandidates_.clear();
+        resyncCarried_.clear();
+        return true;
+    };
+
+    // A one-packet segment before this one: its second header is here
+    if (continues && len >= 4) {
+        for (const auto& c : resyncCandidates_) {
+            if (aes_->confirmHeader(data, c.next)) {
+                std::vector<uint8_t> carried = std::move(resyncCarried_);
+                return accept(c.iv, c.shifts, carried.data(), static_cast<int>(carried.size()));
+            }
+        }
+    }
+    resyncCandidates_.clear();
+    resyncCarried_.clear();
+    if (len < 4) return false;
+
+    uint8_t iv[4];
+    std::memcpy(iv, aes_->getIV(), 4);
+
+    for (int shifts = 0; shifts <= maxShifts; shifts++) {
+        // Walk the packets this IV would frame. Lengths do not depend on the IV,
+        // so only the 16-bit header checks tell candidates apart: one alone
+        // passes for a wrong IV about once per 65536, two in a row are required
+        uint8_t probe[4];
+        std::memcpy(probe, iv, 4);
+        int pos = 0;
+        int headers = 0;
+        bool framed = false;
+        while (pos + 4 <= len && aes_->confirmHeader(data + pos, probe)) {
+            int headerLength = MapleAES::getHeaderLength(data + pos);
+            int packetSize = MapleAES::getPacketLength(data + pos, len - pos);
+            if (packetSize < 0 || pos + headerLength + packetSize > len) break;
+            pos += headerLength + packetSize;
+            headers++;
+            MapleAES::nextIV(probe);
+            if (pos == len) { framed = true; break; }
+        }
+
+        if (framed && headers >= 2) return accept(iv, shifts, nullptr, 0);
+        if (framed && resyncCandidates_.size() < MAX_RESYNC_CANDIDATES) {
+            ResyncCandidate c;
+            std::memcpy(c.iv, iv, 4);
+            std::memcpy(c.next, probe, 4);
+            c.shifts = shifts;
+            resyncCandidates_.push_back(c);
+        }
+        MapleAES::nextIV(iv);
+    }
+    if (!resyncCandidates_.empty()) resyncCarried_.assign(data, data + len);
+    return false;
+}
+
 std::unordered_map<int, uint16_t> MapleStream::parseOpcodeEncryption(
     const uint8_t* data, int dataLen, int bufferSize,
     const std::string& key)
@@ -7,11 +7,13 @@
 #include <memory>
 #include <unordered_map>
 #include <string>
+#include <bitset>
 
 namespace maple {
 
 struct DecryptedPacket {
     double timestamp;
+    int64_t timestampNs = 0;       // capture time in integer ns (use for latency math)
     bool outbound;
     uint16_t opcode;
     std::vector<uint8_t> payload;  // after opcode
@@ -19,6 +21,7 @@ struct DecryptedPacket {
     uint32_t length;               // total decrypted size (opcode + payload)
     bool isHandshake = false;
     bool isDeadNotification = false;
+    bool suppressed = false;       // matched a SuppressionRules entry: payload/hexDump left empty
 
     // Session tracking
     uint32_t sessionId = 0;
@@ -30,6 +33,30 @@ struct DecryptedPacket {
     uint8_t locale = 0;
 };
 
+// Opcodes to drop right after decryption (heartbeats, movement, ...).
+// Suppressed packets are still decrypted and counted, just not materialized.
+struct SuppressionRules {
+    std::bitset<65536> inbound;
+    std::bitset<65536> outbound;
+
+    bool matches(bool isOutbound, uint16_t opcode) const {
+        return isOutbound ? outbound.test(opcode) : inbound.test(opcode);
+    }
+    bool empty() const { return inbound.none() && outbound.none(); }
+};
+
+// Everything needed to resume a MapleStream at a packet boundary
+struct StreamState {
+    uint8_t iv[4]{};
+    std::vector<uint8_t> pending;     // received but not yet decoded bytes
+    int expectedDataSize = 4;
+    bool dead = false;
+    bool opcodeEncrypted = false;
+    std::unordered_map<int, uint16_t> encryptedOpcodes;
+    uint64_t packetIndex = 0;         // packets decoded so far
+    uint64_t byteOffset = 0;          // stream bytes consumed so far (headers included)
+};
+
 class MapleStream {
 public:
     MapleStream(bool outbound, uint16_t build, uint8_t locale,
@@ -43,10 +70,33 @@ public:
 
     bool isDead() const { return dead_; }
 
+    uint64_t packetIndex() const { return packetIndex_; }
+    uint64_t byteOffset() const { return byteOffset_; }
+
+    // Snapshot / restore the IV, buffered bytes and opcode table
+    StreamState saveState() const;
+    void restoreState(const StreamState& state);
+
+    // Re-acquire IV sync after a gap in the byte stream (e.g. sniffer restart).
+    // data must start at a packet boundary; tries up to maxShifts IV steps ahead
+    // for an IV whose packets frame the data exactly. A candidate is accepted
+    // only once two headers in a row confirm with successive IVs: a segment
+    // holding one packet keeps its candidates, and the next segment (continues
+    // = it directly follows the previous call's data) must start with the
+    // second header. On success the stream holds the bytes not yet decoded
+    // (a carried segment) and continues with what follows data.
+    bool resync(const uint8_t* data, int len, bool continues = false, int maxShifts = MAX_RESYNC_SHIFTS);
+
+    static constexpr int MAX_RESYNC_SHIFTS = 1 << 16;
+    static constexpr size_t MAX_RESYNC_CANDIDATES = 64;
+
     // Opcode encryption support
     void setOpcodeEncrypted(bool v) { opcodeEncrypted_ = v; }
     void setEncryptedOpcodes(const std::unordered_map<int, uint16_t>& map) { encryptedOpcodes_ = map; }
 
+    // Optional; the rules must outlive the next tryRead call
+    void setSuppression(const SuppressionRules* rules) { suppression_ = rules; }
+
     // Parse opcode encryption packet (inbound opcode 0x46)
     // Returns mapping: encrypted_opcode -> real_opcode
     // key: 16-byte 3DES key string (empty = use default)
@@ -62,11 +112,24 @@ private:
     std::vector<uint8_t> buffer_;
     int cursor_ = 0;
     int expectedDataSize_ = 4;
+    uint64_t packetIndex_ = 0;
+    uint64_t byteOffset_ = 0;
 
     bool opcodeEncrypted_ = false;
     std::unordered_map<int, uint16_t> encryptedOpcodes_;
+    const SuppressionRules* suppression_ = nullptr;
+
+    // IVs that framed a one-packet segment, waiting for the next header
+    struct ResyncCandidate {
+        uint8_t iv[4];     // IV of the carried packet
+        uint8_t next[4];   // IV the following header must confirm with
+        int shifts;
+    };
+    std::vector<ResyncCandidate> resyncCandidates_;
+    std::vector<uint8_t> resyncCarried_;   // the segment the candidates framed
 
     static constexpr uint16_t DYNAMIC_OPCODE_BASE = 0xCC;
+    static constexpr uint16_t OPCODE_ENCRYPTION = 0x46;   // inbound; its payload is always needed
 };
 
 } // namespace maple
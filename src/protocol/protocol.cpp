@@ -1,4 +1,5 @@
 #include "protocol.h"
+#include <set>
 #include <sstream>
 #include <iomanip>
 #include <iostream>
@@ -107,10 +108,12 @@ std::vector<Packet> Protocol::process(const RawPacket& raw) {
             session->clientPort = seg.srcPort;
             sessions_[fwdKey] = session;
             session->initClientSeq(seg.seq + 1);
+            session->onSyn(raw.timestampNs);
         } else {
             // SYN-ACK (server → client)
             if (session) {
                 session->initServerSeq(seg.seq + 1);
+                session->onSynAck(raw.timestampNs);
             }
         }
         return results;
@@ -131,7 +134,12 @@ std::vector<Packet> Protocol::process(const RawPacket& raw) {
 
     // Route segment to session. Session handles:
     // TCP reassembly → handshake detection → MapleStream decryption
-    auto pkts = session->processSegment(seg, raw.timestamp);
+    session->setMetrics(metrics_);
+    if (session->isInitialized()) {
+        auto rules = suppression_.find({ session->localeVal(), session->version() });
+        session->setSuppression(rules != suppression_.end() ? rules->second : nullptr);
+    }
+    auto pkts = session->processSegment(seg, raw.timestamp, raw.timestampNs);
 
     // If session just got initialized (handshake detected), store server key too
     if (session->isInitialized() && session->serverIP != 0) {
@@ -146,11 +154,62 @@ std::vector<Packet> Protocol::process(const RawPacket& raw) {
     }
 
     for (auto& p : pkts) {
+        p.timestampNs = raw.timestampNs;
         results.push_back(std::move(p));
     }
     return results;
 }
 
+void Protocol::setSuppression(uint8_t locale, uint16_t version, const SuppressionRules& rules) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (rules.empty()) {
+        suppression_.erase({ locale, version });
+    } else {
+        suppression_[{ locale, version }] = std::make_shared<const SuppressionRules>(rules);
+    }
+}
+
+std::vector<SessionTcpStats> Protocol::tcpStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<SessionTcpStats> out;
+    std::set<const Session*> seen;
+    for (const auto& [key, session] : sessions_) {
+        if (seen.insert(session.get()).second) out.push_back(session->tcpStats());
+    }
+    return out;
+}
+
+ProtocolState Protocol::saveState() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ProtocolState state;
+    state.nextSessionId = nextSessionId_;
+
+    // Several keys can point at one session; group them
+    std::map<Session*, size_t> entryOf;
+    for (const auto& [key, session] : sessions_) {
+        auto it = entryOf.find(session.get());
+        if (it == entryOf.end()) {
+            it = entryOf.emplace(session.get(), state.sessions.size()).first;
+            state.sessions.push_back({ {}, session->saveState() });
+        }
+        state.sessions[it->second].keys.push_back(key);
+    }
+    return state;
+}
+
+void Protocol::restoreState(const ProtocolState& state, bool resyncAfterGap) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sessions_.clear();
+    nextSessionId_ = state.nextSessionId;
+    for (const auto& entry : state.sessions) {
+        auto session = Session::fromState(entry.session);
+        if (resyncAfterGap) session->expectGap();
+        for (const auto& key : entry.keys) {
+            sessions_[key] = session;
+        }
+    }
+}
+
 std::string Protocol::toHexDump(const uint8_t* data, size_t len, size_t /*maxBytes*/) {
     std::ostringstream oss;
     for (size_t i = 0; i < len; i++) {
@@ -163,7 +222,8 @@ std::string Protocol::toHexDump(const uint8_t* data, size_t len, size_t /*maxByt
 
 // --- Session ---
 
-std::vector<DecryptedPacket> Session::processSegment(const TcpSegment& seg, double timestamp) {
+std::vector<DecryptedPacket> Session::processSegment(const TcpSegment& seg, double timestamp, int64_t timestampNs) {
+    TraceSpan span("session", "processSegment");
     std::vector<DecryptedPacket> results;
     if (terminated_ || seg.payloadLen <= 0) return results;
 
@@ -226,11 +286,20 @@ std::vector<DecryptedPacket> Session::processSegment(const TcpSegment& seg, doub
     }
 
     // === After handshake: TcpReasm-based flow ===
+    if ((isFromServer ? resyncInbound_ : resyncOutbound_) && !resyncSegment(seg, isFromServer)) {
+        return results;
+    }
+
     TcpReasm& reasm = isFromServer ? serverReasm_ : clientReasm_;
-    reasm.addSegment(seg.seq, seg.payload, seg.payloadLen);
+    std::vector<uint8_t> bytes;
+    {
+        StageTimer timer(metrics_, PipelineStage::Reassembly);
+        reasm.addSegment(seg.seq, seg.payload, seg.payloadLen, timestampNs);
 
-    // holdLast=true for inbound (probe/replacement protection)
-    auto bytes = reasm.drain(isFromServer);
+        // holdLast=true for inbound (probe/replacement protection)
+        bytes = reasm.drain(isFromServer);
+    }
+    if (metrics_) metrics_->add(PipelineCounter::SegmentsReassembled);
     if (bytes.empty()) return results;
 
     MapleStream* stream = isFromServer ? inboundStream_.get() : outboundStream_.get();
@@ -239,11 +308,121 @@ std::vector<DecryptedPacket> Session::processSegment(const TcpSegment& seg, doub
     return feedStream(stream, bytes.data(), static_cast<int>(bytes.size()), timestamp);
 }
 
-std::optional<DecryptedPacket> Session::tryDetectHandshake(double timestamp) {
-    if (pendingInbound_.size() < 4) return std::nullopt;
+bool Session::resyncSegment(const TcpSegment& seg, bool isFromServer) {
+    TcpReasm& reasm = isFromServer ? serverReasm_ : clientReasm_;
+    MapleStream* stream = isFromServer ? inboundStream_.get() : outboundStream_.get();
+    bool& pending = isFromServer ? resyncInbound_ : resyncOutbound_;
 
-    const uint8_t* p = pendingInbound_.data();
-    int totalLen = static_cast<int>(pendingInbound_.size());
+    // End of everything already received in this direction (held segments included)
+    uint32_t receivedEnd = reasm.nextSeq;
+    for (const auto& [seq, data] : reasm.staged) {
+        uint32_t end = seq + static_cast<uint32_t>(data.size());
+        if (static_cast<int32_t>(end - receivedEnd) > 0) receivedEnd = end;
+    }
+
+    int32_t gap = static_cast<int32_t>(seg.seq - receivedEnd);
+    if (!stream || !reasm.initialized || gap == 0) {
+        pending = false;  // nothing was lost in this direction
+        return true;
+    }
+    if (gap < 0) return true;  // retransmit of old data, keep waiting
+
+    // A one-packet segment is confirmed by the header starting the next one
+    std::optional<uint32_t>& triedEnd = isFromServer ? resyncInboundEnd_ : resyncOutboundEnd_;
+    bool continues = triedEnd && seg.seq == *triedEnd;
+    triedEnd = seg.seq + static_cast<uint32_t>(seg.payloadLen);
+    if (stream->resync(seg.payload, seg.payloadLen, continues)) {
+        std::cout << "[Session " << sessionId_ << "] Resynced "
+                  << (isFromServer ? "inbound" : "outbound") << " stream after restart gap" << std::endl;
+        reasm.staged.clear();
+        reasm.init(seg.seq);
+        pending = false;
+        return true;
+    }
+
+    // Segment starts mid-packet or its IV is not confirmed yet: drop it (a
+    // candidate keeps its bytes) and try the next one
+    if (++resyncAttempts_ >= MAX_RESYNC_ATTEMPTS) {
+        pending = false;  // give up; the stream will desync and report dead
+    }
+    return false;
+}
+
+SessionTcpStats Session::tcpStats() const {
+    SessionTcpStats s;
+    s.sessionId = sessionId_;
+    s.rttNs = rttNs_;
+    s.inbound = serverReasm_.stats;
+    s.outbound = clientReasm_.stats;
+    return s;
+}
+
+SessionState Session::saveState() const {
+    SessionState state;
+    state.sessionId = sessionId_;
+    state.serverIP = serverIP;
+    state.serverPort = serverPort;
+    state.clientPort = clientPort;
+    state.initialized = initialized_;
+    state.terminated = terminated_;
+    state.isLoginServer = isLoginServer_;
+    state.deadNotified = deadNotified_;
+    state.version = version_;
+    state.subVersionStr = subVersionStr_;
+    state.locale = locale_;
+    state.subVersion = subVersion_;
+    state.extraCipher = extraCipher_;
+    state.serverReasm = serverReasm_;
+    state.clientReasm = clientReasm_;
+    state.pendingInbound = pendingInbound_;
+    state.pendingOutbound = pendingOutbound_;
+    state.lastServerSeqEnd = lastServerSeqEnd_;
+    state.lastClientSeqEnd = lastClientSeqEnd_;
+    if (outboundStream_) state.outbound = outboundStream_->saveState();
+    if (inboundStream_) state.inbound = inboundStream_->saveState();
+    return state;
+}
+
+std::shared_ptr<Session> Session::fromState(const SessionState& state) {
+    auto s = std::make_shared<Session>();
+    s->sessionId_ = state.sessionId;
+    s->serverIP = state.serverIP;
+    s->serverPort = state.serverPort;
+    s->clientPort = state.clientPort;
+    s->initialized_ = state.initialized;
+    s->terminated_ = state.terminated;
+    s->isLoginServer_ = state.isLoginServer;
+    s->deadNotified_ = state.deadNotified;
+    s->version_ = state.version;
+    s->subVersionStr_ = state.subVersionStr;
+    s->locale_ = state.locale;
+    s->subVersion_ = state.subVersion;
+    s->extraCipher_ = state.extraCipher;
+    s->serverReasm_ = state.serverReasm;
+    s->clientReasm_ = state.clientReasm;
+    s->pendingInbound_ = state.pendingInbound;
+    s->pendingOutbound_ = state.pendingOutbound;
+    s->lastServerSeqEnd_ = state.lastServerSeqEnd;
+    s->lastClientSeqEnd_ = state.lastClientSeqEnd;
+
+    // Streams are rebuilt from handshake parameters, then moved to the saved IV/position
+    if (state.outbound) {
+        s->outboundStream_ = std::make_unique<MapleStream>(true, s->version_, s->locale_,
+            state.outbound->iv, s->subVersion_, s->extraCipher_);
+        s->outboundStream_->restoreState(*state.outbound);
+        std::memcpy(s->sendIV_, state.outbound->iv, 4);
+    }
+    if (state.inbound) {
+        s->inboundStream_ = std::make_unique<MapleStream>(false, s->version_, s->locale_,
+            state.inbound->iv, s->subVersion_, s->extraCipher_);
+        s->inboundStream_->restoreState(*state.inbound);
+        std::memcpy(s->recvIV_, state.inbound->iv, 4);
+    }
+    return s;
+}
+
+std::optional<HandshakeInfo> Session::parseHandshake(const uint8_t* p, int totalLen) {
+    if (totalLen < 4) return std::nullopt;
 
     uint16_t size = static_cast<uint16_t>(p[0] | (p[1] << 8));
     int hsTotal = 2 + static_cast<int>(size);
@@ -251,42 +430,53 @@ std::optional<DecryptedPacket> Session::tryDetectHandshake(double timestamp) {
     // Wait until we have enough bytes
     if (totalLen < hsTotal) return std::nullopt;
 
+    HandshakeInfo hs;
+    hs.totalLength = hsTotal;
     int pos = 2;
-    uint16_t version = 0;
-    std::string patchLocation;
-    uint8_t localIV[4]{};
-    uint8_t remoteIV[4]{};
-    uint8_t serverLocale = 0;
 
     if (size > 0x10) {
         // Standard handshake
         int minRequired = 2 + 2 + 0 + 4 + 4 + 1;
         if (totalLen < pos + minRequired) return std::nullopt;
 
-        version = static_cast<uint16_t>(p[pos] | (p[pos + 1] << 8)); pos += 2;
+        hs.version = static_cast<uint16_t>(p[pos] | (p[pos + 1] << 8)); pos += 2;
 
         uint16_t strLen = static_cast<uint16_t>(p[pos] | (p[pos + 1] << 8)); pos += 2;
         if (strLen > 100 || totalLen < pos + strLen + 4 + 4 + 1) return std::nullopt;
 
-        patchLocation.assign(reinterpret_cast<const char*>(p + pos), strLen); pos += strLen;
-        std::memcpy(localIV, p + pos, 4); pos += 4;
-        std::memcpy(remoteIV, p + pos, 4); pos += 4;
-        serverLocale = p[pos]; pos += 1;
+        hs.patchLocation.assign(reinterpret_cast<const char*>(p + pos), strLen); pos += strLen;
+        std::memcpy(hs.localIV, p + pos, 4); pos += 4;
+        std::memcpy(hs.remoteIV, p + pos, 4); pos += 4;
+        hs.locale = p[pos]; pos += 1;
     } else {
         // Old/short handshake
         int minRequired = 2 + 2 + 2 + 4 + 4 + 1 + 1;
         if (totalLen < pos + minRequired) return std::nullopt;
 
-        version = static_cast<uint16_t>(p[pos] | (p[pos + 1] << 8)); pos += 2;
+        hs.version = static_cast<uint16_t>(p[pos] | (p[pos + 1] << 8)); pos += 2;
         pos += 2; // skip
         uint16_t patchVal = static_cast<uint16_t>(p[pos] | (p[pos + 1] << 8)); pos += 2;
-        patchLocation = std::to_string(patchVal + 1);
-        std::memcpy(localIV, p + pos, 4); pos += 4;
-        std::memcpy(remoteIV, p + pos, 4); pos += 4;
-        serverLocale = p[pos]; pos += 1;
+        hs.patchLocation = std::to_string(patchVal + 1);
+        std::memcpy(hs.localIV, p + pos, 4); pos += 4;
+        std::memcpy(hs.remoteIV, p + pos, 4); pos += 4;
+        hs.locale = p[pos]; pos += 1;
     }
 
-    if (serverLocale > 0x12 || serverLocale == 0) return std::nullopt;
+    if (hs.locale > 0x12 || hs.locale == 0) return std::nullopt;
+    return hs;
+}
+
+std::optional<DecryptedPacket> Session::tryDetectHandshake(double timestamp) {
+    const uint8_t* p = pendingInbound_.data();
+    auto parsed = parseHandshake(p, static_cast<int>(pendingInbound_.size()));
+    if (!parsed.has_value()) return std::nullopt;
+
+    int hsTotal = parsed->totalLength;
+    uint16_t version = parsed->version;
+    const std::string& patchLocation = parsed->patchLocation;
+    const uint8_t* localIV = parsed->localIV;
+    const uint8_t* remoteIV = parsed->remoteIV;
+    uint8_t serverLocale = parsed->locale;
 
     // Handshake parsed successfully
     version_ = version;
@@ -308,6 +498,8 @@ std::optional<DecryptedPacket> Session::tryDetectHandshake(double timestamp) {
     }
 
     isLoginServer_ = (serverPort == LOGIN_PORT);
+    subVersion_ = subVersion;
+    extraCipher_ = extraCipher;
     std::memcpy(sendIV_, localIV, 4);
     std::memcpy(recvIV_, remoteIV, 4);
 
@@ -340,10 +532,18 @@ std::vector<DecryptedPacket> Session::feedStream(MapleStream* stream, const uint
     if (!stream || len <= 0) return results;
 
     stream->append(data, len);
+    stream->setSuppression(suppression_.get());
 
     while (true) {
+        uint64_t readStart = metrics_ ? monotonicNs() : 0;
         auto pkt = stream->tryRead(timestamp);
         if (!pkt.has_value()) break;
+        if (metrics_) {
+            metrics_->record(PipelineStage::Decrypt, monotonicNs() - readStart);
+            metrics_->add(PipelineCounter::PacketsDecoded);
+            metrics_->add(PipelineCounter::BytesDecoded, pkt->length);
+            if (pkt->suppressed) metrics_->add(PipelineCounter::PacketsSuppressed);
+        }
 
         // Propagate opcode encryption from inbound to outbound
         if (!pkt->outbound && pkt->opcode == 0x46) {
@@ -3,9 +3,12 @@
 #include "../capture/capture.h"
 #include "maple_stream.h"
 #include "tcp_reasm.h"
+#include "../metrics/pipeline_metrics.h"
+#include "../metrics/trace.h"
 #include <string>
 #include <vector>
 #include <map>
+#include <optional>
 #include <memory>
 #include <cstdint>
 #include <tuple>
@@ -48,12 +51,59 @@ struct TcpSegment {
     bool rst;
 };
 
+// Fields parsed from the server hello that opens every MapleStory connection
+struct HandshakeInfo {
+    uint16_t version = 0;
+    std::string patchLocation;
+    uint8_t localIV[4]{};
+    uint8_t remoteIV[4]{};
+    uint8_t locale = 0;
+    int totalLength = 0;   // bytes consumed, including the 2-byte size prefix
+};
+
+// Serializable snapshot of a Session (see Session::saveState)
+struct SessionState {
+    uint32_t sessionId = 0;
+    uint32_t serverIP = 0;
+    uint16_t serverPort = 0;
+    uint16_t clientPort = 0;
+
+    bool initialized = false;
+    bool terminated = false;
+    bool isLoginServer = false;
+    bool deadNotified = false;
+
+    uint16_t version = 0;
+    std::string subVersionStr;
+    uint8_t locale = 0;
+    uint8_t subVersion = 1;
+    bool extraCipher = false;
+
+    TcpReasm serverReasm;
+    TcpReasm clientReasm;
+    std::vector<uint8_t> pendingInbound;
+    std::vector<uint8_t> pendingOutbound;
+    uint32_t lastServerSeqEnd = 0;
+    uint32_t lastClientSeqEnd = 0;
+
+    std::optional<StreamState> outbound;
+    std::optional<StreamState> inbound;
+};
+
+// Network quality of one connection, per direction
+struct SessionTcpStats {
+    uint32_t sessionId = 0;
+    int64_t rttNs = -1;     // SYN -> SYN-ACK, -1 if the setup was not captured
+    TcpStats inbound;
+    TcpStats outbound;
+};
+
 // Session tracks a MapleStory connection (bidirectional)
 class Session {
 public:
     // Process a TCP segment through reassembly → protocol parsing → decrypt
     // Returns decoded packets (may be 0 or more)
-    std::vector<DecryptedPacket> processSegment(const TcpSegment& seg, double timestamp);
+    std::vector<DecryptedPacket> processSegment(const TcpSegment& seg, double timestamp, int64_t timestampNs = 0);
 
     bool isInitialized() const { return initialized_; }
     bool isTerminated() const { return terminated_; }
@@ -63,6 +113,29 @@ public:
     void initClientSeq(uint32_t seq) { clientReasm_.init(seq); }
     void initServerSeq(uint32_t seq) { serverReasm_.init(seq); }
 
+    // Connection setup timing: RTT from the last SYN to the SYN-ACK
+    void onSyn(int64_t timestampNs) { synNs_ = timestampNs; }
+    void onSynAck(int64_t timestampNs) {
+        if (synNs_ > 0 && timestampNs >= synNs_) rttNs_ = timestampNs - synNs_;
+    }
+
+    SessionTcpStats tcpStats() const;
+
+    // Snapshot everything needed to continue decoding this connection later
+    SessionState saveState() const;
+    static std::shared_ptr<Session> fromState(const SessionState& state);
+
+    // Expect lost bytes before the next segment of each direction (restored
+    // after a restart): the first segment re-acquires the IV via MapleStream::resync
+    void expectGap() { resyncInbound_ = resyncOutbound_ = true; }
+
+    void setMetrics(PipelineMetrics* metrics) { metrics_ = metrics; }
+    void setSuppression(std::shared_ptr<const SuppressionRules> rules) { suppression_ = std::move(rules); }
+
+    // Parse a handshake from the start of a server → client byte stream.
+    // Returns nullopt if the bytes are incomplete or not a valid handshake.
+    static std::optional<HandshakeInfo> parseHandshake(const uint8_t* data, int len);
+
     // Accessors for handshake info
     uint16_t version() const { return version_; }
     const std::string& subVersionStr() const { return subVersionStr_; }
@@ -83,10 +156,21 @@ private:
     bool terminated_ = false;
     bool isLoginServer_ = false;
     bool deadNotified_ = false;
+    bool resyncInbound_ = false;
+    bool resyncOutbound_ = false;
+    int resyncAttempts_ = 0;
+    std::optional<uint32_t> resyncInboundEnd_;   // end of the last segment offered to resync
+    std::optional<uint32_t> resyncOutboundEnd_;
+    PipelineMetrics* metrics_ = nullptr;   // set by Protocol for live sessions
+    std::shared_ptr<const SuppressionRules> suppression_;
+    int64_t synNs_ = 0;
+    int64_t rttNs_ = -1;
 
     uint16_t version_ = 0;
     std::string subVersionStr_;
     uint8_t locale_ = 0;
+    uint8_t subVersion_ = 1;
+    bool extraCipher_ = false;
     uint8_t sendIV_[4]{};
     uint8_t recvIV_[4]{};
 
@@ -104,6 +188,12 @@ private:
     std::unique_ptr<MapleStream> outboundStream_;
     std::unique_ptr<MapleStream> inboundStream_;
 
+    // Handle a post-handshake segment while a gap is expected.
+    // Returns false if the segment must be dropped.
+    bool resyncSegment(const TcpSegment& seg, bool isFromServer);
+
+    static constexpr int MAX_RESYNC_ATTEMPTS = 256;
+
     // Try to detect handshake from accumulated inbound bytes
     // Returns handshake packet if detected, or nullopt
     std::optional<DecryptedPacket> tryDetectHandshake(double timestamp);
@@ -112,6 +202,16 @@ private:
     std::vector<DecryptedPacket> feedStream(MapleStream* stream, const uint8_t* data, int len, double timestamp);
 };
 
+// Serializable snapshot of all tracked connections (see Protocol::saveState)
+struct ProtocolState {
+    struct Entry {
+        std::vector<ConnectionKey> keys;  // every key mapped to this session
+        SessionState session;
+    };
+    uint32_t nextSessionId = 1;
+    std::vector<Entry> sessions;
+};
+
 // Stateful protocol analyzer
 class Protocol {
 public:
@@ -119,14 +219,32 @@ public:
 
     std::vector<Packet> process(const RawPacket& raw);
 
+    // Snapshot / replace all session state (checkpoints, restart persistence).
+    // resyncAfterGap: traffic was missed since the snapshot (sniffer restart)
+    ProtocolState saveState();
+    void restoreState(const ProtocolState& state, bool resyncAfterGap = false);
+
     static std::string toHexDump(const uint8_t* data, size_t len, size_t maxBytes = 128);
 
-private:
+    // Per-session TCP quality counters of every tracked session
+    std::vector<SessionTcpStats> tcpStats();
+
+    // Optional live metrics (reassembly/decrypt timing, decode counters)
+    void setMetrics(PipelineMetrics* metrics) { metrics_ = metrics; }
+
+    // Opcodes dropped right after decryption for sessions of locale/version.
+    // Matching packets come back with suppressed=true and no payload/hexDump.
+    void setSuppression(uint8_t locale, uint16_t version, const SuppressionRules& rules);
+
+    // Parse an Ethernet/IPv4/TCP frame. Payload pointer refers into data.
     static bool parseTcp(const uint8_t* data, int len, TcpSegment& seg);
 
+private:
     std::map<ConnectionKey, std::shared_ptr<Session>> sessions_;
     std::mutex mutex_;
     uint32_t nextSessionId_ = 1;
+    PipelineMetrics* metrics_ = nullptr;
+    std::map<std::pair<uint8_t, uint16_t>, std::shared_ptr<const SuppressionRules>> suppression_;
 };
 
 } // namespace maple
@@ -0,0 +1,169 @@
+#include "state_io.h"
+
+namespace maple {
+
+// Sanity bounds so a corrupt file cannot make us allocate gigabytes
+static constexpr uint32_t MAX_STAGED_SEGMENTS = 4096;
+static constexpr uint32_t MAX_OPCODE_ENTRIES = 65536;
+static constexpr uint32_t MAX_SESSIONS = 65536;
+static constexpr uint32_t MAX_KEYS_PER_SESSION = 16;
+
+static void writeReasm(BinaryWriter& w, const TcpReasm& r) {
+    w.u32(r.nextSeq);
+    w.u8(r.initialized ? 1 : 0);
+    w.u32(static_cast<uint32_t>(r.staged.size()));
+    for (const auto& [seq, data] : r.staged) {
+        w.u32(seq);
+        w.bytes(data);
+    }
+}
+
+static bool readReasm(BinaryReader& r, TcpReasm& reasm) {
+    reasm.nextSeq = r.u32();
+    reasm.initialized = r.u8() != 0;
+    reasm.staged.clear();
+    uint32_t count = r.u32();
+    if (count > MAX_STAGED_SEGMENTS) return false;
+    for (uint32_t i = 0; i < count && r.ok(); i++) {
+        uint32_t seq = r.u32();
+        reasm.staged[seq] = r.bytes();
+    }
+    return r.ok();
+}
+
+void writeStreamState(BinaryWriter& w, const StreamState& s) {
+    w.raw(s.iv, 4);
+    w.bytes(s.pending);
+    w.u32(static_cast<uint32_t>(s.expectedDataSize));
+    w.u8(s.dead ? 1 : 0);
+    w.u8(s.opcodeEncrypted ? 1 : 0);
+    w.u32(static_cast<uint32_t>(s.encryptedOpcodes.size()));
+    for (const auto& [enc, real] : s.encryptedOpcodes) {
+        w.u32(static_cast<uint32_t>(enc));
+        w.u16(real);
+    }
+    w.u64(s.packetIndex);
+    w.u64(s.byteOffset);
+}
+
+bool readStreamState(BinaryReader& r, StreamState& s) {
+    r.raw(s.iv, 4);
+    s.pending = r.bytes();
+    s.expectedDataSize = static_cast<int>(r.u32());
+    s.dead = r.u8() != 0;
+    s.opcodeEncrypted = r.u8() != 0;
+    uint32_t count = r.u32();
+    if (count > MAX_OPCODE_ENTRIES) return false;
+    s.encryptedOpcodes.clear();
+    for (uint32_t i = 0; i < count && r.ok(); i++) {
+        int enc = static_cast<int>(r.u32());
+        s.encryptedOpcodes[enc] = r.u16();
+    }
+    s.packetIndex = r.u64();
+    s.byteOffset = r.u64();
+    return r.ok();
+}
+
+void writeSessionState(BinaryWriter& w, const SessionState& s) {
+    w.u32(s.sessionId);
+    w.u32(s.serverIP);
+    w.u16(s.serverPort);
+    w.u16(s.clientPort);
+    uint8_t flags = (s.initialized ? 0x01 : 0) | (s.terminated ? 0x02 : 0) |
+                    (s.isLoginServer ? 0x04 : 0) | (s.deadNotified ? 0x08 : 0) |
+                    (s.extraCipher ? 0x10 : 0);
+    w.u8(flags);
+    w.u16(s.version);
+    w.str(s.subVersionStr);
+    w.u8(s.locale);
+    w.u8(s.subVersion);
+
+    writeReasm(w, s.serverReasm);
+    writeReasm(w, s.clientReasm);
+    w.bytes(s.pendingInbound);
+    w.bytes(s.pendingOutbound);
+    w.u32(s.lastServerSeqEnd);
+    w.u32(s.lastClientSeqEnd);
+
+    w.u8(s.outbound.has_value() ? 1 : 0);
+    if (s.outbound) writeStreamState(w, *s.outbound);
+    w.u8(s.inbound.has_value() ? 1 : 0);
+    if (s.inbound) writeStreamState(w, *s.inbound);
+}
+
+bool readSessionState(BinaryReader& r, SessionState& s) {
+    s.sessionId = r.u32();
+    s.serverIP = r.u32();
+    s.serverPort = r.u16();
+    s.clientPort = r.u16();
+    uint8_t flags = r.u8();
+    s.initialized = (flags & 0x01) != 0;
+    s.terminated = (flags & 0x02) != 0;
+    s.isLoginServer = (flags & 0x04) != 0;
+    s.deadNotified = (flags & 0x08) != 0;
+    s.extraCipher = (flags & 0x10) != 0;
+    s.version = r.u16();
+    s.subVersionStr = r.str(256);
+    s.locale = r.u8();
+    s.subVersion = r.u8();
+
+    if (!readReasm(r, s.serverReasm) || !readReasm(r, s.clientReasm)) return false;
+    s.pendingInbound = r.bytes();
+    s.pendingOutbound = r.bytes();
+    s.lastServerSeqEnd = r.u32();
+    s.lastClientSeqEnd = r.u32();
+
+    s.outbound.reset();
+    if (r.u8() != 0) {
+        StreamState st;
+        if (!readStreamState(r, st)) return false;
+        s.outbound = std::move(st);
+    }
+    s.inbound.reset();
+    if (r.u8() != 0) {
+        StreamState st;
+        if (!readStreamState(r, st)) return false;
+        s.inbound = std::move(st);
+    }
+    return r.ok();
+}
+
+void writeProtocolState(BinaryWriter& w, const ProtocolState& s) {
+    w.u32(s.nextSessionId);
+    w.u32(static_cast<uint32_t>(s.sessions.size()));
+    for (const auto& entry : s.sessions) {
+        w.u32(static_cast<uint32_t>(entry.keys.size()));
+        for (const auto& key : entry.keys) {
+            w.u32(key.srcIP);
+            w.u32(key.dstIP);
+            w.u16(key.srcPort);
+            w.u16(key.dstPort);
+        }
+        writeSessionState(w, entry.session);
+    }
+}
+
+bool readProtocolState(BinaryReader& r, ProtocolState& s) {
+    s.nextSessionId = r.u32();
+    uint32_t count = r.u32();
+    if (count > MAX_SESSIONS) return false;
+    s.sessions.clear();
+    for (uint32_t i = 0; i < count && r.ok(); i++) {
+        ProtocolState::Entry entry;
+        uint32_t keyCount = r.u32();
+        if (keyCount > MAX_KEYS_PER_SESSION) return false;
+        for (uint32_t k = 0; k < keyCount; k++) {
+            ConnectionKey key;
+            key.srcIP = r.u32();
+            key.dstIP = r.u32();
+            key.srcPort = r.u16();
+            key.dstPort = r.u16();
+            entry.keys.push_back(key);
+        }
+        if (!readSessionState(r, entry.session)) return false;
+        s.sessions.push_back(std::move(entry));
+    }
+    return r.ok();
+}
+
+} // namespace maple
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "protocol.h"
+#include "../util/binary_io.h"
+
+namespace maple {
+
+// Binary (de)serialization of decoder state, shared by recording checkpoints
+// and restart persistence. Readers return false on truncated/corrupt input.
+void writeStreamState(BinaryWriter& w, const StreamState& s);
+bool readStreamState(BinaryReader& r, StreamState& s);
+
+void writeSessionState(BinaryWriter& w, const SessionState& s);
+bool readSessionState(BinaryReader& r, SessionState& s);
+
+void writeProtocolState(BinaryWriter& w, const ProtocolState& s);
+bool readProtocolState(BinaryReader& r, ProtocolState& s);
+
+} // namespace maple
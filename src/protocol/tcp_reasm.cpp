@@ -1,13 +1,65 @@
 #include "tcp_reasm.h"
+#include <algorithm>
 
 namespace maple {
 
-void TcpReasm::addSegment(uint32_t seq, const uint8_t* data, int len) {
+void TcpReasm::recordStats(uint32_t seq, int len, int64_t timestampNs) {
+    lastNs_ = timestampNs;
+    stats.segments++;
+    stats.bytes += static_cast<uint64_t>(len);
+
+    size_t bucket = 0;
+    while (bucket < TcpStats::SIZE_LIMITS.size() && static_cast<uint32_t>(len) > TcpStats::SIZE_LIMITS[bucket]) bucket++;
+    stats.sizeBuckets[bucket]++;
+
+    uint32_t end = seq + static_cast<uint32_t>(len);
+    if (!haveHigh_) {
+        // First segment, or state restored from a checkpoint
+        highSeq_ = initialized ? nextSeq : seq;
+        for (const auto& [s, data] : staged) {
+            uint32_t e = s + static_cast<uint32_t>(data.size());
+            if (static_cast<int32_t>(e - highSeq_) > 0) highSeq_ = e;
+        }
+        haveHigh_ = true;
+    }
+
+    if (static_cast<int32_t>(seq - highSeq_) > 0) {
+        // Skipped ahead of data we have not seen yet
+        stats.outOfOrderSegments++;
+        if (!holeOpen_) {
+            holeOpen_ = true;
+            holeStartNs_ = timestampNs;
+        }
+    }
+
+    // Bytes we already had: delivered ones below nextSeq plus staged overlap
+    uint64_t seen = 0;
+    if (initialized && static_cast<int32_t>(nextSeq - seq) > 0) {
+        seen = std::min<uint64_t>(static_cast<uint32_t>(nextSeq - seq), static_cast<uint64_t>(len));
+    }
+    uint32_t from = seen ? seq + static_cast<uint32_t>(seen) : seq;
+    for (const auto& [s, data] : staged) {
+        uint32_t e = s + static_cast<uint32_t>(data.size());
+        uint32_t lo = static_cast<int32_t>(s - from) > 0 ? s : from;
+        uint32_t hi = static_cast<int32_t>(e - end) < 0 ? e : end;
+        if (static_cast<int32_t>(hi - lo) > 0) seen += hi - lo;
+    }
+    stats.retransmittedBytes += std::min<uint64_t>(seen, static_cast<uint64_t>(len));
+
+    if (static_cast<int32_t>(end - highSeq_) > 0) highSeq_ = end;
+}
+
+void TcpReasm::addSegment(uint32_t seq, const uint8_t* data, int len, int64_t timestampNs) {
     if (len <= 0) return;
     if (!initialized) { initialized = true; nextSeq = seq; }
 
+    recordStats(seq, len, timestampNs);
+
     // Insert or replace (keep the longer segment at the same seq)
     auto it = staged.find(seq);
+    if (it != staged.end() && static_cast<int>(it->second.size()) < len) {
+        stats.replacements++;
+    }
     if (it == staged.end() || static_cast<int>(it->second.size()) < len) {
         staged[seq].assign(data, data + len);
     }
@@ -50,6 +102,21 @@ std::vector<uint8_t> TcpReasm::drain(bool holdLast) {
         staged.erase(next);
     }
 
+    // Hole filled once nothing staged lies beyond the delivery point
+    if (holeOpen_) {
+        bool gapLeft = false;
+        for (const auto& [s, data] : staged) {
+            if (static_cast<int32_t>(s - nextSeq) > 0) { gapLeft = true; break; }
+        }
+        if (!gapLeft) {
+            holeOpen_ = false;
+            int64_t duration = std::max<int64_t>(lastNs_ - holeStartNs_, 0);
+            stats.holes++;
+            stats.holeTotalNs += duration;
+            stats.holeMaxNs = std::max(stats.holeMaxNs, duration);
+        }
+    }
+
     return result;
 }
 
@@ -1,11 +1,28 @@
 #pragma once
 
+#include <array>
 #include <cstdint>
 #include <map>
 #include <vector>
 
 namespace maple {
 
+// Network quality counters for one direction of a connection
+struct TcpStats {
+    // Segment payload size distribution: <=64, <=128, <=256, <=512, <=1024, <=1460, <=4096, larger
+    static constexpr std::array<uint32_t, 7> SIZE_LIMITS = { 64, 128, 256, 512, 1024, 1460, 4096 };
+
+    uint64_t segments = 0;
+    uint64_t bytes = 0;                // payload bytes on the wire, retransmits included
+    uint64_t retransmittedBytes = 0;   // bytes we had already received
+    uint64_t outOfOrderSegments = 0;   // arrived beyond a hole in the sequence space
+    uint64_t replacements = 0;         // same seq resent with more data
+    uint64_t holes = 0;                // holes that were later filled
+    int64_t holeTotalNs = 0;           // time from hole opening to fill, summed
+    int64_t holeMaxNs = 0;
+    std::array<uint64_t, SIZE_LIMITS.size() + 1> sizeBuckets{};
+};
+
 // TCP reassembly buffer (per direction)
 // Handles retransmit, out-of-order, and segment replacement.
 // Uses one-segment hold: the newest segment stays pending until the next arrives,
@@ -15,14 +32,27 @@ struct TcpReasm {
     bool initialized = false;
     std::map<uint32_t, std::vector<uint8_t>> staged;
 
+    TcpStats stats;
+
     void init(uint32_t seq) { nextSeq = seq; initialized = true; }
 
-    // Add a TCP segment to staging (replace if same seq and longer)
-    void addSegment(uint32_t seq, const uint8_t* data, int len);
+    // Add a TCP segment to staging (replace if same seq and longer).
+    // timestampNs only feeds hole-duration statistics.
+    void addSegment(uint32_t seq, const uint8_t* data, int len, int64_t timestampNs = 0);
 
     // Drain in-order bytes from staging.
     // If holdLast=true, keep the newest segment pending (for replacement protection).
     std::vector<uint8_t> drain(bool holdLast);
+
+private:
+    void recordStats(uint32_t seq, int len, int64_t timestampNs);
+
+    // Statistics state (not part of the reassembly state)
+    uint32_t highSeq_ = 0;        // end of the highest byte received
+    bool haveHigh_ = false;
+    bool holeOpen_ = false;
+    int64_t holeStartNs_ = 0;
+    int64_t lastNs_ = 0;
 };
 
 } // namespace maple
@@ -0,0 +1,465 @@
+#include "script_runner.h"
+#include "../metrics/trace.h"
+#include <quickjs.h>
+#include <chrono>
+#include <cstdio>
+#include <unordered_map>
+
+namespace maple {
+
+namespace {
+
+// One QuickJS runtime + context per thread, with a single `packet` object whose
+// methods read from the payload currently being parsed
+class JsEngine {
+public:
+    explicit JsEngine(size_t memoryLimit) {
+        rt_ = JS_NewRuntime();
+        JS_SetMemoryLimit(rt_, memoryLimit);
+        JS_SetMaxStackSize(rt_, 256 << 10);   // well inside a default 1 MiB thread stack
+        JS_SetInterruptHandler(rt_, &JsEngine::interrupt, this);
+        ctx_ = JS_NewContext(rt_);
+        JS_SetContextOpaque(ctx_, this);
+
+        packet_ = JS_NewObject(ctx_);
+        auto method = [&](const char* name, JSCFunction* fn, int args) {
+            JS_SetPropertyStr(ctx_, packet_, name, JS_NewCFunction(ctx_, fn, name, args));
+        };
+        method("readByte", &JsEngine::readByte, 1);
+        method("readShort", &JsEngine::readShort, 1);
+        method("readInt", &JsEngine::readInt, 1);
+        method("readLong", &JsEngine::readLong, 1);
+        method("readString", &JsEngine::readString, 2);
+        method("readMapleString", &JsEngine::readMapleString, 1);
+        method("readFileTime", &JsEngine::readFileTime, 1);
+        method("_readBytes", &JsEngine::readBytes, 2);
+        method("readObject", &JsEngine::readObject, 2);
+        method("readArray", &JsEngine::readArray, 3);
+        method("skip", &JsEngine::skip, 2);
+        method("remaining", &JsEngine::remaining, 0);
+        method("position", &JsEngine::position, 0);
+
+        // readBytes returns a Uint8Array like the webview reader
+        static const char PRELUDE[] =
+            "(function (packet) {\n"
+            "  packet.readBytes = function (name, len) { return new Uint8Array(packet._readBytes(name, len)) }\n"
+            "})";
+        JSValue prelude = JS_Eval(ctx_, PRELUDE, sizeof(PRELUDE) - 1, "<prelude>", JS_EVAL_TYPE_GLOBAL);
+        if (!JS_IsException(prelude)) {
+            JSValue r = JS_Call(ctx_, prelude, JS_UNDEFINED, 1, &packet_);
+            JS_FreeValue(ctx_, r);
+        }
+        JS_FreeValue(ctx_, prelude);
+    }
+
+    ~JsEngine() {
+        for (auto& [key, fn] : functions_) JS_FreeValue(ctx_, fn.value);
+        JS_FreeValue(ctx_, packet_);
+        JS_FreeContext(ctx_);
+        JS_FreeRuntime(rt_);
+    }
+
+    JsEngine(const JsEngine&) = delete;
+    JsEngine& operator=(const JsEngine&) = delete;
+
+    // Compile the script wrapped as `(function (packet) { ... })` to bytecode
+    bool compile(const std::string& code, std::vector<uint8_t>& bytecode, std::string& error) {
+        std::string source = "(function (packet) {\n" + code + "\n})";
+        JSValue obj = JS_Eval(ctx_, source.c_str(), source.size(), "<script>",
+                              JS_EVAL_TYPE_GLOBAL | JS_EVAL_FLAG_COMPILE_ONLY);
+        if (JS_IsException(obj)) {
+            error = takeException();
+            return false;
+        }
+        size_t size = 0;
+        uint8_t* buf = JS_WriteObject(ctx_, &size, obj, JS_WRITE_OBJ_BYTECODE);
+        JS_FreeValue(ctx_, obj);
+        if (!buf) {
+            error = "bytecode serialization failed";
+            return false;
+        }
+        bytecode.assign(buf, buf + size);
+        js_free(ctx_, buf);
+        return true;
+    }
+
+    // The script function for this compiled generation, loaded once per thread
+    bool function(const std::string& key, const ScriptRunner::Compiled& compiled, JSValue& out, std::string& error) {
+        auto it = functions_.find(key);
+        if (it != functions_.end() && it->second.generation == compiled.generation) {
+            out = it->second.value;
+            return true;
+        }
+        if (it != functions_.end()) {
+            JS_FreeValue(ctx_, it->second.value);
+            functions_.erase(it);
+        }
+
+        JSValue obj = JS_ReadObject(ctx_, compiled.bytecode.data(), compiled.bytecode.size(), JS_READ_OBJ_BYTECODE);
+        if (JS_IsException(obj)) {
+            error = takeException();
+            return false;
+        }
+        JSValue fn = JS_EvalFunction(ctx_, obj);   // frees obj
+        if (JS_IsException(fn)) {
+            error = takeException();
+            return false;
+        }
+        functions_[key] = { compiled.generation, fn };
+        out = fn;
+        return true;
+    }
+
+    void run(JSValue fn, std::span<const uint8_t> payload, uint32_t timeoutMs, ScriptResult& result) {
+        data_ = payload.data();
+        size_ = payload.size();
+        pos_ = 0;
+        result.fields.clear();
+        stack_.assign(1, &result.fields);
+        deadline_ = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+        timedOut_ = false;
+
+        JSValue r = JS_Call(ctx_, fn, JS_UNDEFINED, 1, &packet_);
+        deadline_ = NO_DEADLINE;
+        if (JS_IsException(r)) {
+            result.success = false;
+            result.error = timedOut_ ? "Script timed out" : takeException();
+        } else {
+            result.success = true;
+        }
+        JS_FreeValue(ctx_, r);
+        stack_.clear();
+    }
+
+private:
+    struct Function {
+        uint64_t generation;
+        JSValue value;
+    };
+
+    static JsEngine& self(JSContext* ctx) { return *static_cast<JsEngine*>(JS_GetContextOpaque(ctx)); }
+
+    static int interrupt(JSRuntime*, void* opaque) {
+        auto* e = static_cast<JsEngine*>(opaque);
+        if (std::chrono::steady_clock::now() < e->deadline_) return 0;
+        e->timedOut_ = true;
+        return 1;
+    }
+
+    std::string takeException() {
+        JSValue exc = JS_GetException(ctx_);
+        JSValue message = JS_GetPropertyStr(ctx_, exc, "message");
+        const char* str = JS_ToCString(ctx_, JS_IsUndefined(message) ? exc : message);
+        std::string text = str ? str : "Unknown error";
+        if (str) JS_FreeCString(ctx_, str);
+        JS_FreeValue(ctx_, message);
+        JS_FreeValue(ctx_, exc);
+        return text;
+    }
+
+    // Reader helpers (mirror PacketReader in packet-reader.ts)
+    bool ensure(size_t n) {
+        if (pos_ + n <= size_) return true;
+        JS_ThrowRangeError(ctx_, "Read past end: need %u bytes at offset %u, but only %u remaining",
+                           static_cast<unsigned>(n), static_cast<unsigned>(pos_), static_cast<unsigned>(size_ - pos_));
+        return false;
+    }
+
+    uint64_t le(size_t width) const {
+        uint64_t v = 0;
+        for (size_t i = 0; i < width; i++) v |= static_cast<uint64_t>(data_[pos_ + i]) << (8 * i);
+        return v;
+    }
+
+    std::string argName(int argc, JSValueConst* argv) {
+        if (argc < 1) return "";
+        const char* s = JS_ToCString(ctx_, argv[0]);
+        std::string name = s ? s : "";
+        if (s) JS_FreeCString(ctx_, s);
+        return name;
+    }
+
+    bool argLength(int argc, JSValueConst* argv, int index, int32_t& out) {
+        if (argc <= index) {
+            JS_ThrowTypeError(ctx_, "Missing length");
+            return false;
+        }
+        if (JS_ToInt32(ctx_, &out, argv[index]) < 0) return false;
+        if (out < 0) {
+            JS_ThrowRangeError(ctx_, "Negative length %d", out);
+            return false;
+        }
+        return true;
+    }
+
+    ParsedField& add(std::string name, const char* type, uint32_t offset, uint32_t length) {
+        ParsedField f;
+        f.name = std::move(name);
+        f.type = type;
+        f.offset = offset;
+        f.length = length;
+        stack_.back()->push_back(std::move(f));
+        return stack_.back()->back();
+    }
+
+    std::string hex(size_t offset, size_t len) const {
+        static const char DIGITS[] = "0123456789ABCDEF";
+        std::string s;
+        s.reserve(len * 3);
+        for (size_t i = 0; i < len; i++) {
+            if (i) s += ' ';
+            s += DIGITS[data_[offset + i] >> 4];
+            s += DIGITS[data_[offset + i] & 0xF];
+        }
+        return s;
+    }
+
+    JSValue readInteger(int argc, JSValueConst* argv, size_t width, const char* type) {
+        if (!ensure(width)) return JS_EXCEPTION;
+        uint32_t offset = static_cast<uint32_t>(pos_);
+        uint64_t v = le(width);
+        pos_ += width;
+        ParsedField& f = add(argName(argc, argv), type, offset, static_cast<uint32_t>(width));
+        f.kind = ParsedField::ValueKind::Number;
+        f.number = static_cast<double>(v);
+        return JS_NewUint32(ctx_, static_cast<uint32_t>(v));
+    }
+
+    static JSValue readByte(JSContext* ctx, JSValueConst, int argc, JSValueConst* argv) {
+        return self(ctx).readInteger(argc, argv, 1, "byte");
+    }
+    static JSValue readShort(JSContext* ctx, JSValueConst, int argc, JSValueConst* argv) {
+        return self(ctx).readInteger(argc, argv, 2, "short");
+    }
+    static JSValue readInt(JSContext* ctx, JSValueConst, int argc, JSValueConst* argv) {
+        return self(ctx).readInteger(argc, argv, 4, "int");
+    }
+
+    static JSValue readLong(JSContext* ctx, JSValueConst, int argc, JSValueConst* argv) {
+        JsEngine& e = self(ctx);
+        if (!e.ensure(8)) return JS_EXCEPTION;
+        uint32_t offset = static_cast<uint32_t>(e.pos_);
+        uint64_t v = e.le(8);
+        e.pos_ += 8;
+        ParsedField& f = e.add(e.argName(argc, argv), "long", offset, 8);
+        f.kind = ParsedField::ValueKind::Text;
+        f.text = std::to_string(v);
+        return JS_NewBigUint64(ctx, v);
+    }
+
+    JSValue text(std::string name, size_t offset, size_t headerLen, size_t len) {
+        std::string value(reinterpret_cast<const char*>(data_ + offset + headerLen), len);
+        ParsedField& f = add(std::move(name), "string", static_cast<uint32_t>(offset), static_cast<uint32_t>(headerLen + len));
+        f.kind = ParsedField::ValueKind::Text;
+        f.text = value;
+        return JS_NewStringLen(ctx_, value.data(), value.size());
+    }
+
+    static JSValue readString(JSContext* ctx, JSValueConst, int argc, JSValueConst* argv) {
+        JsEngine& e = self(ctx);
+        int32_t len = 0;
+        if (!e.argLength(argc, argv, 1, len) || !e.ensure(static_cast<size_t>(len))) return JS_EXCEPTION;
+        size_t offset = e.pos_;
+        e.pos_ += static_cast<size_t>(len);
+        return e.text(e.argName(argc, argv), offset, 0, static_cast<size_t>(len));
+    }
+
+    static JSValue readMapleString(JSContext* ctx, JSValueConst, int argc, JSValueConst* argv) {
+        JsEngine& e = self(ctx);
+        if (!e.ensure(2)) return JS_EXCEPTION;
+        size_t offset = e.pos_;
+        size_t len = e.le(2);
+        e.pos_ += 2;
+        if (!e.ensure(len)) return JS_EXCEPTION;
+        e.pos_ += len;
+        return e.text(e.argName(argc, argv), offset, 2, len);
+    }
+
+    static JSValue readFileTime(JSContext* ctx, JSValueConst, int argc, JSValueConst* argv) {
+        JsEngine& e = self(ctx);
+        if (!e.ensure(8)) return JS_EXCEPTION;
+        uint32_t offset = static_cast<uint32_t>(e.pos_);
+        uint64_t filetime = e.le(8);
+        e.pos_ += 8;
+
+        // Same display as the webview: UTC date, "(zero)" or "(special: 0x...)"
+        static constexpr int64_t FILETIME_EPOCH_DIFF_MS = 11644473600000LL;
+        int64_t epochMs = static_cast<int64_t>(filetime / 10000) - FILETIME_EPOCH_DIFF_MS;
+        char buf[64];
+        if (filetime == 0) {
+            std::snprintf(buf, sizeof(buf), "(zero)");
+        } else if (epochMs < -30610224000000LL || epochMs > 32503680000000LL) {
+            std::snprintf(buf, sizeof(buf), "(special: 0x%llX)", static_cast<unsigned long long>(filetime));
+        } else {
+            using namespace std::chrono;
+            sys_time<milliseconds> t{ milliseconds(epochMs) };
+            auto day = floor<days>(t);
+            year_month_day ymd{ day };
+            hh_mm_ss hms{ t - day };
+            int ms = static_cast<int>(hms.subseconds().count());
+            int n = std::snprintf(buf, sizeof(buf), "%04d-%02u-%02u %02d:%02d:%02d", static_cast<int>(ymd.year()),
+                                  static_cast<unsigned>(ymd.month()), static_cast<unsigned>(ymd.day()),
+                                  static_cast<int>(hms.hours().count()), static_cast<int>(hms.minutes().count()),
+                                  static_cast<int>(hms.seconds().count()));
+            if (ms != 0) std::snprintf(buf + n, sizeof(buf) - n, ".%03dZ", ms);
+        }
+        ParsedField& f = e.add(e.argName(argc, argv), "string", offset, 8);
+        f.kind = ParsedField::ValueKind::Text;
+        f.text = buf;
+        return JS_NewString(ctx, buf);
+    }
+
+    static JSValue readBytes(JSContext* ctx, JSValueConst, int argc, JSValueConst* argv) {
+        JsEngine& e = self(ctx);
+        int32_t len = 0;
+        if (!e.argLength(argc, argv, 1, len) || !e.ensure(static_cast<size_t>(len))) return JS_EXCEPTION;
+        size_t offset = e.pos_;
+        e.pos_ += static_cast<size_t>(len);
+        ParsedField& f = e.add(e.argName(argc, argv), "bytes", static_cast<uint32_t>(offset), static_cast<uint32_t>(len));
+        f.kind = ParsedField::ValueKind::Text;
+        f.text = e.hex(offset, static_cast<size_t>(len));
+        return JS_NewArrayBufferCopy(ctx, e.data_ + offset, static_cast<size_t>(len));
+    }
+
+    static JSValue skip(JSContext* ctx, JSValueConst, int argc, JSValueConst* argv) {
+        JsEngine& e = self(ctx);
+        int32_t len = 0;
+        if (!e.argLength(argc, argv, 1, len) || !e.ensure(static_cast<size_t>(len))) return JS_EXCEPTION;
+        size_t offset = e.pos_;
+        e.pos_ += static_cast<size_t>(len);
+        ParsedField& f = e.add(e.argName(argc, argv), "bytes", static_cast<uint32_t>(offset), static_cast<uint32_t>(len));
+        f.kind = ParsedField::ValueKind::Text;
+        f.text = e.hex(offset, static_cast<size_t>(len));
+        return JS_UNDEFINED;
+    }
+
+    // Run fn with the new field's children as the current field list
+    JSValue nested(std::string name, const char* type, uint32_t count, bool isArray, JSValueConst fn, uint32_t offset) {
+        std::vector<ParsedField>* parent = stack_.back();
+        ParsedField& f = add(std::move(name), type, offset, 0);
+        if (isArray) {
+            f.kind = ParsedField::ValueKind::Number;
+            f.number = count;
+        }
+        size_t index = parent->size() - 1;
+        stack_.push_back(&f.children);
+
+        JSValue result = JS_UNDEFINED;
+        uint32_t iterations = isArray ? count : 1;
+        for (uint32_t i = 0; i < iterations; i++) {
+            JSValue args[2] = { packet_, JS_NewUint32(ctx_, i) };
+            JSValue r = JS_Call(ctx_, fn, JS_UNDEFINED, isArray ? 2 : 1, args);
+            if (JS_IsException(r)) {
+                result = JS_EXCEPTION;
+                break;
+            }
+            JS_FreeValue(ctx_, r);
+        }
+        stack_.pop_back();
+        (*parent)[index].length = static_cast<uint32_t>(pos_ - offset);
+        return result;
+    }
+
+    static JSValue readObject(JSContext* ctx, JSValueConst, int argc, JSValueConst* argv) {
+        JsEngine& e = self(ctx);
+        if (argc < 2 || !JS_IsFunction(ctx, argv[1])) return JS_ThrowTypeError(ctx, "readObject needs a function");
+        return e.nested(e.argName(argc, argv), "object", 0, false, argv[1], static_cast<uint32_t>(e.pos_));
+    }
+
+    static JSValue readArray(JSContext* ctx, JSValueConst, int argc, JSValueConst* argv) {
+        JsEngine& e = self(ctx);
+        if (argc < 3 || !JS_IsFunction(ctx, argv[2])) return JS_ThrowTypeError(ctx, "readArray needs a function");
+        uint32_t offset = static_cast<uint32_t>(e.pos_);
+        int32_t count = 0;
+        if (JS_IsNull(argv[1]) || JS_IsUndefined(argv[1])) {
+            // null count: 2-byte prefix
+            if (!e.ensure(2)) return JS_EXCEPTION;
+            count = static_cast<int32_t>(e.le(2));
+            e.pos_ += 2;
+        } else if (!e.argLength(argc, argv, 1, count)) {
+            return JS_EXCEPTION;
+        }
+        std::string name = e.argName(argc, argv) + " [" + std::to_string(count) + "]";
+        return e.nested(std::move(name), "array", static_cast<uint32_t>(count), true, argv[2], offset);
+    }
+
+    static JSValue remaining(JSContext* ctx, JSValueConst, int, JSValueConst*) {
+        JsEngine& e = self(ctx);
+        return JS_NewUint32(ctx, static_cast<uint32_t>(e.size_ - e.pos_));
+    }
+
+    static JSValue position(JSContext* ctx, JSValueConst, int, JSValueConst*) {
+        return JS_NewUint32(ctx, static_cast<uint32_t>(self(ctx).pos_));
+    }
+
+    JSRuntime* rt_ = nullptr;
+    JSContext* ctx_ = nullptr;
+    JSValue packet_;
+    std::unordered_map<std::string, Function> functions_;
+
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    size_t pos_ = 0;
+    std::vector<std::vector<ParsedField>*> stack_;
+    // Only script calls are timed: the prelude, compilation and loading the
+    // wrapper function run with no deadline
+    static constexpr auto NO_DEADLINE = std::chrono::steady_clock::time_point::max();
+    std::chrono::steady_clock::time_point deadline_ = NO_DEADLINE;
+    bool timedOut_ = false;
+};
+
+// Each pool worker (and each compiling caller) keeps its engine for its lifetime
+JsEngine& threadEngine(size_t memoryLimit) {
+    thread_local std::unique_ptr<JsEngine> engine;
+    if (!engine) engine = std::make_unique<JsEngine>(memoryLimit);
+    return *engine;
+}
+
+} // namespace
+
+ScriptRunner::ScriptRunner(const Options& options) : options_(options), pool_(options.threads) {}
+
+ScriptRunner::~ScriptRunner() = default;
+
+std::shared_ptr<const ScriptRunner::Compiled> ScriptRunner::compile(const std::string& key, const std::string& code,
+                                                                    std::string& error) {
+    std::lock_guard<std::mutex> lock(cacheMutex_);
+    auto it = cache_.find(key);
+    if (it != cache_.end() && it->second->code == code) return it->second;
+
+    TraceSpan span("script", "compile");
+    auto compiled = std::make_shared<Compiled>();
+    compiled->code = code;
+    if (!threadEngine(options_.memoryLimit).compile(code, compiled->bytecode, error)) return nullptr;
+    compiled->generation = nextGeneration_++;
+    cache_[key] = compiled;
+    return compiled;
+}
+
+bool ScriptRunner::run(const std::string& key, const std::string& code,
+                       const std::vector<std::span<const uint8_t>>& payloads, std::vector<ScriptResult>& results,
+                       std::string& error) {
+    TraceSpan span("script", "run");
+    auto compiled = compile(key, code, error);
+    if (!compiled) return false;
+
+    results.assign(payloads.size(), ScriptResult{});
+    static constexpr size_t CHUNK = 64;
+    for (size_t begin = 0; begin < payloads.size(); begin += CHUNK) {
+        pool_.submit([&, begin] {
+            JsEngine& engine = threadEngine(options_.memoryLimit);
+            size_t end = std::min(payloads.size(), begin + CHUNK);
+            JSValue fn;
+            std::string loadError;
+            if (!engine.function(key, *compiled, fn, loadError)) {
+                for (size_t i = begin; i < end; i++) results[i].error = loadError;
+                return;
+            }
+            for (size_t i = begin; i < end; i++) engine.run(fn, payloads[i], options_.timeoutMs, results[i]);
+        });
+    }
+    pool_.wait();
+    return true;
+}
+
+} // namespace maple
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "../util/thread_pool.h"
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace maple {
+
+// Field produced by a parse script, same shape as ParsedField in packet-reader.ts
+struct ParsedField {
+    enum class ValueKind { Null, Number, Text };
+
+    std::string name;
+    std::string type;      // "byte" | "short" | "int" | "long" | "string" | "bytes" | "object" | "array"
+    ValueKind kind = ValueKind::Null;
+    double number = 0.0;
+    std::string text;      // longs as decimal text, bytes as hex
+    uint32_t offset = 0;
+    uint32_t length = 0;
+    std::vector<ParsedField> children;
+};
+
+struct ScriptResult {
+    bool success = false;
+    std::string error;
+    std::vector<ParsedField> fields;   // also the fields read before an error
+};
+
+// Runs the existing recv_/send_ parse scripts natively: QuickJS with a C++
+// PacketReader over the raw payload bytes, one runtime per worker thread.
+// A script is compiled once to bytecode (cached by key until its source
+// changes); every worker loads that bytecode into its own context once.
+class ScriptRunner {
+public:
+    struct Options {
+        size_t threads = 0;
+        size_t memoryLimit = 64ull << 20;   // per worker runtime
+        uint32_t timeoutMs = 200;           // per packet
+    };
+
+    ScriptRunner() : ScriptRunner(Options{}) {}
+    explicit ScriptRunner(const Options& options);
+    ~ScriptRunner();
+
+    ScriptRunner(const ScriptRunner&) = delete;
+    ScriptRunner& operator=(const ScriptRunner&) = delete;
+
+    // Run one script over every payload, results in payload order. Returns false
+    // (error set) if the script does not compile.
+    bool run(const std::string& key, const std::string& code, const std::vector<std::span<const uint8_t>>& payloads,
+             std::vector<ScriptResult>& results, std::string& error);
+
+    // Compiled bytecode shared by the workers
+    struct Compiled {
+        uint64_t generation = 0;
+        std::string code;
+        std::vector<uint8_t> bytecode;
+    };
+
+private:
+    std::shared_ptr<const Compiled> compile(const std::string& key, const std::string& code, std::string& error);
+
+    Options options_;
+    ThreadPool pool_;
+    std::mutex cacheMutex_;
+    std::map<std::string, std::shared_ptr<const Compiled>> cache_;
+    uint64_t nextGeneration_ = 1;
+};
+
+} // namespace maple
@@ -0,0 +1,95 @@
+#include "file_sink.h"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+
+namespace maple {
+
+namespace fs = std::filesystem;
+
+RotatingFile::RotatingFile(const SinkConfig& config, std::string extension, std::string fileHeader)
+    : dir_(fs::path(std::u8string(config.path.begin(), config.path.end()))),
+      prefix_(config.prefix.empty() ? "packets" : config.prefix),
+      extension_(std::move(extension)),
+      fileHeader_(std::move(fileHeader)),
+      rotateBytes_(config.rotateBytes),
+      keepFiles_(config.keepFiles) {}
+
+bool RotatingFile::rotate() {
+    file_.close();
+
+    using namespace std::chrono;
+    auto now = floor<seconds>(system_clock::now());
+    auto day = floor<days>(now);
+    year_month_day ymd{ day };
+    hh_mm_ss hms{ now - day };
+    char stem[96];
+    std::snprintf(stem, sizeof(stem), "%s-%04d%02u%02u-%02d%02d%02d-%u", prefix_.c_str(),
+                  static_cast<int>(ymd.year()), static_cast<unsigned>(ymd.month()), static_cast<unsigned>(ymd.day()),
+                  static_cast<int>(hms.hours().count()), static_cast<int>(hms.minutes().count()),
+                  static_cast<int>(hms.seconds().count()), fileIndex_++);
+
+    std::error_code ec;
+    fs::create_directories(dir_, ec);
+    fs::path path = dir_ / (stem + extension_);
+    file_.open(path, std::ios::binary | std::ios::trunc);
+    if (!file_) {
+        std::cerr << "[Sink] Could not open " << path.string() << std::endl;
+        return false;
+    }
+    file_.write(fileHeader_.data(), static_cast<std::streamsize>(fileHeader_.size()));
+    fileBytes_ = fileHeader_.size();
+
+    files_.push_back(path);
+    while (keepFiles_ && files_.size() > keepFiles_) {
+        fs::remove(files_.front(), ec);
+        files_.pop_front();
+    }
+    return true;
+}
+
+bool RotatingFile::write(const std::string& data) {
+    if (!file_.is_open() || (fileBytes_ > fileHeader_.size() && fileBytes_ + data.size() > rotateBytes_)) {
+        if (!rotate()) return false;
+    }
+    file_.write(data.data(), static_cast<std::streamsize>(data.size()));
+    fileBytes_ += data.size();
+    if (!file_) {
+        // Try a fresh file next time (disk full, file removed, ...)
+        file_.close();
+        return false;
+    }
+    return true;
+}
+
+void RotatingFile::flush() {
+    if (file_.is_open()) file_.flush();
+}
+
+// --- Sinks ---
+
+static std::string streamHeader() {
+    std::string header;
+    appendStreamHeader(header);
+    return header;
+}
+
+BinaryFileSink::BinaryFileSink(const SinkConfig& config)
+    : file_(config, ".msstream", streamHeader()) {}
+
+bool BinaryFileSink::write(const std::vector<Packet>& batch) {
+    buffer_.clear();
+    for (const auto& pkt : batch) appendRecord(buffer_, pkt, seq_++);
+    return file_.write(buffer_);
+}
+
+NdjsonFileSink::NdjsonFileSink(const SinkConfig& config)
+    : file_(config, ".ndjson", std::string()) {}
+
+bool NdjsonFileSink::write(const std::vector<Packet>& batch) {
+    buffer_.clear();
+    for (const auto& pkt : batch) appendJsonLine(buffer_, pkt);
+    return file_.write(buffer_);
+}
+
+} // namespace maple
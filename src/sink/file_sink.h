@@ -0,0 +1,60 @@
+#pragma once
+
+#include "packet_sink.h"
+#include <deque>
+#include <filesystem>
+#include <fstream>
+
+namespace maple {
+
+// Appends to <dir>/<prefix>-<time>.<ext>, starting a new file past
+// rotateBytes and deleting the oldest ones beyond keepFiles
+class RotatingFile {
+public:
+    RotatingFile(const SinkConfig& config, std::string extension, std::string fileHeader);
+
+    bool write(const std::string& data);
+    void flush();
+
+private:
+    bool rotate();
+
+    std::filesystem::path dir_;
+    std::string prefix_;
+    std::string extension_;
+    std::string fileHeader_;
+    uint64_t rotateBytes_;
+    uint32_t keepFiles_;
+
+    std::ofstream file_;
+    uint64_t fileBytes_ = 0;
+    uint32_t fileIndex_ = 0;
+    std::deque<std::filesystem::path> files_;
+};
+
+// Binary records (SINK_STREAM_MAGIC header per file), .msstream
+class BinaryFileSink : public PacketSink {
+public:
+    explicit BinaryFileSink(const SinkConfig& config);
+    bool write(const std::vector<Packet>& batch) override;
+    void flush() override { file_.flush(); }
+
+private:
+    RotatingFile file_;
+    std::string buffer_;
+    uint64_t seq_ = 0;
+};
+
+// One JSON object per line, .ndjson
+class NdjsonFileSink : public PacketSink {
+public:
+    explicit NdjsonFileSink(const SinkConfig& config);
+    bool write(const std::vector<Packet>& batch) override;
+    void flush() override { file_.flush(); }
+
+private:
+    RotatingFile file_;
+    std::string buffer_;
+};
+
+} // namespace maple
@@ -0,0 +1,260 @@
+#include "packet_sink.h"
+#include "file_sink.h"
+#include "stream_sink.h"
+#include "../../sdk/maple_ring.h"
+#include "../metrics/trace.h"
+#include <chrono>
+#include <cstring>
+
+namespace maple {
+
+void appendStreamHeader(std::string& out) {
+    out.append(SINK_STREAM_MAGIC, sizeof(SINK_STREAM_MAGIC));
+    uint32_t words[2] = { SINK_STREAM_VERSION, static_cast<uint32_t>(sizeof(maple_ring_record)) };
+    out.append(reinterpret_cast<const char*>(words), sizeof(words));
+}
+
+void appendRecord(std::string& out, const Packet& pkt, uint64_t seq) {
+    constexpr size_t HEADER = sizeof(maple_ring_record);
+    size_t payloadSize = pkt.payload.size();
+    uint32_t size = static_cast<uint32_t>((HEADER + payloadSize + 7) & ~size_t{7});
+
+    maple_ring_record rec {};
+    rec.size = size;
+    rec.payload_size = static_cast<uint32_t>(payloadSize);
+    rec.seq = seq;
+    rec.timestamp_ns = pkt.timestampNs;
+    rec.session_id = pkt.sessionId;
+    rec.opcode = pkt.opcode;
+    if (pkt.outbound) rec.flags |= MAPLE_RING_FLAG_OUTBOUND;
+    if (pkt.isHandshake) rec.flags |= MAPLE_RING_FLAG_HANDSHAKE;
+    if (pkt.isDeadNotification) rec.flags |= MAPLE_RING_FLAG_DEAD;
+    rec.locale = pkt.locale;
+    rec.version = pkt.version;
+    rec.server_port = pkt.serverPort;
+    rec.length = pkt.length;
+
+    size_t at = out.size();
+    out.resize(at + size);
+    std::memcpy(out.data() + at, &rec, HEADER);
+    if (payloadSize) std::memcpy(out.data() + at + HEADER, pkt.payload.data(), payloadSize);
+    std::memset(out.data() + at + HEADER + payloadSize, 0, size - HEADER - payloadSize);
+}
+
+void appendJsonLine(std::string& out, const Packet& pkt) {
+    static constexpr char HEX[] = "0123456789ABCDEF";
+    char buf[160];
+    int n = std::snprintf(buf, sizeof(buf),
+                          "{\"ts\":%lld,\"session\":%u,\"dir\":\"%s\",\"opcode\":%u,\"length\":%u,\"port\":%u",
+                          static_cast<long long>(pkt.timestampNs), pkt.sessionId, pkt.outbound ? "out" : "in",
+                          pkt.opcode, pkt.length, pkt.serverPort);
+    out.append(buf, static_cast<size_t>(n));
+
+    if (pkt.isHandshake) {
+        n = std::snprintf(buf, sizeof(buf), ",\"handshake\":true,\"version\":%u,\"locale\":%u,\"subVersion\":\"",
+                          pkt.version, pkt.locale);
+        out.append(buf, static_cast<size_t>(n));
+        for (char c : pkt.subVersionStr) {
+            auto u = static_cast<unsigned char>(c);
+            if (c == '"' || c == '\\') {
+                out += '\\';
+                out += c;
+            } else if (u < 0x20) {
+                out += "\\u00";
+                out += HEX[u >> 4];
+                out += HEX[u & 15];
+            } else {
+                out += c;
+            }
+        }
+        out += '"';
+    }
+    if (pkt.isDeadNotification) out += ",\"dead\":true";
+
+    out += ",\"payload\":\"";
+    size_t at = out.size();
+    out.resize(at + pkt.payload.size() * 2);
+    for (uint8_t b : pkt.payload) {
+        out[at++] = HEX[b >> 4];
+        out[at++] = HEX[b & 15];
+    }
+    out += "\"}\n";
+}
+
+std::unique_ptr<PacketSink> makeSink(const SinkConfig& config) {
+    switch (config.kind) {
+    case SinkConfig::Kind::BinaryFile:
+        return std::make_unique<BinaryFileSink>(config);
+    case SinkConfig::Kind::NdjsonFile:
+        return std::make_unique<NdjsonFileSink>(config);
+    case SinkConfig::Kind::Stream:
+        return StreamSink::create(config);
+    }
+    return nullptr;
+}
+
+// --- SinkRunner ---
+
+SinkRunner::SinkRunner(SinkConfig config, std::unique_ptr<PacketSink> sink)
+    : config_(std::move(config)), sink_(std::move(sink)) {
+    thread_ = std::jthread([this](std::stop_token stop) { run(stop); });
+}
+
+SinkRunner::~SinkRunner() {
+    thread_.request_stop();
+    sink_->interrupt();
+    if (thread_.joinable()) thread_.join();
+}
+
+void SinkRunner::offer(const PacketBatch& batch, size_t bytes) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    size_t count = batch->size();
+
+    if (stats_.queuedBytes + bytes > config_.queueBytes && !queue_.empty()) {
+        switch (config_.policy) {
+        case SinkConfig::Policy::DropOldest:
+            while (!queue_.empty() && stats_.queuedBytes + bytes > config_.queueBytes) {
+                stats_.dropped += queue_.front().first->size();
+                stats_.queuedBytes -= queue_.front().second;
+                queue_.pop_front();
+            }
+            break;
+        case SinkConfig::Policy::Block:
+            room_.wait_for(lock, std::chrono::milliseconds(config_.blockMs), [&] {
+                return queue_.empty() || stats_.queuedBytes + bytes <= config_.queueBytes;
+            });
+            if (queue_.empty() || stats_.queuedBytes + bytes <= config_.queueBytes) break;
+            [[fallthrough]];
+        case SinkConfig::Policy::DropNewest:
+            stats_.dropped += count;
+            return;
+        }
+    }
+
+    queue_.emplace_back(batch, bytes);
+    stats_.queuedBytes += bytes;
+    stats_.accepted += count;
+    lock.unlock();
+    ready_.notify_one();
+}
+
+SinkStats SinkRunner::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void SinkRunner::run(std::stop_token stop) {
+    Tracer::setThreadName("sink-" + config_.name);
+
+    // Flush when idle this long, so followers of a file see packets promptly
+    static constexpr auto FLUSH_IDLE = std::chrono::milliseconds(500);
+    bool dirty = false;
+
+    while (true) {
+        std::pair<PacketBatch, size_t> item;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            bool ready = ready_.wait_for(lock, stop, FLUSH_IDLE, [&] { return !queue_.empty(); });
+            if (!ready) {
+                if (stop.stop_requested()) break;
+                lock.unlock();
+                if (dirty) {
+                    sink_->flush();
+                    dirty = false;
+                }
+                continue;
+            }
+            item = std::move(queue_.front());
+            queue_.pop_front();
+            stats_.queuedBytes -= item.second;
+        }
+        room_.notify_all();
+
+        bool ok;
+        {
+            TraceSpan span("sink", "write");
+            ok = sink_->write(*item.first);
+        }
+        dirty = true;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.batches++;
+        if (ok) stats_.written += item.first->size();
+        else stats_.failed += item.first->size();
+    }
+    sink_->flush();
+}
+
+// --- PacketSinks ---
+
+bool PacketSinks::configure(const std::vector<SinkConfig>& configs, std::string& error) {
+    std::vector<std::shared_ptr<SinkRunner>> runners;
+    for (const auto& config : configs) {
+        auto sink = makeSink(config);
+        if (!sink) {
+            error = "Could not open sink " + config.name;
+            return false;
+        }
+        runners.push_back(std::make_shared<SinkRunner>(config, std::move(sink)));
+    }
+
+    std::vector<std::shared_ptr<SinkRunner>> old;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        old.swap(runners_);
+        runners_ = std::move(runners);
+    }
+    // Old sinks are stopped here, outside the lock: queued batches are dropped,
+    // what was written is flushed
+    return true;
+}
+
+bool PacketSinks::empty() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return runners_.empty();
+}
+
+void PacketSinks::publish(const std::vector<Packet>& pkts) {
+    std::vector<std::shared_ptr<SinkRunner>> runners;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (runners_.empty()) return;
+        runners = runners_;
+    }
+
+    auto batch = std::make_shared<std::vector<Packet>>();
+    batch->reserve(pkts.size());
+    size_t bytes = 0;
+    for (const auto& pkt : pkts) {
+        if (pkt.suppressed) continue;
+        // Field by field: the hex dump (about 3x the payload) is never written by a sink
+        Packet& copy = batch->emplace_back();
+        copy.timestamp = pkt.timestamp;
+        copy.timestampNs = pkt.timestampNs;
+        copy.outbound = pkt.outbound;
+        copy.opcode = pkt.opcode;
+        copy.payload = pkt.payload;
+        copy.length = pkt.length;
+        copy.isHandshake = pkt.isHandshake;
+        copy.isDeadNotification = pkt.isDeadNotification;
+        copy.sessionId = pkt.sessionId;
+        copy.serverPort = pkt.serverPort;
+        copy.version = pkt.version;
+        copy.locale = pkt.locale;
+        if (pkt.isHandshake) copy.subVersionStr = pkt.subVersionStr;
+        bytes += copy.payload.capacity() + copy.subVersionStr.capacity() + sizeof(Packet);
+    }
+    if (batch->empty()) return;
+
+    PacketBatch shared = std::move(batch);
+    for (const auto& runner : runners) runner->offer(shared, bytes);
+}
+
+std::vector<std::pair<SinkConfig, SinkStats>> PacketSinks::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::pair<SinkConfig, SinkStats>> out;
+    for (const auto& runner : runners_) out.emplace_back(runner->config(), runner->stats());
+    return out;
+}
+
+} // namespace maple
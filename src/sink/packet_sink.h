@@ -0,0 +1,117 @@
+#pragma once
+
+#include "../protocol/protocol.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace maple {
+
+using PacketBatch = std::shared_ptr<const std::vector<Packet>>;
+
+// Output for decoded packets. A sink only ever runs on its own SinkRunner
+// thread; interrupt() is the one call made from another thread.
+class PacketSink {
+public:
+    virtual ~PacketSink() = default;
+
+    // Write one batch; false = the packets were lost (counted as failed)
+    virtual bool write(const std::vector<Packet>& batch) = 0;
+    // Called when the queue runs dry and before the sink is destroyed
+    virtual void flush() {}
+    // Unblock a write stuck on a slow consumer (stream sinks)
+    virtual void interrupt() {}
+};
+
+struct SinkConfig {
+    enum class Kind { BinaryFile, NdjsonFile, Stream };
+    // What happens to new batches when the queue is full. The decode pipeline
+    // never waits longer than blockMs, even with Block.
+    enum class Policy { DropNewest, DropOldest, Block };
+
+    std::string name;
+    Kind kind = Kind::BinaryFile;
+    Policy policy = Policy::DropNewest;
+    std::string path;                    // files: directory; Stream: socket path / pipe name
+    std::string prefix = "packets";      // file name prefix
+    uint64_t rotateBytes = 256ull << 20; // start a new file past this size
+    uint32_t keepFiles = 8;              // rotated files kept per sink (0 = all)
+    bool json = false;                   // Stream: NDJSON instead of binary records
+    size_t queueBytes = 64u << 20;       // queued payload budget
+    uint32_t blockMs = 20;
+};
+
+struct SinkStats {
+    uint64_t accepted = 0;   // packets queued
+    uint64_t written = 0;
+    uint64_t dropped = 0;    // queue full
+    uint64_t failed = 0;     // sink write failed (disk error, no stream consumer)
+    uint64_t batches = 0;
+    size_t queuedBytes = 0;
+};
+
+// Binary record stream shared by file and stream sinks: the 16-byte header
+// below, then one maple_ring_record (sdk/maple_ring.h) per packet followed by
+// its payload, padded to 8 bytes.
+inline constexpr char SINK_STREAM_MAGIC[8] = { 'M', 'S', 'P', 'K', 'S', 'T', 'R', 'M' };
+inline constexpr uint32_t SINK_STREAM_VERSION = 1;
+
+void appendStreamHeader(std::string& out);
+void appendRecord(std::string& out, const Packet& pkt, uint64_t seq);
+// One JSON object per line: ts, session, dir, opcode, length, port, payload (hex)
+void appendJsonLine(std::string& out, const Packet& pkt);
+
+std::unique_ptr<PacketSink> makeSink(const SinkConfig& config);
+
+// Queue plus worker thread in front of one sink
+class SinkRunner {
+public:
+    SinkRunner(SinkConfig config, std::unique_ptr<PacketSink> sink);
+    ~SinkRunner();
+
+    SinkRunner(const SinkRunner&) = delete;
+    SinkRunner& operator=(const SinkRunner&) = delete;
+
+    void offer(const PacketBatch& batch, size_t bytes);
+
+    const SinkConfig& config() const { return config_; }
+    SinkStats stats() const;
+
+private:
+    void run(std::stop_token stop);
+
+    SinkConfig config_;
+    std::unique_ptr<PacketSink> sink_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable_any ready_;   // queue not empty
+    std::condition_variable_any room_;    // queue shrank (Block)
+    std::deque<std::pair<PacketBatch, size_t>> queue_;
+    SinkStats stats_;
+
+    std::jthread thread_;   // last: stopped before the rest is destroyed
+};
+
+// All configured sinks. publish() only copies the batch once and never waits
+// on a sink (beyond a Block sink's blockMs).
+class PacketSinks {
+public:
+    // Replace every sink; returns false (error set) if one cannot be created
+    bool configure(const std::vector<SinkConfig>& configs, std::string& error);
+    bool empty() const;
+
+    void publish(const std::vector<Packet>& pkts);
+
+    std::vector<std::pair<SinkConfig, SinkStats>> stats() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<std::shared_ptr<SinkRunner>> runners_;
+};
+
+} // namespace maple
@@ -0,0 +1,186 @@
+#include "shared_ring.h"
+#include <atomic>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace maple {
+
+namespace {
+
+constexpr uint64_t DATA_OFFSET = 256;   // header rounded up
+static_assert(sizeof(maple_ring_header) <= DATA_OFFSET);
+static_assert(sizeof(maple_ring_record) % 8 == 0);
+
+uint64_t roundUpPow2(uint64_t v) {
+    uint64_t p = 1 << 16;
+    while (p < v) p <<= 1;
+    return p;
+}
+
+} // namespace
+
+SharedRingWriter::~SharedRingWriter() {
+    close();
+}
+
+bool SharedRingWriter::open(const std::string& name, uint64_t capacity) {
+    close();
+    capacity = roundUpPow2(capacity);
+    size_t total = static_cast<size_t>(DATA_OFFSET + capacity);
+    bool existed = false;
+
+#ifdef _WIN32
+    HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                       static_cast<DWORD>(static_cast<uint64_t>(total) >> 32),
+                                       static_cast<DWORD>(total), name.c_str());
+    if (!mapping) {
+        std::cerr << "[SharedRing] CreateFileMapping failed: " << GetLastError() << std::endl;
+        return false;
+    }
+    existed = GetLastError() == ERROR_ALREADY_EXISTS;
+    void* view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, total);
+    if (!view) {
+        std::cerr << "[SharedRing] MapViewOfFile failed: " << GetLastError() << std::endl;
+        CloseHandle(mapping);
+        return false;
+    }
+    handle_ = mapping;
+    base_ = static_cast<uint8_t*>(view);
+#else
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+    if (fd < 0) {
+        std::cerr << "[SharedRing] shm_open failed: " << name << std::endl;
+        return false;
+    }
+    struct stat st {};
+    existed = fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) == total;
+    if (!existed && ftruncate(fd, static_cast<off_t>(total)) != 0) {
+        std::cerr << "[SharedRing] ftruncate failed: " << name << std::endl;
+        ::close(fd);
+        return false;
+    }
+    void* view = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED) {
+        std::cerr << "[SharedRing] mmap failed: " << name << std::endl;
+        return false;
+    }
+    base_ = static_cast<uint8_t*>(view);
+#endif
+    mappedSize_ = total;
+    name_ = name;
+    header_ = reinterpret_cast<maple_ring_header*>(base_);
+    data_ = base_ + DATA_OFFSET;
+
+    if (existed && header_->magic == MAPLE_RING_MAGIC && header_->version == MAPLE_RING_VERSION &&
+        header_->record_header_size == sizeof(maple_ring_record) && header_->capacity == capacity &&
+        header_->data_offset == DATA_OFFSET) {
+        // Previous writer may have died mid-record: resume after the last complete one
+        writePos_ = header_->write_pos;
+        nextSeq_ = header_->next_seq;
+        std::atomic_ref<uint64_t>(header_->reserve_pos).store(writePos_, std::memory_order_release);
+    } else {
+        // Readers check the magic last written, so it goes in after the rest
+        std::atomic_ref<uint64_t>(header_->magic).store(0, std::memory_order_relaxed);
+        std::memset(reinterpret_cast<uint8_t*>(header_) + sizeof(uint64_t), 0, DATA_OFFSET - sizeof(uint64_t));
+        header_->version = MAPLE_RING_VERSION;
+        header_->record_header_size = sizeof(maple_ring_record);
+        header_->capacity = capacity;
+        header_->data_offset = DATA_OFFSET;
+        writePos_ = 0;
+        nextSeq_ = 0;
+        std::atomic_ref<uint64_t>(header_->magic).store(MAPLE_RING_MAGIC, std::memory_order_release);
+    }
+    published_ = 0;
+    truncated_ = 0;
+    return true;
+}
+
+void SharedRingWriter::close() {
+    if (!base_) return;
+#ifdef _WIN32
+    UnmapViewOfFile(base_);
+    CloseHandle(static_cast<HANDLE>(handle_));
+#else
+    munmap(base_, mappedSize_);   // the name stays so readers can reattach to a restarted writer
+#endif
+    handle_ = nullptr;
+    base_ = nullptr;
+    header_ = nullptr;
+    data_ = nullptr;
+    mappedSize_ = 0;
+}
+
+void SharedRingWriter::publish(const Packet& pkt) {
+    if (!header_ || pkt.suppressed) return;
+
+    const uint64_t capacity = header_->capacity;
+    constexpr size_t HEADER = sizeof(maple_ring_record);
+
+    // A record may take at most half the ring, so a reader always sees whole records
+    size_t payloadSize = pkt.payload.size();
+    uint8_t flags = 0;
+    if (HEADER + payloadSize > capacity / 2) {
+        payloadSize = capacity / 2 - HEADER;
+        flags |= MAPLE_RING_FLAG_TRUNCATED;
+        truncated_++;
+    }
+    uint32_t size = static_cast<uint32_t>((HEADER + payloadSize + 7) & ~size_t{7});
+
+    uint64_t pos = writePos_;
+    uint64_t offset = pos & (capacity - 1);
+    uint64_t tail = capacity - offset;
+    uint64_t end = (tail < size ? pos + tail : pos) + size;
+
+    // Claim the bytes first: readers still on them see reserve_pos move past and
+    // drop what they read (seqlock-style, the writer never waits)
+    std::atomic_ref<uint64_t>(header_->reserve_pos).store(end, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    if (tail < size) {
+        // Records never wrap: fill the rest of the ring and start over at offset 0
+        if (tail >= HEADER) {
+            maple_ring_record pad {};
+            pad.size = static_cast<uint32_t>(tail);
+            pad.seq = nextSeq_;
+            pad.flags = MAPLE_RING_FLAG_PAD;
+            std::memcpy(data_ + offset, &pad, HEADER);
+        }
+        offset = 0;
+    }
+
+    maple_ring_record rec {};
+    rec.size = size;
+    rec.payload_size = static_cast<uint32_t>(payloadSize);
+    rec.seq = nextSeq_;
+    rec.timestamp_ns = pkt.timestampNs;
+    rec.session_id = pkt.sessionId;
+    rec.opcode = pkt.opcode;
+    if (pkt.outbound) flags |= MAPLE_RING_FLAG_OUTBOUND;
+    if (pkt.isHandshake) flags |= MAPLE_RING_FLAG_HANDSHAKE;
+    if (pkt.isDeadNotification) flags |= MAPLE_RING_FLAG_DEAD;
+    rec.flags = flags;
+    rec.locale = pkt.locale;
+    rec.version = pkt.version;
+    rec.server_port = pkt.serverPort;
+    rec.length = pkt.length;
+    std::memcpy(data_ + offset, &rec, HEADER);
+    if (payloadSize) std::memcpy(data_ + offset + HEADER, pkt.payload.data(), payloadSize);
+
+    writePos_ = end;
+    nextSeq_++;
+    published_++;
+    std::atomic_ref<uint64_t>(header_->next_seq).store(nextSeq_, std::memory_order_relaxed);
+    std::atomic_ref<uint64_t>(header_->write_pos).store(end, std::memory_order_release);
+}
+
+} // namespace maple
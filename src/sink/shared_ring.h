@@ -0,0 +1,54 @@
+#pragma once
+
+#include "../protocol/protocol.h"
+#include "../../sdk/maple_ring.h"
+#include <cstdint>
+#include <string>
+
+namespace maple {
+
+// Writer side of the shared-memory packet ring (layout in sdk/maple_ring.h).
+// Publishes decoded packets for external readers; never waits for them, a
+// reader that falls a whole ring behind detects it and skips ahead.
+// Single writer: publish is not thread-safe.
+class SharedRingWriter {
+public:
+    static constexpr uint64_t DEFAULT_CAPACITY = 32ull << 20;
+
+    SharedRingWriter() = default;
+    ~SharedRingWriter();
+
+    SharedRingWriter(const SharedRingWriter&) = delete;
+    SharedRingWriter& operator=(const SharedRingWriter&) = delete;
+
+    // Create (or reattach to) the named region. capacity is rounded up to a
+    // power of two. An existing region of the same size keeps its positions
+    // and sequence numbers so attached readers carry on.
+    bool open(const std::string& name, uint64_t capacity = DEFAULT_CAPACITY);
+    void close();
+    bool isOpen() const { return header_ != nullptr; }
+
+    // Suppressed packets are not published
+    void publish(const Packet& pkt);
+
+    const std::string& name() const { return name_; }
+    uint64_t capacity() const { return header_ ? header_->capacity : 0; }
+    uint64_t published() const { return published_; }
+    uint64_t truncated() const { return truncated_; }
+    uint64_t nextSeq() const { return nextSeq_; }
+
+private:
+    void* handle_ = nullptr;
+    uint8_t* base_ = nullptr;
+    size_t mappedSize_ = 0;
+    maple_ring_header* header_ = nullptr;
+    uint8_t* data_ = nullptr;
+    std::string name_;
+
+    uint64_t writePos_ = 0;
+    uint64_t nextSeq_ = 0;
+    uint64_t published_ = 0;
+    uint64_t truncated_ = 0;
+};
+
+} // namespace maple
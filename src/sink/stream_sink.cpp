@@ -0,0 +1,175 @@
+#include "stream_sink.h"
+#include <iostream>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <algorithm>
+#else
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace maple {
+
+#ifdef _WIN32
+
+std::unique_ptr<StreamSink> StreamSink::create(const SinkConfig& config) {
+    std::string name = config.path.rfind("\\\\.\\pipe\\", 0) == 0 ? config.path : "\\\\.\\pipe\\" + config.path;
+    // PIPE_NOWAIT while listening so the sink thread can poll for a consumer
+    HANDLE pipe = CreateNamedPipeA(name.c_str(), PIPE_ACCESS_OUTBOUND,
+                                   PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_NOWAIT | PIPE_REJECT_REMOTE_CLIENTS,
+                                   1, 1 << 20, 0, 0, nullptr);
+    if (pipe == INVALID_HANDLE_VALUE) {
+        std::cerr << "[Sink] CreateNamedPipe failed for " << name << ": " << GetLastError() << std::endl;
+        return nullptr;
+    }
+    std::unique_ptr<StreamSink> sink(new StreamSink(config));
+    sink->pipe_ = pipe;
+    return sink;
+}
+
+StreamSink::~StreamSink() {
+    if (connected_) DisconnectNamedPipe(pipe_);
+    CloseHandle(pipe_);
+}
+
+bool StreamSink::acceptClient() {
+    if (!ConnectNamedPipe(pipe_, nullptr)) {
+        DWORD err = GetLastError();
+        if (err == ERROR_NO_DATA) DisconnectNamedPipe(pipe_);   // consumer came and went
+        if (err != ERROR_PIPE_CONNECTED) return false;
+    }
+    // Blocking writes from here on: a slow consumer only holds up this thread
+    DWORD mode = PIPE_READMODE_BYTE | PIPE_WAIT;
+    SetNamedPipeHandleState(pipe_, &mode, nullptr, nullptr);
+    connected_ = true;
+    return true;
+}
+
+bool StreamSink::sendAll(const std::string& data) {
+    const char* p = data.data();
+    size_t left = data.size();
+    while (left) {
+        DWORD chunk = static_cast<DWORD>(std::min<size_t>(left, 1 << 20));
+        DWORD written = 0;
+        if (!WriteFile(pipe_, p, chunk, &written, nullptr)) return false;
+        p += written;
+        left -= written;
+    }
+    return true;
+}
+
+void StreamSink::dropClient() {
+    DisconnectNamedPipe(pipe_);
+    DWORD mode = PIPE_READMODE_BYTE | PIPE_NOWAIT;
+    SetNamedPipeHandleState(pipe_, &mode, nullptr, nullptr);
+    connected_ = false;
+}
+
+void StreamSink::interrupt() {
+    interrupted_ = true;
+    // Breaks the client side off, failing a write blocked on it
+    DisconnectNamedPipe(pipe_);
+}
+
+#else
+
+std::unique_ptr<StreamSink> StreamSink::create(const SinkConfig& config) {
+    sockaddr_un addr {};
+    addr.sun_family = AF_UNIX;
+    if (config.path.empty() || config.path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "[Sink] Invalid socket path: " << config.path << std::endl;
+        return nullptr;
+    }
+    std::memcpy(addr.sun_path, config.path.c_str(), config.path.size());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return nullptr;
+    ::unlink(config.path.c_str());   // stale socket of an earlier run
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(fd, 1) != 0) {
+        std::cerr << "[Sink] Could not listen on " << config.path << ": " << std::strerror(errno) << std::endl;
+        ::close(fd);
+        return nullptr;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    std::unique_ptr<StreamSink> sink(new StreamSink(config));
+    sink->listenFd_ = fd;
+    sink->socketPath_ = config.path;
+    return sink;
+}
+
+StreamSink::~StreamSink() {
+    if (clientFd_ >= 0) ::close(clientFd_);
+    ::close(listenFd_);
+    ::unlink(socketPath_.c_str());
+}
+
+bool StreamSink::acceptClient() {
+    int fd = accept(listenFd_, nullptr, nullptr);
+    if (fd < 0) return false;
+    // Accepted sockets do not inherit O_NONBLOCK on Linux; make sure on the rest
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+    clientFd_ = fd;
+    return true;
+}
+
+bool StreamSink::sendAll(const std::string& data) {
+    const char* p = data.data();
+    size_t left = data.size();
+    while (left) {
+#ifdef MSG_NOSIGNAL
+        ssize_t n = send(clientFd_, p, left, MSG_NOSIGNAL);
+#else
+        ssize_t n = send(clientFd_, p, left, 0);
+#endif
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        left -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+void StreamSink::dropClient() {
+    ::close(clientFd_.exchange(-1));
+}
+
+void StreamSink::interrupt() {
+    interrupted_ = true;
+    int fd = clientFd_;
+    if (fd >= 0) shutdown(fd, SHUT_RDWR);
+}
+
+#endif
+
+bool StreamSink::write(const std::vector<Packet>& batch) {
+    if (interrupted_) return false;
+#ifdef _WIN32
+    bool connected = connected_;
+#else
+    bool connected = clientFd_ >= 0;
+#endif
+
+    buffer_.clear();
+    if (!connected) {
+        if (!acceptClient()) return false;
+        if (!json_) appendStreamHeader(buffer_);
+    }
+    for (const auto& pkt : batch) {
+        if (json_) appendJsonLine(buffer_, pkt);
+        else appendRecord(buffer_, pkt, seq_++);
+    }
+
+    if (!sendAll(buffer_)) {
+        dropClient();
+        return false;
+    }
+    return true;
+}
+
+} // namespace maple
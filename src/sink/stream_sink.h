@@ -0,0 +1,42 @@
+#pragma once
+
+#include "packet_sink.h"
+#include <atomic>
+
+namespace maple {
+
+// Streams packets to one local consumer at a time: a named pipe on Windows
+// (\\.\pipe\<path>), a Unix domain socket elsewhere. The sink listens, a
+// consumer connects whenever it likes; without one, batches count as failed.
+// Binary streams start with the SINK_STREAM_MAGIC header on every connection.
+class StreamSink : public PacketSink {
+public:
+    // nullptr if the pipe/socket cannot be created
+    static std::unique_ptr<StreamSink> create(const SinkConfig& config);
+    ~StreamSink() override;
+
+    bool write(const std::vector<Packet>& batch) override;
+    void interrupt() override;
+
+private:
+    explicit StreamSink(const SinkConfig& config) : json_(config.json) {}
+
+    bool acceptClient();   // non-blocking
+    bool sendAll(const std::string& data);
+    void dropClient();
+
+#ifdef _WIN32
+    void* pipe_ = nullptr;
+    bool connected_ = false;
+#else
+    int listenFd_ = -1;
+    std::atomic<int> clientFd_{ -1 };
+    std::string socketPath_;
+#endif
+    bool json_;
+    std::atomic<bool> interrupted_{ false };
+    std::string buffer_;
+    uint64_t seq_ = 0;
+};
+
+} // namespace maple
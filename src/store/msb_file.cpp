@@ -0,0 +1,287 @@
+#include "msb_file.h"
+#include <iostream>
+
+namespace maple {
+
+// .NET DateTime ticks (100 ns since 0001-01-01) of the Unix epoch
+static constexpr int64_t UNIX_EPOCH_TICKS = 621355968000000000;
+
+// Upper bound for a single packet; anything larger means the file is corrupt
+static constexpr uint32_t MAX_PACKET_SIZE = 64 * 1024 * 1024;
+
+// MapleShark's locale for build-only headers (pre-0x2000 files were GMS only)
+static constexpr uint8_t LEGACY_LOCALE = 8;
+
+// .NET BinaryReader/BinaryWriter strings: 7-bit encoded length, then UTF-8
+static std::string readNetString(BinaryReader& r) {
+    uint64_t len = r.varint();
+    if (!r.ok() || len > (1 << 20)) return {};
+    std::string s(static_cast<size_t>(len), '\0');
+    r.raw(s.data(), s.size());
+    return s;
+}
+
+static void writeNetString(BinaryWriter& w, const std::string& s) {
+    w.varint(s.size());
+    w.raw(s.data(), s.size());
+}
+
+bool MsbReader::open(const std::filesystem::path& path) {
+    close();
+
+    std::error_code ec;
+    fileSize_ = std::filesystem::file_size(path, ec);
+    if (ec) {
+        error_ = "cannot stat file";
+        return false;
+    }
+
+    ioBuffer_.resize(1 << 20);
+    file_.rdbuf()->pubsetbuf(ioBuffer_.data(), static_cast<std::streamsize>(ioBuffer_.size()));
+    file_.open(path, std::ios::binary);
+    if (!file_.is_open()) {
+        error_ = "cannot open file";
+        return false;
+    }
+    reader_.emplace(file_);
+    BinaryReader& r = *reader_;
+
+    header_ = MsbHeader{};
+    uint16_t version = r.u16();
+    header_.formatVersion = version;
+    if (version < 0x2000) {
+        header_.build = version;
+        header_.localPort = r.u16();
+        header_.locale = LEGACY_LOCALE;
+    } else if (version == 0x2012) {
+        header_.locale = static_cast<uint8_t>(r.u16());
+        header_.build = r.u16();
+        header_.localPort = r.u16();
+    } else if (version == 0x2014 || version == 0x2015 || version >= 0x2020) {
+        header_.localEndpoint = readNetString(r);
+        header_.localPort = r.u16();
+        header_.remoteEndpoint = readNetString(r);
+        header_.remotePort = r.u16();
+        header_.locale = version == 0x2014 ? static_cast<uint8_t>(r.u16()) : r.u8();
+        header_.build = r.u16();
+        if (version >= 0x2021) header_.patchLocation = readNetString(r);
+    } else {
+        error_ = "unsupported format version";
+        close();
+        return false;
+    }
+    if (!r.ok()) {
+        error_ = "truncated header";
+        close();
+        return false;
+    }
+
+    position_ = static_cast<uint64_t>(file_.tellg());
+    error_.clear();
+    return true;
+}
+
+void MsbReader::close() {
+    reader_.reset();
+    if (file_.is_open()) file_.close();
+    file_.clear();
+    position_ = 0;
+}
+
+bool MsbReader::next(Packet& pkt) {
+    if (!reader_ || position_ >= fileSize_) return false;
+    BinaryReader& r = *reader_;
+    uint16_t version = header_.formatVersion;
+
+    int64_t ticks = r.i64();
+    uint32_t size = version < 0x2027 ? r.u16() : r.u32();
+    uint16_t opcode = r.u16();
+    bool outbound;
+    if (version >= 0x2020) {
+        outbound = r.u8() != 0;
+    } else {
+        outbound = (size & 0x8000) != 0;
+        size &= 0x7FFF;
+    }
+    if (!r.ok() || size > MAX_PACKET_SIZE || size > fileSize_ - position_) {
+        error_ = "corrupt packet record";
+        return false;
+    }
+    pkt.payload.resize(size);
+    r.raw(pkt.payload.data(), size);
+    if (version >= 0x2025) {
+        r.u32();   // IVs before and after the packet; decoding is already done
+        r.u32();
+    }
+    if (!r.ok()) {
+        error_ = "truncated packet record";
+        return false;
+    }
+    // Counted instead of tellg(), which costs a seek per record
+    position_ += 8 + (version < 0x2027 ? 2 : 4) + 2 + (version >= 0x2020 ? 1 : 0) + size + (version >= 0x2025 ? 8 : 0);
+
+    pkt.timestampNs = (ticks - UNIX_EPOCH_TICKS) * 100;
+    pkt.timestamp = static_cast<double>(pkt.timestampNs) / 1e9;
+    pkt.outbound = outbound;
+    pkt.opcode = opcode;
+    pkt.length = size + 2;
+    pkt.hexDump.clear();
+    pkt.isHandshake = false;
+    pkt.isDeadNotification = false;
+    pkt.suppressed = false;
+    pkt.serverPort = header_.remotePort;
+    pkt.version = 0;
+    pkt.subVersionStr.clear();
+    pkt.locale = 0;
+    return true;
+}
+
+Packet MsbReader::handshake(int64_t timestampNs) const {
+    Packet hs{};
+    hs.timestampNs = timestampNs;
+    hs.timestamp = static_cast<double>(timestampNs) / 1e9;
+    hs.outbound = false;
+    hs.opcode = 0;
+    hs.length = 0;
+    hs.isHandshake = true;
+    hs.serverPort = header_.remotePort;
+    hs.version = header_.build;
+    hs.subVersionStr = header_.patchLocation;
+    hs.locale = header_.locale;
+    return hs;
+}
+
+std::optional<size_t> MsbReader::import(const std::filesystem::path& path, PacketStore& store, uint32_t sessionId) {
+    MsbReader reader;
+    if (!reader.open(path)) {
+        std::cerr << "[MsbReader] Cannot read " << path.string() << ": " << reader.error() << std::endl;
+        return std::nullopt;
+    }
+
+    // The payload arena is at most the file size; one growth step instead of many
+    store.reserve(store.size() + reader.fileSize() / 64, store.payloadData().size() + reader.fileSize());
+
+    Packet pkt{};
+    pkt.sessionId = sessionId;
+    size_t count = 0;
+    int64_t lastNs = 0;
+    while (reader.next(pkt)) {
+        if (count == 0) {
+            Packet hs = reader.handshake(pkt.timestampNs);
+            hs.sessionId = sessionId;
+            store.append(hs);
+        }
+        store.append(pkt);
+        lastNs = pkt.timestampNs;
+        count++;
+    }
+    if (!reader.error().empty()) {
+        // Keep what was read: archives are often cut off mid-record
+        std::cerr << "[MsbReader] " << path.string() << ": " << reader.error()
+                  << " at offset " << reader.position() << ", kept " << count << " packets" << std::endl;
+    }
+    if (count == 0) {
+        Packet hs = reader.handshake(0);
+        hs.sessionId = sessionId;
+        store.append(hs);
+    }
+
+    Packet dead{};
+    dead.timestampNs = lastNs;
+    dead.timestamp = static_cast<double>(lastNs) / 1e9;
+    dead.isDeadNotification = true;
+    dead.sessionId = sessionId;
+    dead.serverPort = reader.header().remotePort;
+    store.append(dead);
+    return count;
+}
+
+bool MsbWriter::open(const std::filesystem::path& path, const MsbHeader& header) {
+    close();
+    ioBuffer_.resize(1 << 20);
+    file_.rdbuf()->pubsetbuf(ioBuffer_.data(), static_cast<std::streamsize>(ioBuffer_.size()));
+    file_.open(path, std::ios::binary | std::ios::trunc);
+    if (!file_.is_open()) return false;
+    writer_.emplace(file_);
+    BinaryWriter& w = *writer_;
+
+    w.u16(FORMAT_VERSION);
+    writeNetString(w, header.localEndpoint);
+    w.u16(header.localPort);
+    writeNetString(w, header.remoteEndpoint);
+    w.u16(header.remotePort);
+    w.u8(header.locale);
+    w.u16(header.build);
+    writeNetString(w, header.patchLocation);
+    packets_ = 0;
+    return w.ok();
+}
+
+void MsbWriter::close() {
+    writer_.reset();
+    if (file_.is_open()) file_.close();
+    file_.clear();
+}
+
+bool MsbWriter::write(const Packet& pkt) {
+    if (pkt.isHandshake || pkt.isDeadNotification) return true;
+    return write(pkt.timestampNs, pkt.outbound, pkt.opcode, pkt.payload.data(), pkt.payload.size());
+}
+
+bool MsbWriter::write(int64_t timestampNs, bool outbound, uint16_t opcode, const uint8_t* data, size_t size) {
+    if (!writer_) return false;
+    BinaryWriter& w = *writer_;
+    w.i64(timestampNs / 100 + UNIX_EPOCH_TICKS);
+    w.u32(static_cast<uint32_t>(size));
+    w.u16(opcode);
+    w.u8(outbound ? 1 : 0);
+    w.raw(data, size);
+    w.u32(0);   // IVs are not kept by the packet store
+    w.u32(0);
+    packets_++;
+    return w.ok();
+}
+
+std::optional<MsbHeader> MsbWriter::sessionHeader(const PacketStore& store, uint32_t sessionId) {
+    std::optional<MsbHeader> header;
+    for (size_t i = 0; i < store.size(); i++) {
+        if (store.sessionIds()[i] != sessionId) continue;
+        if (!header) {
+            header = MsbHeader{};
+            header->formatVersion = FORMAT_VERSION;
+            header->remotePort = store.serverPorts()[i];
+        }
+        if (store.flags()[i] & PacketStore::FLAG_HANDSHAKE) {
+            Packet hs = store.get(i);
+            header->locale = hs.locale;
+            header->build = hs.version;
+            header->patchLocation = hs.subVersionStr;
+            break;
+        }
+    }
+    return header;
+}
+
+std::optional<size_t> MsbWriter::exportSession(const PacketStore& store, uint32_t sessionId,
+                                               const MsbHeader& header, const std::filesystem::path& path) {
+    MsbWriter writer;
+    if (!writer.open(path, header)) {
+        std::cerr << "[MsbWriter] Cannot create " << path.string() << std::endl;
+        return std::nullopt;
+    }
+    const auto& flags = store.flags();
+    for (size_t i = 0; i < store.size(); i++) {
+        if (store.sessionIds()[i] != sessionId) continue;
+        if (flags[i] & (PacketStore::FLAG_HANDSHAKE | PacketStore::FLAG_DEAD)) continue;
+        if (!writer.write(store.timestampsNs()[i], (flags[i] & PacketStore::FLAG_OUTBOUND) != 0,
+                          store.opcodes()[i], store.payload(i), store.payloadSize(i))) {
+            std::cerr << "[MsbWriter] Write failed for " << path.string() << std::endl;
+            return std::nullopt;
+        }
+    }
+    size_t written = writer.packets();
+    writer.close();
+    return written;
+}
+
+} // namespace maple
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "packet_store.h"
+#include "../util/binary_io.h"
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace maple {
+
+// Session header of a MapleShark capture (.msb). Local is the client, remote the server.
+struct MsbHeader {
+    uint16_t formatVersion = 0;   // as read; files are always written as MsbWriter::FORMAT_VERSION
+    std::string localEndpoint;
+    uint16_t localPort = 0;
+    std::string remoteEndpoint;
+    uint16_t remotePort = 0;
+    uint8_t locale = 0;
+    uint16_t build = 0;           // game version
+    std::string patchLocation;    // sub-version string of the handshake
+};
+
+// Streaming reader for MapleShark session files: the header is read by open(),
+// packets one record at a time. Handles format versions from the pre-0x2000
+// build-only header up to 0x2027 (32-bit sizes). Timestamps are .NET ticks,
+// taken as UTC.
+class MsbReader {
+public:
+    MsbReader() = default;
+
+    MsbReader(const MsbReader&) = delete;
+    MsbReader& operator=(const MsbReader&) = delete;
+
+    bool open(const std::filesystem::path& path);
+    void close();
+
+    const MsbHeader& header() const { return header_; }
+
+    // Read the next packet into pkt, reusing its payload buffer (hexDump is
+    // left empty). Returns false at the end of the file or on a corrupt record.
+    bool next(Packet& pkt);
+
+    // Handshake packet carrying the header's version, locale and patch location
+    Packet handshake(int64_t timestampNs) const;
+
+    uint64_t position() const { return position_; }
+    uint64_t fileSize() const { return fileSize_; }
+    const std::string& error() const { return error_; }
+
+    // Import a whole file into store as one session: a handshake, every packet,
+    // then a dead-stream marker. Returns the number of packets read.
+    static std::optional<size_t> import(const std::filesystem::path& path, PacketStore& store, uint32_t sessionId);
+
+private:
+    std::vector<char> ioBuffer_;   // declared before file_: must outlive the stream
+    std::ifstream file_;
+    std::optional<BinaryReader> reader_;
+    MsbHeader header_;
+    uint64_t fileSize_ = 0;
+    uint64_t position_ = 0;
+    std::string error_;
+};
+
+// Streaming writer for MapleShark session files (format 0x2027)
+class MsbWriter {
+public:
+    static constexpr uint16_t FORMAT_VERSION = 0x2027;
+
+    MsbWriter() = default;
+
+    MsbWriter(const MsbWriter&) = delete;
+    MsbWriter& operator=(const MsbWriter&) = delete;
+
+    bool open(const std::filesystem::path& path, const MsbHeader& header);
+    void close();
+    bool isOpen() const { return file_.is_open(); }
+
+    // Handshakes and dead-stream markers have no .msb record and are skipped
+    bool write(const Packet& pkt);
+    bool write(int64_t timestampNs, bool outbound, uint16_t opcode, const uint8_t* data, size_t size);
+
+    uint64_t packets() const { return packets_; }
+
+    // Header for one session of a store: locale, build and patch location from
+    // its handshake, remote port from its rows. Endpoints are left to the caller.
+    static std::optional<MsbHeader> sessionHeader(const PacketStore& store, uint32_t sessionId);
+
+    // Write every packet of one session, streaming rows from the store
+    static std::optional<size_t> exportSession(const PacketStore& store, uint32_t sessionId,
+                                               const MsbHeader& header, const std::filesystem::path& path);
+
+private:
+    std::vector<char> ioBuffer_;
+    std::ofstream file_;
+    std::optional<BinaryWriter> writer_;
+    uint64_t packets_ = 0;
+};
+
+} // namespace maple
@@ -0,0 +1,241 @@
+#include "packet_store.h"
+#include "../util/binary_io.h"
+#include <fstream>
+#include <iostream>
+#include <queue>
+
+namespace maple {
+
+void PacketStore::append(const Packet& pkt) {
+    uint8_t f = 0;
+    if (pkt.outbound) f |= FLAG_OUTBOUND;
+    if (pkt.isHandshake) f |= FLAG_HANDSHAKE;
+    if (pkt.isDeadNotification) f |= FLAG_DEAD;
+
+    if (pkt.isHandshake) {
+        handshakes_[size()] = { pkt.version, pkt.locale, pkt.subVersionStr, pkt.hexDump };
+    }
+
+    timestampsNs_.push_back(pkt.timestampNs);
+    sessionIds_.push_back(pkt.sessionId);
+    opcodes_.push_back(pkt.opcode);
+    flags_.push_back(f);
+    lengths_.push_back(pkt.length);
+    serverPorts_.push_back(pkt.serverPort);
+    payloadData_.insert(payloadData_.end(), pkt.payload.begin(), pkt.payload.end());
+    payloadOffsets_.push_back(payloadData_.size());
+}
+
+void PacketStore::appendFrom(const PacketStore& other, size_t i) {
+    if (other.flags_[i] & FLAG_HANDSHAKE) {
+        auto it = other.handshakes_.find(i);
+        if (it != other.handshakes_.end()) handshakes_[size()] = it->second;
+    }
+
+    timestampsNs_.push_back(other.timestampsNs_[i]);
+    sessionIds_.push_back(other.sessionIds_[i]);
+    opcodes_.push_back(other.opcodes_[i]);
+    flags_.push_back(other.flags_[i]);
+    lengths_.push_back(other.lengths_[i]);
+    serverPorts_.push_back(other.serverPorts_[i]);
+    const uint8_t* p = other.payload(i);
+    payloadData_.insert(payloadData_.end(), p, p + other.payloadSize(i));
+    payloadOffsets_.push_back(payloadData_.size());
+}
+
+void PacketStore::reserve(size_t packets, size_t payloadBytes) {
+    timestampsNs_.reserve(packets);
+    sessionIds_.reserve(packets);
+    opcodes_.reserve(packets);
+    flags_.reserve(packets);
+    lengths_.reserve(packets);
+    serverPorts_.reserve(packets);
+    payloadOffsets_.reserve(packets + 1);
+    payloadData_.reserve(payloadBytes);
+}
+
+void PacketStore::clear() {
+    *this = PacketStore();
+}
+
+Packet PacketStore::get(size_t i) const {
+    Packet pkt;
+    pkt.timestampNs = timestampsNs_[i];
+    pkt.timestamp = static_cast<double>(timestampsNs_[i]) / 1e9;
+    pkt.outbound = (flags_[i] & FLAG_OUTBOUND) != 0;
+    pkt.isHandshake = (flags_[i] & FLAG_HANDSHAKE) != 0;
+    pkt.isDeadNotification = (flags_[i] & FLAG_DEAD) != 0;
+    pkt.opcode = opcodes_[i];
+    pkt.length = lengths_[i];
+    pkt.sessionId = sessionIds_[i];
+    pkt.serverPort = serverPorts_[i];
+    pkt.payload.assign(payload(i), payload(i) + payloadSize(i));
+
+    if (pkt.isHandshake) {
+        auto it = handshakes_.find(i);
+        if (it != handshakes_.end()) {
+            pkt.version = it->second.version;
+            pkt.locale = it->second.locale;
+            pkt.subVersionStr = it->second.subVersion;
+            pkt.hexDump = it->second.hexDump;
+        }
+    } else {
+        pkt.hexDump = Protocol::toHexDump(pkt.payload.data(), pkt.payload.size());
+    }
+    return pkt;
+}
+
+PacketStore PacketStore::merge(std::vector<PacketStore>&& parts) {
+    PacketStore out;
+    size_t total = 0, totalBytes = 0;
+    for (const auto& p : parts) {
+        total += p.size();
+        totalBytes += p.payloadData_.size();
+    }
+    out.reserve(total, totalBytes);
+
+    // Min-heap on (timestamp, part) over each part's next packet
+    using Head = std::pair<int64_t, size_t>;
+    std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+    std::vector<size_t> cursor(parts.size(), 0);
+    for (size_t p = 0; p < parts.size(); p++) {
+        if (!parts[p].empty()) heads.push({ parts[p].timestampsNs_[0], p });
+    }
+
+    while (!heads.empty()) {
+        size_t p = heads.top().second;
+        heads.pop();
+
+        // Drain the run of this part that stays ahead of every other head
+        PacketStore& part = parts[p];
+        int64_t limit = heads.empty() ? 0 : heads.top().first;
+        size_t limitPart = heads.empty() ? 0 : heads.top().second;
+        size_t& i = cursor[p];
+        do {
+            out.appendFrom(part, i++);
+        } while (i < part.size() &&
+                 (heads.empty() || part.timestampsNs_[i] < limit ||
+                  (part.timestampsNs_[i] == limit && p < limitPart)));
+
+        if (i < part.size()) {
+            heads.push({ part.timestampsNs_[i], p });
+        } else {
+            part.clear();
+        }
+    }
+    return out;
+}
+
+size_t PacketStore::memoryBytes() const {
+    size_t bytes = timestampsNs_.capacity() * sizeof(int64_t) +
+                   sessionIds_.capacity() * sizeof(uint32_t) +
+                   opcodes_.capacity() * sizeof(uint16_t) +
+                   flags_.capacity() +
+                   lengths_.capacity() * sizeof(uint32_t) +
+                   serverPorts_.capacity() * sizeof(uint16_t) +
+                   payloadOffsets_.capacity() * sizeof(uint64_t) +
+                   payloadData_.capacity();
+    for (const auto& [seq, hs] : handshakes_) {
+        bytes += sizeof(hs) + hs.subVersion.size() + hs.hexDump.size();
+    }
+    return bytes;
+}
+
+static constexpr char STORE_MAGIC[8] = { 'M', 'S', 'P', 'K', 'T', 'S', '\0', '\0' };
+static constexpr uint32_t STORE_FORMAT_VERSION = 1;
+
+bool PacketStore::save(const std::filesystem::path& path) const {
+    // Write to a temp file and rename so a crash never leaves a truncated store
+    auto tmp = path;
+    tmp += ".tmp";
+    {
+        std::ofstream ofs(tmp, std::ios::binary | std::ios::trunc);
+        if (!ofs.is_open()) return false;
+        BinaryWriter w(ofs);
+        w.raw(STORE_MAGIC, sizeof(STORE_MAGIC));
+        w.u32(STORE_FORMAT_VERSION);
+        w.u64(size());
+        for (size_t i = 0; i < size(); i++) {
+            w.i64(timestampsNs_[i]);
+            w.u32(sessionIds_[i]);
+            w.u16(opcodes_[i]);
+            w.u8(flags_[i]);
+            w.u32(lengths_[i]);
+            w.u16(serverPorts_[i]);
+            w.varint(payloadSize(i));
+        }
+        w.u64(payloadData_.size());
+        w.raw(payloadData_.data(), payloadData_.size());
+
+        w.u32(static_cast<uint32_t>(handshakes_.size()));
+        for (const auto& [seq, hs] : handshakes_) {
+            w.u64(seq);
+            w.u16(hs.version);
+            w.u8(hs.locale);
+            w.str(hs.subVersion);
+            w.str(hs.hexDump);
+        }
+        if (!w.ok()) return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp, path, ec);
+    if (ec) {
+        std::filesystem::remove(tmp, ec);
+        return false;
+    }
+    return true;
+}
+
+std::optional<PacketStore> PacketStore::load(const std::filesystem::path& path) {
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs.is_open()) return std::nullopt;
+    BinaryReader r(ifs);
+
+    char magic[sizeof(STORE_MAGIC)]{};
+    r.raw(magic, sizeof(magic));
+    if (std::memcmp(magic, STORE_MAGIC, sizeof(magic)) != 0 || r.u32() != STORE_FORMAT_VERSION) {
+        std::cerr << "[PacketStore] Not a packet store file: " << path.string() << std::endl;
+        return std::nullopt;
+    }
+
+    PacketStore store;
+    uint64_t count = r.u64();
+    uint64_t payloadTotal = 0;
+    for (uint64_t i = 0; i < count && r.ok(); i++) {
+        store.timestampsNs_.push_back(r.i64());
+        store.sessionIds_.push_back(r.u32());
+        store.opcodes_.push_back(r.u16());
+        store.flags_.push_back(r.u8());
+        store.lengths_.push_back(r.u32());
+        store.serverPorts_.push_back(r.u16());
+        payloadTotal += r.varint();
+        store.payloadOffsets_.push_back(payloadTotal);
+    }
+
+    uint64_t payloadBytes = r.u64();
+    if (!r.ok() || payloadBytes != payloadTotal) {
+        std::cerr << "[PacketStore] Corrupt packet store: " << path.string() << std::endl;
+        return std::nullopt;
+    }
+    store.payloadData_.resize(payloadBytes);
+    r.raw(store.payloadData_.data(), payloadBytes);
+
+    uint32_t handshakes = r.u32();
+    for (uint32_t i = 0; i < handshakes && r.ok(); i++) {
+        uint64_t seq = r.u64();
+        HandshakeInfo hs;
+        hs.version = r.u16();
+        hs.locale = r.u8();
+        hs.subVersion = r.str();
+        hs.hexDump = r.str();
+        store.handshakes_[seq] = std::move(hs);
+    }
+    if (!r.ok()) {
+        std::cerr << "[PacketStore] Corrupt packet store: " << path.string() << std::endl;
+        return std::nullopt;
+    }
+    return store;
+}
+
+} // namespace maple
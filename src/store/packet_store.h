@@ -0,0 +1,82 @@
+#pragma once
+
+#include "../protocol/protocol.h"
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace maple {
+
+// Append-only columnar store of decoded packets.
+// Fixed-size fields live in parallel columns and payloads in one contiguous
+// arena, so millions of packets cost a few bytes of overhead each and columns
+// can be handed out as flat arrays. Hex dumps are not stored; get() rebuilds them.
+// Not synchronized: callers serialize access.
+class PacketStore {
+public:
+    enum Flag : uint8_t {
+        FLAG_OUTBOUND  = 1 << 0,
+        FLAG_HANDSHAKE = 1 << 1,
+        FLAG_DEAD      = 1 << 2,
+    };
+
+    void append(const Packet& pkt);
+    void reserve(size_t packets, size_t payloadBytes);
+    void clear();
+
+    size_t size() const { return timestampsNs_.size(); }
+    bool empty() const { return timestampsNs_.empty(); }
+
+    // Columns, indexed by packet sequence number
+    const std::vector<int64_t>& timestampsNs() const { return timestampsNs_; }
+    const std::vector<uint32_t>& sessionIds() const { return sessionIds_; }
+    const std::vector<uint16_t>& opcodes() const { return opcodes_; }
+    const std::vector<uint8_t>& flags() const { return flags_; }
+    const std::vector<uint32_t>& lengths() const { return lengths_; }
+    const std::vector<uint16_t>& serverPorts() const { return serverPorts_; }
+    const std::vector<uint64_t>& payloadOffsets() const { return payloadOffsets_; }  // size() + 1 entries
+    const std::vector<uint8_t>& payloadData() const { return payloadData_; }
+
+    const uint8_t* payload(size_t i) const { return payloadData_.data() + payloadOffsets_[i]; }
+    size_t payloadSize(size_t i) const { return payloadOffsets_[i + 1] - payloadOffsets_[i]; }
+
+    // Rebuild the full packet (hex dump regenerated)
+    Packet get(size_t i) const;
+
+    // Merge stores that are each in capture order into one timeline ordered by
+    // timestamp. Ties keep part order, so the result is deterministic.
+    // Parts are released as they are consumed.
+    static PacketStore merge(std::vector<PacketStore>&& parts);
+
+    size_t memoryBytes() const;
+
+    // Persist / reload a whole store (".mspkts": magic, version, then every column)
+    bool save(const std::filesystem::path& path) const;
+    static std::optional<PacketStore> load(const std::filesystem::path& path);
+
+private:
+    // Handshakes are rare: their extra fields sit in a side table
+    struct HandshakeInfo {
+        uint16_t version = 0;
+        uint8_t locale = 0;
+        std::string subVersion;
+        std::string hexDump;  // raw handshake bytes (no payload column data)
+    };
+
+    void appendFrom(const PacketStore& other, size_t i);
+
+    std::vector<int64_t> timestampsNs_;
+    std::vector<uint32_t> sessionIds_;
+    std::vector<uint16_t> opcodes_;
+    std::vector<uint8_t> flags_;
+    std::vector<uint32_t> lengths_;
+    std::vector<uint16_t> serverPorts_;
+    std::vector<uint64_t> payloadOffsets_{0};
+    std::vector<uint8_t> payloadData_;
+    std::unordered_map<uint64_t, HandshakeInfo> handshakes_;
+};
+
+} // namespace maple
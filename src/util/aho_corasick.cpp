@@ -0,0 +1,97 @@
+#include "aho_corasick.h"
+#include <queue>
+
+namespace maple {
+
+uint32_t AhoCorasick::add(const uint8_t* data, size_t len) {
+    uint32_t id = static_cast<uint32_t>(patternLengths_.size());
+    patternLengths_.push_back(static_cast<uint32_t>(len));
+    if (len == 0) return id;
+
+    uint32_t node = 0;
+    for (size_t i = 0; i < len; i++) {
+        uint32_t next = 0;
+        for (const auto& [b, child] : trie_[node].children) {
+            if (b == data[i]) { next = child; break; }
+        }
+        if (next == 0) {
+            next = static_cast<uint32_t>(trie_.size());
+            trie_[node].children.push_back({ data[i], next });
+            trie_.emplace_back();
+        }
+        node = next;
+    }
+    trie_[node].outputs.push_back(id);
+    return id;
+}
+
+void AhoCorasick::build() {
+    // Input classes: one per byte value used by any pattern, class 0 for the rest
+    classOf_.fill(0);
+    width_ = 1;
+    for (const auto& node : trie_) {
+        for (const auto& [b, child] : node.children) {
+            if (classOf_[b] == 0) classOf_[b] = static_cast<uint8_t>(width_++);
+        }
+    }
+    // 256 distinct bytes would overflow the uint8_t class index: fall back to identity
+    if (width_ > 256) {
+        for (int b = 0; b < 256; b++) classOf_[b] = static_cast<uint8_t>(b);
+        width_ = 256;
+    }
+
+    size_t states = trie_.size();
+    delta_.assign(states * width_, 0);
+    fail_.assign(states, 0);
+    std::vector<std::vector<uint32_t>> outputs(states);
+
+    // BFS: a state's transitions default to those of its failure state
+    std::queue<uint32_t> queue;
+    outputs[0] = trie_[0].outputs;
+    for (const auto& [b, child] : trie_[0].children) {
+        delta_[classOf_[b]] = child;
+        queue.push(child);
+    }
+    while (!queue.empty()) {
+        uint32_t s = queue.front();
+        queue.pop();
+
+        outputs[s] = trie_[s].outputs;
+        const auto& inherited = outputs[fail_[s]];
+        outputs[s].insert(outputs[s].end(), inherited.begin(), inherited.end());
+
+        for (uint32_t c = 0; c < width_; c++) {
+            delta_[s * width_ + c] = delta_[fail_[s] * width_ + c];
+        }
+        for (const auto& [b, child] : trie_[s].children) {
+            fail_[child] = delta_[fail_[s] * width_ + classOf_[b]];
+            delta_[s * width_ + classOf_[b]] = child;
+            queue.push(child);
+        }
+    }
+
+    // Premultiply targets into row offsets and flag states with outputs,
+    // so scanning needs no output lookup for most bytes
+    for (auto& target : delta_) {
+        uint32_t state = target;
+        target = state * width_ | (outputs[state].empty() ? 0 : OUTPUT_FLAG);
+    }
+
+    outStart_.assign(states + 1, 0);
+    outIds_.clear();
+    for (size_t s = 0; s < states; s++) {
+        outStart_[s] = static_cast<uint32_t>(outIds_.size());
+        outIds_.insert(outIds_.end(), outputs[s].begin(), outputs[s].end());
+    }
+    outStart_[states] = static_cast<uint32_t>(outIds_.size());
+
+    // The trie is no longer needed
+    trie_ = { Node{} };
+}
+
+size_t AhoCorasick::memoryBytes() const {
+    return delta_.capacity() * sizeof(uint32_t) + fail_.capacity() * sizeof(uint32_t) +
+           outStart_.capacity() * sizeof(uint32_t) + outIds_.capacity() * sizeof(uint32_t);
+}
+
+} // namespace maple
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace maple {
+
+// Multi-pattern byte matcher. Patterns are added, build() turns the trie into
+// a full DFA (every state has a transition for every input class), and scan()
+// then reports all occurrences in a single pass: one table lookup per byte.
+// Bytes that occur in no pattern share one input class, which keeps rows short.
+class AhoCorasick {
+public:
+    // Returns the pattern id (sequential from 0). Empty patterns are ignored (id still assigned).
+    uint32_t add(const uint8_t* data, size_t len);
+    void build();
+
+    size_t patternCount() const { return patternLengths_.size(); }
+    size_t stateCount() const { return fail_.size(); }
+    size_t memoryBytes() const;
+
+    // onMatch(patternId, endOffset) for every occurrence; endOffset is one past the last byte
+    template <class F>
+    void scan(const uint8_t* data, size_t len, F&& onMatch) const {
+        if (delta_.empty()) return;
+        uint32_t row = 0;
+        for (size_t i = 0; i < len; i++) {
+            uint32_t next = delta_[row + classOf_[data[i]]];
+            row = next & ~OUTPUT_FLAG;
+            if (next & OUTPUT_FLAG) {
+                uint32_t state = row / width_;
+                for (uint32_t o = outStart_[state]; o < outStart_[state + 1]; o++) {
+                    onMatch(outIds_[o], i + 1);
+                }
+            }
+        }
+    }
+
+private:
+    struct Node {
+        std::vector<std::pair<uint8_t, uint32_t>> children;  // byte -> node, build time only
+        std::vector<uint32_t> outputs;
+    };
+
+    std::vector<Node> trie_{ Node{} };
+    std::vector<uint32_t> patternLengths_;
+
+    // Built automaton
+    std::array<uint8_t, 256> classOf_{};
+    uint32_t width_ = 0;
+    // stateCount * width_ entries: target row offset (state * width_), with
+    // OUTPUT_FLAG set if the target state reports matches
+    static constexpr uint32_t OUTPUT_FLAG = 1u << 31;
+    std::vector<uint32_t> delta_;
+    std::vector<uint32_t> fail_;
+    std::vector<uint32_t> outStart_;   // stateCount + 1 offsets into outIds_
+    std::vector<uint32_t> outIds_;
+};
+
+} // namespace maple
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace maple {
+
+// Little-endian binary writer for sidecar/state files
+class BinaryWriter {
+public:
+    explicit BinaryWriter(std::ostream& os) : os_(os) {}
+
+    void u8(uint8_t v) { os_.put(static_cast<char>(v)); }
+    void u16(uint16_t v) { uint8_t b[2] = { static_cast<uint8_t>(v), static_cast<uint8_t>(v >> 8) }; raw(b, 2); }
+    void u32(uint32_t v) {
+        uint8_t b[4];
+        for (int i = 0; i < 4; i++) b[i] = static_cast<uint8_t>(v >> (i * 8));
+        raw(b, 4);
+    }
+    void u64(uint64_t v) {
+        uint8_t b[8];
+        for (int i = 0; i < 8; i++) b[i] = static_cast<uint8_t>(v >> (i * 8));
+        raw(b, 8);
+    }
+    void i64(int64_t v) { u64(static_cast<uint64_t>(v)); }
+    void f64(double v) { uint64_t bits; std::memcpy(&bits, &v, 8); u64(bits); }
+
+    // LEB128 unsigned varint (used for delta-encoded offset lists)
+    void varint(uint64_t v) {
+        while (v >= 0x80) {
+            u8(static_cast<uint8_t>(v | 0x80));
+            v >>= 7;
+        }
+        u8(static_cast<uint8_t>(v));
+    }
+
+    void str(const std::string& s) { u32(static_cast<uint32_t>(s.size())); raw(s.data(), s.size()); }
+    void bytes(const std::vector<uint8_t>& v) { u32(static_cast<uint32_t>(v.size())); raw(v.data(), v.size()); }
+    void raw(const void* data, size_t len) { os_.write(static_cast<const char*>(data), static_cast<std::streamsize>(len)); }
+
+    bool ok() const { return os_.good(); }
+
+private:
+    std::ostream& os_;
+};
+
+// Little-endian binary reader. Reads past EOF return zero and clear ok().
+class BinaryReader {
+public:
+    explicit BinaryReader(std::istream& is) : is_(is) {}
+
+    uint8_t u8() { uint8_t b = 0; raw(&b, 1); return b; }
+    uint16_t u16() { uint8_t b[2]{}; raw(b, 2); return static_cast<uint16_t>(b[0] | (b[1] << 8)); }
+    uint32_t u32() {
+        uint8_t b[4]{};
+        raw(b, 4);
+        return static_cast<uint32_t>(b[0]) | (static_cast<uint32_t>(b[1]) << 8) |
+               (static_cast<uint32_t>(b[2]) << 16) | (static_cast<uint32_t>(b[3]) << 24);
+    }
+    uint64_t u64() {
+        uint8_t b[8]{};
+        raw(b, 8);
+        uint64_t v = 0;
+        for (int i = 7; i >= 0; i--) v = (v << 8) | b[i];
+        return v;
+    }
+    int64_t i64() { return static_cast<int64_t>(u64()); }
+    double f64() { uint64_t bits = u64(); double v; std::memcpy(&v, &bits, 8); return v; }
+
+    uint64_t varint() {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64 && ok_; shift += 7) {
+            uint8_t b = u8();
+            v |= static_cast<uint64_t>(b & 0x7F) << shift;
+            if ((b & 0x80) == 0) break;
+        }
+        return v;
+    }
+
+    // maxLen guards against allocating garbage sizes from a corrupt file
+    std::string str(uint32_t maxLen = 1 << 20) {
+        uint32_t len = u32();
+        if (!ok_ || len > maxLen) { ok_ = false; return {}; }
+        std::string s(len, '\0');
+        raw(s.data(), len);
+        return s;
+    }
+    std::vector<uint8_t> bytes(uint32_t maxLen = 1 << 28) {
+        uint32_t len = u32();
+        if (!ok_ || len > maxLen) { ok_ = false; return {}; }
+        std::vector<uint8_t> v(len);
+        raw(v.data(), len);
+        return v;
+    }
+    void raw(void* data, size_t len) {
+        if (!ok_) { std::memset(data, 0, len); return; }
+        is_.read(static_cast<char*>(data), static_cast<std::streamsize>(len));
+        if (static_cast<size_t>(is_.gcount()) != len) {
+            ok_ = false;
+            std::memset(data, 0, len);
+        }
+    }
+
+    bool ok() const { return ok_; }
+
+private:
+    std::istream& is_;
+    bool ok_ = true;
+};
+
+} // namespace maple
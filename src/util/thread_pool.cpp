@@ -0,0 +1,107 @@
+#include "thread_pool.h"
+#include "../metrics/trace.h"
+#include <exception>
+#include <iostream>
+#include <string>
+
+namespace maple {
+
+// Pool and worker index owning the current thread (nullptr outside any pool)
+static thread_local const ThreadPool* tlsPool = nullptr;
+static thread_local size_t tlsWorker = 0;
+
+ThreadPool::ThreadPool(size_t threads) {
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    if (threads == 0) threads = 1;
+
+    for (size_t i = 0; i < threads; i++) {
+        queues_.push_back(std::make_unique<Queue>());
+    }
+    for (size_t i = 0; i < threads; i++) {
+        workers_.emplace_back([this, i] { workerLoop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(stateMutex_);
+        stopping_ = true;
+    }
+    workCv_.notify_all();
+    for (auto& t : workers_) t.join();
+}
+
+void ThreadPool::submit(Task task) {
+    size_t target = tlsPool == this ? tlsWorker
+                                    : nextQueue_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+    outstanding_.fetch_add(1);
+    {
+        // Count before pushing so queued_ never underflows; under stateMutex_
+        // so a worker about to sleep cannot miss it
+        std::lock_guard<std::mutex> lock(stateMutex_);
+        queued_.fetch_add(1);
+    }
+    {
+        std::lock_guard<std::mutex> lock(queues_[target]->mutex);
+        queues_[target]->tasks.push_back(std::move(task));
+    }
+    workCv_.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(stateMutex_);
+    idleCv_.wait(lock, [this] { return outstanding_.load() == 0; });
+}
+
+bool ThreadPool::popLocal(size_t index, Task& task) {
+    Queue& q = *queues_[index];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (q.tasks.empty()) return false;
+    task = std::move(q.tasks.back());
+    q.tasks.pop_back();
+    return true;
+}
+
+bool ThreadPool::steal(size_t thief, Task& task) {
+    for (size_t n = 1; n < queues_.size(); n++) {
+        Queue& q = *queues_[(thief + n) % queues_.size()];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (q.tasks.empty()) continue;
+        task = std::move(q.tasks.front());
+        q.tasks.pop_front();
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(size_t index) {
+    tlsPool = this;
+    tlsWorker = index;
+    Tracer::setThreadName("pool-" + std::to_string(index));
+
+    while (true) {
+        Task task;
+        if (popLocal(index, task) || steal(index, task)) {
+            queued_.fetch_sub(1);
+            try {
+                task();
+            } catch (const std::exception& e) {
+                std::cerr << "[ThreadPool] Task failed: " << e.what() << std::endl;
+            } catch (...) {
+                std::cerr << "[ThreadPool] Task failed" << std::endl;
+            }
+            task = nullptr;
+            if (outstanding_.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> lock(stateMutex_);
+                idleCv_.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(stateMutex_);
+        workCv_.wait(lock, [this] { return stopping_ || queued_.load() > 0; });
+        if (stopping_ && queued_.load() == 0) return;
+    }
+}
+
+} // namespace maple
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace maple {
+
+// Fixed-size work-stealing thread pool.
+// Each worker owns a deque: it pops its own newest task (LIFO, cache-warm) and
+// steals the oldest task of a busy peer when idle, so a few huge jobs mixed with
+// many small ones still keep every core busy.
+class ThreadPool {
+public:
+    using Task = std::function<void()>;
+
+    // threads == 0: one worker per hardware thread
+    explicit ThreadPool(size_t threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Queue a task. Called from a worker, it lands on that worker's own deque.
+    void submit(Task task);
+
+    // Block until every submitted task (including ones they submitted) has finished
+    void wait();
+
+    size_t size() const { return workers_.size(); }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void workerLoop(size_t index);
+    bool popLocal(size_t index, Task& task);
+    bool steal(size_t thief, Task& task);
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> workers_;
+
+    std::mutex stateMutex_;
+    std::condition_variable workCv_;   // new task or shutdown
+    std::condition_variable idleCv_;   // outstanding_ reached zero
+    std::atomic<size_t> outstanding_{0};  // submitted but not finished
+    std::atomic<size_t> queued_{0};       // submitted but not started
+    std::atomic<size_t> nextQueue_{0};
+    bool stopping_ = false;
+};
+
+} // namespace maple